@@ -0,0 +1,136 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef AVI_WRITER_HPP
+#define AVI_WRITER_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "develope_queue.hpp"
+#include "frame_file.hpp"
+
+// AVI 1.0 keeps 32 bit offsets and many players stop reading at 1 GiB; longer captures roll over to a new part
+#define AVI_PART_MAX_BYTES (1024ull * 1024 * 1024)
+// Frames between index checkpoints, 0 checkpoints once per second of video
+#define AVI_CHECKPOINT_FRAMES 0
+
+// <directory>capture_<YYYY-mm-dd-HH-MM-SS>, the base path of a session
+std::string timestamped_capture_path(const std::string& directory);
+
+// One MJPEG AVI file, written as frames arrive
+// checkpoint() puts idx1 and the frame counts on disk, so a killed process leaves a file
+// that plays up to its last checkpoint; the next frame overwrites that idx1 after the
+// header has been rewritten without AVIF_HASINDEX
+class MjpegAviWriter {
+public:
+  MjpegAviWriter() = default;
+  ~MjpegAviWriter() { close(); }
+  MjpegAviWriter(const MjpegAviWriter&) = delete;
+  MjpegAviWriter& operator=(const MjpegAviWriter&) = delete;
+
+  bool open(const std::string& path, int width, int height, int fps);
+  // One JPEG from its segments; the frame index in this file, -1 when the write failed
+  int64_t append(const FrameSegment* segments, size_t count);
+  bool checkpoint(bool sync);
+  void close();
+
+  bool is_open() const { return file_.is_open(); }
+  uint32_t frames() const { return static_cast<uint32_t>(index_.size()); }
+  // File size once the index is written
+  uint64_t size() const { return movi_end_ + 8 + 16 * index_.size(); }
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+private:
+  struct IndexEntry {
+    uint32_t offset;   // from the 'movi' fourcc
+    uint32_t size;
+  };
+
+  // indexed: idx1 follows the movi list and AVIF_HASINDEX is set
+  std::vector<u_char> header(bool indexed) const;
+
+  SegmentFile file_;
+  std::vector<IndexEntry> index_;
+  std::vector<FrameSegment> chunk_;
+  std::vector<u_char> index_buffer_;
+  uint64_t movi_end_ = 0;
+  bool index_written_ = false;   // the idx1 at movi_end_ is what the header on disk points at
+  uint32_t max_frame_size_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+  int fps_ = 30;
+};
+
+// Captured frames of a session in <base>.avi (then <base>_001.avi ...), with <base>.csv
+// mapping every frame number and its error codes to the part and index it was stored at
+// Develop workers finish frames out of order; frames are stored in develop_sequence order,
+// a frame that arrives before the ones popped ahead of it is copied and held until they are done
+class CaptureContainer {
+public:
+  ~CaptureContainer() { close(); }
+
+  // first_sequence: develop_sequence of the first frame popped after open; earlier ones are stored as they come
+  bool open(const std::string& base_path, int fps, int checkpoint_frames = AVI_CHECKPOINT_FRAMES,
+            uint64_t first_sequence = 1);
+  bool write_frame(const DevelopFrameFormat& frame_format, const FrameSegment* segments, size_t count);
+  // Every popped frame reports here once developed, stored or not, so the frames after it can follow
+  void frame_done(uint64_t develop_sequence);
+  // Stores what is still held, then writes the index
+  void close();
+
+  bool is_open();
+  uint64_t frames_written();
+
+private:
+  struct HeldFrame {
+    DevelopFrameFormat format;
+    std::vector<u_char> data;
+  };
+
+  bool open_part(int width, int height);
+  bool store_locked(const DevelopFrameFormat& frame_format, const FrameSegment* segments, size_t count);
+  void store_held_locked(const HeldFrame& held);
+
+  std::mutex mutex_;
+  MjpegAviWriter avi_;
+  std::ofstream sidecar_;
+  std::string base_path_;
+  std::string part_path_;
+  int part_ = -1;
+  int fps_ = 30;
+  int checkpoint_frames_ = 30;
+  uint64_t frames_written_ = 0;
+  bool open_ = false;
+  uint64_t next_sequence_ = 1;
+  std::map<uint64_t, HeldFrame> held_;
+  std::set<uint64_t> done_;   // finished ahead of next_sequence_
+};
+
+#endif // AVI_WRITER_HPP
@@ -22,20 +22,40 @@
 #ifndef DEVELOP_PHOTO_HPP
 #define DEVELOP_PHOTO_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <mutex>
-#include <queue>
-#ifdef __linux__
-#include <condition_variable>
-#endif
+#include <thread>
+
+#include "avi_writer.hpp"
+#include "develope_queue.hpp"
+#include "raw_frame_store.hpp"
+#include "validuvc/control_config.hpp"
 
 #ifdef _WIN32
   typedef unsigned char u_char;
 #endif
 
+// How YUYV frames become JPEG files
+enum YuyvJpegPath : uint8_t {
+  YUYV_JPEG_PLANES = 0,   // split into 4:2:2 planes and compressed as is
+  YUYV_JPEG_RGB = 1       // through RGB24 at 4:4:4, the format agnostic path for debugging
+};
+
+// Where developed frames go
+enum DevelopOutput : uint8_t {
+  DEVELOP_OUTPUT_JPEG = 0,   // one ./images/frame_<n>.jpg per frame
+  DEVELOP_OUTPUT_AVI = 1,    // appended to the CaptureContainer opened by open_container()
+  DEVELOP_OUTPUT_NONE = 2    // nothing on disk; FramePreview and the raw store still get the frame
+};
+
+// "jpg", "avi", "none"
+bool parse_develop_output(const char* name, DevelopOutput& output);
+
 class DevFImage{
 public:
   static DevFImage& instance(){
@@ -43,27 +63,64 @@ public:
     return devfimage;
   }
 
-  struct DevFImageFormat{
-    int frame_number;
-    int width;
-    int height;
-    std::string format;
-  };
+  using DevFImageFormat = DevelopFrameFormat;
+
+  // Frames handed over by ValidFrame::push_queue, drained by the develop workers
+  DevelopQueue dev_f_image_queue;
 
-  std::mutex dev_f_image_mutex;
-  std::condition_variable dev_f_image_cv;
-  std::queue<std::vector<std::vector<u_char>>> dev_f_image_queue;
-  std::queue<DevFImageFormat> dev_f_image_format_queue;
+  // workers <= 0 picks from the core count; a running pool is stopped first
+  void start_workers(int workers);
+  // drain develops what is still queued, otherwise it is discarded
+  void stop_workers(bool drain);
+  int worker_count();
+  uint64_t developed_frames() const { return developed.load(std::memory_order_relaxed); }
+
+  // False when the frame was dropped by the queue policy
+  bool queue_frame(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>&& frame_data);
+
+  std::atomic<YuyvJpegPath> yuyv_jpeg_path{YUYV_JPEG_PLANES};
+  std::atomic<DevelopOutput> develop_output{DEVELOP_OUTPUT_JPEG};
+
+  // Switches to DEVELOP_OUTPUT_AVI: <base_path>.avi and its <base_path>.csv sidecar
+  bool open_container(const std::string& base_path, int fps);
+  // Writes the final index and goes back to one JPEG per frame
+  void close_container();
+
+  // Exact frame bytes to <base_path>.uvcraw / .uvcridx next to whatever develop_output writes
+  bool open_raw_store(const std::string& base_path, RawStoreMode mode);
+  void close_raw_store();
+  uint64_t raw_frames() const { return raw_store.frames(); }
 
   void u_char_to_jpg(const std::vector<std::vector<u_char>>& binary_data, const std::string& output_jpg_path);
   void develope_photo(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data);
 
-  void develope_mjpeg_to_jpg(std::vector<std::vector<u_char>>& binary_data, const std::string& output_jpg_path);
-  void develope_rgb_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path);
-  void develope_yuyv_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path);
+  bool develope_mjpeg_to_jpg(std::vector<std::vector<u_char>>& binary_data, const std::string& output_jpg_path);
+  bool develope_rgb_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path);
+  bool develope_yuyv_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path);
+  bool develope_to_container(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data);
+
+  // Compress into JpegEncoder::thread_instance()
+  bool encode_rgb_jpeg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data);
+  bool encode_yuyv_jpeg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data);
+  bool encode_yuyv_planes_jpeg(const DevFImageFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data);
 
 private:
+  void develop_worker();
+
+  std::mutex workers_mutex;
+  std::vector<std::thread> workers;
+  std::atomic<bool> workers_running{false};
+  std::atomic<uint64_t> developed{0};
+  CaptureContainer container;
+  RawFrameWriter raw_store;
+  std::atomic<RawStoreMode> raw_store_mode{RAW_STORE_OFF};
+
   DevFImage() = default;
+  ~DevFImage() {
+    stop_workers(false);
+    close_container();
+    close_raw_store();
+  }
   DevFImage(const DevFImage&) = delete;
   DevFImage& operator=(const DevFImage&) = delete;
 };
@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef DEVELOP_QUEUE_HPP
+#define DEVELOP_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "validuvc/control_config.hpp"
+
+#ifdef _WIN32
+  typedef unsigned char u_char;
+#endif
+
+// Frames waiting for a develop worker; one 1080p YUYV frame is about 4 MB
+#define DEVELOP_QUEUE_DEFAULT_CAPACITY 8
+#define DEVELOP_MAX_WORKERS 16
+
+// What a full queue does with the next frame
+enum DevelopDropPolicy : uint8_t {
+  DEVELOP_BLOCK = 0,          // the producer waits for a free slot
+  DEVELOP_DROP_NEWEST = 1,    // the incoming frame is discarded
+  DEVELOP_DROP_OLDEST = 2,    // the oldest queued frame makes room
+  DEVELOP_KEEP_ERRORS = 3     // the oldest valid frame makes room; valid frames never push out error frames
+};
+
+const char* develop_drop_policy_name(DevelopDropPolicy policy);
+// "block", "newest", "oldest", "errors"
+bool parse_develop_drop_policy(const char* name, DevelopDropPolicy& policy);
+
+struct DevelopFrameFormat {
+  int frame_number;
+  int width;
+  int height;
+  FrameFormat format;
+  uint64_t queued_tick = 0;   // PipelineClock tick at push, 0 when not measured
+  bool error_frame = false;   // error or suspicious frame, kept first by DEVELOP_KEEP_ERRORS
+  int frame_error = 0;        // FrameError
+  int frame_suspicious = 0;   // FrameSuspicious
+  uint32_t pts = 0;
+  int64_t first_received_ns = 0;   // steady clock, first and last payload of the frame
+  int64_t last_received_ns = 0;
+  uint64_t develop_sequence = 0;   // pop order from DevelopQueue, starting at 1; 0 when developed outside the queue
+};
+
+struct DevelopJob {
+  DevelopFrameFormat format;
+  std::vector<std::vector<u_char>> data;
+};
+
+struct DevelopQueueStats {
+  size_t depth = 0;
+  size_t capacity = 0;
+  size_t high_water = 0;        // deepest the queue has been since the last reset
+  uint64_t queued = 0;
+  uint64_t dropped = 0;         // frames lost to the policy, incoming or evicted
+  uint64_t dropped_errors = 0;  // of those, error or suspicious frames
+  uint64_t blocked = 0;         // pushes that had to wait under DEVELOP_BLOCK
+};
+
+// Bounded queue shared by every producer (checkers) and every develop worker
+class DevelopQueue {
+public:
+  explicit DevelopQueue(size_t capacity = DEVELOP_QUEUE_DEFAULT_CAPACITY, DevelopDropPolicy policy = DEVELOP_KEEP_ERRORS);
+
+  // Frames already queued beyond a smaller capacity are kept until popped
+  void configure(size_t capacity, DevelopDropPolicy policy);
+  size_t capacity() const;
+  DevelopDropPolicy policy() const;
+
+  // True when the incoming frame was queued
+  // may_block false turns DEVELOP_BLOCK into DEVELOP_DROP_NEWEST (no worker to make room)
+  bool push(DevelopJob&& job, bool may_block = true);
+
+  // Waits for a frame; false once the queue is closed and empty
+  // Each popped frame gets the next develop_sequence
+  bool pop(DevelopJob& job);
+  bool try_pop(DevelopJob& job);
+  // develop_sequence of the last popped frame
+  uint64_t popped() const;
+
+  // Wakes every waiter; pushes are dropped until reopen(), pops drain what is left
+  void close();
+  void reopen();
+  size_t clear();
+
+  DevelopQueueStats stats() const;
+  void reset_stats();
+
+private:
+  void drop_locked(const DevelopJob& job);
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<DevelopJob> jobs_;
+  size_t capacity_;
+  DevelopDropPolicy policy_;
+  bool closed_ = false;
+  uint64_t popped_ = 0;
+  DevelopQueueStats stats_;
+};
+
+#endif // DEVELOP_QUEUE_HPP
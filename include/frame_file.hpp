@@ -0,0 +1,89 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef FRAME_FILE_HPP
+#define FRAME_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+  typedef unsigned char u_char;
+#endif
+
+struct FrameSegment {
+  const u_char* data;
+  size_t size;
+};
+
+// Writes one image file from its segments (payload chunks, or one encoded buffer)
+// Linux hands every segment to the kernel in one writev; no user space copy is made
+bool write_frame_file(const std::string& path, const FrameSegment* segments, size_t count);
+bool write_frame_file(const std::string& path, const std::vector<std::vector<u_char>>& segments);
+
+// 0 (default) leaves write back to the kernel; N keeps each thread's files open and
+// syncs them, and their directory, once every N frames
+// A batch is synced early when all threads together hold a quarter of RLIMIT_NOFILE
+void set_frame_fsync_every(int frames);
+int frame_fsync_every();
+
+// Syncs and closes the files of this thread still waiting for their batch
+// Runs on its own when the thread exits
+void sync_frame_files();
+
+// A file written at explicit offsets, for container writers that patch their headers
+// Consecutive writes at the end of the file skip the seek
+class SegmentFile {
+public:
+  SegmentFile() = default;
+  ~SegmentFile() { close(); }
+  SegmentFile(const SegmentFile&) = delete;
+  SegmentFile& operator=(const SegmentFile&) = delete;
+
+  // Creates or truncates; direct asks for O_DIRECT (aligned buffers, offsets and sizes only)
+  // and quietly falls back to buffered I/O where the file system refuses it
+  bool open(const std::string& path, bool direct = false);
+  bool is_open() const;
+  bool direct() const { return direct_; }
+  // Reserves blocks without changing the file size (fallocate KEEP_SIZE); false where unsupported
+  bool preallocate(uint64_t offset, uint64_t length);
+  bool truncate(uint64_t size);
+  bool write_at(uint64_t offset, const FrameSegment* segments, size_t count);
+  bool write_at(uint64_t offset, const void* data, size_t size);
+  bool sync();
+  void close();
+
+private:
+#ifdef _WIN32
+  FILE* file_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  uint64_t position_ = 0;
+  bool direct_ = false;
+};
+
+#endif // FRAME_FILE_HPP
@@ -0,0 +1,137 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef FRAME_PREVIEW_HPP
+#define FRAME_PREVIEW_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "develope_queue.hpp"
+
+// Previews are reduced by 1/2, 1/4 or 1/8 while they still cover this size (the GUI draws 288 x 162)
+#define PREVIEW_TARGET_WIDTH 320
+#define PREVIEW_TARGET_HEIGHT 180
+// Previews kept for the GUI log, about 170 KB each at the target size
+#define PREVIEW_CACHE_FRAMES 128
+
+// Decoded RGB24 pixels of one developed frame
+struct PreviewFrame {
+  int frame_number = -1;
+  int width = 0;
+  int height = 0;
+  int scale = 1;             // frame width / width
+  bool error_frame = false;
+  std::vector<u_char> rgb;   // width * height * 3, tightly packed
+};
+
+// Least recently used previews by frame number; shared_ptr lets a reader keep one past eviction
+class PreviewCache {
+public:
+  explicit PreviewCache(size_t capacity = PREVIEW_CACHE_FRAMES) : capacity_(capacity) {}
+
+  void set_capacity(size_t capacity);
+  // Replaces an older preview of the same frame number
+  void put(std::shared_ptr<const PreviewFrame> frame);
+  // nullptr when the frame was never cached or already evicted; a hit becomes the most recent
+  std::shared_ptr<const PreviewFrame> get(int frame_number);
+  void clear();
+  size_t size();
+
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+  // Bumped by every put; a poller waiting for a frame only looks again once it moved
+  uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+private:
+  void evict_locked();
+
+  std::mutex mutex_;
+  size_t capacity_;
+  std::list<std::shared_ptr<const PreviewFrame>> order_;   // most recent first
+  std::unordered_map<int, std::list<std::shared_ptr<const PreviewFrame>>::iterator> frames_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> generation_{0};
+};
+
+// Latest developed frame, handed to the GUI in memory instead of through a JPEG file
+// Triple buffered: the develop side fills its back buffer and swaps it with the middle one,
+// the GUI swaps the middle one into its front buffer; neither side waits on the other
+class FramePreview {
+public:
+  static FramePreview& instance();
+
+  // Nothing is decoded until a viewer turns the preview on
+  void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  // Only error and suspicious frames (the ones the GUI log offers), or every frame
+  void set_errors_only(bool errors_only) { errors_only_.store(errors_only, std::memory_order_relaxed); }
+  bool wants(const DevelopFrameFormat& frame_format) const;
+  // Size a preview should still cover; 0 x 0 keeps full resolution
+  void set_target_size(int width, int height);
+  // 1, 2, 4 or 8
+  int scale_for(int width, int height) const;
+
+  // Develop side: decodes MJPEG at a TurboJPEG scaling factor, box filters YUYV or copies RGB,
+  // caches the preview and publishes it into the back buffer
+  // The slot is skipped (the cache is not) while another worker publishes, rather than waited for
+  bool publish(const DevelopFrameFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data);
+
+  // Any thread: the cached preview of a frame
+  std::shared_ptr<const PreviewFrame> find(int frame_number) { return cache.get(frame_number); }
+  PreviewCache cache;
+
+  // GUI side, one reader: true when a newer frame replaced front()
+  bool acquire();
+  const PreviewFrame& front() const { return buffers_[front_]; }
+
+  uint64_t published_frames() const { return published_.load(std::memory_order_relaxed); }
+
+private:
+  FramePreview() = default;
+  FramePreview(const FramePreview&) = delete;
+  FramePreview& operator=(const FramePreview&) = delete;
+
+  bool decode(const DevelopFrameFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data, PreviewFrame& out);
+
+  static constexpr uint8_t kFresh = 0x4;
+
+  PreviewFrame buffers_[3];
+  std::mutex writer_mutex_;
+  int back_ = 0;                          // writer_mutex_
+  std::atomic<uint8_t> middle_{1};        // buffer index | kFresh once published and not yet acquired
+  int front_ = 2;                         // reader only
+  std::atomic<bool> enabled_{false};
+  std::atomic<bool> errors_only_{true};
+  std::atomic<int> target_width_{PREVIEW_TARGET_WIDTH};
+  std::atomic<int> target_height_{PREVIEW_TARGET_HEIGHT};
+  std::atomic<uint64_t> published_{0};
+};
+
+#endif // FRAME_PREVIEW_HPP
@@ -32,6 +32,7 @@
 #include "backends/imgui_impl_opengl3.h"
 #include "window_manager.hpp"
 #include "dearimgui.hpp"
+#include "frame_preview.hpp"
 #include <atomic>
 
 void addErrorFrameLog(const std::string& efn);
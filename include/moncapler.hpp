@@ -48,6 +48,9 @@
 #endif
 
 #include "utils/logger.hpp"
+#include "utils/metrics.hpp"
+#include "utils/pipeline_latency.hpp"
+#include "utils/trace_probes.hpp"
 #include "utils/verbose.hpp"
 #include "validuvc/control_config.hpp"
 #include "validuvc/uvcpheader_checker.hpp"
@@ -71,6 +74,7 @@ extern std::mutex time_mutex;
 extern std::queue<std::vector<u_char>> packet_queue;
 extern std::mutex queue_mutex;
 extern std::condition_variable queue_cv;
+extern std::queue<uint64_t> packet_queue_ticks;
 extern bool stop_processing;
 
 extern int log_verbose_level;
@@ -181,6 +185,8 @@ void print_capture_statistics(const pcap_stat& stats,
                               unsigned long long filtered_total_captured_length,
                               std::ofstream* log_file = nullptr);
 void clean_exit(int signum);
+void print_exit_statistics();
+void collect_capture_metrics(MetricsWriter& out);
 std::string getCurrentTimeFormatted();
 std::string convertToKST(double unix_timestamp);
 void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
@@ -23,6 +23,8 @@
 #ifndef MONCAPWER_HPP
 #define MONCAPWER_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <csignal>
@@ -44,7 +46,15 @@
 #include "validuvc/uvcpheader_checker.hpp"
 #include "validuvc/device_info.hpp"
 #include "utils/verbose.hpp"
+#include "utils/hex_bytes.hpp"
+#include "utils/log_sink.hpp"
+#include "utils/metrics.hpp"
+#include "utils/pipeline_latency.hpp"
+#include "utils/trace_export.hpp"
+#include "utils/trace_probes.hpp"
 #include "develope_photo.hpp"
+#include "frame_file.hpp"
+#include "rgb_to_jpeg.hpp"
 
 #ifdef TUI_SET
 #include "utils/tui_win.hpp"
@@ -55,9 +65,8 @@
 void clean_exit(int signum);
 std::vector<std::string> split(const std::string& s, char delimiter);
 std::chrono::time_point<std::chrono::steady_clock> convert_epoch_to_time_point(double frame_time_epoch);
-void hex_string_to_bytes_append(const std::string& hex_str, std::vector<u_char>& out_vec);
 void capture_packets();
 void process_packets();
-void develope_frame_image();
+void collect_pipeline_metrics(MetricsWriter& out);
 
 #endif // MONCAPWER_HPP
\ No newline at end of file
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef RAW_FRAME_STORE_HPP
+#define RAW_FRAME_STORE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "develope_queue.hpp"
+#include "frame_file.hpp"
+#include "validuvc/control_config.hpp"
+
+// Exact frame bytes (payload data without headers) for pixel level analysis
+// All integers little endian
+//
+//   <base>.uvcraw   header block "UVCFDRAW", u32 version, u32 header size, u32 alignment, zero padded
+//                   to the alignment; every frame starts on an aligned offset and is zero padded
+//   <base>.uvcridx  "UVCFDRIX", u32 version, u32 header size, u32 entry size, then one entry per frame:
+//                   u32 frame number, u8 format (FrameFormat), u8 0, u16 frame error, u16 frame suspicious,
+//                   u16 width, u16 height, u16 0, u64 offset, u32 size, u32 PTS,
+//                   i64 first and last payload received time (steady clock ns)
+//
+// An entry is only appended once its frame is written, so a killed process leaves a usable pair
+#define RAW_FRAME_MAGIC "UVCFDRAW"
+#define RAW_FRAME_INDEX_MAGIC "UVCFDRIX"
+#define RAW_FRAME_VERSION 1
+#define RAW_FRAME_ALIGN 4096
+#define RAW_FRAME_INDEX_HEADER 20
+#define RAW_FRAME_INDEX_ENTRY 48
+// Blocks reserved ahead of the writer, so appends do not allocate on the way
+#define RAW_FRAME_PREALLOCATE (256ull * 1024 * 1024)
+
+// Which captured frames go to the raw store
+enum RawStoreMode : uint8_t {
+  RAW_STORE_OFF = 0,
+  RAW_STORE_ERRORS = 1,   // error and suspicious frames
+  RAW_STORE_ALL = 2
+};
+
+bool parse_raw_store_mode(const char* name, RawStoreMode& mode);
+
+struct RawFrameEntry {
+  uint32_t frame_number = 0;
+  FrameFormat format = FRAME_FORMAT_MJPEG;
+  uint16_t frame_error = 0;
+  uint16_t frame_suspicious = 0;
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint64_t offset = 0;
+  uint32_t size = 0;
+  uint32_t pts = 0;
+  int64_t first_received_ns = 0;
+  int64_t last_received_ns = 0;
+};
+
+// Appends frames to <base>.uvcraw with aligned O_DIRECT writes out of one aligned staging arena
+// Safe to call from every develop worker; frames land in the order they are written
+class RawFrameWriter {
+public:
+  RawFrameWriter() = default;
+  ~RawFrameWriter();
+  RawFrameWriter(const RawFrameWriter&) = delete;
+  RawFrameWriter& operator=(const RawFrameWriter&) = delete;
+
+  bool open(const std::string& base_path, uint64_t preallocate = RAW_FRAME_PREALLOCATE);
+  bool write(const DevelopFrameFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data);
+  void close();
+
+  bool is_open();
+  bool direct();
+  uint64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+  uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+private:
+  bool reserve_arena(size_t size);
+
+  std::mutex mutex_;
+  SegmentFile data_;
+  std::ofstream index_;
+  uint64_t offset_ = 0;         // next aligned frame offset
+  uint64_t allocated_ = 0;      // end of the preallocated range
+  uint64_t preallocate_ = RAW_FRAME_PREALLOCATE;
+  u_char* arena_ = nullptr;     // RAW_FRAME_ALIGN aligned, reused for every frame
+  size_t arena_size_ = 0;
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> bytes_{0};
+};
+
+class RawFrameReader {
+public:
+  // Loads the index; frames are read on demand
+  bool open(const std::string& base_path);
+
+  const std::string& error() const { return error_; }
+  const std::vector<RawFrameEntry>& entries() const { return entries_; }
+  // Last entry with that frame number, nullptr when it was not stored
+  const RawFrameEntry* find(uint32_t frame_number) const;
+  bool read(const RawFrameEntry& entry, std::vector<u_char>& data);
+
+private:
+  std::ifstream data_;
+  uint64_t data_size_ = 0;
+  std::vector<RawFrameEntry> entries_;
+  std::string error_;
+};
+
+#endif // RAW_FRAME_STORE_HPP
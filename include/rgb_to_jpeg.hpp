@@ -25,15 +25,64 @@
 
 #include <string>
 #include <vector>
+#include <turbojpeg.h>
 
 #ifdef _WIN32
 typedef unsigned char u_char;
 #endif
 
+// JPEG output options, changeable while frames are being developed
+struct JpegSettings {
+    int quality = 85;
+    int subsampling = -1;       // TJSAMP_*, -1 keeps the source: 4:4:4 for RGB, 4:2:2 for YUYV planes
+    bool fast_dct = true;       // TJFLAG_FASTDCT, false uses TJFLAG_ACCURATEDCT
+};
+
+JpegSettings jpeg_settings();
+void set_jpeg_settings(const JpegSettings& settings);
+
+// "444", "422", "420", "440", "411", "441", "gray" to TJSAMP_*, "auto" to -1
+bool parse_jpeg_subsampling(const std::string& name, int& subsampling);
+
+// One TurboJPEG compressor and one tjBufSize output buffer per thread, reused for every frame
+// The buffer only grows, and TJFLAG_NOREALLOC keeps TurboJPEG from replacing it
+class JpegEncoder {
+public:
+    static JpegEncoder& thread_instance();
+
+    bool compress_rgb(const u_char* rgb, int width, int height, const JpegSettings& settings);
+    // 4:2:2 planes; 4:2:0 reads every other chroma row and gray only Y, other subsamplings fail
+    bool compress_yuv422(const u_char* planes[3], int width, int height, const JpegSettings& settings);
+
+    // The last image, valid until the next compress call on this thread
+    const u_char* data() const { return buffer_; }
+    unsigned long size() const { return size_; }
+
+    JpegEncoder(const JpegEncoder&) = delete;
+    JpegEncoder& operator=(const JpegEncoder&) = delete;
+
+private:
+    JpegEncoder() = default;
+    ~JpegEncoder();
+
+    bool prepare(int width, int height, int subsampling);
+    int flags(const JpegSettings& settings) const;
+
+    tjhandle handle_ = nullptr;
+    unsigned char* buffer_ = nullptr;
+    unsigned long capacity_ = 0;
+    unsigned long size_ = 0;
+};
+
 std::vector<u_char> readRGBFile(const std::string& filename, int width,
                                 int height);
 
 bool saveJPEG(const std::vector<u_char>& rgbData, int width, int height,
               const std::string& filename);
 
+// Both compress with jpeg_settings() on the calling thread's JpegEncoder
+// 4:2:2 planes (splitYUYVtoPlanes) straight to JPEG, no RGB round trip
+bool saveJPEGFromYUV422(const u_char* planes[3], int width, int height,
+                        const std::string& filename);
+
 #endif  // RTJ_HPP
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef ALLOC_STATS_HPP
+#define ALLOC_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/pipeline_latency.hpp"
+
+// Threads with their own row; later threads share the last one
+#define ALLOC_STATS_MAX_THREADS 32
+// Extra stage slot for allocations outside any ALLOC_STAGE scope
+#define ALLOC_STAGE_UNTAGGED STAGE_COUNT
+#define ALLOC_STAGE_SLOTS (STAGE_COUNT + 1)
+
+class MetricsWriter;
+
+struct AllocCounts {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t freed_bytes = 0;
+
+    AllocCounts& operator+=(const AllocCounts& other) {
+        allocations += other.allocations;
+        frees += other.frees;
+        allocated_bytes += other.allocated_bytes;
+        freed_bytes += other.freed_bytes;
+        return *this;
+    }
+};
+
+// Heap accounting fed by the replaced global operator new / delete (built with
+// -DUVCFD_ALLOC_STATS=ON). Counts are kept per thread and per stage tag; a free
+// is charged to the stage of the thread that frees, not the one that allocated.
+// Without ALLOC_STATS nothing is replaced and every count reads zero.
+class AllocStats {
+public:
+    static AllocStats& instance();
+
+    // Static string shown as the thread label; call once at the top of the thread
+    static void set_thread_name(const char* name);
+
+    static PipelineStage current_stage();
+    static void set_current_stage(PipelineStage stage);
+
+    AllocCounts stage_counts(PipelineStage stage) const;
+    AllocCounts thread_counts(size_t thread_slot) const;
+    size_t thread_slots() const;
+    const char* thread_name(size_t thread_slot) const;
+
+    void print_stats() const;
+    void collect_metrics(MetricsWriter& out) const;
+
+    static const char* stage_name(PipelineStage stage);
+    static bool enabled();
+
+private:
+    AllocStats();
+    ~AllocStats();
+    AllocStats(const AllocStats&) = delete;
+    AllocStats& operator=(const AllocStats&) = delete;
+
+    int metrics_collector_id_;
+};
+
+// Tags every allocation of this thread with a stage until the end of the scope
+class AllocStageScope {
+public:
+    explicit AllocStageScope(PipelineStage stage) : previous_(AllocStats::current_stage()) {
+        AllocStats::set_current_stage(stage);
+    }
+    ~AllocStageScope() { AllocStats::set_current_stage(previous_); }
+
+private:
+    PipelineStage previous_;
+};
+
+#ifdef ALLOC_STATS
+  #define ALLOC_STAGE(stage) AllocStageScope alloc_stage_scope_(stage)
+  #define ALLOC_STATS_ONLY(...) __VA_ARGS__
+#else
+  #define ALLOC_STAGE(stage) ((void)0)
+  #define ALLOC_STATS_ONLY(...)
+#endif
+
+#endif // ALLOC_STATS_HPP
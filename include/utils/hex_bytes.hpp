@@ -0,0 +1,39 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef HEX_BYTES_HPP
+#define HEX_BYTES_HPP
+
+#include <string>
+#include <vector>
+
+// tshark usb.capdata text ("0c8d...") to bytes, appended to out_vec
+// Only even length, valid hex input is expected; this sits on the capture path
+void hex_string_to_bytes_append(const std::string& hex_str, std::vector<unsigned char>& out_vec);
+
+// Same for a character range, so callers splitting a large line need no temporary strings
+void hex_chars_to_bytes_append(const char* hex, size_t length, std::vector<unsigned char>& out_vec);
+
+// Bytes to lower case hex text ("0c8d..."), appended to out_str
+void bytes_to_hex_append(const unsigned char* data, size_t size, std::string& out_str);
+
+#endif // HEX_BYTES_HPP
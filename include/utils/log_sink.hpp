@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef LOG_SINK_HPP
+#define LOG_SINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "utils/mpsc_ring.hpp"
+
+#define LOG_SINK_CAPACITY 16384
+
+enum LogTarget : uint8_t {
+    LOG_TARGET_STREAM = 0,   // std::cout / std::cerr (CLI)
+    LOG_TARGET_FILE = 1,     // Logger file
+    LOG_TARGET_WINDOW = 2    // GUI WindowData
+};
+
+// Copy of the thread's routing state at the moment the text was flushed
+enum LogRecordFlag : uint8_t {
+    LOG_FLAG_PRINT_WHOLE = 1 << 0,
+    LOG_FLAG_FRAME_ERROR = 1 << 1,
+    LOG_FLAG_FRAME_SUSPICIOUS = 1 << 2
+};
+
+struct LogRecord {
+    LogTarget target = LOG_TARGET_STREAM;
+    uint8_t flags = 0;
+    int window = 0;                     // WindowName, used by LOG_TARGET_WINDOW
+    std::ostream* stream = nullptr;     // used by LOG_TARGET_STREAM / LOG_TARGET_FILE
+    std::string text;
+};
+
+// Single writer thread draining a lock-free ring
+// submit() never blocks the caller; when the ring is full the record is dropped and counted
+class LogSink {
+public:
+    static LogSink& instance();
+
+    bool submit(LogRecord&& record);
+
+    // Blocks until everything submitted before the call is written (exit paths, Logger close)
+    void flush();
+
+    uint64_t dropped_records() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t written_records() const { return written_.load(std::memory_order_relaxed); }
+    size_t pending_records() const { return ring_.size_approx(); }
+
+private:
+    LogSink();
+    ~LogSink();
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    void writer_loop();
+    size_t drain();
+    void write_window(LogRecord& record);
+
+    MpscRing<LogRecord, LOG_SINK_CAPACITY> ring_;
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> writer_idle_{false};
+    std::atomic<bool> stop_{false};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable drained_cv_;
+
+    std::thread writer_;
+};
+
+#endif // LOG_SINK_HPP
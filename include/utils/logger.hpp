@@ -57,6 +57,9 @@ private:
     // Private helper to open the log file
     bool open_log_file(const std::string& log_path);
 
+    // Queue one line for the log file
+    void write_file(const std::string& level_name, const std::string& message);
+
     // Ensure log directory exists
     void ensure_log_directory(const std::string& log_dir_path);
 };
@@ -0,0 +1,116 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// Builds one scrape in the Prometheus text format (version 0.0.4)
+// Samples of the same metric are grouped under one HELP / TYPE header
+// no matter which collector wrote them
+class MetricsWriter {
+public:
+    void counter(const std::string& name, const std::string& help, const MetricLabels& labels, int64_t value);
+    void gauge(const std::string& name, const std::string& help, const MetricLabels& labels, double value);
+    // quantiles are (quantile, value) pairs; also writes name_sum and name_count
+    void summary(const std::string& name, const std::string& help, const MetricLabels& labels,
+                 const std::vector<std::pair<double, double>>& quantiles, double sum, uint64_t count);
+
+    std::string str() const;
+
+private:
+    struct Family {
+        std::string name;
+        std::string help;
+        const char* type;
+        std::vector<std::string> samples;
+    };
+
+    Family& family(const std::string& name, const std::string& help, const char* type);
+    static std::string sample_prefix(const std::string& name, const MetricLabels& labels);
+
+    std::vector<Family> families_;
+};
+
+// Process wide list of metric collectors, called on every scrape
+// A collector reads its counters with relaxed loads and must not block the caller
+class MetricsRegistry {
+public:
+    using Collector = std::function<void(MetricsWriter&)>;
+
+    static MetricsRegistry& instance();
+
+    int add_collector(Collector collector);
+    // After this returns the collector is never called again
+    void remove_collector(int id);
+
+    std::string render();
+
+private:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    std::mutex mutex_;
+    std::vector<std::pair<int, Collector>> collectors_;
+    int next_id_ = 0;
+};
+
+// Minimal HTTP/1.0 listener serving MetricsRegistry::render() on GET /metrics
+// Enabled with -metrics [host]:port, one connection at a time on its own thread
+class MetricsServer {
+public:
+    static MetricsServer& instance();
+
+    // "host:port" or ":port" (all interfaces); port 0 picks a free port
+    bool start(const std::string& listen_address);
+    void stop();
+
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    int port() const { return port_; }
+
+private:
+    MetricsServer();
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void serve_loop();
+    void handle_client(intptr_t client);
+
+    intptr_t listen_socket_;
+    int port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread server_thread_;
+};
+
+#endif // METRICS_HPP
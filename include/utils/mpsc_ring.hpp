@@ -0,0 +1,107 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef MPSC_RING_HPP
+#define MPSC_RING_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded multi producer / single consumer ring (Vyukov sequence cells)
+// try_push never blocks: a full ring returns false and the caller decides
+// what to do with the item (LogSink counts it as dropped)
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpscRing capacity must be a power of two");
+
+public:
+    MpscRing() : head_(0), tail_(0) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Any thread
+    bool try_push(T&& item) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only
+    bool try_pop(T& out) {
+        Cell& cell = cells_[tail_ & (Capacity - 1)];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(tail_ + 1) < 0) {
+            return false;  // empty, or the producer has not finished writing yet
+        }
+        out = std::move(cell.value);
+        cell.sequence.store(tail_ + Capacity, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    // Approximate, for statistics only
+    size_t size_approx() const {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = consumed_.load(std::memory_order_relaxed);
+        return head >= tail ? head - tail : 0;
+    }
+
+    // Consumer publishes its position so size_approx() can be read from other threads
+    void publish_consumed() { consumed_.store(tail_, std::memory_order_relaxed); }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    alignas(64) std::array<Cell, Capacity> cells_;
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) size_t tail_;
+    std::atomic<size_t> consumed_{0};
+};
+
+#endif // MPSC_RING_HPP
@@ -0,0 +1,182 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef PIPELINE_LATENCY_HPP
+#define PIPELINE_LATENCY_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #else
+    #include <x86intrin.h>
+  #endif
+  #define PIPELINE_CLOCK_TSC
+#endif
+
+class MetricsWriter;
+
+// Stage boundaries a payload / frame crosses on its way through uvcfd
+enum PipelineStage : uint8_t {
+    STAGE_QUEUE_WAIT = 0,     // capture thread push -> process thread pop (packet_queue)
+    STAGE_VALIDATE = 1,       // payload_valid_ctrl
+    STAGE_DEVELOP_WAIT = 2,   // ValidFrame::push_queue -> develope_photo (dev_f_image_queue)
+    STAGE_DEVELOP = 3,        // develope_photo
+    STAGE_COUNT = 4
+};
+
+// Raw monotonic ticks: the TSC on x86, steady_clock nanoseconds elsewhere
+// Ticks are only turned into nanoseconds when a report is built
+struct PipelineClock {
+    static uint64_t now() {
+#ifdef PIPELINE_CLOCK_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Measured against steady_clock since the first call
+    static double ns_per_tick();
+};
+
+// HDR style histogram: 16 linear sub buckets per power of two (~6% resolution)
+// over the full 64 bit range, relaxed atomics so any thread can record
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    struct Summary {
+        uint64_t count = 0;
+        double p50_ns = 0;
+        double p99_ns = 0;
+        double p999_ns = 0;
+        double max_ns = 0;
+        double sum_ns = 0;
+    };
+
+    void record(uint64_t ticks) {
+        buckets_[bucket_index(ticks)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ticks, std::memory_order_relaxed);
+        uint64_t current_max = max_.load(std::memory_order_relaxed);
+        while (ticks > current_max &&
+               !max_.compare_exchange_weak(current_max, ticks, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Percentiles report the highest value of the bucket, capped at the recorded max
+    uint64_t percentile_ticks(double quantile) const;
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max_ticks() const { return max_.load(std::memory_order_relaxed); }
+    Summary summary() const;
+
+    static size_t bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        int exponent = highest_bit(value);
+        return static_cast<size_t>(exponent - SUB_BITS + 1) * SUB_BUCKETS +
+               static_cast<size_t>((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+    static uint64_t bucket_upper(size_t index);
+
+private:
+    static int highest_bit(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Process wide histograms, one per stage, reported by print_stats(), the GUI
+// Statistics window and the metrics endpoint
+class PipelineLatency {
+public:
+    static PipelineLatency& instance();
+
+    void record(PipelineStage stage, uint64_t start_tick) {
+        uint64_t end_tick = PipelineClock::now();
+        // a start taken on another core can read slightly ahead
+        histograms_[stage].record(end_tick > start_tick ? end_tick - start_tick : 0);
+    }
+
+    const LatencyHistogram& histogram(PipelineStage stage) const { return histograms_[stage]; }
+
+    void print_stats() const;
+    void collect_metrics(MetricsWriter& out) const;
+
+    static const char* stage_name(PipelineStage stage);
+
+private:
+    PipelineLatency();
+    ~PipelineLatency();
+    PipelineLatency(const PipelineLatency&) = delete;
+    PipelineLatency& operator=(const PipelineLatency&) = delete;
+
+    std::array<LatencyHistogram, STAGE_COUNT> histograms_;
+    int metrics_collector_id_;
+};
+
+// Records the time from construction to the end of the scope
+class PipelineStageScope {
+public:
+    explicit PipelineStageScope(PipelineStage stage) : stage_(stage), start_(PipelineClock::now()) {}
+    ~PipelineStageScope() { PipelineLatency::instance().record(stage_, start_); }
+
+private:
+    PipelineStage stage_;
+    uint64_t start_;
+};
+
+// Built with -DUVCFD_PIPELINE_LATENCY=OFF every probe below compiles to nothing
+#ifdef PIPELINE_LATENCY
+  #define PIPELINE_STAMP() PipelineClock::now()
+  #define PIPELINE_RECORD(stage, start_tick) PipelineLatency::instance().record((stage), (start_tick))
+  #define PIPELINE_SCOPE(stage) PipelineStageScope pipeline_stage_scope_(stage)
+  #define PIPELINE_LATENCY_ONLY(...) __VA_ARGS__
+#else
+  #define PIPELINE_STAMP() uint64_t(0)
+  #define PIPELINE_RECORD(stage, start_tick) ((void)0)
+  #define PIPELINE_SCOPE(stage) ((void)0)
+  #define PIPELINE_LATENCY_ONLY(...)
+#endif
+
+#endif // PIPELINE_LATENCY_HPP
@@ -0,0 +1,80 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef SHARDED_COUNTER_HPP
+#define SHARDED_COUNTER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define SHARDED_COUNTER_SHARDS 8
+
+// 64 bit event counter split over cache line sized shards
+// Each thread adds into its own shard, so the capture, processing and develop
+// threads never bounce a line between cores; value() sums the shards
+class ShardedCounter {
+public:
+    ShardedCounter() = default;
+    ShardedCounter(const ShardedCounter&) = delete;
+    ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+    void add(int64_t n) {
+        shards_[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    ShardedCounter& operator++() {
+        add(1);
+        return *this;
+    }
+    void operator++(int) { add(1); }
+    ShardedCounter& operator+=(int64_t n) {
+        add(n);
+        return *this;
+    }
+
+    // Exact once writers are quiet; while they run it is a value the counter
+    // passed through between the first and the last shard read
+    int64_t value() const {
+        int64_t sum = 0;
+        for (const Shard& shard : shards_) {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value{0};
+    };
+
+    static size_t shard_index() {
+        static std::atomic<size_t> next_shard{0};
+        thread_local size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDED_COUNTER_SHARDS;
+        return index;
+    }
+
+    std::array<Shard, SHARDED_COUNTER_SHARDS> shards_;
+};
+
+#endif // SHARDED_COUNTER_HPP
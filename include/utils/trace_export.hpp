@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef TRACE_EXPORT_HPP
+#define TRACE_EXPORT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils/mpsc_ring.hpp"
+
+#define TRACE_EXPORT_CAPACITY 16384
+#define TRACE_EXPORT_MAX_ARGS 4
+// Minimum capture time between two queue depth samples
+#define TRACE_QUEUE_SAMPLE_MS 10
+
+// Rows of the timeline (Chrome trace "tid")
+enum TraceTrack : uint8_t {
+    TRACK_FRAMES = 1,           // one span per frame, first payload -> EOF
+    TRACK_PAYLOAD_ERRORS = 2,   // instant per payload error
+    TRACK_DEVICE_TIME = 3,      // frame start placed at its PTS derived device time
+    TRACK_COUNTERS = 4          // throughput, queue depth, PTS drift
+};
+
+// Colour of a frame span; the checker decides which bucket a frame falls in
+enum TraceFrameState : uint8_t {
+    TRACE_FRAME_VALID = 0,
+    TRACE_FRAME_SUSPICIOUS = 1,
+    TRACE_FRAME_ERROR = 2
+};
+
+struct TraceEvent {
+    char phase = 'i';               // 'X' span, 'i' instant, 'C' counter
+    TraceTrack track = TRACK_FRAMES;
+    const char* name = "";          // static strings only, nothing is copied
+    const char* color = nullptr;    // Chrome trace reserved colour name
+    int64_t ts_us = 0;
+    int64_t dur_us = 0;
+    uint8_t arg_count = 0;
+    const char* arg_names[TRACE_EXPORT_MAX_ARGS] = {};
+    int64_t arg_values[TRACE_EXPORT_MAX_ARGS] = {};
+
+    TraceEvent& arg(const char* arg_name, int64_t value) {
+        if (arg_count < TRACE_EXPORT_MAX_ARGS) {
+            arg_names[arg_count] = arg_name;
+            arg_values[arg_count] = value;
+            ++arg_count;
+        }
+        return *this;
+    }
+};
+
+// Streams a Chrome trace event JSON array (chrome://tracing, ui.perfetto.dev)
+// Producers only fill a ring; formatting and file writes happen on the exporter thread.
+// The array is left open until close(), the viewers accept a truncated file after a crash.
+// Timestamps are capture times (payload received_time) in microseconds; the viewers rebase them.
+class TraceExporter {
+public:
+    static TraceExporter& instance();
+
+    bool open(const std::string& path);
+    void close();
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void frame(uint64_t frame_number, std::chrono::steady_clock::time_point first_payload,
+               std::chrono::steady_clock::time_point last_payload, TraceFrameState state,
+               int frame_error, int frame_suspicious, uint32_t payload_count, uint64_t frame_bytes);
+    void payload_error(std::chrono::steady_clock::time_point time, int error, uint64_t payload_size);
+    // Validation thread only; the first call after open() anchors the device clock to the host clock
+    void device_time(uint64_t frame_number, std::chrono::steady_clock::time_point host_time,
+                     std::chrono::steady_clock::time_point device_time);
+    void counter(const char* name, std::chrono::steady_clock::time_point time, int64_t value);
+
+    uint64_t dropped_events() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t written_events() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    TraceExporter() = default;
+    ~TraceExporter();
+    TraceExporter(const TraceExporter&) = delete;
+    TraceExporter& operator=(const TraceExporter&) = delete;
+
+    static int64_t to_us(std::chrono::steady_clock::time_point time);
+    void submit(TraceEvent&& event);
+    void writer_loop();
+    size_t drain(std::string& out);
+    static void append_event(std::string& out, const TraceEvent& event);
+
+    std::unique_ptr<MpscRing<TraceEvent, TRACE_EXPORT_CAPACITY>> ring_;
+    std::ofstream file_;
+    std::thread writer_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> written_{0};
+    std::string path_;
+    std::string pending_;
+
+    // Device clock anchor for TRACK_DEVICE_TIME, set by the first frame after open()
+    bool device_anchored_ = false;
+    int64_t device_anchor_us_ = 0;
+    int64_t host_anchor_us_ = 0;
+};
+
+#endif // TRACE_EXPORT_HPP
@@ -0,0 +1,64 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#ifndef TRACE_PROBES_HPP
+#define TRACE_PROBES_HPP
+
+// USDT (user space statically defined tracing) probes, provider "uvcfd"
+// Each probe is a single nop until bpftrace / perf attaches to it, so they stay
+// compiled in for field builds; list them with
+//   bpftrace -l 'usdt:./uvc_frame_detector:uvcfd:*'
+// Arguments must stay cheap to compute: they are evaluated even when nothing is attached.
+//
+// Probes and arguments
+//   urb_accepted    (bus, device, transfer_type, caplen)
+//   urb_filtered    (bus, device, transfer_type, caplen)
+//   payload_enqueue (payload_size, queue_depth)
+//   payload_dequeue (payload_size, queue_depth)
+//   header_parsed   (HLE, BFH, PTS, payload_size)
+//   payload_error   (UVCError, payload_size)
+//   frame_open      (frame_number, fid)
+//   frame_finish    (frame_number, FrameError, FrameSuspicious, packet_count)
+//   develope_start  (frame_number, FrameFormat, chunk_count)
+//   develope_end    (frame_number, saved)
+//
+// Builds without <sys/sdt.h> (Windows, minimal Linux images) or with
+// -DUVCFD_NO_USDT compile every probe to nothing.
+
+#if defined(__linux__) && !defined(UVCFD_NO_USDT) && defined(__has_include)
+  #if __has_include(<sys/sdt.h>)
+    #include <sys/sdt.h>
+    #define UVCFD_USDT_ENABLED 1
+  #endif
+#endif
+
+#ifdef UVCFD_USDT_ENABLED
+  #define UVCFD_PROBE2(name, a1, a2) DTRACE_PROBE2(uvcfd, name, a1, a2)
+  #define UVCFD_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(uvcfd, name, a1, a2, a3)
+  #define UVCFD_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(uvcfd, name, a1, a2, a3, a4)
+#else
+  #define UVCFD_PROBE2(name, a1, a2) ((void)0)
+  #define UVCFD_PROBE3(name, a1, a2, a3) ((void)0)
+  #define UVCFD_PROBE4(name, a1, a2, a3, a4) ((void)0)
+#endif
+
+#endif // TRACE_PROBES_HPP
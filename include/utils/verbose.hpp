@@ -28,7 +28,11 @@
 #include <iostream>
 #include <sstream>
 
+#define VERBOSE_MAX_STREAMS 16
+
 // VerboseStream class for handling different verbose levels
+// Text is formatted into a per-thread buffer and handed to LogSink on flush,
+// so concurrent writers never share a buffer and never wait on the console
 class VerboseStream {
 public:
     static int verbose_level;
@@ -37,7 +41,7 @@ public:
     template<typename T>
     VerboseStream& operator<<(const T& message) {
         if (verbose_level >= level_) {
-            buffer_ << message;
+            local_buffer() << message;
         };
         return *this;
     }
@@ -48,9 +52,11 @@ public:
     void flush();
 
 private:
+    std::ostringstream& local_buffer();
+
     int level_;
+    int slot_;
     std::string prefix_;
-    std::ostringstream buffer_;
     std::ostream& output_stream_;
 };
 
@@ -70,6 +76,32 @@ namespace CtrlPrint{
     extern VerboseStream v_cerr_5;
 };
 
+// Highest verbose level compiled into the binary (set with -DUVCFD_VERBOSE_CEILING)
+// Statements above the ceiling are removed entirely, below it they cost one branch
+#ifndef VERBOSE_CEILING
+#define VERBOSE_CEILING 5
+#endif
+
+#define VERBOSE_ON(level) \
+    ((level) <= VERBOSE_CEILING && VerboseStream::verbose_level >= (level))
+
+// Use like a stream: V_LOG(2, CtrlPrint::v_cout_2) << a << b << std::endl;
+// The right hand side is only evaluated when the level is enabled
+// A one pass for loop has no else to capture, so it is safe under a bare if
+#define V_LOG(level, stream) \
+    for (bool v_log_on_ = VERBOSE_ON(level); v_log_on_; v_log_on_ = false) stream
+
+#define V_COUT_1 V_LOG(1, CtrlPrint::v_cout_1)
+#define V_CERR_1 V_LOG(1, CtrlPrint::v_cerr_1)
+#define V_COUT_2 V_LOG(2, CtrlPrint::v_cout_2)
+#define V_CERR_2 V_LOG(2, CtrlPrint::v_cerr_2)
+#define V_COUT_3 V_LOG(3, CtrlPrint::v_cout_3)
+#define V_CERR_3 V_LOG(3, CtrlPrint::v_cerr_3)
+#define V_COUT_4 V_LOG(4, CtrlPrint::v_cout_4)
+#define V_CERR_4 V_LOG(4, CtrlPrint::v_cerr_4)
+#define V_COUT_5 V_LOG(5, CtrlPrint::v_cout_5)
+#define V_CERR_5 V_LOG(5, CtrlPrint::v_cerr_5)
+
 enum WindowName {
     WIN_ERROR_FRAME = 0,
     WIN_FRAME_TIME = 1,
@@ -86,12 +118,12 @@ enum WindowName {
     WIN_VALID_FRAME = 13
 };
 
-// Global variable declaration 
-extern WindowName gui_window_number;
-extern bool print_whole_flag;
-extern WindowName temp_window_number;
-extern bool frame_error_flag;
-extern bool frame_suspicious_flag;
+// Per-thread routing state, captured into each log record on flush
+extern thread_local WindowName gui_window_number;
+extern thread_local bool print_whole_flag;
+extern thread_local WindowName temp_window_number;
+extern thread_local bool frame_error_flag;
+extern thread_local bool frame_suspicious_flag;
 
 
 #endif // VERBOSE_HPP
@@ -0,0 +1,106 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef CAPTURE_CONVERT_HPP
+#define CAPTURE_CONVERT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "validuvc/control_config.hpp"
+#include "validuvc/stream_generator.hpp"
+
+// Capture formats uvcfd_convert reads and writes
+enum CaptureFormat : uint8_t {
+    CAPTURE_AUTO = 0,           // input only, chosen from the first bytes
+    CAPTURE_RECORD,             // .uvcrec payload records (payload_record.hpp)
+    CAPTURE_PCAP,               // pcap / pcapng with usbmon (link type 189, 220) or USBPcap (249); written as usbmon pcapng
+    CAPTURE_HEXDUMP,            // Wireshark hex dump, "0000   00 f8 07 ..." lines per packet (change_shark/input.txt)
+    CAPTURE_DISSECTION,         // Wireshark Export Packet Dissections As Plain Text, all expanded
+    CAPTURE_TSHARK,             // tshark -T fields lines, as scripts/run_uvcfd.bash feeds uvcfd
+    CAPTURE_TIMED,              // "Converted Monotonic Time: <s> seconds" and payload hex lines (log_test)
+    CAPTURE_HEX,                // one payload per line as hex (uvcfd_saturation -in)
+    CAPTURE_PACKET_HEX,         // output only, whole packets as "00 f8 07 ..." lines (test_packet_handler tph_*.txt)
+    CAPTURE_FORMAT_COUNT
+};
+
+const char* capture_format_name(CaptureFormat format);
+bool parse_capture_format(const std::string& name, CaptureFormat& format);
+
+// CAPTURE_AUTO when the first bytes match none of the input formats
+CaptureFormat detect_capture_format(const u_char* head, size_t size);
+
+struct ConvertOptions {
+    CaptureFormat input = CAPTURE_AUTO;
+    CaptureFormat output = CAPTURE_RECORD;
+
+    // Written with record and tshark output until the capture carries its own configuration
+    // (record header, tshark descriptor lines, usbmon GET_DESCRIPTOR and VS_COMMIT_CONTROL)
+    StreamConfig config;
+    StreamTransfer transfer = TRANSFER_ISO;     // for inputs that do not tell iso from bulk
+
+    uint32_t stream = 0;                // (bus << 16) | (device << 8) | endpoint, 0 takes the first one carrying UVC headers
+    uint32_t bulk_urb_size = 0;         // 0 learns it from bulk submissions or the longest URB, as moncapler does
+    uint16_t hexdump_linktype = 220;    // hex dumps do not say which header the packets start with
+
+    size_t workers = 0;                 // decode threads, 0 uses every core
+    size_t chunk_bytes = 4 << 20;       // input bytes per decode job
+    size_t chunks_in_flight = 0;        // 0 is two per worker; memory stays near chunk_bytes * chunks_in_flight * 2
+};
+
+struct ConvertStats {
+    uint64_t input_bytes = 0;
+    uint64_t packets = 0;               // URBs, lines or records decoded
+    uint64_t payloads = 0;              // payloads (or packets, tph output) written
+    uint64_t payload_bytes = 0;
+    uint64_t skipped = 0;               // other streams, submissions, control and interrupt transfers
+    uint64_t malformed = 0;             // records that could not be decoded
+    uint64_t truncated = 0;             // payloads shorter than the capture says ("[truncated]", snap length)
+    uint64_t configs = 0;               // stream configurations found in the capture
+    uint32_t stream = 0;                // the stream that was converted, same layout as ConvertOptions::stream
+    double seconds = 0;
+    std::vector<std::string> notes;     // things worth telling the user, printed by uvcfd_convert
+};
+
+// Streams one capture into another format with bounded memory
+// A reader thread cuts the input into chunks on record boundaries, worker threads decode
+// chunks in parallel, and the calling thread writes the results back in input order
+class CaptureConverter {
+public:
+    explicit CaptureConverter(const ConvertOptions& options) : options_(options) {}
+
+    // "-" reads stdin / writes stdout; false when the input or output cannot be used (error())
+    bool run(const std::string& input, const std::string& output);
+
+    const ConvertStats& stats() const { return stats_; }
+    const std::string& error() const { return error_; }
+
+private:
+    ConvertOptions options_;
+    ConvertStats stats_;
+    std::string error_;
+};
+
+#endif // CAPTURE_CONVERT_HPP
@@ -0,0 +1,159 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef CAPTURE_POLICY_HPP
+#define CAPTURE_POLICY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "develope_queue.hpp"
+
+// Which capture button a finished frame belongs to
+enum CaptureCategory : uint8_t {
+    CAPTURE_ERROR = 0,
+    CAPTURE_SUSPICIOUS = 1,
+    CAPTURE_VALID = 2
+};
+
+#define CAPTURE_CATEGORY_COUNT 3
+// Upper bound of frames one policy keeps back (reservoir slots, burst tail)
+#define CAPTURE_MAX_HELD 64
+
+const char* capture_category_name(CaptureCategory category);
+
+// Which frames of a category go to the develop queue
+enum CaptureSampling : uint8_t {
+    CAPTURE_SAMPLE_ALL = 0,         // every frame
+    CAPTURE_SAMPLE_EVERY_NTH = 1,   // frames 0, count, 2 * count, ...
+    CAPTURE_SAMPLE_RATE = 2,        // at most count frames per second
+    CAPTURE_SAMPLE_RESERVOIR = 3,   // count frames picked uniformly from each window
+    CAPTURE_SAMPLE_BURST = 4        // first count and last count frames of each run of the category
+};
+
+struct CapturePolicyConfig {
+    CaptureSampling sampling = CAPTURE_SAMPLE_ALL;
+    uint32_t count = 1;
+    std::chrono::milliseconds window{1000};   // CAPTURE_SAMPLE_RESERVOIR
+};
+
+// "all", "every:N", "rate:K", "reservoir:K" or "reservoir:K:window_ms", "burst:N"
+bool parse_capture_policy(const char* text, CapturePolicyConfig& config);
+std::string capture_policy_name(const CapturePolicyConfig& config);
+
+// Process wide defaults, picked up by every checker constructed afterwards
+CapturePolicyConfig capture_policy_config(CaptureCategory category);
+void set_capture_policy_config(CaptureCategory category, const CapturePolicyConfig& config);
+
+// "error=burst:3,valid=every:30"; categories are error, suspicious and valid
+// The categories named are set in mask (1 << CaptureCategory)
+bool parse_capture_policies(const char* text, unsigned& mask);
+
+enum CaptureDecision : uint8_t {
+    CAPTURE_SKIP = 0,   // the frame keeps its bytes, nothing is copied or moved
+    CAPTURE_NOW = 1,    // push_queue() right away
+    CAPTURE_HOLD = 2    // hand the frame to hold(); release() queues it later
+};
+
+struct CaptureCounts {
+    int64_t sampled = 0;   // handed to the develop queue
+    int64_t skipped = 0;   // left out by the policy, including held frames pushed out of their slot
+    int64_t held = 0;      // waiting for their window or burst to close
+};
+
+// Sampling state of one category, owned by one checker
+// decide() is O(1) and only looks at counters, so a skipped frame costs no copy
+class CapturePolicy {
+public:
+    CapturePolicy();
+
+    void configure(const CapturePolicyConfig& config);
+    const CapturePolicyConfig& config() const { return config_; }
+
+    CaptureDecision decide(std::chrono::steady_clock::time_point now);
+    // The frame decide() just returned CAPTURE_HOLD for
+    void hold(DevelopJob&& job);
+
+    // A frame of another category finished; the current burst is over
+    void interrupt();
+    // Moves the frames whose window or burst has closed to out; flush releases everything held
+    void release(std::chrono::steady_clock::time_point now, std::vector<DevelopJob>& out, bool flush = false);
+
+    CaptureCounts counts() const;
+
+private:
+    void release_held(std::vector<DevelopJob>& out);
+    uint64_t next_random();
+
+    CapturePolicyConfig config_;
+    uint32_t limit_ = 1;   // count clamped to CAPTURE_MAX_HELD where frames are held
+
+    uint64_t seen_ = 0;    // EVERY_NTH: frames so far, RESERVOIR: in this window, BURST: in this run
+    bool burst_closed_ = false;
+
+    double tokens_ = 0;
+    std::chrono::steady_clock::time_point last_refill_{};
+    std::chrono::steady_clock::time_point window_start_{};
+    bool window_open_ = false;
+
+    // Reservoir slots or the burst tail ring
+    std::vector<DevelopJob> held_;
+    std::vector<bool> occupied_;
+    size_t hold_slot_ = 0;
+    size_t ring_start_ = 0;   // oldest frame of the burst tail
+    size_t held_count_ = 0;
+    uint64_t random_state_;
+
+    std::atomic<int64_t> sampled_{0};
+    std::atomic<int64_t> skipped_{0};
+    std::atomic<int64_t> held_frames_{0};
+};
+
+// Consumers besides the capture buttons that read frame pixels (content checks, flight recorders)
+// register the categories they need while active; frames nobody asked for keep metadata only
+class PayloadDemand {
+public:
+    static PayloadDemand& instance();
+
+    // category_mask is a set of (1 << CaptureCategory); every add needs a matching remove
+    void add(unsigned category_mask);
+    void remove(unsigned category_mask);
+
+    // Categories with at least one registration, one atomic load
+    unsigned mask() const { return mask_.load(std::memory_order_acquire); }
+
+private:
+    PayloadDemand() = default;
+    PayloadDemand(const PayloadDemand&) = delete;
+    PayloadDemand& operator=(const PayloadDemand&) = delete;
+
+    std::mutex mutex_;
+    int counts_[CAPTURE_CATEGORY_COUNT] = {};
+    std::atomic<unsigned> mask_{0};
+};
+
+#endif // CAPTURE_POLICY_HPP
@@ -25,6 +25,57 @@
 
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+enum FrameFormat : uint8_t {
+    FRAME_FORMAT_MJPEG = 0,
+    FRAME_FORMAT_H264 = 1,
+    FRAME_FORMAT_YUYV = 2,
+    FRAME_FORMAT_RGB = 3
+};
+
+const char* frame_format_name(FrameFormat format);
+// Case insensitive, returns false for unsupported names
+bool parse_frame_format(const std::string& name, FrameFormat& format);
+
+// One published stream configuration, never modified after publish
+// Retired versions stay alive until exit so frames can keep pointing at them
+struct StreamConfig {
+    uint64_t version = 0;
+
+    // Device Info
+    int vendor_id = 0;
+    int product_id = 0;
+    std::string device_name = "-";
+
+    int width = 1;
+    int height = 1;
+    int fps = 1;
+    FrameFormat format = FRAME_FORMAT_MJPEG;
+    uint32_t dwMaxVideoFrameSize = 1;
+    uint32_t dwMaxPayloadTransferSize = 1;
+    uint32_t dwTimeFrequency = 1;
+
+    // Derived on publish
+    size_t expected_yuyv_size = 2;
+    double pts_to_ms = 1000.0;                      // milliseconds per PTS tick
+    std::chrono::milliseconds pts_wrap{0};          // duration of a full 32 bit PTS cycle
+
+    bool is_yuyv() const { return format == FRAME_FORMAT_YUYV; }
+    bool is_mjpeg() const { return format == FRAME_FORMAT_MJPEG; }
+
+    std::chrono::milliseconds pts_to_milliseconds(uint32_t pts) const {
+        return std::chrono::milliseconds(static_cast<long long>(pts * pts_to_ms));
+    }
+
+    void derive();
+};
 
 class ControlConfig {
 public:
@@ -35,7 +86,13 @@ public:
     ControlConfig(const ControlConfig&) = delete;
     ControlConfig& operator=(const ControlConfig&) = delete;
 
-    // Public setters
+    // Lock free read of the current version, valid for the life of the process
+    const StreamConfig* current() const { return current_.load(std::memory_order_acquire); }
+
+    // Publish a whole configuration at once (probe/commit); returns the new version
+    const StreamConfig* publish(const StreamConfig& next);
+
+    // Public setters, each publishes a new version
     void set_vendor_id(int v);
     void set_product_id(int p);
     void set_device_name(const std::string& name);
@@ -48,7 +105,7 @@ public:
     void set_dwMaxPayloadTransferSize(uint32_t max_payload_transfer_size);
     void set_dwTimeFrequency(uint32_t time_frequency);
 
-    // Public getters
+    // Public getters, read from the current version
     int get_vendor_id() const;
     int get_product_id() const;
     std::string get_device_name() const;
@@ -57,27 +114,34 @@ public:
     int get_height() const;
     int get_fps() const;
     std::string get_frame_format() const;
+    FrameFormat get_format() const;
     uint32_t get_dwMaxVideoFrameSize() const;
     uint32_t get_dwMaxPayloadTransferSize() const;
     uint32_t get_dwTimeFrequency() const;
 
+    uint64_t get_version() const;
+
 private:
     // Private constructor to prevent instantiation
     ControlConfig();
 
-    // Device Info
-    int vendor_id;
-    int product_id;
-    std::string device_name;
-
-    // Member variables
-    int width;
-    int height;
-    int fps;
-    std::string frame_format;
-    uint32_t dwMaxVideoFrameSize;
-    uint32_t dwMaxPayloadTransferSize;
-    uint32_t dwTimeFrequency;
+    // Read, change and publish under one lock, so concurrent setters never drop each other's change
+    template <typename Modify>
+    void modify(Modify&& change) {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        StreamConfig next = *current();
+        change(next);
+        publish_locked(std::move(next));
+    }
+
+    // Caller holds publish_mutex_
+    const StreamConfig* publish_locked(StreamConfig&& next);
+
+    std::atomic<const StreamConfig*> current_;
+
+    // Writers only
+    std::mutex publish_mutex_;
+    std::vector<std::unique_ptr<const StreamConfig>> versions_;
 };
 
 
@@ -0,0 +1,97 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef PAYLOAD_RECORD_HPP
+#define PAYLOAD_RECORD_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "validuvc/control_config.hpp"
+
+#ifdef _WIN32
+    typedef unsigned char u_char;
+#else
+  #include <sys/types.h>
+#endif
+
+// .uvcrec: a captured payload stream, the fixture format of tests/corpus
+// All integers little endian
+//
+//   file header  "UVCFDREC", u32 version, u32 header size (bytes from the start of the file),
+//                u32 width, u32 height, u32 fps, u32 format (FrameFormat),
+//                u32 dwMaxVideoFrameSize, u32 dwMaxPayloadTransferSize, u32 dwTimeFrequency
+//   record       u32 payload length, i64 received time (steady clock ns), payload bytes
+//
+// Readers skip header bytes they do not know, so fields can be appended without a new version
+#define PAYLOAD_RECORD_MAGIC "UVCFDREC"
+#define PAYLOAD_RECORD_VERSION 1
+#define PAYLOAD_RECORD_ENTRY_HEADER 12
+
+// Reads the file header from the first bytes of a file (streaming readers, uvcfd_convert)
+// Returns the header size, records start there; 0 when the bytes are not a usable header
+size_t parse_payload_record_header(const u_char* head, size_t size, StreamConfig& config, std::string& error);
+
+class PayloadRecordWriter {
+public:
+    ~PayloadRecordWriter() { close(); }
+
+    bool open(const std::string& path, const StreamConfig& config);
+    void write(const u_char* data, size_t size, std::chrono::steady_clock::time_point time);
+    void close();
+
+    uint64_t records() const { return records_; }
+
+private:
+    std::ofstream file_;
+    std::vector<u_char> buffer_;    // records are batched into large writes
+    uint64_t records_ = 0;
+};
+
+// Loads the whole file; next() hands out views into it
+class PayloadRecordReader {
+public:
+    bool open(const std::string& path);
+
+    const StreamConfig& config() const { return config_; }
+    const std::string& error() const { return error_; }
+
+    // False at the end of the file or on a truncated record (error() is set then)
+    bool next(const u_char*& data, size_t& size, std::chrono::steady_clock::time_point& time);
+    void rewind() { offset_ = header_size_; }
+
+    size_t file_size() const { return file_.size(); }
+
+private:
+    std::vector<u_char> file_;
+    size_t header_size_ = 0;
+    size_t offset_ = 0;
+    StreamConfig config_;
+    std::string error_;
+};
+
+#endif // PAYLOAD_RECORD_HPP
@@ -0,0 +1,200 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#ifndef STREAM_GENERATOR_HPP
+#define STREAM_GENERATOR_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "validuvc/control_config.hpp"
+
+#ifdef _WIN32
+    typedef unsigned char u_char;
+#else
+  #include <sys/types.h>
+#endif
+
+// Conditions the generator can inject, named after what the checker reports for them
+// Faults marked "no detector" have an enum value in the checker but nothing that returns it yet
+enum StreamFault : uint8_t {
+    FAULT_EMPTY_PAYLOAD = 0,        // ERR_EMPTY_PAYLOAD: zero length payload mid frame
+    FAULT_PAYLOAD_OVERFLOW,         // ERR_MAX_PAYLAOD_OVERFLOW: payload longer than dwMaxPayloadTransferSize
+    FAULT_ERR_BIT,                  // ERR_ERR_BIT_SET -> ERR_FRAME_ERROR
+    FAULT_LENGTH_OUT_OF_RANGE,      // ERR_LENGTH_OUT_OF_RANGE: HLE above 0x0C
+    FAULT_LENGTH_INVALID,           // ERR_LENGTH_INVALID: HLE does not match the PTS / SCR bits
+    FAULT_RESERVED_BIT,             // ERR_RESERVED_BIT_SET on a non EOF payload
+    FAULT_EOH_CLEARED,              // ERR_EOH_BIT (no detector)
+    FAULT_TOGGLE_OVERLAP,           // ERR_TOGGLE_BIT_OVERLAPPED: FID flips mid frame, reported as ERR_MISSING_EOF
+    FAULT_FID_MISMATCH,             // ERR_FID_MISMATCH -> ERR_FRAME_FID_MISMATCH: FID not toggled after EOF
+    FAULT_SWAP,                     // ERR_SWAP: FID and PTS of the previous frame repeated
+    FAULT_MISSING_EOF,              // ERR_MISSING_EOF -> ERR_FRAME_MISSING_EOF
+    FAULT_FRAME_DROP,               // ERR_FRAME_DROP: the device skips a frame
+    FAULT_FRAME_OVERFLOW,           // ERR_FRAME_MAX_FRAME_OVERFLOW: frame above dwMaxVideoFrameSize
+    FAULT_YUYV_SHORT,               // ERR_FRAME_INVALID_YUYV_RAW_SIZE: one payload of a YUYV frame lost
+    FAULT_PTS_MIXED,                // ERR_FRAME_SAME_DIFFERENT_PTS (no detector): one payload with another PTS
+    FAULT_TIME_JITTER,              // SUSPICIOUS_PAYLOAD_TIME_INCONSISTENT (no detector): late host timestamp
+    FAULT_FRAME_SHRINK,             // SUSPICIOUS_FRAME_SIZE / PAYLOAD_COUNT_INCONSISTENT: half size compressed frame
+    FAULT_PTS_DECREASE,             // SUSPICIOUS_PTS_DECREASE
+    FAULT_STC_DECREASE,             // SUSPICIOUS_SCR_STC_DECREASE
+    FAULT_OVERCOMPRESSED,           // SUSPICIOUS_OVERCOMPRESSED: compressed frame under 5% of YUYV size
+    FAULT_COUNT
+};
+
+const char* stream_fault_name(StreamFault fault);
+// Accepts the names printed by stream_fault_name, returns false for unknown ones
+bool parse_stream_fault(const std::string& name, StreamFault& fault);
+
+enum StreamTransfer : uint8_t {
+    TRANSFER_ISO = 0,
+    TRANSFER_BULK = 1
+};
+
+struct GeneratorConfig {
+    FrameFormat format = FRAME_FORMAT_YUYV;     // YUYV, MJPEG or H264
+    StreamTransfer transfer = TRANSFER_ISO;
+    int width = 1280;
+    int height = 720;
+    int fps = 30;
+    uint32_t max_payload_transfer_size = 3072;  // dwMaxPayloadTransferSize, header included
+    uint32_t time_frequency = 48000000;         // dwTimeFrequency, PTS and SCR STC clock
+    uint32_t compression_ratio = 6;             // MJPEG / H264 frame size is YUYV size / ratio
+    uint64_t seed = 1;
+
+    // Host time of the first payload; payloads of a frame are spread over the frame interval
+    std::chrono::steady_clock::time_point start_time{std::chrono::seconds(1)};
+
+    // Chance per frame of each fault, 0 (default) to 1
+    double fault_probability[FAULT_COUNT] = {};
+
+    // Device side descriptors, matching what the checker would read from probe / commit
+    StreamConfig stream_config() const;
+};
+
+// One payload of the current frame; data stays valid until the next next_frame()
+struct PayloadView {
+    const u_char* data;
+    size_t size;
+    std::chrono::steady_clock::time_point time;
+};
+
+// What was injected into one frame, for accuracy tests
+struct GeneratedFrame {
+    uint64_t frame_number = 0;
+    uint32_t faults = 0;            // bit (1 << StreamFault)
+    uint32_t pts = 0;
+    size_t payload_count = 0;
+    size_t data_bytes = 0;          // frame data, headers excluded
+
+    bool has(StreamFault fault) const { return faults & (1u << fault); }
+};
+
+// Synthetic UVC payload stream with PTS / SCR clocks and fault injection
+// Frames are cut from one prebuilt buffer and only their headers are rewritten,
+// so next_frame() runs at memory speed and allocates nothing after the first frame
+class UVCStreamGenerator {
+public:
+    explicit UVCStreamGenerator(const GeneratorConfig& config);
+
+    const std::vector<PayloadView>& next_frame();
+    const GeneratedFrame& frame_truth() const { return truth_; }
+
+    const GeneratorConfig& config() const { return config_; }
+    uint64_t frames_generated() const { return frame_number_; }
+    uint64_t injected(StreamFault fault) const { return injected_[fault]; }
+
+    // Frame data bytes of a regular frame for the configured format
+    size_t frame_data_size() const { return frame_data_size_; }
+
+private:
+    double uniform();
+    bool roll(StreamFault fault);
+    size_t pick_middle(size_t payload_count);
+    void write_header(u_char* header, uint8_t bfh, uint32_t pts, uint32_t stc, uint16_t sof);
+    uint32_t device_clock(std::chrono::steady_clock::time_point time) const;
+
+    GeneratorConfig config_;
+    size_t payload_data_size_;      // data bytes per full payload
+    size_t frame_data_size_;
+    size_t slot_size_;              // stride in buffer_, leaves room for FAULT_PAYLOAD_OVERFLOW
+    std::vector<u_char> buffer_;
+    std::vector<PayloadView> views_;
+    std::vector<size_t> touched_;   // payloads already carrying a fault this frame
+
+    GeneratedFrame truth_;
+    uint64_t frame_number_ = 0;
+    uint64_t device_frame_ = 0;     // frames the device produced, dropped ones included
+    uint64_t rng_state_;
+    uint8_t fid_ = 0;
+    uint32_t previous_pts_ = 0;
+    uint64_t injected_[FAULT_COUNT] = {};
+};
+
+// tshark -T fields -E separator=; text, the line layout scripts/run_uvcfd.bash feeds uvcfd
+// (usb.transfer_type;frame.time_epoch;frame.len;usb.capdata;usb.iso.data)
+class TsharkFieldsWriter {
+public:
+    TsharkFieldsWriter(std::ostream& out, StreamTransfer transfer, size_t iso_packets_per_urb = 32)
+        : out_(out), transfer_(transfer), iso_packets_per_urb_(iso_packets_per_urb) {}
+
+    // Descriptor and commit lines uvcfd reads the stream configuration from
+    void write_config(const GeneratorConfig& config, std::chrono::steady_clock::time_point time);
+    void write_config(const StreamConfig& config, std::chrono::steady_clock::time_point time);
+    void write(const std::vector<PayloadView>& payloads);
+
+private:
+    std::ostream& out_;
+    StreamTransfer transfer_;
+    size_t iso_packets_per_urb_;
+    std::string line_;
+};
+
+// pcapng with Linux usbmon (LINKTYPE_USB_LINUX_MMAPPED) URB completions, as moncapler captures them
+// Bulk payloads are split into bulk_urb_size URBs, iso payloads are grouped into URBs with descriptors
+class UsbmonPcapngWriter {
+public:
+    UsbmonPcapngWriter(std::ostream& out, StreamTransfer transfer, uint8_t bus = 1, uint8_t device = 2,
+                       uint8_t endpoint = 0x81, size_t iso_packets_per_urb = 32, uint32_t bulk_urb_size = 16384);
+
+    void write(const std::vector<PayloadView>& payloads);
+
+private:
+    void write_urb(std::chrono::steady_clock::time_point time, const PayloadView* iso, size_t iso_count,
+                   const u_char* bulk_data, size_t bulk_size);
+
+    std::ostream& out_;
+    StreamTransfer transfer_;
+    uint8_t bus_;
+    uint8_t device_;
+    uint8_t endpoint_;
+    size_t iso_packets_per_urb_;
+    uint32_t bulk_urb_size_;
+    uint64_t urb_id_ = 0;
+    std::vector<u_char> block_;
+};
+
+#endif // STREAM_GENERATOR_HPP
@@ -41,8 +41,16 @@
 #include <atomic>
 #include <iostream>
 
+#include "utils/alloc_stats.hpp"
+#include "utils/metrics.hpp"
+#include "utils/pipeline_latency.hpp"
+#include "utils/sharded_counter.hpp"
+#include "utils/trace_export.hpp"
+#include "utils/trace_probes.hpp"
 #include "utils/verbose.hpp"
 #include "develope_photo.hpp"
+#include "validuvc/capture_policy.hpp"
+#include "validuvc/control_config.hpp"
 
 #ifdef _WIN32
     typedef unsigned char u_char;
@@ -94,121 +102,141 @@ typedef struct PACKED {
 #endif
 std::ostream& operator<<(std::ostream& os, const UVC_Payload_Header& header);
 
-struct PayloadErrorStats {
-    int count_no_error = 0;
-    int count_empty_payload = 0;
-    int count_max_payload_overflow = 0;
-    int count_err_bit_set = 0;
-    int count_length_out_of_range = 0;
-    int count_length_invalid = 0;
-    int count_reserved_bit_set = 0;
-    int count_eoh_bit = 0;
-    int count_toggle_bit_overlapped = 0;
-    int count_fid_mismatch = 0;
-    int count_swap = 0;
-    int count_missing_eof = 0;
-    int count_unknown_error = 0;
-
-    int total() const {
-        return count_no_error + count_empty_payload + count_max_payload_overflow +
-               count_err_bit_set + count_length_out_of_range + count_length_invalid +
-               count_reserved_bit_set + count_eoh_bit + count_toggle_bit_overlapped +
-               count_fid_mismatch + count_swap + count_missing_eof + count_unknown_error;
-    }
+// Counter lists shared by the live statistics, their snapshots and the metrics export
+// X(field, metric label value, printed name)
+#define UVC_PAYLOAD_ERROR_COUNTERS(X) \
+    X(count_no_error, "no_error", "No Error") \
+    X(count_empty_payload, "empty_payload", "Empty Payload") \
+    X(count_max_payload_overflow, "max_payload_overflow", "Max Payload Overflow") \
+    X(count_err_bit_set, "err_bit_set", "Error Bit Set") \
+    X(count_length_out_of_range, "length_out_of_range", "Length Out of Range") \
+    X(count_length_invalid, "length_invalid", "Length Invalid") \
+    X(count_reserved_bit_set, "reserved_bit_set", "Reserved Bit Set") \
+    X(count_eoh_bit, "eoh_bit", "End of Header Bit") \
+    X(count_toggle_bit_overlapped, "toggle_bit_overlapped", "Toggle Bit Overlapped") \
+    X(count_fid_mismatch, "fid_mismatch", "Frame Identifier Mismatch") \
+    X(count_swap, "swap", "Swap") \
+    X(count_missing_eof, "missing_eof", "Missing EOF") \
+    X(count_unknown_error, "unknown", "Unknown Error")
+
+#define UVC_FRAME_ERROR_COUNTERS(X) \
+    X(count_no_error, "no_error", "No Error") \
+    X(count_frame_drop, "frame_drop", "Frame Drop") \
+    X(count_frame_error, "frame_error", "Frame Error") \
+    X(count_max_frame_overflow, "max_frame_overflow", "Max Frame Overflow") \
+    X(count_invalid_yuyv_raw_size, "invalid_yuyv_raw_size", "Invalid YUYV Raw Size") \
+    X(count_same_different_pts, "same_different_pts", "Same Different PTS") \
+    X(count_missing_eof, "missing_eof", "Missing EOF") \
+    X(count_f_fid_mismatch, "fid_mismatch", "FID Mismatch") \
+    X(count_unknown_frame_error, "unknown", "Unknown Frame Error")
+
+// count_unchecked is kept out of the total and printed without a percentage
+#define UVC_FRAME_SUSPICIOUS_COUNTERS(X) \
+    X(count_no_suspicious, "no_suspicious", "No Suspicious") \
+    X(count_payload_time_inconsistent, "payload_time_inconsistent", "Payload Time Inconsistent") \
+    X(count_frame_size_inconsistent, "frame_size_inconsistent", "Frame Size Inconsistent") \
+    X(count_payload_count_inconsistent, "payload_count_inconsistent", "Payload Count Inconsistent") \
+    X(count_pts_decrease, "pts_decrease", "PTS Decrease") \
+    X(count_scr_stc_decrease, "scr_stc_decrease", "SCR STC Decrease") \
+    X(count_overcompressed, "overcompressed", "Overcompressed") \
+    X(count_error_checked, "error_checked", "Error Checked") \
+    X(count_unknown_suspicious, "unknown", "Unknown Suspicious")
+
+#define UVC_STATS_SNAPSHOT_FIELD(field, metric, label) int64_t field = 0;
+#define UVC_STATS_LIVE_FIELD(field, metric, label) ShardedCounter field;
+#define UVC_STATS_SUM(field, metric, label) + field
+#define UVC_STATS_READ(field, metric, label) counts.field = field.value();
+#define UVC_STATS_PRINT(field, metric, label) print_stat_line(label, field, total_count);
+
+inline double stat_percentage(int64_t count, int64_t total_count) {
+    return total_count == 0 ? 0 : static_cast<double>(count) / total_count * 100.0;
+}
+
+inline void print_stat_line(const char* label, int64_t count, int64_t total_count) {
+    V_COUT_1 << label << ": " << count << " (" << stat_percentage(count, total_count) << "%)\n";
+}
+
+// Snapshots are plain values read once from the live counters;
+// totals and percentages are computed from the snapshot so they always agree
+struct PayloadErrorCounts {
+    UVC_PAYLOAD_ERROR_COUNTERS(UVC_STATS_SNAPSHOT_FIELD)
+
+    int64_t total() const { return 0 UVC_PAYLOAD_ERROR_COUNTERS(UVC_STATS_SUM); }
 
     void print_stats() const {
-        int total_count = total();
-        CtrlPrint::v_cout_1 << "Payload Error Statistics:\n";
-        CtrlPrint::v_cout_1 << "No Error: " << count_no_error << " (" << percentage(count_no_error, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Empty Payload: " << count_empty_payload << " (" << percentage(count_empty_payload, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Max Payload Overflow: " << count_max_payload_overflow << " (" << percentage(count_max_payload_overflow, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Error Bit Set: " << count_err_bit_set << " (" << percentage(count_err_bit_set, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Length Out of Range: " << count_length_out_of_range << " (" << percentage(count_length_out_of_range, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Length Invalid: " << count_length_invalid << " (" << percentage(count_length_invalid, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Reserved Bit Set: " << count_reserved_bit_set << " (" << percentage(count_reserved_bit_set, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "End of Header Bit: " << count_eoh_bit << " (" << percentage(count_eoh_bit, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Toggle Bit Overlapped: " << count_toggle_bit_overlapped << " (" << percentage(count_toggle_bit_overlapped, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Frame Identifier Mismatch: " << count_fid_mismatch << " (" << percentage(count_fid_mismatch, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Swap: " << count_swap << " (" << percentage(count_swap, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Missing EOF: " << count_missing_eof << " (" << percentage(count_missing_eof, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Unknown Error: " << count_unknown_error << " (" << percentage(count_unknown_error, total_count) << "%)\n";
+        int64_t total_count = total();
+        V_COUT_1 << "Payload Error Statistics:\n";
+        UVC_PAYLOAD_ERROR_COUNTERS(UVC_STATS_PRINT)
     }
+};
 
-    double percentage(int count, int total_count) const {
-        return total_count == 0 ? 0 : static_cast<double>(count) / total_count * 100.0;
+struct FrameErrorCounts {
+    UVC_FRAME_ERROR_COUNTERS(UVC_STATS_SNAPSHOT_FIELD)
+
+    int64_t total() const { return 0 UVC_FRAME_ERROR_COUNTERS(UVC_STATS_SUM); }
+
+    void print_stats() const {
+        int64_t total_count = total();
+        V_COUT_1 << "\nFrame Error Statistics:\n";
+        UVC_FRAME_ERROR_COUNTERS(UVC_STATS_PRINT)
     }
 };
 
-struct FrameErrorStats {
-    int count_no_error = 0;
-    int count_frame_drop = 0;
-    int count_frame_error = 0;
-    int count_max_frame_overflow = 0;
-    int count_invalid_yuyv_raw_size = 0;
-    int count_same_different_pts = 0;
-    int count_missing_eof = 0;
-    int count_f_fid_mismatch = 0;
-    int count_unknown_frame_error = 0;
-
-    int total() const {
-        return count_no_error + count_frame_drop + count_frame_error +
-               count_max_frame_overflow + count_invalid_yuyv_raw_size + count_same_different_pts + count_missing_eof + count_f_fid_mismatch + count_unknown_frame_error;
-    }
+struct FrameSuspiciousCounts {
+    UVC_FRAME_SUSPICIOUS_COUNTERS(UVC_STATS_SNAPSHOT_FIELD)
+    int64_t count_unchecked = 0;
+
+    int64_t total() const { return 0 UVC_FRAME_SUSPICIOUS_COUNTERS(UVC_STATS_SUM); }
 
     void print_stats() const {
-        int total_count = total();
-        CtrlPrint::v_cout_1 << "\nFrame Error Statistics:\n";
-        CtrlPrint::v_cout_1 << "No Error: " << count_no_error << " (" << percentage(count_no_error, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Frame Drop: " << count_frame_drop << " (" << percentage(count_frame_drop, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Frame Error: " << count_frame_error << " (" << percentage(count_frame_error, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Max Frame Overflow: " << count_max_frame_overflow << " (" << percentage(count_max_frame_overflow, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Invalid YUYV Raw Size: " << count_invalid_yuyv_raw_size << " (" << percentage(count_invalid_yuyv_raw_size, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Same Different PTS: " << count_same_different_pts << " (" << percentage(count_same_different_pts, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Missing EOF: " << count_missing_eof << " (" << percentage(count_missing_eof, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "FID Mismatch: " << count_f_fid_mismatch << " (" << percentage(count_f_fid_mismatch, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Unknown Frame Error: " << count_unknown_frame_error << " (" << percentage(count_unknown_frame_error, total_count) << "%)\n";
+        int64_t total_count = total();
+        V_COUT_1 << "\nSuspicious Frame Statistics:\n";
+        UVC_FRAME_SUSPICIOUS_COUNTERS(UVC_STATS_PRINT)
+        V_COUT_1 << "Unchecked: " << count_unchecked << "\n";
     }
+};
+
+// Live counters, 64 bit and sharded per thread so a long soak never wraps
+// and a metrics scrape never stalls the processing thread
+struct PayloadErrorStats {
+    UVC_PAYLOAD_ERROR_COUNTERS(UVC_STATS_LIVE_FIELD)
 
-    double percentage(int count, int total_count) const {
-        return total_count == 0 ? 0 : static_cast<double>(count) / total_count * 100.0;
+    PayloadErrorCounts snapshot() const {
+        PayloadErrorCounts counts;
+        UVC_PAYLOAD_ERROR_COUNTERS(UVC_STATS_READ)
+        return counts;
     }
+
+    int64_t total() const { return snapshot().total(); }
+    void print_stats() const { snapshot().print_stats(); }
 };
 
-struct FrameSuspiciousStats{
-    int count_no_suspicious = 0;
-    int count_payload_time_inconsistent = 0;
-    int count_frame_size_inconsistent = 0;
-    int count_payload_count_inconsistent = 0;   
-    int count_pts_decrease = 0;
-    int count_scr_stc_decrease = 0;
-    int count_overcompressed = 0;
-    int count_error_checked = 0;
-    int count_unknown_suspicious = 0;
-    int count_unchecked = 0;
-
-    int total() const {
-        return count_no_suspicious + count_payload_time_inconsistent + count_frame_size_inconsistent +
-               count_payload_count_inconsistent + count_pts_decrease + count_scr_stc_decrease + count_overcompressed + count_error_checked + count_unknown_suspicious;
-    }
+struct FrameErrorStats {
+    UVC_FRAME_ERROR_COUNTERS(UVC_STATS_LIVE_FIELD)
 
-    void print_stats () const{
-        int total_count = total();
-        CtrlPrint::v_cout_1 << "\nSuspicious Frame Statistics:\n";
-        CtrlPrint::v_cout_1 << "No Suspicious: " << count_no_suspicious << " (" << percentage(count_no_suspicious, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Payload Time Inconsistent: " << count_payload_time_inconsistent << " (" << percentage(count_payload_time_inconsistent, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Frame Size Inconsistent: " << count_frame_size_inconsistent << " (" << percentage(count_frame_size_inconsistent, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Payload Count Inconsistent: " << count_payload_count_inconsistent << " (" << percentage(count_payload_count_inconsistent, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "PTS Decrease: " << count_pts_decrease << " (" << percentage(count_pts_decrease, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "SCR STC Decrease: " << count_scr_stc_decrease << " (" << percentage(count_scr_stc_decrease, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Overcompressed: " << count_overcompressed << " (" << percentage(count_overcompressed, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Error Checked: " << count_error_checked << " (" << percentage(count_error_checked, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Unknown Suspicious: " << count_unknown_suspicious << " (" << percentage(count_unknown_suspicious, total_count) << "%)\n";
-        CtrlPrint::v_cout_1 << "Unchecked: " << count_unchecked << "\n";
+    FrameErrorCounts snapshot() const {
+        FrameErrorCounts counts;
+        UVC_FRAME_ERROR_COUNTERS(UVC_STATS_READ)
+        return counts;
     }
 
-    double percentage(int count, int total_count) const {
-        return total_count == 0 ? 0 : static_cast<double>(count) / total_count * 100.0;
+    int64_t total() const { return snapshot().total(); }
+    void print_stats() const { snapshot().print_stats(); }
+};
+
+struct FrameSuspiciousStats {
+    UVC_FRAME_SUSPICIOUS_COUNTERS(UVC_STATS_LIVE_FIELD)
+    ShardedCounter count_unchecked;
+
+    FrameSuspiciousCounts snapshot() const {
+        FrameSuspiciousCounts counts;
+        UVC_FRAME_SUSPICIOUS_COUNTERS(UVC_STATS_READ)
+        counts.count_unchecked = count_unchecked.value();
+        return counts;
     }
+
+    int64_t total() const { return snapshot().total(); }
+    void print_stats() const { snapshot().print_stats(); }
 };
 
 
@@ -271,11 +299,17 @@ public:
 
     int frame_width;
     int frame_height;
-    std::string frame_format;
+    FrameFormat frame_format;
+
+    // Configuration the frame started under; a mid stream format change only affects later frames
+    const StreamConfig* stream_config = nullptr;
+    uint64_t config_version = 0;
 
     std::vector<UVC_Payload_Header> payload_headers;  // To store UVC_Payload_Header
     std::vector<size_t> payload_sizes;                // To store the size of each uvc_payload
     std::vector<std::vector<u_char>> payload_datas;   // To store the uvc_payloads
+    // Categories (1 << CaptureCategory) that want this frame's pixels, fixed when the frame opens
+    unsigned payload_demand = ~0u;
     std::vector<std::vector<u_char>> error_payload_datas;
     
     std::vector<std::tuple<std::chrono::time_point<std::chrono::steady_clock>,bool>> received_chrono_times;  // Packet reception times
@@ -291,10 +325,12 @@ public:
         packet_number++;
     }
 
-    void set_frame_format(int width, int height, const std::string& format) {
-        frame_width = width;
-        frame_height = height;
-        frame_format = format;
+    void set_stream_config(const StreamConfig* config) {
+        stream_config = config;
+        config_version = config->version;
+        frame_width = config->width;
+        frame_height = config->height;
+        frame_format = config->format;
     }
 
     void add_image_data(const UVC_Payload_Header& header, const std::vector<u_char>& payload) {
@@ -306,6 +342,18 @@ public:
         }
     }
 
+    // An error frame can only finish as CAPTURE_ERROR, so it stops keeping bytes nobody wants
+    bool keeps_payload() const {
+        if (frame_error != ERR_FRAME_NO_ERROR) {
+            return (payload_demand & (1u << CAPTURE_ERROR)) != 0;
+        }
+        return payload_demand != 0;
+    }
+
+    void drop_image_data() {
+        std::vector<std::vector<u_char>>().swap(payload_datas);
+    }
+
     void set_frame_error() {
         frame_error = ERR_FRAME_ERROR;
     }
@@ -324,36 +372,93 @@ public:
         received_chrono_times.push_back(std::make_tuple(time_point, false));
     }
 
-    void push_queue() {
-        DevFImage::DevFImageFormat frame_format_struct;
+    // Format and pixels for the develop queue; the payload bytes are moved out of the frame
+    DevelopJob take_develop_job() {
+        DevelopJob job;
+        DevelopFrameFormat& frame_format_struct = job.format;
         frame_format_struct.frame_number = static_cast<int>(frame_number);
         frame_format_struct.width = frame_width;
         frame_format_struct.height = frame_height;
         frame_format_struct.format = frame_format;
-
-        DevFImage& dev_f_image = DevFImage::instance();
-        {
-            std::lock_guard<std::mutex> lock(dev_f_image.dev_f_image_mutex);
-            
-            dev_f_image.dev_f_image_queue.push(std::move(payload_datas));
-            dev_f_image.dev_f_image_format_queue.push(frame_format_struct);
+        frame_format_struct.queued_tick = PIPELINE_STAMP();
+        frame_format_struct.frame_error = frame_error;
+        frame_format_struct.frame_suspicious = frame_suspicious;
+        frame_format_struct.error_frame = frame_error != ERR_FRAME_NO_ERROR || frame_suspicious != SUSPICIOUS_NO_SUSPICIOUS;
+        frame_format_struct.pts = frame_pts;
+        if (!received_chrono_times.empty()) {
+            frame_format_struct.first_received_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::get<0>(received_chrono_times.front()).time_since_epoch()).count();
+            frame_format_struct.last_received_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::get<0>(received_chrono_times.back()).time_since_epoch()).count();
         }
+        job.data = std::move(payload_datas);
+        return job;
+    }
+
+    void push_queue() {
+        DevelopJob job = take_develop_job();
+        DevFImage::instance().queue_frame(job.format, std::move(job.data));
+    }
+};
 
-        dev_f_image.dev_f_image_cv.notify_one();
+// Run control toggled from the GUI buttons while the processing thread reads it
+struct RunFlags {
+    std::atomic<bool> play_pause_flag{true};
+    std::atomic<bool> capture_image_flag{true};
+    std::atomic<bool> capture_error_flag{false};
+    std::atomic<bool> capture_suspicious_flag{false};
+    std::atomic<bool> capture_valid_flag{false};
+    std::atomic<bool> filter_on_off_flag{true};
+    std::atomic<bool> irregular_define_flag{false};
+    std::atomic<bool> pts_decrease_filter_flag{false};
+    std::atomic<bool> stc_decrease_filter_flag{false};
+
+    // Process wide flags used by the GUI and by checkers built without their own
+    static RunFlags& instance();
+};
+
+// Everything one checker needs besides its own statistics
+// Several checkers can run side by side, each with its own context
+struct CheckerContext {
+    explicit CheckerContext(RunFlags& run_flags)
+        : flags(&run_flags), config(ControlConfig::instance().current()) {}
+
+    RunFlags* flags;
+    const StreamConfig* config;
+
+    // payload_valid_ctrl history
+    UVC_Payload_Header previous_previous_payload_header{};
+    UVC_Payload_Header previous_payload_header{};
+    UVC_Payload_Header temp_error_payload_header{};
+
+    // print_frame_data history
+    std::chrono::milliseconds stack_overflow_pts{0};
+    std::chrono::milliseconds very_first_gap{0};
+    bool very_first_gap_set = false;
+
+    // Pick up the latest published config, one atomic load
+    const StreamConfig& sync_config() {
+        config = ControlConfig::instance().current();
+        return *config;
     }
 };
 
 class UVCPHeaderChecker {
 private:  
+    // The benchmark drivers in tests/ time the header parse and validation steps on their own
+    friend class UVCPHeaderCheckerBench;
+
+    CheckerContext ctx;
+
     uint64_t received_frames_count;
     uint64_t received_throughput;
     uint32_t previous_frame_pts;
     std::chrono::time_point<std::chrono::steady_clock> temp_received_time;
-    std::chrono::milliseconds::rep received_time_clock; 
 
-    std::string formatted_time;
-    std::string p_formatted_time;
-    std::string e_formatted_time;
+    // Raw receive times; only formatted when a log line that uses them is emitted
+    std::chrono::time_point<std::chrono::steady_clock> current_received_time;
+    std::chrono::time_point<std::chrono::steady_clock> p_received_time;
+    std::chrono::time_point<std::chrono::steady_clock> e_received_time;
 
     std::vector<u_char> payload = {};
 
@@ -363,6 +468,33 @@ private:
     FrameErrorStats frame_stats;
     FrameSuspiciousStats frame_suspicious_stats;
 
+    // Pipeline counters for the metrics endpoint
+    ShardedCounter received_payloads;
+    ShardedCounter received_bytes;
+    ShardedCounter finished_frames;
+    std::atomic<int64_t> last_second_frames{0};
+    std::atomic<int64_t> last_second_bytes{0};
+    int checker_id;
+    int metrics_collector_id;
+
+    void collect_metrics(MetricsWriter& out) const;
+
+    // Frame span and device time sample for the timeline export
+    void trace_frame_finish(const ValidFrame& frame);
+
+    // Capture sampling per category, configured from capture_policy_config() at construction
+    CapturePolicy capture_policies[CAPTURE_CATEGORY_COUNT];
+    std::vector<DevelopJob> capture_released;
+
+    // Runs for every finished frame; enabled is the category's capture button
+    // The policy decides before any payload byte is moved out of the frame
+    // Whatever the policy did not take is dropped, so processed_frames keep metadata only
+    void capture_frame(ValidFrame& frame, CaptureCategory category, bool enabled);
+    void queue_captures(bool flush);
+
+    // Categories whose payload bytes a new frame has to keep: capture buttons and PayloadDemand
+    unsigned payload_demand_mask() const;
+
     uint32_t frame_average_size;
 
     bool temp_new_frame_flag;
@@ -374,7 +506,11 @@ private:
     std::chrono::time_point<std::chrono::steady_clock> final_pts_chrono;
 
 
-    void update_payload_error_stat(UVCError perror) {
+    void update_payload_error_stat(UVCError perror, size_t payload_size) {
+        if (perror != ERR_NO_ERROR) {
+            UVCFD_PROBE2(payload_error, static_cast<int>(perror), payload_size);
+            TraceExporter::instance().payload_error(current_received_time, static_cast<int>(perror), payload_size);
+        }
         switch (perror) {
             case ERR_NO_ERROR: payload_stats.count_no_error++; break;
             case ERR_EMPTY_PAYLOAD: payload_stats.count_empty_payload++; break;
@@ -445,6 +581,7 @@ private:
     void printFrameErrorExplanation(FrameError error);
     void printSuspiciousExplanation(FrameSuspicious error);
     std::string formatTime(std::chrono::milliseconds ms);
+    std::string formatTime(std::chrono::time_point<std::chrono::steady_clock> time_point);
     void print_summary(const ValidFrame& frame);
 
     std::chrono::time_point<std::chrono::steady_clock> plot_gui_graph(int window_number, std::chrono::milliseconds::rep time_gap, 
@@ -452,16 +589,29 @@ private:
                         size_t y_size, std::chrono::time_point<std::chrono::steady_clock> temp_time);
 
 public:
-    UVCPHeaderChecker() :  
+    UVCPHeaderChecker() : UVCPHeaderChecker(RunFlags::instance()) {}
+
+    explicit UVCPHeaderChecker(RunFlags& run_flags) :  
+        ctx(run_flags),
         frame_count(0), throughput(0), average_frame_rate(0), current_frame_number(0),
         received_frames_count(0), received_throughput(0), previous_frame_pts(0), temp_received_time(std::chrono::time_point<std::chrono::steady_clock>()),
         current_pts_chrono(std::chrono::time_point<std::chrono::steady_clock>()), previous_pts_chrono(std::chrono::time_point<std::chrono::steady_clock>()),
         stacked_pts_chrono(0), final_pts_chrono(std::chrono::time_point<std::chrono::steady_clock>()){
-        CtrlPrint::v_cout_1 << "\nUVCPHeaderChecker Constructor\n" << std::endl;
+        static std::atomic<int> next_checker_id{0};
+        checker_id = next_checker_id.fetch_add(1, std::memory_order_relaxed);
+        metrics_collector_id = MetricsRegistry::instance().add_collector(
+            [this](MetricsWriter& out) { collect_metrics(out); });
+        for (int category = 0; category < CAPTURE_CATEGORY_COUNT; ++category) {
+            capture_policies[category].configure(capture_policy_config(static_cast<CaptureCategory>(category)));
+        }
+        ALLOC_STATS_ONLY(AllocStats::instance();)
+        V_COUT_1 << "\nUVCPHeaderChecker Constructor\n" << std::endl;
     }
 
     ~UVCPHeaderChecker() {
-        CtrlPrint::v_cout_1 << "\nUVCPHeaderChecker Destructor\n" << std::endl;
+        MetricsRegistry::instance().remove_collector(metrics_collector_id);
+        queue_captures(true);
+        V_COUT_1 << "\nUVCPHeaderChecker Destructor\n" << std::endl;
         print_stats();
     }
 
@@ -470,15 +620,8 @@ public:
     uint64_t graph_throughput;
     double average_frame_rate;
     
-    static bool play_pause_flag;
-    static bool capture_image_flag;
-    static bool capture_error_flag;
-    static bool capture_suspicious_flag;
-    static bool capture_valid_flag;
-    static bool filter_on_off_flag;
-    static bool irregular_define_flag;
-    static bool pts_decrease_filter_flag;
-    static bool stc_decrease_filter_flag;
+    RunFlags& run_flags() { return *ctx.flags; }
+    const StreamConfig* stream_config() const { return ctx.config; }
 
     std::list<std::unique_ptr<ValidFrame>> frames;
     std::vector<std::unique_ptr<ValidFrame>> processed_frames;
@@ -490,6 +633,12 @@ public:
     void control_configuration_ctrl(int vendor_id, int product_id, std::string device_name, int width, int height, int fps, std::string frame_format, uint32_t max_frame_size, uint32_t max_payload_size, uint32_t time_frequency, std::chrono::time_point<std::chrono::steady_clock> received_time);
 
     void print_stats() const;
+
+    // Statistics so far, read once (corpus runner, tests)
+    PayloadErrorCounts payload_error_counts() const { return payload_stats.snapshot(); }
+    FrameErrorCounts frame_error_counts() const { return frame_stats.snapshot(); }
+    FrameSuspiciousCounts frame_suspicious_counts() const { return frame_suspicious_stats.snapshot(); }
+    CaptureCounts capture_counts(CaptureCategory category) const { return capture_policies[category].counts(); }
 };
 
 #endif // UVCPHEADER_CHECKER_HPP
\ No newline at end of file
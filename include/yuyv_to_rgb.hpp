@@ -23,6 +23,7 @@
 #ifndef YTR_HPP
 #define YTR_HPP
 
+#include <cstddef>
 #include <iostream>
 #include <vector>
 #include <turbojpeg.h>
@@ -31,6 +32,49 @@
 typedef unsigned char u_char;
 #endif
 
+// Frames with at least this many pixels are converted in row bands on several threads
+#define YUYV_RGB_PARALLEL_PIXELS (1280 * 720)
+#define YUYV_RGB_MAX_BANDS 4
+
+// Conversion kernels, all bit exact with the scalar one; the plane split follows the same choice
+enum YuyvRgbKernel {
+    YUYV_RGB_AUTO = 0,      // best kernel the CPU supports, picked once at first use
+    YUYV_RGB_SCALAR,
+    YUYV_RGB_SSE2,
+    YUYV_RGB_AVX2,
+    YUYV_RGB_NEON
+};
+
+const char* yuyv_rgb_kernel_name(YuyvRgbKernel kernel);
+// Kernel used by the conversions; tests and uvcfd_bench switch it, false when the CPU lacks it
+bool set_yuyv_rgb_kernel(YuyvRgbKernel kernel);
+YuyvRgbKernel yuyv_rgb_kernel();
+
+// Writes width * height * 3 bytes of RGB24 to rgb; pixels missing from a short yuyv input are black
+// threads 0 splits frames above YUYV_RGB_PARALLEL_PIXELS into bands, 1 converts on the calling thread
+void convertYUYVtoRGB(const u_char* yuyv, size_t yuyv_size, int width, int height, u_char* rgb, int threads = 0);
+
+// Reuses rgb between frames, it only grows
+void convertYUYVtoRGB(const std::vector<u_char>& yuyvData, int width, int height, std::vector<u_char>& rgb, int threads = 0);
+
 std::vector<u_char> convertYUYVtoRGB(const std::vector<u_char>& yuyvData, int width, int height);
 
+// Deinterleaves YUYV into 4:2:2 planes for tjCompressFromYUVPlanes: y is width * height bytes,
+// u and v width / 2 * height each, expanded from studio to the full range JPEG stores. Reads the payload chunks of a frame in order, so the frame is
+// never concatenated; a macropixel split across two chunks is carried over. Like the RGB path,
+// bytes missing at the end of a short frame are treated as zero. Uses the SIMD family of yuyv_rgb_kernel().
+// Returns the number of YUYV bytes taken from the chunks
+size_t splitYUYVtoPlanes(const std::vector<std::vector<u_char>>& chunks, int width, int height,
+                         u_char* y, u_char* u, u_char* v);
+
+// Width of a downscaleYUYV result: width / factor, rounded down to whole macropixels
+int downscaled_yuyv_width(int width, int factor);
+
+// Box filter by factor (1, 2, 4 or 8) in both directions, YUYV in and out, for previews.
+// Each output luma sample is the rounded mean of a factor x factor block, each chroma sample the mean
+// over its macropixel's 2 factor x factor input pixels; edge pixels that do not fill a block are dropped.
+// Output is downscaled_yuyv_width() x height / factor. Bytes missing from a short frame count as zero.
+// The row sums use the SIMD family of yuyv_rgb_kernel()
+void downscaleYUYV(const u_char* yuyv, size_t yuyv_size, int width, int height, int factor, u_char* out);
+
 #endif // YTR_HPP
\ No newline at end of file
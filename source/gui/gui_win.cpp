@@ -26,6 +26,9 @@
 #include "validuvc/uvcpheader_checker.hpp"
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 
 static std::vector<std::string> error_frame_log_button;
 void addErrorFrameLog(const std::string& efn) {
@@ -49,7 +52,39 @@ std::string image_file_path = "images\\smpte.jpg";
 std::string image_file_path = "images/smpte.jpg";
 #endif
 
+// One persistent texture for the viewer; frames are uploaded into it, never re-created per image
 GLuint texture_id = 0;
+static int texture_width = 0;
+static int texture_height = 0;
+static bool texture_ready = false;
+// Frame the viewer waits for in FramePreview, -1 when it shows a file
+static int preview_frame_number = -1;
+
+static void UploadImageTexture(const unsigned char* pixels, int width, int height, int channels) {
+    if (!texture_id) {
+        glGenTextures(1, &texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+    }
+
+    // RGB rows of odd widths are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
+    if (width != texture_width || height != texture_height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        texture_width = width;
+        texture_height = height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    texture_ready = true;
+}
 
 GLuint LoadTextureFromFile(const char* filename) {
     int width, height, channels;
@@ -58,28 +93,87 @@ GLuint LoadTextureFromFile(const char* filename) {
         std::cerr << "Failed to load image: " << filename << std::endl;
         return 0;
     }
+    UploadImageTexture(data, width, height, channels);
+    stbi_image_free(data);
+    return texture_id;
+}
 
-    GLuint texture_id;
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+void UpdateImageTexture(const std::string& path) {
+    texture_ready = false;
+    preview_frame_number = -1;
+    LoadTextureFromFile(path.c_str());
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, channels == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, data);
+// Frames developed in this session come from the FramePreview cache; older ones, or ones
+// already evicted, fall back to the file the develop thread wrote
+static void ShowFrameImage(int frame_number) {
+    FramePreview& preview = FramePreview::instance();
+    if (std::shared_ptr<const PreviewFrame> frame = preview.find(frame_number)) {
+        UploadImageTexture(frame->rgb.data(), frame->width, frame->height, 3);
+        preview_frame_number = -1;
+        return;
+    }
+#ifdef _WIN32
+    UpdateImageTexture("images\\frame_" + std::to_string(frame_number) + ".jpg");
+#elif __linux__
+    UpdateImageTexture("images/frame_" + std::to_string(frame_number) + ".jpg");
+#endif
+    // Not developed yet: shown as soon as the develop worker publishes it
+    if (!texture_ready && preview.enabled()) {
+        preview_frame_number = frame_number;
+    }
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// Frame number at the end of a "Frame N" / "Suspicious N" log name, -1 for other names
+static int LoggedFrameNumber(const std::string& log_name, const char* prefix) {
+    size_t pos = log_name.find(prefix);
+    if (pos == std::string::npos) {
+        return -1;
+    }
+    return std::atoi(log_name.c_str() + pos + std::strlen(prefix));
+}
 
-    stbi_image_free(data);
-    return texture_id;
+static void ShowLoggedFrameImage(const std::string& log_name, const char* prefix) {
+    const int frame_number = LoggedFrameNumber(log_name, prefix);
+    if (frame_number >= 0) {
+        ShowFrameImage(frame_number);
+        return;
+    }
+#ifdef _WIN32
+    image_file_path = "images\\smpte.jpg";
+#elif __linux__
+    image_file_path = "images/smpte.jpg";
+#endif
+    UpdateImageTexture(image_file_path);
 }
 
-void UpdateImageTexture(const std::string& path) {
-    if (texture_id) {
-        glDeleteTextures(1, &texture_id);
-        texture_id = 0;
+// Called once per GUI frame
+static void PollFramePreview() {
+    // The cache is searched again only after a put, not on every GUI frame
+    static int looked_up_frame = -1;
+    static uint64_t looked_up_generation = 0;
+
+    FramePreview& preview = FramePreview::instance();
+    if (preview_frame_number < 0) {
+        preview.acquire();
+        return;
+    }
+    if (preview.acquire() && preview.front().frame_number == preview_frame_number) {
+        const PreviewFrame& frame = preview.front();
+        UploadImageTexture(frame.rgb.data(), frame.width, frame.height, 3);
+        preview_frame_number = -1;
+        return;
+    }
+    const uint64_t generation = preview.cache.generation();
+    if (looked_up_frame == preview_frame_number && looked_up_generation == generation) {
+        return;
+    }
+    looked_up_frame = preview_frame_number;
+    looked_up_generation = generation;
+    if (std::shared_ptr<const PreviewFrame> frame = preview.find(preview_frame_number)) {
+        UploadImageTexture(frame->rgb.data(), frame->width, frame->height, 3);
+        preview_frame_number = -1;
     }
-    texture_id = LoadTextureFromFile(path.c_str());
 }
 
 
@@ -108,10 +202,12 @@ void screen(){
 
     WindowManager &uvcfd_win = WindowManager::getInstance();
     GraphManager &uvcfd_graph = GraphManager::getInstance();
+    RunFlags &run_flags = RunFlags::instance();
 
     while (!glfwWindowShouldClose(window)) {
 
         glfwPollEvents();
+        PollFramePreview();
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -198,6 +294,7 @@ void screen(){
 
                         ImGui::TextWrapped("Show Image:");
                         ImGui::BulletText("When Error Log or Suspicious Log button is pressed and a Frame is selected, it shows the saved image.");
+                        ImGui::BulletText("While the image is shown, selecting another frame switches to its preview.");
                         ImGui::BulletText("To view saved log data, press Error Log button to switch screens.");
 
                         ImGui::Separator();
@@ -278,9 +375,14 @@ void screen(){
                     for (int n = 0; n < error_frame_log_button.size(); n++) {
                         bool is_selected = (selected_error_frame == n);
                         if (ImGui::Selectable(error_frame_log_button[n].c_str(), is_selected)) {
-                            show_image = false;
                             selected_error_payload = 0;
                             selected_error_frame = n; 
+                            // Browsing with the image open swaps in the cached preview
+                            if (show_image && show_error_log) {
+                                ShowLoggedFrameImage(error_frame_log_button[n], "Frame ");
+                            } else {
+                                show_image = false;
+                            }
                         }
                         if (is_selected) {
                             ImGui::SetItemDefaultFocus(); 
@@ -321,8 +423,12 @@ void screen(){
                     for (int n = 0; n < suspicious_frame_log_button.size(); n++) {
                         bool is_selected = (selected_suspicious_frame == n);
                         if (ImGui::Selectable(suspicious_frame_log_button[n].c_str(), is_selected)) {
-                            show_image = false;
                             selected_suspicious_frame = n; 
+                            if (show_image && show_suspicious_log) {
+                                ShowLoggedFrameImage(suspicious_frame_log_button[n], "Suspicious ");
+                            } else {
+                                show_image = false;
+                            }
                         }
                         if (is_selected) {
                             ImGui::SetItemDefaultFocus(); 
@@ -350,46 +456,14 @@ void screen(){
                         show_image = !show_image;
                         if (show_image) {
 
-                            std::string selected_log_name = error_frame_log_button[selected_error_frame];
-                            size_t pos = selected_log_name.find("Frame ");
-                            if (pos != std::string::npos) {
-                                std::string frame_number = selected_log_name.substr(pos + 6);
-            #ifdef _WIN32
-                                image_file_path = "images\\frame_" + frame_number + ".jpg";
-            #elif __linux__
-                                image_file_path = "images/frame_" + frame_number + ".jpg";
-            #endif
-                            } else {
-            #ifdef _WIN32
-                                image_file_path = "images\\smpte.jpg";
-            #elif __linux__
-                                image_file_path = "images/smpte.jpg";
-            #endif
-                            }
-                            UpdateImageTexture(image_file_path);
+                            ShowLoggedFrameImage(error_frame_log_button[selected_error_frame], "Frame ");
                         }
                     }
                 } else if (show_suspicious_log) {
                     if (!suspicious_frame_log_button.empty()) {
                         show_image = !show_image;
                         if (show_image) {
-                            std::string selected_log_name = suspicious_frame_log_button[selected_suspicious_frame];
-                            size_t pos = selected_log_name.find("Suspicious ");
-                            if (pos != std::string::npos) {
-                                std::string frame_number = selected_log_name.substr(pos + 11);
-            #ifdef _WIN32
-                                image_file_path = "images\\frame_" + frame_number + ".jpg";
-            #elif __linux__
-                                image_file_path = "images/frame_" + frame_number + ".jpg";
-            #endif
-                            } else {
-            #ifdef _WIN32
-                                image_file_path = "images\\smpte.jpg";
-            #elif __linux__
-                                image_file_path = "images/smpte.jpg";
-            #endif
-                            }
-                            UpdateImageTexture(image_file_path);
+                            ShowLoggedFrameImage(suspicious_frame_log_button[selected_suspicious_frame], "Suspicious ");
                         }
                     }
                 }
@@ -449,160 +523,160 @@ void screen(){
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(27, 185));
-            if (UVCPHeaderChecker::capture_image_flag) {
+            if (run_flags.capture_image_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::capture_image_flag ? "Capture On" : "Capture Off", ImVec2(96, 40))){
-                UVCPHeaderChecker::capture_image_flag = !UVCPHeaderChecker::capture_image_flag;
-                if (UVCPHeaderChecker::capture_image_flag) {
-                    UVCPHeaderChecker::capture_error_flag = prev_capture_error_image_flag;
-                    UVCPHeaderChecker::capture_suspicious_flag = prev_capture_suspicious_image_flag;
-                    UVCPHeaderChecker::capture_valid_flag = prev_capture_valid_image_flag;
+            if (ImGui::Button(run_flags.capture_image_flag ? "Capture On" : "Capture Off", ImVec2(96, 40))){
+                run_flags.capture_image_flag = !run_flags.capture_image_flag;
+                if (run_flags.capture_image_flag) {
+                    run_flags.capture_error_flag = prev_capture_error_image_flag;
+                    run_flags.capture_suspicious_flag = prev_capture_suspicious_image_flag;
+                    run_flags.capture_valid_flag = prev_capture_valid_image_flag;
                 } else {
-                    prev_capture_error_image_flag = UVCPHeaderChecker::capture_error_flag;
-                    prev_capture_suspicious_image_flag = UVCPHeaderChecker::capture_suspicious_flag;
-                    prev_capture_valid_image_flag = UVCPHeaderChecker::capture_valid_flag;
+                    prev_capture_error_image_flag = run_flags.capture_error_flag;
+                    prev_capture_suspicious_image_flag = run_flags.capture_suspicious_flag;
+                    prev_capture_valid_image_flag = run_flags.capture_valid_flag;
 
-                    UVCPHeaderChecker::capture_error_flag = false;
-                    UVCPHeaderChecker::capture_suspicious_flag = false;
-                    UVCPHeaderChecker::capture_valid_flag = false;
+                    run_flags.capture_error_flag = false;
+                    run_flags.capture_suspicious_flag = false;
+                    run_flags.capture_valid_flag = false;
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(137, 185));
-            if (UVCPHeaderChecker::capture_error_flag && UVCPHeaderChecker::capture_image_flag) {
+            if (run_flags.capture_error_flag && run_flags.capture_image_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::capture_error_flag ? "Error Image" : "Error Image", ImVec2(96, 40))) {
-                if (UVCPHeaderChecker::capture_image_flag){
-                    UVCPHeaderChecker::capture_error_flag = !UVCPHeaderChecker::capture_error_flag;
+            if (ImGui::Button(run_flags.capture_error_flag ? "Error Image" : "Error Image", ImVec2(96, 40))) {
+                if (run_flags.capture_image_flag){
+                    run_flags.capture_error_flag = !run_flags.capture_error_flag;
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(247, 185));
-            if (UVCPHeaderChecker::capture_suspicious_flag && UVCPHeaderChecker::capture_image_flag) {
+            if (run_flags.capture_suspicious_flag && run_flags.capture_image_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::capture_suspicious_flag ? "Suspicious Image" : "Suspicious Image", ImVec2(96, 40))) {
-                if (UVCPHeaderChecker::capture_image_flag){
-                    UVCPHeaderChecker::capture_suspicious_flag = !UVCPHeaderChecker::capture_suspicious_flag;
+            if (ImGui::Button(run_flags.capture_suspicious_flag ? "Suspicious Image" : "Suspicious Image", ImVec2(96, 40))) {
+                if (run_flags.capture_image_flag){
+                    run_flags.capture_suspicious_flag = !run_flags.capture_suspicious_flag;
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(357, 185));
-            if (UVCPHeaderChecker::capture_valid_flag && UVCPHeaderChecker::capture_image_flag) {
+            if (run_flags.capture_valid_flag && run_flags.capture_image_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::capture_valid_flag ? "Valid Image" : "Valid Image", ImVec2(96, 40))) {
-                if (UVCPHeaderChecker::capture_image_flag){
-                    UVCPHeaderChecker::capture_valid_flag = !UVCPHeaderChecker::capture_valid_flag;
+            if (ImGui::Button(run_flags.capture_valid_flag ? "Valid Image" : "Valid Image", ImVec2(96, 40))) {
+                if (run_flags.capture_image_flag){
+                    run_flags.capture_valid_flag = !run_flags.capture_valid_flag;
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(27, 240));
-            if (UVCPHeaderChecker::filter_on_off_flag) {
+            if (run_flags.filter_on_off_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::filter_on_off_flag ? "Filter ON" : "Filter OFF", ImVec2(96, 40))){
-                UVCPHeaderChecker::filter_on_off_flag = !UVCPHeaderChecker::filter_on_off_flag;
-                if (UVCPHeaderChecker::filter_on_off_flag) {
-                    UVCPHeaderChecker::irregular_define_flag = prev_static_const_img_filter;
-                    UVCPHeaderChecker::pts_decrease_filter_flag = prev_pts_decrease_filter;
-                    UVCPHeaderChecker::stc_decrease_filter_flag = prev_scr_stc_decrease_filter;
+            if (ImGui::Button(run_flags.filter_on_off_flag ? "Filter ON" : "Filter OFF", ImVec2(96, 40))){
+                run_flags.filter_on_off_flag = !run_flags.filter_on_off_flag;
+                if (run_flags.filter_on_off_flag) {
+                    run_flags.irregular_define_flag = prev_static_const_img_filter;
+                    run_flags.pts_decrease_filter_flag = prev_pts_decrease_filter;
+                    run_flags.stc_decrease_filter_flag = prev_scr_stc_decrease_filter;
                 } else {
                     // if (static_const_img_filter || pts_decrease_filter || scr_stc_decrease_filter) {
-                        prev_static_const_img_filter = UVCPHeaderChecker::irregular_define_flag;
-                        prev_pts_decrease_filter = UVCPHeaderChecker::pts_decrease_filter_flag;
-                        prev_scr_stc_decrease_filter = UVCPHeaderChecker::stc_decrease_filter_flag;
+                        prev_static_const_img_filter = run_flags.irregular_define_flag;
+                        prev_pts_decrease_filter = run_flags.pts_decrease_filter_flag;
+                        prev_scr_stc_decrease_filter = run_flags.stc_decrease_filter_flag;
                     // }
 
-                    UVCPHeaderChecker::irregular_define_flag = false;
-                    UVCPHeaderChecker::pts_decrease_filter_flag = false;
-                    UVCPHeaderChecker::stc_decrease_filter_flag = false;
+                    run_flags.irregular_define_flag = false;
+                    run_flags.pts_decrease_filter_flag = false;
+                    run_flags.stc_decrease_filter_flag = false;
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(137, 240));
-            if (UVCPHeaderChecker::irregular_define_flag && UVCPHeaderChecker::filter_on_off_flag) {
+            if (run_flags.irregular_define_flag && run_flags.filter_on_off_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::irregular_define_flag ? "Irregular" : "Irregular", ImVec2(96, 40))) {
-                if (UVCPHeaderChecker::filter_on_off_flag){
-                    UVCPHeaderChecker::irregular_define_flag = !UVCPHeaderChecker::irregular_define_flag;  
+            if (ImGui::Button(run_flags.irregular_define_flag ? "Irregular" : "Irregular", ImVec2(96, 40))) {
+                if (run_flags.filter_on_off_flag){
+                    run_flags.irregular_define_flag = !run_flags.irregular_define_flag;  
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(247, 240));
-            if (UVCPHeaderChecker::pts_decrease_filter_flag && UVCPHeaderChecker::filter_on_off_flag) {
+            if (run_flags.pts_decrease_filter_flag && run_flags.filter_on_off_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::pts_decrease_filter_flag ? "PTS Dec" : "PTS Dec", ImVec2(96, 40))) {
-                if (UVCPHeaderChecker::filter_on_off_flag){
-                    UVCPHeaderChecker::pts_decrease_filter_flag = !UVCPHeaderChecker::pts_decrease_filter_flag;  
+            if (ImGui::Button(run_flags.pts_decrease_filter_flag ? "PTS Dec" : "PTS Dec", ImVec2(96, 40))) {
+                if (run_flags.filter_on_off_flag){
+                    run_flags.pts_decrease_filter_flag = !run_flags.pts_decrease_filter_flag;  
                 }
             }
             ImGui::PopStyleColor(2);
 
             ImGui::SetCursorPos(ImVec2(357, 240));
-            if (UVCPHeaderChecker::stc_decrease_filter_flag && UVCPHeaderChecker::filter_on_off_flag) {
+            if (run_flags.stc_decrease_filter_flag && run_flags.filter_on_off_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f)); 
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.40f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.80f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::stc_decrease_filter_flag ? "STC Dec" : "STC Dec", ImVec2(96, 40))) {
-                if(UVCPHeaderChecker::filter_on_off_flag){ 
-                    UVCPHeaderChecker::stc_decrease_filter_flag = !UVCPHeaderChecker::stc_decrease_filter_flag;  
+            if (ImGui::Button(run_flags.stc_decrease_filter_flag ? "STC Dec" : "STC Dec", ImVec2(96, 40))) {
+                if(run_flags.filter_on_off_flag){ 
+                    run_flags.stc_decrease_filter_flag = !run_flags.stc_decrease_filter_flag;  
                 }
             }
             ImGui::PopStyleColor(2);
 
 
             ImGui::SetCursorPos(ImVec2(247, 295));
-            if (UVCPHeaderChecker::play_pause_flag) {
+            if (run_flags.play_pause_flag) {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 1.0f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.60f));
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.26f, 0.59f, 0.98f, 0.10f)); 
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.26f, 0.59f, 0.98f, 0.50f)); 
             }
-            if (ImGui::Button(UVCPHeaderChecker::play_pause_flag ? "Play" : "Pause", ImVec2(96, 40))) {
-                UVCPHeaderChecker::play_pause_flag = ! UVCPHeaderChecker::play_pause_flag;
+            if (ImGui::Button(run_flags.play_pause_flag ? "Play" : "Pause", ImVec2(96, 40))) {
+                run_flags.play_pause_flag = ! run_flags.play_pause_flag;
             }
             ImGui::PopStyleColor(2);
 
@@ -646,7 +720,7 @@ void screen(){
                 if (show_image) {
                     ImGui::Text("Image:");
 
-                    if (texture_id) {
+                    if (texture_ready) {
                         ImGui::Image((ImTextureID)(intptr_t)texture_id, ImVec2(288, 162));
                     } else {
                         ImGui::Text("Invalid Image / Failed to load image. Image could be zero size or not found.");
@@ -657,7 +731,7 @@ void screen(){
                 if (show_image) {
                     ImGui::Text("Image:");
 
-                    if (texture_id) {
+                    if (texture_ready) {
                         ImGui::Image((ImTextureID)(intptr_t)texture_id, ImVec2(288, 162));
                     } else {
                         ImGui::Text("Invalid Image / Failed to load image. Image could be zero size or not found.");
@@ -0,0 +1,352 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "avi_writer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr size_t kAviHeaderSize = 224;      // RIFF, hdrl (avih, strl) and the movi LIST header
+constexpr uint64_t kMoviFourccOffset = 220; // idx1 offsets count from here
+constexpr uint32_t kAvifHasIndex = 0x10;
+constexpr uint32_t kAviifKeyframe = 0x10;
+
+void put32(u_char* out, uint32_t value) {
+    out[0] = static_cast<u_char>(value);
+    out[1] = static_cast<u_char>(value >> 8);
+    out[2] = static_cast<u_char>(value >> 16);
+    out[3] = static_cast<u_char>(value >> 24);
+}
+
+void put16(u_char* out, uint16_t value) {
+    out[0] = static_cast<u_char>(value);
+    out[1] = static_cast<u_char>(value >> 8);
+}
+
+void put_fourcc(u_char* out, const char* fourcc) {
+    std::memcpy(out, fourcc, 4);
+}
+
+std::string file_name(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+std::string timestamped_capture_path(const std::string& directory) {
+    const std::time_t now = std::time(nullptr);
+    std::ostringstream path;
+    path << directory << "capture_" << std::put_time(std::localtime(&now), "%Y-%m-%d-%H-%M-%S");
+    return path.str();
+}
+
+std::vector<u_char> MjpegAviWriter::header(bool indexed) const {
+    std::vector<u_char> out(kAviHeaderSize, 0);
+    u_char* h = out.data();
+    const uint32_t frames = static_cast<uint32_t>(index_.size());
+
+    // Without an index the RIFF ends with the movi list
+    put_fourcc(h + 0, "RIFF");
+    put32(h + 4, static_cast<uint32_t>((indexed ? size() : movi_end_) - 8));
+    put_fourcc(h + 8, "AVI ");
+
+    put_fourcc(h + 12, "LIST");
+    put32(h + 16, 192);
+    put_fourcc(h + 20, "hdrl");
+
+    put_fourcc(h + 24, "avih");
+    put32(h + 28, 56);
+    put32(h + 32, static_cast<uint32_t>(1000000 / fps_));
+    // dwMaxBytesPerSec is only a hint; large frames at high rates saturate it instead of wrapping
+    const uint64_t max_bytes_per_sec = static_cast<uint64_t>(max_frame_size_) * static_cast<uint64_t>(fps_);
+    put32(h + 36, static_cast<uint32_t>(std::min<uint64_t>(max_bytes_per_sec, UINT32_MAX)));
+    put32(h + 44, indexed ? kAvifHasIndex : 0);
+    put32(h + 48, frames);
+    put32(h + 56, 1);
+    put32(h + 60, max_frame_size_);
+    put32(h + 64, static_cast<uint32_t>(width_));
+    put32(h + 68, static_cast<uint32_t>(height_));
+
+    put_fourcc(h + 88, "LIST");
+    put32(h + 92, 116);
+    put_fourcc(h + 96, "strl");
+
+    put_fourcc(h + 100, "strh");
+    put32(h + 104, 56);
+    put_fourcc(h + 108, "vids");
+    put_fourcc(h + 112, "MJPG");
+    put32(h + 128, 1);
+    put32(h + 132, static_cast<uint32_t>(fps_));
+    put32(h + 140, frames);
+    put32(h + 144, max_frame_size_);
+    put32(h + 148, 0xFFFFFFFFu);
+    put16(h + 160, static_cast<uint16_t>(width_));
+    put16(h + 162, static_cast<uint16_t>(height_));
+
+    put_fourcc(h + 164, "strf");
+    put32(h + 168, 40);
+    put32(h + 172, 40);
+    put32(h + 176, static_cast<uint32_t>(width_));
+    put32(h + 180, static_cast<uint32_t>(height_));
+    put16(h + 184, 1);
+    put16(h + 186, 24);
+    put_fourcc(h + 188, "MJPG");
+    put32(h + 192, static_cast<uint32_t>(width_) * static_cast<uint32_t>(height_) * 3);
+
+    put_fourcc(h + 212, "LIST");
+    put32(h + 216, static_cast<uint32_t>(movi_end_ - kMoviFourccOffset));
+    put_fourcc(h + 220, "movi");
+    return out;
+}
+
+bool MjpegAviWriter::open(const std::string& path, int width, int height, int fps) {
+    close();
+    width_ = width;
+    height_ = height;
+    fps_ = fps > 0 ? fps : 30;
+    index_.clear();
+    max_frame_size_ = 0;
+    movi_end_ = kAviHeaderSize;
+    index_written_ = false;
+    if (!file_.open(path)) {
+        return false;
+    }
+    return checkpoint(false);
+}
+
+int64_t MjpegAviWriter::append(const FrameSegment* segments, size_t count) {
+    if (!is_open()) {
+        return -1;
+    }
+    size_t frame_size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        frame_size += segments[i].size;
+    }
+
+    // Chunk header, the JPEG as it came, and a pad byte to keep chunks word aligned
+    u_char chunk_header[8];
+    put_fourcc(chunk_header, "00dc");
+    put32(chunk_header + 4, static_cast<uint32_t>(frame_size));
+    static const u_char pad = 0;
+
+    // The frame overwrites the idx1 of the last checkpoint; the header stops pointing at it first,
+    // so a kill from here on leaves the frames up to that checkpoint without an index
+    if (index_written_) {
+        const std::vector<u_char> avi_header = header(false);
+        if (!file_.write_at(0, avi_header.data(), avi_header.size())) {
+            return -1;
+        }
+        index_written_ = false;
+    }
+
+    chunk_.clear();
+    chunk_.push_back({chunk_header, sizeof(chunk_header)});
+    chunk_.insert(chunk_.end(), segments, segments + count);
+    if (frame_size % 2) {
+        chunk_.push_back({&pad, 1});
+    }
+
+    if (!file_.write_at(movi_end_, chunk_.data(), chunk_.size())) {
+        return -1;
+    }
+    index_.push_back({static_cast<uint32_t>(movi_end_ - kMoviFourccOffset), static_cast<uint32_t>(frame_size)});
+    movi_end_ += sizeof(chunk_header) + frame_size + (frame_size % 2);
+    if (frame_size > max_frame_size_) {
+        max_frame_size_ = static_cast<uint32_t>(frame_size);
+    }
+    return static_cast<int64_t>(index_.size()) - 1;
+}
+
+bool MjpegAviWriter::checkpoint(bool sync) {
+    if (!is_open()) {
+        return false;
+    }
+    index_buffer_.resize(8 + 16 * index_.size());
+    u_char* out = index_buffer_.data();
+    put_fourcc(out, "idx1");
+    put32(out + 4, static_cast<uint32_t>(16 * index_.size()));
+    out += 8;
+    for (const IndexEntry& entry : index_) {
+        put_fourcc(out, "00dc");
+        put32(out + 4, kAviifKeyframe);
+        put32(out + 8, entry.offset);
+        put32(out + 12, entry.size);
+        out += 16;
+    }
+
+    // Index first, then the header that points at it
+    const std::vector<u_char> avi_header = header(true);
+    if (!file_.write_at(movi_end_, index_buffer_.data(), index_buffer_.size()) ||
+        !file_.write_at(0, avi_header.data(), avi_header.size())) {
+        return false;
+    }
+    index_written_ = true;
+    return !sync || file_.sync();
+}
+
+void MjpegAviWriter::close() {
+    if (!is_open()) {
+        return;
+    }
+    checkpoint(frame_fsync_every() > 0);
+    file_.close();
+}
+
+bool CaptureContainer::open(const std::string& base_path, int fps, int checkpoint_frames, uint64_t first_sequence) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    base_path_ = base_path;
+    fps_ = fps > 0 ? fps : 30;
+    checkpoint_frames_ = checkpoint_frames > 0 ? checkpoint_frames : fps_;
+    part_ = -1;
+    frames_written_ = 0;
+    next_sequence_ = first_sequence;
+    held_.clear();
+    done_.clear();
+
+    sidecar_.open(base_path_ + ".csv", std::ios::out | std::ios::trunc);
+    if (!sidecar_.is_open()) {
+        std::cerr << "Error: Could not open file " << base_path_ << ".csv for writing." << std::endl;
+        return false;
+    }
+    sidecar_ << "frame_number,file,index,bytes,frame_error,frame_suspicious\n";
+    sidecar_.flush();
+    open_ = true;
+    return true;
+}
+
+bool CaptureContainer::open_part(int width, int height) {
+    avi_.close();
+    ++part_;
+    if (part_ == 0) {
+        part_path_ = base_path_ + ".avi";
+    } else {
+        char suffix[24];   // "_" + any int + ".avi"
+        std::snprintf(suffix, sizeof(suffix), "_%03d.avi", part_);
+        part_path_ = base_path_ + suffix;
+    }
+    return avi_.open(part_path_, width, height, fps_);
+}
+
+bool CaptureContainer::write_frame(const DevelopFrameFormat& frame_format, const FrameSegment* segments, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) {
+        return false;
+    }
+    const uint64_t sequence = frame_format.develop_sequence;
+    if (sequence == 0 || sequence <= next_sequence_) {
+        return store_locked(frame_format, segments, count);
+    }
+
+    // Frames popped before this one are still being developed
+    HeldFrame& held = held_[sequence];
+    held.format = frame_format;
+    held.data.clear();
+    for (size_t i = 0; i < count; ++i) {
+        held.data.insert(held.data.end(), segments[i].data, segments[i].data + segments[i].size);
+    }
+    return true;
+}
+
+void CaptureContainer::frame_done(uint64_t develop_sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || develop_sequence < next_sequence_) {
+        return;
+    }
+    done_.insert(develop_sequence);
+    while (!done_.empty() && *done_.begin() == next_sequence_) {
+        done_.erase(done_.begin());
+        auto held = held_.find(next_sequence_);
+        if (held != held_.end()) {
+            store_held_locked(held->second);
+            held_.erase(held);
+        }
+        ++next_sequence_;
+    }
+}
+
+void CaptureContainer::store_held_locked(const HeldFrame& held) {
+    const FrameSegment segment = {held.data.data(), held.data.size()};
+    store_locked(held.format, &segment, 1);
+}
+
+bool CaptureContainer::store_locked(const DevelopFrameFormat& frame_format, const FrameSegment* segments, size_t count) {
+    size_t frame_size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        frame_size += segments[i].size;
+    }
+
+    // A new part for a new resolution, or before the part outgrows 32 bit offsets
+    const bool new_part = !avi_.is_open() || avi_.width() != frame_format.width || avi_.height() != frame_format.height ||
+                          avi_.size() + 8 + frame_size + 1 + 16 > AVI_PART_MAX_BYTES;
+    if (new_part && !open_part(frame_format.width, frame_format.height)) {
+        return false;
+    }
+
+    const int64_t index = avi_.append(segments, count);
+    if (index < 0) {
+        std::cerr << "Error: Could not write frame " << frame_format.frame_number << " to " << part_path_ << std::endl;
+        return false;
+    }
+    ++frames_written_;
+    sidecar_ << frame_format.frame_number << ',' << file_name(part_path_) << ',' << index << ',' << frame_size << ','
+             << frame_format.frame_error << ',' << frame_format.frame_suspicious << '\n';
+
+    if (avi_.frames() % static_cast<uint32_t>(checkpoint_frames_) == 0) {
+        avi_.checkpoint(frame_fsync_every() > 0);
+        sidecar_.flush();
+    }
+    return true;
+}
+
+void CaptureContainer::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& held : held_) {
+        store_held_locked(held.second);
+    }
+    held_.clear();
+    done_.clear();
+    avi_.close();
+    if (sidecar_.is_open()) {
+        sidecar_.close();
+    }
+    open_ = false;
+}
+
+bool CaptureContainer::is_open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_;
+}
+
+uint64_t CaptureContainer::frames_written() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_written_;
+}
@@ -21,24 +21,27 @@
 *********************************************************************/
 
 #include "develope_photo.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "avi_writer.hpp"
+#include "frame_file.hpp"
+#include "frame_preview.hpp"
+#include "utils/alloc_stats.hpp"
+#include "utils/pipeline_latency.hpp"
+#include "utils/trace_probes.hpp"
 #include "validuvc/uvcpheader_checker.hpp"
 #include "validuvc/control_config.hpp"
 #include "rgb_to_jpeg.hpp"
 #include "yuyv_to_rgb.hpp"
 
-void DevFImage::develope_mjpeg_to_jpg(std::vector<std::vector<u_char>>& binary_data, const std::string& output_jpg_path) {
-    std::ofstream output_file(output_jpg_path, std::ios::binary);
-    if (!output_file.is_open()) {
-        std::cerr << "Failed to open output file." << std::endl;
-        return;
-    }
-
-    for (const auto& chunk : binary_data) {
-        output_file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
-    }
+bool DevFImage::develope_mjpeg_to_jpg(std::vector<std::vector<u_char>>& binary_data, const std::string& output_jpg_path) {
+    // The payload chunks already are the JPEG, written as they are in one gathered write
+    return write_frame_file(output_jpg_path, binary_data);
 }
 
-void DevFImage::develope_rgb_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path) {
+bool DevFImage::encode_rgb_jpeg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data) {
     std::vector<u_char> rgb_data;
     size_t required_size = frame_format.width * frame_format.height * 3;
     rgb_data.reserve(required_size);
@@ -55,10 +58,34 @@ void DevFImage::develope_rgb_to_jpg(const DevFImageFormat& frame_format, std::ve
         // std::cerr << "Warning: RGB data was larger than expected. Excess data was truncated." << std::endl;
     }
 
-    saveJPEG(rgb_data, frame_format.width, frame_format.height, output_jpg_path);
+    return JpegEncoder::thread_instance().compress_rgb(rgb_data.data(), frame_format.width, frame_format.height, jpeg_settings());
+}
+
+bool DevFImage::encode_yuyv_planes_jpeg(const DevFImageFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data) {
+    const size_t luma_size = static_cast<size_t>(frame_format.width) * frame_format.height;
+
+    // Y, U and V back to back, reused across frames of this develop thread
+    thread_local std::vector<u_char> planes;
+    if (planes.size() < luma_size * 2) {
+        planes.resize(luma_size * 2);
+    }
+    u_char* y = planes.data();
+    u_char* u = y + luma_size;
+    u_char* v = u + luma_size / 2;
+    splitYUYVtoPlanes(frame_data, frame_format.width, frame_format.height, y, u, v);
+
+    const u_char* plane_pointers[3] = {y, u, v};
+    return JpegEncoder::thread_instance().compress_yuv422(plane_pointers, frame_format.width, frame_format.height, jpeg_settings());
 }
 
-void DevFImage::develope_yuyv_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path) {
+bool DevFImage::encode_yuyv_jpeg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data) {
+    // Planes need whole macropixels per row and a subsampling that 4:2:2 planes can give
+    const int subsampling = jpeg_settings().subsampling;
+    const bool planes_subsampling = subsampling < 0 || subsampling == TJSAMP_422 || subsampling == TJSAMP_420 || subsampling == TJSAMP_GRAY;
+    if (yuyv_jpeg_path.load(std::memory_order_relaxed) == YUYV_JPEG_PLANES && frame_format.width % 2 == 0 && planes_subsampling) {
+        return encode_yuyv_planes_jpeg(frame_format, frame_data);
+    }
+
     std::vector<u_char> yuyv_data;
     size_t required_size = frame_format.width * frame_format.height * 2;
     yuyv_data.reserve(required_size);
@@ -75,14 +102,134 @@ void DevFImage::develope_yuyv_to_jpg(const DevFImageFormat& frame_format, std::v
         // std::cerr << "Warning: YUYV data was larger than expected. Excess data was truncated." << std::endl;
     }
 
-    std::vector<u_char> rgb_data = convertYUYVtoRGB(yuyv_data, frame_format.width, frame_format.height);
+    // Reused across frames of this develop thread
+    thread_local std::vector<u_char> rgb_data;
+    convertYUYVtoRGB(yuyv_data, frame_format.width, frame_format.height, rgb_data);
 
     // std::cerr << "RGB Convertion Success" << std::endl;
-    
-    saveJPEG(rgb_data, frame_format.width, frame_format.height, output_jpg_path);
+
+    return JpegEncoder::thread_instance().compress_rgb(rgb_data.data(), frame_format.width, frame_format.height, jpeg_settings());
+}
+
+bool DevFImage::develope_rgb_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path) {
+    if (!encode_rgb_jpeg(frame_format, frame_data)) {
+        return false;
+    }
+    const JpegEncoder& encoder = JpegEncoder::thread_instance();
+    const FrameSegment jpeg = {encoder.data(), encoder.size()};
+    return write_frame_file(output_jpg_path, &jpeg, 1);
+}
+
+bool DevFImage::develope_yuyv_to_jpg(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data, const std::string& output_jpg_path) {
+    if (!encode_yuyv_jpeg(frame_format, frame_data)) {
+        return false;
+    }
+    const JpegEncoder& encoder = JpegEncoder::thread_instance();
+    const FrameSegment jpeg = {encoder.data(), encoder.size()};
+    return write_frame_file(output_jpg_path, &jpeg, 1);
+}
+
+bool DevFImage::develope_to_container(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data) {
+    thread_local std::vector<FrameSegment> segments;
+    segments.clear();
+
+    if (frame_format.format == FRAME_FORMAT_MJPEG) {
+        for (const auto& chunk : frame_data) {
+            segments.push_back({chunk.data(), chunk.size()});
+        }
+    } else if (frame_format.format == FRAME_FORMAT_YUYV || frame_format.format == FRAME_FORMAT_RGB) {
+        const bool encoded = frame_format.format == FRAME_FORMAT_YUYV ? encode_yuyv_jpeg(frame_format, frame_data)
+                                                                       : encode_rgb_jpeg(frame_format, frame_data);
+        if (!encoded) {
+            return false;
+        }
+        const JpegEncoder& encoder = JpegEncoder::thread_instance();
+        segments.push_back({encoder.data(), encoder.size()});
+    } else {
+        std::cout << "No container support for " << frame_format_name(frame_format.format) << " format." << std::endl;
+        return false;
+    }
+    return container.write_frame(frame_format, segments.data(), segments.size());
+}
+
+bool parse_develop_output(const char* name, DevelopOutput& output) {
+    if (std::strcmp(name, "jpg") == 0) {
+        output = DEVELOP_OUTPUT_JPEG;
+    } else if (std::strcmp(name, "avi") == 0) {
+        output = DEVELOP_OUTPUT_AVI;
+    } else if (std::strcmp(name, "none") == 0) {
+        output = DEVELOP_OUTPUT_NONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool DevFImage::open_container(const std::string& base_path, int fps) {
+    // Frames popped from here on are stored in pop order
+    if (!container.open(base_path, fps, AVI_CHECKPOINT_FRAMES, dev_f_image_queue.popped() + 1)) {
+        return false;
+    }
+    develop_output = DEVELOP_OUTPUT_AVI;
+    return true;
+}
+
+void DevFImage::close_container() {
+    DevelopOutput avi = DEVELOP_OUTPUT_AVI;
+    develop_output.compare_exchange_strong(avi, DEVELOP_OUTPUT_JPEG);
+    container.close();
+}
+
+bool DevFImage::open_raw_store(const std::string& base_path, RawStoreMode mode) {
+    close_raw_store();
+    if (mode == RAW_STORE_OFF) {
+        return true;
+    }
+    if (!raw_store.open(base_path)) {
+        return false;
+    }
+    raw_store_mode = mode;
+    return true;
+}
+
+void DevFImage::close_raw_store() {
+    raw_store_mode = RAW_STORE_OFF;
+    raw_store.close();
 }
 
 void DevFImage::develope_photo(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>& frame_data){
+    if (frame_format.queued_tick) {
+        PIPELINE_RECORD(STAGE_DEVELOP_WAIT, frame_format.queued_tick);
+    }
+    PIPELINE_SCOPE(STAGE_DEVELOP);
+    ALLOC_STAGE(STAGE_DEVELOP);
+    UVCFD_PROBE3(develope_start, frame_format.frame_number, static_cast<int>(frame_format.format), frame_data.size());
+
+    // Before the encoders below, which may consume frame_data
+    const RawStoreMode raw_mode = raw_store_mode.load(std::memory_order_relaxed);
+    if (raw_mode == RAW_STORE_ALL || (raw_mode == RAW_STORE_ERRORS && frame_format.error_frame)) {
+        raw_store.write(frame_format, frame_data);
+    }
+    FramePreview& preview = FramePreview::instance();
+    if (preview.wants(frame_format)) {
+        preview.publish(frame_format, frame_data);
+    }
+
+    const DevelopOutput output = develop_output.load(std::memory_order_relaxed);
+    if (output == DEVELOP_OUTPUT_NONE) {
+        UVCFD_PROBE2(develope_end, frame_format.frame_number, 1);
+        return;
+    }
+
+    if (output == DEVELOP_OUTPUT_AVI) {
+        const bool stored = develope_to_container(frame_format, frame_data);
+        UVCFD_PROBE2(develope_end, frame_format.frame_number, stored ? 1 : 0);
+        if (!stored) {
+            std::cerr << "Failed to store frame " << frame_format.frame_number << " in the capture container" << std::endl;
+        }
+        return;
+    }
+
 //recieve frame number, frame format and the data by using queue
 #ifdef _WIN32
         std::string output_jpg_path = "images\\frame_" + std::to_string(frame_format.frame_number) + ".jpg";
@@ -92,26 +239,87 @@ void DevFImage::develope_photo(const DevFImageFormat& frame_format, std::vector<
 
     bool save_success = false;
 
-    if (frame_format.format == "mjpeg"){
-        develope_mjpeg_to_jpg(frame_data, output_jpg_path);
-        save_success = true;
-    } else if (frame_format.format == "yuyv"){
-        develope_yuyv_to_jpg(frame_format, frame_data, output_jpg_path);
-        save_success = true;
-    } else if (frame_format.format == "h264"){
+    if (frame_format.format == FRAME_FORMAT_MJPEG){
+        save_success = develope_mjpeg_to_jpg(frame_data, output_jpg_path);
+    } else if (frame_format.format == FRAME_FORMAT_YUYV){
+        save_success = develope_yuyv_to_jpg(frame_format, frame_data, output_jpg_path);
+    } else if (frame_format.format == FRAME_FORMAT_H264){
         std::cout << "No support for H264 format." << std::endl;
+        UVCFD_PROBE2(develope_end, frame_format.frame_number, 0);
         return;
-    } else if (frame_format.format == "rgb"){
-        develope_rgb_to_jpg(frame_format, frame_data, output_jpg_path);
-        save_success = true;
+    } else if (frame_format.format == FRAME_FORMAT_RGB){
+        save_success = develope_rgb_to_jpg(frame_format, frame_data, output_jpg_path);
     } else {
-        std::cout << "Unsupported frame format: " << frame_format.format << std::endl;
+        std::cout << "Unsupported frame format: " << frame_format_name(frame_format.format) << std::endl;
     }
 
 
+    UVCFD_PROBE2(develope_end, frame_format.frame_number, save_success ? 1 : 0);
+
     if (save_success) {
         // std::cout << "Frame " << frame_format.frame_number << " saved as JPEG in " << output_jpg_path << std::endl;
     } else {
         std::cerr << "Failed to save frame " << frame_format.frame_number << " in " << output_jpg_path << std::endl;
     }
 };
+
+void DevFImage::start_workers(int workers_requested) {
+    stop_workers(true);
+
+    int count = workers_requested;
+    if (count <= 0) {
+        // Leave a core for capture and one for the checker
+        const int cores = static_cast<int>(std::thread::hardware_concurrency());
+        count = std::max(1, std::min(4, cores - 2));
+    }
+    count = std::min(count, DEVELOP_MAX_WORKERS);
+
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    dev_f_image_queue.reset_stats();
+    workers_running = true;
+    for (int i = 0; i < count; ++i) {
+        workers.emplace_back(&DevFImage::develop_worker, this);
+    }
+}
+
+void DevFImage::stop_workers(bool drain) {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    if (workers.empty()) {
+        return;
+    }
+    workers_running = false;
+    if (!drain) {
+        dev_f_image_queue.clear();
+    }
+    dev_f_image_queue.close();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+    dev_f_image_queue.reopen();
+}
+
+int DevFImage::worker_count() {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    return static_cast<int>(workers.size());
+}
+
+bool DevFImage::queue_frame(const DevFImageFormat& frame_format, std::vector<std::vector<u_char>>&& frame_data) {
+    DevelopJob job;
+    job.format = frame_format;
+    job.data = std::move(frame_data);
+    // Without a worker nothing would ever make room for a blocked producer
+    return dev_f_image_queue.push(std::move(job), workers_running.load(std::memory_order_acquire));
+}
+
+void DevFImage::develop_worker() {
+    ALLOC_STATS_ONLY(AllocStats::set_thread_name("develop");)
+    DevelopJob job;
+    while (dev_f_image_queue.pop(job)) {
+        develope_photo(job.format, job.data);
+        container.frame_done(job.format.develop_sequence);
+        developed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
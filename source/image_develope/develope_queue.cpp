@@ -0,0 +1,198 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "develope_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+const char* develop_drop_policy_name(DevelopDropPolicy policy) {
+    switch (policy) {
+      case DEVELOP_BLOCK: return "block";
+      case DEVELOP_DROP_NEWEST: return "newest";
+      case DEVELOP_DROP_OLDEST: return "oldest";
+      case DEVELOP_KEEP_ERRORS: return "errors";
+      default: return "unknown";
+    }
+}
+
+bool parse_develop_drop_policy(const char* name, DevelopDropPolicy& policy) {
+    const DevelopDropPolicy policies[] = {DEVELOP_BLOCK, DEVELOP_DROP_NEWEST, DEVELOP_DROP_OLDEST, DEVELOP_KEEP_ERRORS};
+    for (DevelopDropPolicy candidate : policies) {
+        if (std::strcmp(name, develop_drop_policy_name(candidate)) == 0) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+DevelopQueue::DevelopQueue(size_t capacity, DevelopDropPolicy policy)
+    : capacity_(std::max<size_t>(1, capacity)), policy_(policy) {}
+
+void DevelopQueue::configure(size_t capacity, DevelopDropPolicy policy) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = std::max<size_t>(1, capacity);
+        policy_ = policy;
+    }
+    not_full_.notify_all();
+}
+
+size_t DevelopQueue::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+DevelopDropPolicy DevelopQueue::policy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return policy_;
+}
+
+void DevelopQueue::drop_locked(const DevelopJob& job) {
+    ++stats_.dropped;
+    if (job.format.error_frame) {
+        ++stats_.dropped_errors;
+    }
+}
+
+bool DevelopQueue::push(DevelopJob&& job, bool may_block) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!closed_ && jobs_.size() >= capacity_) {
+        DevelopDropPolicy policy = policy_;
+        if (policy == DEVELOP_BLOCK && !may_block) {
+            policy = DEVELOP_DROP_NEWEST;
+        }
+
+        switch (policy) {
+          case DEVELOP_BLOCK:
+            ++stats_.blocked;
+            not_full_.wait(lock, [this] { return closed_ || jobs_.size() < capacity_; });
+            break;
+          case DEVELOP_DROP_NEWEST:
+            drop_locked(job);
+            return false;
+          case DEVELOP_DROP_OLDEST:
+            drop_locked(jobs_.front());
+            jobs_.pop_front();
+            break;
+          case DEVELOP_KEEP_ERRORS: {
+            auto victim = std::find_if(jobs_.begin(), jobs_.end(),
+                                       [](const DevelopJob& queued) { return !queued.format.error_frame; });
+            if (victim == jobs_.end()) {
+                // Only error frames queued: a valid frame is not worth one of them
+                if (!job.format.error_frame) {
+                    drop_locked(job);
+                    return false;
+                }
+                victim = jobs_.begin();
+            }
+            drop_locked(*victim);
+            jobs_.erase(victim);
+            break;
+          }
+        }
+    }
+    if (closed_) {
+        drop_locked(job);
+        return false;
+    }
+
+    jobs_.push_back(std::move(job));
+    ++stats_.queued;
+    stats_.high_water = std::max(stats_.high_water, jobs_.size());
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+}
+
+bool DevelopQueue::pop(DevelopJob& job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+        return false;
+    }
+    job = std::move(jobs_.front());
+    jobs_.pop_front();
+    job.format.develop_sequence = ++popped_;
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+bool DevelopQueue::try_pop(DevelopJob& job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (jobs_.empty()) {
+        return false;
+    }
+    job = std::move(jobs_.front());
+    jobs_.pop_front();
+    job.format.develop_sequence = ++popped_;
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+uint64_t DevelopQueue::popped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return popped_;
+}
+
+void DevelopQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+}
+
+void DevelopQueue::reopen() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+}
+
+size_t DevelopQueue::clear() {
+    size_t cleared = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cleared = jobs_.size();
+        jobs_.clear();
+    }
+    not_full_.notify_all();
+    return cleared;
+}
+
+DevelopQueueStats DevelopQueue::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DevelopQueueStats stats = stats_;
+    stats.depth = jobs_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+void DevelopQueue::reset_stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = DevelopQueueStats();
+    stats_.high_water = jobs_.size();
+}
@@ -0,0 +1,335 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "frame_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#ifdef _WIN32
+#include <climits>
+#include <cstdio>
+#include <io.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32) && !defined(IOV_MAX)
+#define IOV_MAX 1024
+#endif
+
+namespace {
+
+std::atomic<int> fsync_every{0};
+
+// Descriptors held open by every thread's batch, and how many the process can spare
+std::atomic<int> pending_open{0};
+std::atomic<int> pending_budget{1};
+
+// A quarter of the descriptor limit, leaving the rest to the capture, logs and containers
+int open_file_budget() {
+#ifdef _WIN32
+    const long long limit = _getmaxstdio();
+#else
+    rlimit limit_info{};
+    const long long limit = getrlimit(RLIMIT_NOFILE, &limit_info) == 0 && limit_info.rlim_cur != RLIM_INFINITY
+        ? static_cast<long long>(limit_info.rlim_cur) : 1024;
+#endif
+    return static_cast<int>(std::max<long long>(1, std::min<long long>(limit / 4, INT_MAX)));
+}
+
+#ifdef _WIN32
+using FrameHandle = FILE*;
+#else
+using FrameHandle = int;
+#endif
+
+// Files written by this thread and not synced yet
+struct PendingFrameFiles {
+    std::vector<FrameHandle> handles;
+    std::string directory;
+
+    void sync_and_close() {
+        for (FrameHandle handle : handles) {
+#ifdef _WIN32
+            fflush(handle);
+            _commit(_fileno(handle));
+            fclose(handle);
+#else
+            fdatasync(handle);
+            close(handle);
+#endif
+        }
+#ifndef _WIN32
+        // New directory entries are only durable once the directory is synced too
+        if (!handles.empty() && !directory.empty()) {
+            int dir = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dir >= 0) {
+                fsync(dir);
+                close(dir);
+            }
+        }
+#endif
+        pending_open.fetch_sub(static_cast<int>(handles.size()), std::memory_order_relaxed);
+        handles.clear();
+    }
+
+    ~PendingFrameFiles() { sync_and_close(); }
+};
+
+PendingFrameFiles& pending_frame_files() {
+    thread_local PendingFrameFiles pending;
+    return pending;
+}
+
+std::string parent_directory(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+}
+
+#ifndef _WIN32
+bool write_segments(int fd, const FrameSegment* segments, size_t count) {
+    thread_local std::vector<iovec> iov;
+    iov.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (segments[i].size > 0) {
+            iov.push_back({const_cast<u_char*>(segments[i].data), segments[i].size});
+        }
+    }
+
+    size_t first = 0;
+    while (first < iov.size()) {
+        const int batch = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        ssize_t written = writev(fd, &iov[first], batch);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        // Short write: skip what went out and resume inside the segment it stopped in
+        while (first < iov.size() && static_cast<size_t>(written) >= iov[first].iov_len) {
+            written -= static_cast<ssize_t>(iov[first].iov_len);
+            ++first;
+        }
+        if (written > 0) {
+            iov[first].iov_base = static_cast<u_char*>(iov[first].iov_base) + written;
+            iov[first].iov_len -= static_cast<size_t>(written);
+        }
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+void set_frame_fsync_every(int frames) {
+    fsync_every.store(frames > 0 ? frames : 0, std::memory_order_relaxed);
+    pending_budget.store(open_file_budget(), std::memory_order_relaxed);
+}
+
+int frame_fsync_every() {
+    return fsync_every.load(std::memory_order_relaxed);
+}
+
+void sync_frame_files() {
+    pending_frame_files().sync_and_close();
+}
+
+bool write_frame_file(const std::string& path, const FrameSegment* segments, size_t count) {
+#ifdef _WIN32
+    FrameHandle handle = nullptr;
+    if (fopen_s(&handle, path.c_str(), "wb") != 0 || !handle) {
+        std::cerr << "Error: Could not open file " << path << " for writing." << std::endl;
+        return false;
+    }
+    bool written = true;
+    for (size_t i = 0; i < count && written; ++i) {
+        written = segments[i].size == 0 || fwrite(segments[i].data, segments[i].size, 1, handle) == 1;
+    }
+#else
+    FrameHandle handle = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (handle < 0) {
+        std::cerr << "Error: Could not open file " << path << " for writing." << std::endl;
+        return false;
+    }
+    bool written = write_segments(handle, segments, count);
+#endif
+    if (!written) {
+        std::cerr << "Error: Could not write file " << path << std::endl;
+    }
+
+    const int every = frame_fsync_every();
+    if (every == 0) {
+#ifdef _WIN32
+        fclose(handle);
+#else
+        close(handle);
+#endif
+        return written;
+    }
+
+    PendingFrameFiles& pending = pending_frame_files();
+    pending.handles.push_back(handle);
+    pending.directory = parent_directory(path);
+    // Large batches across many threads would run out of descriptors (EMFILE);
+    // past the budget a thread syncs what it holds before the batch is full
+    const int open_now = pending_open.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (pending.handles.size() >= static_cast<size_t>(every) ||
+        open_now >= pending_budget.load(std::memory_order_relaxed)) {
+        pending.sync_and_close();
+    }
+    return written;
+}
+
+bool SegmentFile::open(const std::string& path, bool direct) {
+    close();
+    direct_ = false;
+#ifdef _WIN32
+    (void)direct;
+    if (fopen_s(&file_, path.c_str(), "w+b") != 0) {
+        file_ = nullptr;
+    }
+#else
+#ifdef O_DIRECT
+    if (direct) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;
+    }
+#endif
+    if (fd_ < 0) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+#endif
+    position_ = 0;
+    if (!is_open()) {
+        std::cerr << "Error: Could not open file " << path << " for writing." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SegmentFile::is_open() const {
+#ifdef _WIN32
+    return file_ != nullptr;
+#else
+    return fd_ >= 0;
+#endif
+}
+
+bool SegmentFile::write_at(uint64_t offset, const FrameSegment* segments, size_t count) {
+    if (!is_open()) {
+        return false;
+    }
+    if (offset != position_) {
+#ifdef _WIN32
+        if (_fseeki64(file_, static_cast<__int64>(offset), SEEK_SET) != 0) return false;
+#else
+        if (lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0) return false;
+#endif
+        position_ = offset;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += segments[i].size;
+    }
+#ifdef _WIN32
+    for (size_t i = 0; i < count; ++i) {
+        if (segments[i].size > 0 && fwrite(segments[i].data, segments[i].size, 1, file_) != 1) {
+            return false;
+        }
+    }
+#else
+    if (!write_segments(fd_, segments, count)) {
+        return false;
+    }
+#endif
+    position_ += total;
+    return true;
+}
+
+bool SegmentFile::write_at(uint64_t offset, const void* data, size_t size) {
+    const FrameSegment segment = {static_cast<const u_char*>(data), size};
+    return write_at(offset, &segment, 1);
+}
+
+bool SegmentFile::preallocate(uint64_t offset, uint64_t length) {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    return is_open() && fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(length)) == 0;
+#else
+    (void)offset;
+    (void)length;
+    return false;
+#endif
+}
+
+bool SegmentFile::truncate(uint64_t size) {
+    if (!is_open()) {
+        return false;
+    }
+#ifdef _WIN32
+    return fflush(file_) == 0 && _chsize_s(_fileno(file_), static_cast<__int64>(size)) == 0;
+#else
+    return ftruncate(fd_, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+bool SegmentFile::sync() {
+    if (!is_open()) {
+        return false;
+    }
+#ifdef _WIN32
+    return fflush(file_) == 0 && _commit(_fileno(file_)) == 0;
+#else
+    return fdatasync(fd_) == 0;
+#endif
+}
+
+void SegmentFile::close() {
+#ifdef _WIN32
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+#else
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+bool write_frame_file(const std::string& path, const std::vector<std::vector<u_char>>& segments) {
+    thread_local std::vector<FrameSegment> views;
+    views.clear();
+    for (const auto& segment : segments) {
+        views.push_back({segment.data(), segment.size()});
+    }
+    return write_frame_file(path, views.data(), views.size());
+}
@@ -0,0 +1,250 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "frame_preview.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <turbojpeg.h>
+
+#include "yuyv_to_rgb.hpp"
+
+namespace {
+
+// One decompressor per develop thread, like JpegEncoder::thread_instance()
+struct PreviewDecoder {
+    tjhandle handle = nullptr;
+    std::vector<u_char> joined;
+    std::vector<u_char> downscaled;
+
+    ~PreviewDecoder() {
+        if (handle) tjDestroy(handle);
+    }
+};
+
+PreviewDecoder& preview_decoder() {
+    thread_local PreviewDecoder decoder;
+    return decoder;
+}
+
+const u_char* contiguous(const std::vector<std::vector<u_char>>& frame_data, size_t& size) {
+    size = 0;
+    for (const auto& payload : frame_data) size += payload.size();
+    if (frame_data.size() == 1) {
+        return frame_data[0].data();
+    }
+    std::vector<u_char>& joined = preview_decoder().joined;
+    joined.resize(size);
+    size_t offset = 0;
+    for (const auto& payload : frame_data) {
+        if (!payload.empty()) {
+            std::memcpy(joined.data() + offset, payload.data(), payload.size());
+            offset += payload.size();
+        }
+    }
+    return joined.data();
+}
+
+} // namespace
+
+void PreviewCache::set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evict_locked();
+}
+
+void PreviewCache::evict_locked() {
+    while (order_.size() > capacity_) {
+        frames_.erase(order_.back()->frame_number);
+        order_.pop_back();
+    }
+}
+
+void PreviewCache::put(std::shared_ptr<const PreviewFrame> frame) {
+    if (!frame) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = frames_.find(frame->frame_number);
+    if (found != frames_.end()) {
+        order_.erase(found->second);
+        frames_.erase(found);
+    }
+    order_.push_front(std::move(frame));
+    frames_[order_.front()->frame_number] = order_.begin();
+    evict_locked();
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<const PreviewFrame> PreviewCache::get(int frame_number) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = frames_.find(frame_number);
+    if (found == frames_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    order_.splice(order_.begin(), order_, found->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return order_.front();
+}
+
+void PreviewCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    order_.clear();
+    frames_.clear();
+}
+
+size_t PreviewCache::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return order_.size();
+}
+
+FramePreview& FramePreview::instance() {
+    static FramePreview preview;
+    return preview;
+}
+
+bool FramePreview::wants(const DevelopFrameFormat& frame_format) const {
+    return enabled() && (frame_format.error_frame || !errors_only_.load(std::memory_order_relaxed));
+}
+
+void FramePreview::set_target_size(int width, int height) {
+    target_width_.store(std::max(0, width), std::memory_order_relaxed);
+    target_height_.store(std::max(0, height), std::memory_order_relaxed);
+}
+
+int FramePreview::scale_for(int width, int height) const {
+    const int target_width = target_width_.load(std::memory_order_relaxed);
+    const int target_height = target_height_.load(std::memory_order_relaxed);
+    int scale = 8;
+    while (scale > 1 && (width / scale < target_width || height / scale < target_height)) {
+        scale /= 2;
+    }
+    return scale;
+}
+
+bool FramePreview::decode(const DevelopFrameFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data,
+                          PreviewFrame& out) {
+    if (frame_format.width <= 0 || frame_format.height <= 0) {
+        return false;
+    }
+    size_t size = 0;
+    const u_char* data = contiguous(frame_data, size);
+    const size_t rgb_size = size_t(frame_format.width) * frame_format.height * 3;
+
+    if (frame_format.format == FRAME_FORMAT_MJPEG) {
+        PreviewDecoder& decoder = preview_decoder();
+        if (!decoder.handle && !(decoder.handle = tjInitDecompress())) {
+            return false;
+        }
+        int width = 0, height = 0, subsampling = 0, colorspace = 0;
+        if (tjDecompressHeader3(decoder.handle, data, static_cast<unsigned long>(size), &width, &height,
+                                &subsampling, &colorspace) != 0) {
+            return false;
+        }
+        // Scaled IDCT: each 8x8 block is transformed straight to 8 / scale pixels per side,
+        // only the entropy decode still touches the whole frame
+        const int scale = scale_for(width, height);
+        const tjscalingfactor factor = {1, scale};
+        const int scaled_width = TJSCALED(width, factor);
+        const int scaled_height = TJSCALED(height, factor);
+        out.rgb.resize(size_t(scaled_width) * scaled_height * 3);
+        // Error frames are often cut short; whatever decodes is still worth showing
+        if (tjDecompress2(decoder.handle, data, static_cast<unsigned long>(size), out.rgb.data(), scaled_width, 0,
+                          scaled_height, TJPF_RGB, TJFLAG_FASTDCT) != 0 &&
+            tjGetErrorCode(decoder.handle) == TJERR_FATAL) {
+            return false;
+        }
+        out.width = scaled_width;
+        out.height = scaled_height;
+        out.scale = scale;
+        return true;
+    }
+
+    if (frame_format.format == FRAME_FORMAT_YUYV) {
+        const int scale = scale_for(frame_format.width, frame_format.height);
+        const int scaled_width = downscaled_yuyv_width(frame_format.width, scale);
+        const int scaled_height = frame_format.height / scale;
+        if (scaled_width <= 0 || scaled_height <= 0) {
+            return false;
+        }
+        const u_char* yuyv = data;
+        size_t yuyv_size = size;
+        if (scale > 1) {
+            std::vector<u_char>& downscaled = preview_decoder().downscaled;
+            downscaled.resize(size_t(scaled_width) * scaled_height * 2);
+            downscaleYUYV(data, size, frame_format.width, frame_format.height, scale, downscaled.data());
+            yuyv = downscaled.data();
+            yuyv_size = downscaled.size();
+        }
+        out.rgb.resize(size_t(scaled_width) * scaled_height * 3);
+        convertYUYVtoRGB(yuyv, yuyv_size, scaled_width, scaled_height, out.rgb.data(), 1);
+        out.width = scaled_width;
+        out.height = scaled_height;
+        out.scale = scale;
+        return true;
+    }
+    if (frame_format.format == FRAME_FORMAT_RGB) {
+        // Synthetic streams only; kept at full size
+        out.rgb.resize(rgb_size);
+        const size_t copied = std::min(size, rgb_size);
+        std::memcpy(out.rgb.data(), data, copied);
+        std::memset(out.rgb.data() + copied, 0, rgb_size - copied);
+        out.width = frame_format.width;
+        out.height = frame_format.height;
+        out.scale = 1;
+        return true;
+    }
+    return false;
+}
+
+bool FramePreview::publish(const DevelopFrameFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data) {
+    auto frame = std::make_shared<PreviewFrame>();
+    if (!decode(frame_format, frame_data, *frame)) {
+        return false;
+    }
+    frame->frame_number = frame_format.frame_number;
+    frame->error_frame = frame_format.error_frame;
+    cache.put(frame);
+
+    std::unique_lock<std::mutex> lock(writer_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return true;
+    }
+    // Assignment keeps the back buffer's capacity
+    buffers_[back_] = *frame;
+
+    const uint8_t previous = middle_.exchange(static_cast<uint8_t>(back_ | kFresh), std::memory_order_acq_rel);
+    back_ = previous & 0x3;
+    published_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool FramePreview::acquire() {
+    if (!(middle_.load(std::memory_order_acquire) & kFresh)) {
+        return false;
+    }
+    const uint8_t previous = middle_.exchange(static_cast<uint8_t>(front_), std::memory_order_acq_rel);
+    front_ = previous & 0x3;
+    return true;
+}
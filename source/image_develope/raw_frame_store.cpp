@@ -0,0 +1,332 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "raw_frame_store.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+void put16(u_char* out, uint16_t value) {
+    out[0] = static_cast<u_char>(value);
+    out[1] = static_cast<u_char>(value >> 8);
+}
+
+void put32(u_char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<u_char>(value >> (8 * i));
+}
+
+void put64(u_char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out[i] = static_cast<u_char>(value >> (8 * i));
+}
+
+uint16_t get16(const u_char* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t get32(const u_char* in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) value = (value << 8) | in[i];
+    return value;
+}
+
+uint64_t get64(const u_char* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) value = (value << 8) | in[i];
+    return value;
+}
+
+uint64_t align_up(uint64_t value) {
+    return (value + RAW_FRAME_ALIGN - 1) / RAW_FRAME_ALIGN * RAW_FRAME_ALIGN;
+}
+
+u_char* aligned_alloc_bytes(size_t size) {
+#ifdef _WIN32
+    return static_cast<u_char*>(_aligned_malloc(size, RAW_FRAME_ALIGN));
+#else
+    void* out = nullptr;
+    return posix_memalign(&out, RAW_FRAME_ALIGN, size) == 0 ? static_cast<u_char*>(out) : nullptr;
+#endif
+}
+
+void aligned_free_bytes(u_char* data) {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+} // namespace
+
+bool parse_raw_store_mode(const char* name, RawStoreMode& mode) {
+    if (strcmp(name, "off") == 0) {
+        mode = RAW_STORE_OFF;
+    } else if (strcmp(name, "errors") == 0) {
+        mode = RAW_STORE_ERRORS;
+    } else if (strcmp(name, "all") == 0) {
+        mode = RAW_STORE_ALL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+RawFrameWriter::~RawFrameWriter() {
+    close();
+    aligned_free_bytes(arena_);
+}
+
+bool RawFrameWriter::reserve_arena(size_t size) {
+    if (size <= arena_size_) {
+        return true;
+    }
+    // Grow in steps so a slowly growing MJPEG size does not reallocate on every frame
+    const size_t grown = static_cast<size_t>(align_up(size + size / 4));
+    u_char* arena = aligned_alloc_bytes(grown);
+    if (arena == nullptr) {
+        return false;
+    }
+    aligned_free_bytes(arena_);
+    arena_ = arena;
+    arena_size_ = grown;
+    return true;
+}
+
+bool RawFrameWriter::open(const std::string& base_path, uint64_t preallocate) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    preallocate_ = align_up(preallocate);
+    frames_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+
+    if (!data_.open(base_path + ".uvcraw", true)) {
+        return false;
+    }
+    index_.open(base_path + ".uvcridx", std::ios::binary | std::ios::trunc);
+    if (!index_.is_open()) {
+        std::cerr << "Error: Could not open file " << base_path << ".uvcridx for writing." << std::endl;
+        data_.close();
+        return false;
+    }
+
+    if (!reserve_arena(RAW_FRAME_ALIGN)) {
+        data_.close();
+        index_.close();
+        return false;
+    }
+    std::memset(arena_, 0, RAW_FRAME_ALIGN);
+    std::memcpy(arena_, RAW_FRAME_MAGIC, 8);
+    put32(arena_ + 8, RAW_FRAME_VERSION);
+    put32(arena_ + 12, RAW_FRAME_ALIGN);
+    put32(arena_ + 16, RAW_FRAME_ALIGN);
+
+    u_char index_header[RAW_FRAME_INDEX_HEADER];
+    std::memcpy(index_header, RAW_FRAME_INDEX_MAGIC, 8);
+    put32(index_header + 8, RAW_FRAME_VERSION);
+    put32(index_header + 12, RAW_FRAME_INDEX_HEADER);
+    put32(index_header + 16, RAW_FRAME_INDEX_ENTRY);
+    index_.write(reinterpret_cast<const char*>(index_header), sizeof(index_header));
+    index_.flush();
+
+    allocated_ = 0;
+    if (preallocate_ > 0 && data_.preallocate(0, preallocate_)) {
+        allocated_ = preallocate_;
+    }
+    if (!data_.write_at(0, arena_, RAW_FRAME_ALIGN) || !index_) {
+        std::cerr << "Error: Could not write the raw frame store header " << base_path << std::endl;
+        data_.close();
+        index_.close();
+        return false;
+    }
+    offset_ = RAW_FRAME_ALIGN;
+    return true;
+}
+
+bool RawFrameWriter::write(const DevelopFrameFormat& frame_format, const std::vector<std::vector<u_char>>& frame_data) {
+    size_t size = 0;
+    for (const auto& payload : frame_data) {
+        size += payload.size();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!data_.is_open()) {
+        return false;
+    }
+
+    // O_DIRECT needs aligned memory, offset and length, so the frame is gathered into the arena
+    const uint64_t padded = align_up(size);
+    if (!reserve_arena(static_cast<size_t>(padded))) {
+        std::cerr << "Error: Raw frame store could not allocate " << padded << " bytes" << std::endl;
+        return false;
+    }
+    u_char* out = arena_;
+    for (const auto& payload : frame_data) {
+        if (!payload.empty()) {
+            std::memcpy(out, payload.data(), payload.size());
+            out += payload.size();
+        }
+    }
+    std::memset(out, 0, static_cast<size_t>(padded - size));
+
+    if (allocated_ > 0 && offset_ + padded > allocated_) {
+        const uint64_t extend = std::max<uint64_t>(preallocate_, padded);
+        if (data_.preallocate(allocated_, extend)) {
+            allocated_ += extend;
+        }
+    }
+    if (!data_.write_at(offset_, arena_, static_cast<size_t>(padded))) {
+        std::cerr << "Error: Could not write raw frame " << frame_format.frame_number << std::endl;
+        return false;
+    }
+
+    u_char entry[RAW_FRAME_INDEX_ENTRY] = {};
+    put32(entry + 0, static_cast<uint32_t>(frame_format.frame_number));
+    entry[4] = static_cast<u_char>(frame_format.format);
+    put16(entry + 6, static_cast<uint16_t>(frame_format.frame_error));
+    put16(entry + 8, static_cast<uint16_t>(frame_format.frame_suspicious));
+    put16(entry + 10, static_cast<uint16_t>(frame_format.width));
+    put16(entry + 12, static_cast<uint16_t>(frame_format.height));
+    put64(entry + 16, offset_);
+    put32(entry + 24, static_cast<uint32_t>(size));
+    put32(entry + 28, frame_format.pts);
+    put64(entry + 32, static_cast<uint64_t>(frame_format.first_received_ns));
+    put64(entry + 40, static_cast<uint64_t>(frame_format.last_received_ns));
+    index_.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+    index_.flush();
+
+    offset_ += padded;
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(size, std::memory_order_relaxed);
+    return static_cast<bool>(index_);
+}
+
+void RawFrameWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (data_.is_open()) {
+        // Give back the preallocated tail
+        data_.truncate(offset_);
+        data_.sync();
+        data_.close();
+    }
+    if (index_.is_open()) {
+        index_.close();
+    }
+}
+
+bool RawFrameWriter::is_open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return data_.is_open();
+}
+
+bool RawFrameWriter::direct() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return data_.direct();
+}
+
+bool RawFrameReader::open(const std::string& base_path) {
+    entries_.clear();
+    error_.clear();
+    data_.close();
+
+    std::ifstream index(base_path + ".uvcridx", std::ios::binary);
+    if (!index.is_open()) {
+        error_ = "cannot open " + base_path + ".uvcridx";
+        return false;
+    }
+    u_char header[RAW_FRAME_INDEX_HEADER];
+    if (!index.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, RAW_FRAME_INDEX_MAGIC, 8) != 0) {
+        error_ = base_path + ".uvcridx is not a raw frame index";
+        return false;
+    }
+    const uint32_t entry_size = get32(header + 16);
+    if (get32(header + 8) != RAW_FRAME_VERSION || entry_size < RAW_FRAME_INDEX_ENTRY) {
+        error_ = base_path + ".uvcridx has an unsupported version";
+        return false;
+    }
+    index.seekg(get32(header + 12));
+
+    data_.open(base_path + ".uvcraw", std::ios::binary);
+    if (!data_.is_open()) {
+        error_ = "cannot open " + base_path + ".uvcraw";
+        return false;
+    }
+    u_char data_header[16];
+    if (!data_.read(reinterpret_cast<char*>(data_header), sizeof(data_header)) ||
+        std::memcmp(data_header, RAW_FRAME_MAGIC, 8) != 0) {
+        error_ = base_path + ".uvcraw is not a raw frame store";
+        return false;
+    }
+    data_.seekg(0, std::ios::end);
+    data_size_ = static_cast<uint64_t>(data_.tellg());
+
+    // A killed writer can leave a partial last entry, or an entry past the truncated data
+    std::vector<u_char> entry(entry_size);
+    while (index.read(reinterpret_cast<char*>(entry.data()), entry_size)) {
+        const u_char* e = entry.data();
+        RawFrameEntry parsed;
+        parsed.frame_number = get32(e + 0);
+        parsed.format = static_cast<FrameFormat>(e[4]);
+        parsed.frame_error = get16(e + 6);
+        parsed.frame_suspicious = get16(e + 8);
+        parsed.width = get16(e + 10);
+        parsed.height = get16(e + 12);
+        parsed.offset = get64(e + 16);
+        parsed.size = get32(e + 24);
+        parsed.pts = get32(e + 28);
+        parsed.first_received_ns = static_cast<int64_t>(get64(e + 32));
+        parsed.last_received_ns = static_cast<int64_t>(get64(e + 40));
+        if (parsed.offset + parsed.size > data_size_) {
+            break;
+        }
+        entries_.push_back(parsed);
+    }
+    return true;
+}
+
+const RawFrameEntry* RawFrameReader::find(uint32_t frame_number) const {
+    for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+        if (it->frame_number == frame_number) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+bool RawFrameReader::read(const RawFrameEntry& entry, std::vector<u_char>& data) {
+    if (!data_.is_open() || entry.offset + entry.size > data_size_) {
+        return false;
+    }
+    data.resize(entry.size);
+    data_.clear();
+    data_.seekg(static_cast<std::streamoff>(entry.offset));
+    return static_cast<bool>(data_.read(reinterpret_cast<char*>(data.data()), entry.size));
+}
@@ -22,8 +22,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <turbojpeg.h>
 
+#include "frame_file.hpp"
 #include "rgb_to_jpeg.hpp"
 
 std::vector<u_char> readRGBFile(const std::string& filename, int width, int height) {
@@ -44,50 +46,143 @@ std::vector<u_char> readRGBFile(const std::string& filename, int width, int heig
     return rgbData;
 }
 
-bool saveJPEG(const std::vector<u_char>& rgbData, int width, int height, const std::string& filename) {
-    tjhandle compressor = tjInitCompress();
-    if (!compressor) {
-        std::cerr << "Error: Could not initialize TurboJPEG compressor." << std::endl;
-        return false;
+namespace {
+
+bool writeJPEGFile(const unsigned char* jpegBuffer, unsigned long jpegSize, const std::string& filename) {
+    const FrameSegment segment = {jpegBuffer, jpegSize};
+    return write_frame_file(filename, &segment, 1);
+}
+
+std::mutex& settings_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+JpegSettings& current_settings() {
+    static JpegSettings settings;
+    return settings;
+}
+
+} // namespace
+
+JpegSettings jpeg_settings() {
+    std::lock_guard<std::mutex> lock(settings_mutex());
+    return current_settings();
+}
+
+void set_jpeg_settings(const JpegSettings& settings) {
+    std::lock_guard<std::mutex> lock(settings_mutex());
+    current_settings() = settings;
+}
+
+bool parse_jpeg_subsampling(const std::string& name, int& subsampling) {
+    static const struct { const char* name; int value; } names[] = {
+        {"auto", -1}, {"444", TJSAMP_444}, {"422", TJSAMP_422}, {"420", TJSAMP_420}, {"gray", TJSAMP_GRAY},
+        {"440", TJSAMP_440}, {"411", TJSAMP_411}, {"441", TJSAMP_441},
+    };
+    for (const auto& entry : names) {
+        if (name == entry.name) {
+            subsampling = entry.value;
+            return true;
+        }
     }
+    return false;
+}
 
-    unsigned char* jpegBuffer = nullptr;
-    unsigned long jpegSize = 0;
-    int quality = 85;
+JpegEncoder& JpegEncoder::thread_instance() {
+    thread_local JpegEncoder encoder;
+    return encoder;
+}
 
-    if (tjCompress2(compressor, rgbData.data(), width, 0, height, TJPF_RGB, &jpegBuffer, &jpegSize, TJSAMP_444, quality, TJFLAG_FASTDCT) < 0) {
-        std::cerr << "Error: Failed to compress JPEG image: " << tjGetErrorStr() << std::endl;
-        tjDestroy(compressor);
-        return false;
+JpegEncoder::~JpegEncoder() {
+    if (buffer_) {
+        tjFree(buffer_);
+    }
+    if (handle_) {
+        tjDestroy(handle_);
     }
+}
 
-    FILE* outfile = nullptr;
-#ifdef _WIN32
-    if (fopen_s(&outfile, filename.c_str(), "wb") != 0 || !outfile) {
-        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
-        tjFree(jpegBuffer);
-        tjDestroy(compressor);
-        return false;
+bool JpegEncoder::prepare(int width, int height, int subsampling) {
+    if (!handle_) {
+        handle_ = tjInitCompress();
+        if (!handle_) {
+            std::cerr << "Error: Could not initialize TurboJPEG compressor." << std::endl;
+            return false;
+        }
     }
-#else
-    outfile = fopen(filename.c_str(), "wb");
-    if (!outfile) {
-        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
-        tjFree(jpegBuffer);
-        tjDestroy(compressor);
+    const unsigned long needed = tjBufSize(width, height, subsampling);
+    if (needed == static_cast<unsigned long>(-1)) {
+        std::cerr << "Error: Invalid JPEG size " << width << "x" << height << std::endl;
         return false;
     }
+    if (needed > capacity_) {
+        if (buffer_) {
+            tjFree(buffer_);
+        }
+        buffer_ = tjAlloc(static_cast<int>(needed));
+        capacity_ = buffer_ ? needed : 0;
+        if (!buffer_) {
+            std::cerr << "Error: Could not allocate " << needed << " bytes for JPEG output." << std::endl;
+            return false;
+        }
+    }
+    size_ = capacity_;
+    return true;
+}
 
-#endif
+int JpegEncoder::flags(const JpegSettings& settings) const {
+    return TJFLAG_NOREALLOC | (settings.fast_dct ? TJFLAG_FASTDCT : TJFLAG_ACCURATEDCT);
+}
 
-    fwrite(jpegBuffer, jpegSize, 1, outfile);
-    fclose(outfile);
+bool JpegEncoder::compress_rgb(const u_char* rgb, int width, int height, const JpegSettings& settings) {
+    const int subsampling = settings.subsampling < 0 ? TJSAMP_444 : settings.subsampling;
+    if (!prepare(width, height, subsampling)) {
+        return false;
+    }
+    if (tjCompress2(handle_, rgb, width, 0, height, TJPF_RGB, &buffer_, &size_, subsampling, settings.quality, flags(settings)) < 0) {
+        std::cerr << "Error: Failed to compress JPEG image: " << tjGetErrorStr2(handle_) << std::endl;
+        size_ = 0;
+        return false;
+    }
+    return true;
+}
 
-    tjFree(jpegBuffer);
-    tjDestroy(compressor);
+bool JpegEncoder::compress_yuv422(const u_char* planes[3], int width, int height, const JpegSettings& settings) {
+    const int subsampling = settings.subsampling < 0 ? TJSAMP_422 : settings.subsampling;
+    if (subsampling != TJSAMP_422 && subsampling != TJSAMP_420 && subsampling != TJSAMP_GRAY) {
+        std::cerr << "Error: YUYV planes cannot be written with JPEG subsampling " << subsampling << std::endl;
+        return false;
+    }
+    // Chroma rows are width / 2 bytes; 4:2:0 steps over every second one
+    const int chroma_stride = subsampling == TJSAMP_420 ? (width / 2) * 2 : width / 2;
+    const int strides[3] = {width, chroma_stride, chroma_stride};
+    if (!prepare(width, height, subsampling)) {
+        return false;
+    }
+    if (tjCompressFromYUVPlanes(handle_, planes, width, strides, height, subsampling, &buffer_, &size_, settings.quality, flags(settings)) < 0) {
+        std::cerr << "Error: Failed to compress JPEG image: " << tjGetErrorStr2(handle_) << std::endl;
+        size_ = 0;
+        return false;
+    }
+    return true;
+}
 
+bool saveJPEG(const std::vector<u_char>& rgbData, int width, int height, const std::string& filename) {
+    JpegEncoder& encoder = JpegEncoder::thread_instance();
+    if (!encoder.compress_rgb(rgbData.data(), width, height, jpeg_settings())) {
+        return false;
+    }
     // std::cout << "JPEG file saved as " << filename << std::endl;
-    return true;
+    return writeJPEGFile(encoder.data(), encoder.size(), filename);
+}
+
+bool saveJPEGFromYUV422(const u_char* planes[3], int width, int height, const std::string& filename) {
+    JpegEncoder& encoder = JpegEncoder::thread_instance();
+    if (!encoder.compress_yuv422(planes, width, height, jpeg_settings())) {
+        return false;
+    }
+    return writeJPEGFile(encoder.data(), encoder.size(), filename);
 }
 
 
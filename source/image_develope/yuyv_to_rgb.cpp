@@ -22,22 +22,52 @@
 
 #include <turbojpeg.h>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
 
 #include "yuyv_to_rgb.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define YUYV_RGB_X86 1
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || (defined(__ARM_NEON) && defined(__arm__))
+  #define YUYV_RGB_ARM 1
+  #include <arm_neon.h>
+#endif
+
+#if defined(YUYV_RGB_X86) && (defined(__GNUC__) || defined(__clang__))
+  #define YUYV_RGB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define YUYV_RGB_TARGET_AVX2
+#endif
+
 #ifdef _WIN32
 typedef unsigned char u_char;
 #endif
 
-std::vector<u_char> convertYUYVtoRGB(const std::vector<u_char>& yuyvData, int width, int height) {
-    std::vector<u_char> rgbData(width * height * 3);
-    int pixelPairs = (width * height) / 2;
-    
-    for (int i = 0; i < pixelPairs; ++i) {
-        int y0 = yuyvData[i * 4 + 0] - 16;
-        int u  = yuyvData[i * 4 + 1] - 128;
-        int y1 = yuyvData[i * 4 + 2] - 16;
-        int v  = yuyvData[i * 4 + 3] - 128;
+// BT.601 studio range to RGB in 8.8 fixed point:
+//   R = (298 (Y - 16) + 409 (V - 128) + 128) >> 8
+//   G = (298 (Y - 16) - 100 (U - 128) - 208 (V - 128) + 256) >> 8
+//   B = (298 (Y - 16) + 516 (U - 128) + 128) >> 8
+// clamped to 0..255. The SIMD kernels use the same 32 bit sums, so every pixel is bit exact.
+// Each kernel converts pairs [begin, end) of a frame; pair i reads yuyv[4i..4i+3] and writes rgb[6i..6i+5]
+typedef void (*YuyvRgbFn)(const u_char* yuyv, u_char* rgb, size_t begin, size_t end);
+// Splits count pairs into y (2 per pair), u and v (1 per pair)
+typedef void (*YuyvPlanesFn)(const u_char* yuyv, u_char* y, u_char* u, u_char* v, size_t count);
+
+namespace {
+
+void yuyv_rgb_scalar(const u_char* yuyv, u_char* rgb, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        int y0 = yuyv[i * 4 + 0] - 16;
+        int u  = yuyv[i * 4 + 1] - 128;
+        int y1 = yuyv[i * 4 + 2] - 16;
+        int v  = yuyv[i * 4 + 3] - 128;
 
         int c0 = 298 * y0;
         int c1 = 298 * y1;
@@ -46,15 +76,486 @@ std::vector<u_char> convertYUYVtoRGB(const std::vector<u_char>& yuyvData, int wi
         int f  = -208 * v + 128;
         int g  = 516 * u + 128;
 
-        int rgbIndex = i * 6;
-        rgbData[rgbIndex + 0] = std::clamp((c0 + d) >> 8, 0, 255);
-        rgbData[rgbIndex + 1] = std::clamp((c0 + e + f) >> 8, 0, 255);
-        rgbData[rgbIndex + 2] = std::clamp((c0 + g) >> 8, 0, 255);
+        size_t rgbIndex = i * 6;
+        rgb[rgbIndex + 0] = static_cast<u_char>(std::clamp((c0 + d) >> 8, 0, 255));
+        rgb[rgbIndex + 1] = static_cast<u_char>(std::clamp((c0 + e + f) >> 8, 0, 255));
+        rgb[rgbIndex + 2] = static_cast<u_char>(std::clamp((c0 + g) >> 8, 0, 255));
+
+        rgb[rgbIndex + 3] = static_cast<u_char>(std::clamp((c1 + d) >> 8, 0, 255));
+        rgb[rgbIndex + 4] = static_cast<u_char>(std::clamp((c1 + e + f) >> 8, 0, 255));
+        rgb[rgbIndex + 5] = static_cast<u_char>(std::clamp((c1 + g) >> 8, 0, 255));
+    }
+}
+
+// JPEG (JFIF) YCbCr is full range, UVC YUYV is studio range, so the planes are expanded on the way:
+//   Y' = ((Y - 16) 149 + 64) >> 7           = (149 Y - 2320) >> 7, the 298 / 256 luma scale of the RGB path
+//   C' = ((C - 128) 146 + 64) >> 7 + 128    = (146 C - 2240) >> 7
+// clamped to 0..255. Both products fit in uint16, so the SIMD kernels use a saturating subtract for the clamp at 0
+#define PLANE_LUMA_SCALE 149
+#define PLANE_LUMA_BIAS 2320
+#define PLANE_CHROMA_SCALE 146
+#define PLANE_CHROMA_BIAS 2240
+
+inline u_char expand_range(int value, int scale, int bias) {
+    return static_cast<u_char>(std::clamp((value * scale - bias) >> 7, 0, 255));
+}
+
+void yuyv_planes_scalar(const u_char* yuyv, u_char* y, u_char* u, u_char* v, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        y[i * 2 + 0] = expand_range(yuyv[i * 4 + 0], PLANE_LUMA_SCALE, PLANE_LUMA_BIAS);
+        u[i]         = expand_range(yuyv[i * 4 + 1], PLANE_CHROMA_SCALE, PLANE_CHROMA_BIAS);
+        y[i * 2 + 1] = expand_range(yuyv[i * 4 + 2], PLANE_LUMA_SCALE, PLANE_LUMA_BIAS);
+        v[i]         = expand_range(yuyv[i * 4 + 3], PLANE_CHROMA_SCALE, PLANE_CHROMA_BIAS);
+    }
+}
+
+// Adds count bytes of one YUYV row to 16 bit column sums (downscaleYUYV, at most 8 rows of 255)
+typedef void (*YuyvRowSumFn)(const u_char* row, uint16_t* sums, size_t count);
+
+void yuyv_row_sum_scalar(const u_char* row, uint16_t* sums, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        sums[i] = static_cast<uint16_t>(sums[i] + row[i]);
+    }
+}
+
+#ifdef YUYV_RGB_X86
+// Two int16 multipliers in one 32 bit lane, the operand of madd_epi16
+constexpr int madd_pair(int first, int second) {
+    return static_cast<int>((static_cast<uint32_t>(first) & 0xFFFF) | (static_cast<uint32_t>(second) << 16));
+}
+
+// 8 pixels (4 pairs) per step. madd_epi16 forms the 32 bit sums from (Y, V), (Y, U) and (V, 1) lanes,
+// packs_epi32 / packus_epi16 do the clamp. Pixels are stored as overlapping 4 byte RGBx writes,
+// so the loop stops while at least one pair is left for the scalar tail to overwrite the spare byte.
+void yuyv_rgb_sse2(const u_char* yuyv, u_char* rgb, size_t begin, size_t end) {
+    const __m128i mask_y = _mm_set1_epi16(0x00FF);
+    const __m128i bias_y = _mm_set1_epi16(16);
+    const __m128i bias_uv = _mm_set1_epi16(128);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i k_r = _mm_set1_epi32(madd_pair(298, 409));
+    const __m128i k_b = _mm_set1_epi32(madd_pair(298, 516));
+    const __m128i k_gu = _mm_set1_epi32(madd_pair(298, -100));
+    const __m128i k_gv = _mm_set1_epi32(madd_pair(-208, 256));
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = begin;
+    for (; i + 4 < end; i += 4) {
+        __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuyv + i * 4));
+        __m128i y = _mm_sub_epi16(_mm_and_si128(src, mask_y), bias_y);
+        __m128i uv = _mm_sub_epi16(_mm_srli_epi16(src, 8), bias_uv);
+        __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+        __m128i yv_lo = _mm_unpacklo_epi16(y, v), yv_hi = _mm_unpackhi_epi16(y, v);
+        __m128i yu_lo = _mm_unpacklo_epi16(y, u), yu_hi = _mm_unpackhi_epi16(y, u);
+        __m128i v1_lo = _mm_unpacklo_epi16(v, one), v1_hi = _mm_unpackhi_epi16(v, one);
+
+        __m128i r = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv_lo, k_r), round), 8),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv_hi, k_r), round), 8));
+        __m128i g = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_lo, k_gu), _mm_madd_epi16(v1_lo, k_gv)), 8),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_hi, k_gu), _mm_madd_epi16(v1_hi, k_gv)), 8));
+        __m128i b = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_lo, k_b), round), 8),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_hi, k_b), round), 8));
+
+        __m128i rg8 = _mm_packus_epi16(r, g);
+        __m128i b8 = _mm_packus_epi16(b, b);
+        __m128i rg = _mm_unpacklo_epi8(rg8, _mm_srli_si128(rg8, 8));
+        __m128i bz = _mm_unpacklo_epi8(b8, zero);
+
+        alignas(16) uint32_t pixels[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(pixels), _mm_unpacklo_epi16(rg, bz));
+        _mm_store_si128(reinterpret_cast<__m128i*>(pixels + 4), _mm_unpackhi_epi16(rg, bz));
+        u_char* out = rgb + i * 6;
+        for (int p = 0; p < 8; ++p) {
+            std::memcpy(out + p * 3, &pixels[p], 4);
+        }
+    }
+    yuyv_rgb_scalar(yuyv, rgb, i, end);
+}
+
+// Same arithmetic on 16 pixels; unpack / pack work per 128 bit lane, which keeps pixels in order.
+// pshufb drops the x byte, each lane is stored as 16 bytes of which the last 4 are overwritten later.
+YUYV_RGB_TARGET_AVX2
+void yuyv_rgb_avx2(const u_char* yuyv, u_char* rgb, size_t begin, size_t end) {
+    const __m256i mask_y = _mm256_set1_epi16(0x00FF);
+    const __m256i bias_y = _mm256_set1_epi16(16);
+    const __m256i bias_uv = _mm256_set1_epi16(128);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i k_r = _mm256_set1_epi32(madd_pair(298, 409));
+    const __m256i k_b = _mm256_set1_epi32(madd_pair(298, 516));
+    const __m256i k_gu = _mm256_set1_epi32(madd_pair(298, -100));
+    const __m256i k_gv = _mm256_set1_epi32(madd_pair(-208, 256));
+    const __m256i round = _mm256_set1_epi32(128);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i drop_x = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    size_t i = begin;
+    for (; i + 8 < end; i += 8) {
+        __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(yuyv + i * 4));
+        __m256i y = _mm256_sub_epi16(_mm256_and_si256(src, mask_y), bias_y);
+        __m256i uv = _mm256_sub_epi16(_mm256_srli_epi16(src, 8), bias_uv);
+        __m256i u = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        __m256i v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+        __m256i yv_lo = _mm256_unpacklo_epi16(y, v), yv_hi = _mm256_unpackhi_epi16(y, v);
+        __m256i yu_lo = _mm256_unpacklo_epi16(y, u), yu_hi = _mm256_unpackhi_epi16(y, u);
+        __m256i v1_lo = _mm256_unpacklo_epi16(v, one), v1_hi = _mm256_unpackhi_epi16(v, one);
+
+        __m256i r = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yv_lo, k_r), round), 8),
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yv_hi, k_r), round), 8));
+        __m256i g = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu_lo, k_gu), _mm256_madd_epi16(v1_lo, k_gv)), 8),
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu_hi, k_gu), _mm256_madd_epi16(v1_hi, k_gv)), 8));
+        __m256i b = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu_lo, k_b), round), 8),
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu_hi, k_b), round), 8));
+
+        __m256i rg8 = _mm256_packus_epi16(r, g);
+        __m256i b8 = _mm256_packus_epi16(b, b);
+        __m256i rg = _mm256_unpacklo_epi8(rg8, _mm256_srli_si256(rg8, 8));
+        __m256i bz = _mm256_unpacklo_epi8(b8, zero);
+        __m256i rgb_lo = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg, bz), drop_x);     // pixels 0-3, 8-11
+        __m256i rgb_hi = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg, bz), drop_x);     // pixels 4-7, 12-15
+
+        u_char* out = rgb + i * 6;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(rgb_lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm256_castsi256_si128(rgb_hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 24), _mm256_extracti128_si256(rgb_lo, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 36), _mm256_extracti128_si256(rgb_hi, 1));
+    }
+    yuyv_rgb_scalar(yuyv, rgb, i, end);
+}
+
+// 16 pairs per step: even bytes are Y, the odd bytes (U V U V ...) are expanded, packed and split once more
+void yuyv_planes_sse2(const u_char* yuyv, u_char* y, u_char* u, u_char* v, size_t count) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i luma_scale = _mm_set1_epi16(PLANE_LUMA_SCALE), luma_bias = _mm_set1_epi16(PLANE_LUMA_BIAS);
+    const __m128i chroma_scale = _mm_set1_epi16(PLANE_CHROMA_SCALE), chroma_bias = _mm_set1_epi16(PLANE_CHROMA_BIAS);
+    auto luma = [&](__m128i a) {
+        return _mm_srli_epi16(_mm_subs_epu16(_mm_mullo_epi16(_mm_and_si128(a, mask), luma_scale), luma_bias), 7);
+    };
+    auto chroma = [&](__m128i a) {
+        return _mm_srli_epi16(_mm_subs_epu16(_mm_mullo_epi16(_mm_srli_epi16(a, 8), chroma_scale), chroma_bias), 7);
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(yuyv + i * 4);
+        __m128i a0 = _mm_loadu_si128(src + 0), a1 = _mm_loadu_si128(src + 1);
+        __m128i a2 = _mm_loadu_si128(src + 2), a3 = _mm_loadu_si128(src + 3);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i * 2), _mm_packus_epi16(luma(a0), luma(a1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i * 2 + 16), _mm_packus_epi16(luma(a2), luma(a3)));
+        __m128i uv0 = _mm_packus_epi16(chroma(a0), chroma(a1));
+        __m128i uv1 = _mm_packus_epi16(chroma(a2), chroma(a3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i),
+                         _mm_packus_epi16(_mm_and_si128(uv0, mask), _mm_and_si128(uv1, mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i),
+                         _mm_packus_epi16(_mm_srli_epi16(uv0, 8), _mm_srli_epi16(uv1, 8)));
+    }
+    yuyv_planes_scalar(yuyv + i * 4, y + i * 2, u + i, v + i, count - i);
+}
+
+void yuyv_row_sum_sse2(const u_char* row, uint16_t* sums, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i* out = reinterpret_cast<__m128i*>(sums + i);
+        _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi8(bytes, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi16(_mm_loadu_si128(out + 1), _mm_unpackhi_epi8(bytes, zero)));
+    }
+    yuyv_row_sum_scalar(row + i, sums + i, count - i);
+}
+
+YUYV_RGB_TARGET_AVX2
+void yuyv_row_sum_avx2(const u_char* row, uint16_t* sums, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        const __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 16)));
+        __m256i* out = reinterpret_cast<__m256i*>(sums + i);
+        _mm256_storeu_si256(out, _mm256_add_epi16(_mm256_loadu_si256(out), lo));
+        _mm256_storeu_si256(out + 1, _mm256_add_epi16(_mm256_loadu_si256(out + 1), hi));
+    }
+    yuyv_row_sum_scalar(row + i, sums + i, count - i);
+}
+
+// packus works per 128 bit lane, permute4x64 puts the quarters back in order
+YUYV_RGB_TARGET_AVX2
+inline __m256i pack_in_order(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+YUYV_RGB_TARGET_AVX2
+inline __m256i expand_range_avx2(__m256i value, __m256i scale, __m256i bias) {
+    return _mm256_srli_epi16(_mm256_subs_epu16(_mm256_mullo_epi16(value, scale), bias), 7);
+}
+
+// 32 pairs per step
+YUYV_RGB_TARGET_AVX2
+void yuyv_planes_avx2(const u_char* yuyv, u_char* y, u_char* u, u_char* v, size_t count) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    const __m256i luma_scale = _mm256_set1_epi16(PLANE_LUMA_SCALE), luma_bias = _mm256_set1_epi16(PLANE_LUMA_BIAS);
+    const __m256i chroma_scale = _mm256_set1_epi16(PLANE_CHROMA_SCALE), chroma_bias = _mm256_set1_epi16(PLANE_CHROMA_BIAS);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i* src = reinterpret_cast<const __m256i*>(yuyv + i * 4);
+        __m256i a[4];
+        __m256i luma[4];
+        __m256i chroma[4];
+        for (int k = 0; k < 4; ++k) {
+            a[k] = _mm256_loadu_si256(src + k);
+            luma[k] = expand_range_avx2(_mm256_and_si256(a[k], mask), luma_scale, luma_bias);
+            chroma[k] = expand_range_avx2(_mm256_srli_epi16(a[k], 8), chroma_scale, chroma_bias);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i * 2), pack_in_order(luma[0], luma[1]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i * 2 + 32), pack_in_order(luma[2], luma[3]));
+        __m256i uv0 = pack_in_order(chroma[0], chroma[1]);
+        __m256i uv1 = pack_in_order(chroma[2], chroma[3]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + i),
+                            pack_in_order(_mm256_and_si256(uv0, mask), _mm256_and_si256(uv1, mask)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i),
+                            pack_in_order(_mm256_srli_epi16(uv0, 8), _mm256_srli_epi16(uv1, 8)));
+    }
+    yuyv_planes_scalar(yuyv + i * 4, y + i * 2, u + i, v + i, count - i);
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // YUYV_RGB_X86
+
+#ifdef YUYV_RGB_ARM
+// vld4 splits 8 pairs into Y0 / U / Y1 / V; even and odd pixels are computed apart and zipped back
+inline int16x8_t neon_channel(int32x4_t c_lo, int32x4_t c_hi, int32x4_t t_lo, int32x4_t t_hi) {
+    return vcombine_s16(vqmovn_s32(vshrq_n_s32(vaddq_s32(c_lo, t_lo), 8)),
+                        vqmovn_s32(vshrq_n_s32(vaddq_s32(c_hi, t_hi), 8)));
+}
+
+void yuyv_rgb_neon(const u_char* yuyv, u_char* rgb, size_t begin, size_t end) {
+    const int32x4_t round = vdupq_n_s32(128);
+    const int32x4_t round_g = vdupq_n_s32(256);
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        uint8x8x4_t src = vld4_u8(yuyv + i * 4);
+        int16x8_t y0 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(src.val[0])), vdupq_n_s16(16));
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(src.val[1])), vdupq_n_s16(128));
+        int16x8_t y1 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(src.val[2])), vdupq_n_s16(16));
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(src.val[3])), vdupq_n_s16(128));
+
+        int32x4_t d_lo = vmlaq_n_s32(round, vmovl_s16(vget_low_s16(v)), 409);
+        int32x4_t d_hi = vmlaq_n_s32(round, vmovl_s16(vget_high_s16(v)), 409);
+        int32x4_t g_lo = vmlaq_n_s32(round, vmovl_s16(vget_low_s16(u)), 516);
+        int32x4_t g_hi = vmlaq_n_s32(round, vmovl_s16(vget_high_s16(u)), 516);
+        int32x4_t ef_lo = vmlaq_n_s32(vmlaq_n_s32(round_g, vmovl_s16(vget_low_s16(u)), -100), vmovl_s16(vget_low_s16(v)), -208);
+        int32x4_t ef_hi = vmlaq_n_s32(vmlaq_n_s32(round_g, vmovl_s16(vget_high_s16(u)), -100), vmovl_s16(vget_high_s16(v)), -208);
+
+        uint8x8_t r[2], gr[2], b[2];
+        const int16x8_t ys[2] = {y0, y1};
+        for (int k = 0; k < 2; ++k) {
+            int32x4_t c_lo = vmull_n_s16(vget_low_s16(ys[k]), 298);
+            int32x4_t c_hi = vmull_n_s16(vget_high_s16(ys[k]), 298);
+            r[k] = vqmovun_s16(neon_channel(c_lo, c_hi, d_lo, d_hi));
+            gr[k] = vqmovun_s16(neon_channel(c_lo, c_hi, ef_lo, ef_hi));
+            b[k] = vqmovun_s16(neon_channel(c_lo, c_hi, g_lo, g_hi));
+        }
+
+        uint8x8x2_t rz = vzip_u8(r[0], r[1]);
+        uint8x8x2_t gz = vzip_u8(gr[0], gr[1]);
+        uint8x8x2_t bz = vzip_u8(b[0], b[1]);
+        uint8x16x3_t out;
+        out.val[0] = vcombine_u8(rz.val[0], rz.val[1]);
+        out.val[1] = vcombine_u8(gz.val[0], gz.val[1]);
+        out.val[2] = vcombine_u8(bz.val[0], bz.val[1]);
+        vst3q_u8(rgb + i * 6, out);
+    }
+    yuyv_rgb_scalar(yuyv, rgb, i, end);
+}
+
+inline uint8x16_t expand_range_neon(uint8x16_t value, uint8_t scale, uint16_t bias) {
+    const uint16x8_t b = vdupq_n_u16(bias);
+    uint16x8_t lo = vshrq_n_u16(vqsubq_u16(vmull_u8(vget_low_u8(value), vdup_n_u8(scale)), b), 7);
+    uint16x8_t hi = vshrq_n_u16(vqsubq_u16(vmull_u8(vget_high_u8(value), vdup_n_u8(scale)), b), 7);
+    return vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi));
+}
+
+void yuyv_planes_neon(const u_char* yuyv, u_char* y, u_char* u, u_char* v, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t src = vld4q_u8(yuyv + i * 4);
+        uint8x16x2_t luma;
+        luma.val[0] = expand_range_neon(src.val[0], PLANE_LUMA_SCALE, PLANE_LUMA_BIAS);
+        luma.val[1] = expand_range_neon(src.val[2], PLANE_LUMA_SCALE, PLANE_LUMA_BIAS);
+        vst2q_u8(y + i * 2, luma);
+        vst1q_u8(u + i, expand_range_neon(src.val[1], PLANE_CHROMA_SCALE, PLANE_CHROMA_BIAS));
+        vst1q_u8(v + i, expand_range_neon(src.val[3], PLANE_CHROMA_SCALE, PLANE_CHROMA_BIAS));
+    }
+    yuyv_planes_scalar(yuyv + i * 4, y + i * 2, u + i, v + i, count - i);
+}
+
+void yuyv_row_sum_neon(const u_char* row, uint16_t* sums, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t bytes = vld1q_u8(row + i);
+        vst1q_u16(sums + i, vaddw_u8(vld1q_u16(sums + i), vget_low_u8(bytes)));
+        vst1q_u16(sums + i + 8, vaddw_u8(vld1q_u16(sums + i + 8), vget_high_u8(bytes)));
+    }
+    yuyv_row_sum_scalar(row + i, sums + i, count - i);
+}
+#endif // YUYV_RGB_ARM
+
+YuyvRgbKernel best_kernel() {
+#ifdef YUYV_RGB_X86
+    return cpu_has_avx2() ? YUYV_RGB_AVX2 : YUYV_RGB_SSE2;
+#elif defined(YUYV_RGB_ARM)
+    return YUYV_RGB_NEON;
+#else
+    return YUYV_RGB_SCALAR;
+#endif
+}
+
+YuyvRgbFn kernel_function(YuyvRgbKernel kernel) {
+    switch (kernel) {
+#ifdef YUYV_RGB_X86
+      case YUYV_RGB_SSE2: return yuyv_rgb_sse2;
+      case YUYV_RGB_AVX2: return cpu_has_avx2() ? yuyv_rgb_avx2 : nullptr;
+#endif
+#ifdef YUYV_RGB_ARM
+      case YUYV_RGB_NEON: return yuyv_rgb_neon;
+#endif
+      case YUYV_RGB_SCALAR: return yuyv_rgb_scalar;
+      default: return nullptr;
+    }
+}
+
+YuyvPlanesFn planes_function(YuyvRgbKernel kernel) {
+    switch (kernel) {
+#ifdef YUYV_RGB_X86
+      case YUYV_RGB_SSE2: return yuyv_planes_sse2;
+      case YUYV_RGB_AVX2: return yuyv_planes_avx2;
+#endif
+#ifdef YUYV_RGB_ARM
+      case YUYV_RGB_NEON: return yuyv_planes_neon;
+#endif
+      default: return yuyv_planes_scalar;
+    }
+}
+
+YuyvRowSumFn row_sum_function(YuyvRgbKernel kernel) {
+    switch (kernel) {
+#ifdef YUYV_RGB_X86
+      case YUYV_RGB_SSE2: return yuyv_row_sum_sse2;
+      case YUYV_RGB_AVX2: return yuyv_row_sum_avx2;
+#endif
+#ifdef YUYV_RGB_ARM
+      case YUYV_RGB_NEON: return yuyv_row_sum_neon;
+#endif
+      default: return yuyv_row_sum_scalar;
+    }
+}
+
+std::atomic<YuyvRgbKernel>& selected_kernel() {
+    static std::atomic<YuyvRgbKernel> kernel{best_kernel()};
+    return kernel;
+}
+
+} // namespace
+
+const char* yuyv_rgb_kernel_name(YuyvRgbKernel kernel) {
+    switch (kernel) {
+      case YUYV_RGB_AUTO: return "auto";
+      case YUYV_RGB_SCALAR: return "scalar";
+      case YUYV_RGB_SSE2: return "sse2";
+      case YUYV_RGB_AVX2: return "avx2";
+      case YUYV_RGB_NEON: return "neon";
+    }
+    return "unknown";
+}
+
+bool set_yuyv_rgb_kernel(YuyvRgbKernel kernel) {
+    if (kernel == YUYV_RGB_AUTO) {
+        kernel = best_kernel();
+    }
+    if (kernel_function(kernel) == nullptr) {
+        return false;
+    }
+    selected_kernel().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+YuyvRgbKernel yuyv_rgb_kernel() {
+    return selected_kernel().load(std::memory_order_relaxed);
+}
 
-        rgbData[rgbIndex + 3] = std::clamp((c1 + d) >> 8, 0, 255);
-        rgbData[rgbIndex + 4] = std::clamp((c1 + e + f) >> 8, 0, 255);
-        rgbData[rgbIndex + 5] = std::clamp((c1 + g) >> 8, 0, 255);
+void convertYUYVtoRGB(const u_char* yuyv, size_t yuyv_size, int width, int height, u_char* rgb, int threads) {
+    const size_t pixels = static_cast<size_t>(width) * height;
+    const size_t pairs = pixels / 2;
+    const size_t available = std::min(pairs, yuyv_size / 4);
+    if (available * 6 < pixels * 3) {
+        std::memset(rgb + available * 6, 0, pixels * 3 - available * 6);
+    }
+
+    YuyvRgbFn convert = kernel_function(yuyv_rgb_kernel());
+
+    int bands = threads;
+    if (bands <= 0) {
+        bands = pixels >= YUYV_RGB_PARALLEL_PIXELS
+              ? static_cast<int>(std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), YUYV_RGB_MAX_BANDS))
+              : 1;
+    }
+    if (bands <= 1 || height < bands) {
+        convert(yuyv, rgb, 0, available);
+        return;
     }
+
+    // Bands start on row boundaries; the calling thread converts the first one
+    auto band_begin = [&](int band) {
+        return std::min(available, static_cast<size_t>(height) * band / bands * width / 2);
+    };
+    std::thread workers[YUYV_RGB_MAX_BANDS];
+    const int spawned = std::min(bands, YUYV_RGB_MAX_BANDS) - 1;
+    bands = spawned + 1;
+    for (int band = 1; band <= spawned; ++band) {
+        workers[band - 1] = std::thread(convert, yuyv, rgb, band_begin(band), band_begin(band + 1));
+    }
+    convert(yuyv, rgb, 0, band_begin(1));
+    for (int band = 0; band < spawned; ++band) {
+        workers[band].join();
+    }
+}
+
+void convertYUYVtoRGB(const std::vector<u_char>& yuyvData, int width, int height, std::vector<u_char>& rgb, int threads) {
+    const size_t required = static_cast<size_t>(width) * height * 3;
+    if (rgb.size() < required) {
+        rgb.resize(required);
+    }
+    convertYUYVtoRGB(yuyvData.data(), yuyvData.size(), width, height, rgb.data(), threads);
+}
+
+std::vector<u_char> convertYUYVtoRGB(const std::vector<u_char>& yuyvData, int width, int height) {
+    std::vector<u_char> rgbData;
+    convertYUYVtoRGB(yuyvData, width, height, rgbData);
     return rgbData;
 }
 
@@ -69,3 +570,107 @@ std::vector<u_char> combineYUYVtoRGB(std::vector<std::vector<u_char>>& yuyvDataL
     
     return combinedRGB;
 }
+
+size_t splitYUYVtoPlanes(const std::vector<std::vector<u_char>>& chunks, int width, int height,
+                         u_char* y, u_char* u, u_char* v) {
+    YuyvPlanesFn split = planes_function(yuyv_rgb_kernel());
+    const size_t pairs = static_cast<size_t>(width) * height / 2;
+    size_t pair = 0;
+    u_char carry[4] = {0, 0, 0, 0};
+    size_t carried = 0;
+
+    for (const auto& chunk : chunks) {
+        const u_char* data = chunk.data();
+        size_t size = chunk.size();
+        if (carried > 0) {
+            const size_t take = std::min(size, 4 - carried);
+            std::memcpy(carry + carried, data, take);
+            carried += take;
+            data += take;
+            size -= take;
+            if (carried < 4) {
+                continue;
+            }
+            yuyv_planes_scalar(carry, y + pair * 2, u + pair, v + pair, 1);
+            carried = 0;
+            if (++pair == pairs) {
+                break;
+            }
+        }
+        const size_t whole = std::min(size / 4, pairs - pair);
+        split(data, y + pair * 2, u + pair, v + pair, whole);
+        pair += whole;
+        if (pair == pairs) {
+            break;
+        }
+        carried = size - whole * 4;
+        std::memcpy(carry, data + whole * 4, carried);
+    }
+
+    const size_t taken = pair * 4 + carried;
+    if (pair < pairs) {
+        std::memset(carry + carried, 0, 4 - carried);
+        yuyv_planes_scalar(carry, y + pair * 2, u + pair, v + pair, 1);
+        ++pair;
+        std::memset(y + pair * 2, 0, (pairs - pair) * 2);
+        std::memset(u + pair, 0, pairs - pair);
+        std::memset(v + pair, 0, pairs - pair);
+    }
+    return taken;
+}
+
+int downscaled_yuyv_width(int width, int factor) {
+    return factor > 0 ? (width / factor) & ~1 : 0;
+}
+
+void downscaleYUYV(const u_char* yuyv, size_t yuyv_size, int width, int height, int factor, u_char* out) {
+    const int out_width = downscaled_yuyv_width(width, factor);
+    const int out_height = factor > 0 ? height / factor : 0;
+    if (out_width <= 0 || out_height <= 0) {
+        return;
+    }
+    const size_t row_bytes = static_cast<size_t>(width) * 2;
+    const size_t out_row_bytes = static_cast<size_t>(out_width) * 2;
+    if (factor == 1) {
+        const size_t frame_bytes = row_bytes * height;
+        const size_t copied = std::min(yuyv_size, frame_bytes);
+        std::memcpy(out, yuyv, copied);
+        std::memset(out + copied, 0, frame_bytes - copied);
+        return;
+    }
+
+    YuyvRowSumFn row_sum = row_sum_function(yuyv_rgb_kernel());
+    thread_local std::vector<uint16_t> sums;
+    sums.resize(row_bytes);
+    const unsigned area = static_cast<unsigned>(factor * factor);
+    const unsigned half = area / 2;
+
+    for (int out_row = 0; out_row < out_height; ++out_row) {
+        // Vertical pass in SIMD over whole rows, then the horizontal one on the 1 / factor as many sums
+        std::fill(sums.begin(), sums.end(), 0);
+        for (int r = 0; r < factor; ++r) {
+            const size_t offset = (static_cast<size_t>(out_row) * factor + r) * row_bytes;
+            if (offset < yuyv_size) {
+                row_sum(yuyv + offset, sums.data(), std::min(row_bytes, yuyv_size - offset));
+            }
+        }
+
+        u_char* dst = out + out_row * out_row_bytes;
+        for (int pair = 0; pair < out_width / 2; ++pair) {
+            // Output pixels 2 pair and 2 pair + 1 cover input pixels [2 pair factor, 2 pair factor + 2 factor),
+            // which are the input macropixels [pair factor, pair factor + factor)
+            const uint16_t* block = sums.data() + static_cast<size_t>(pair) * factor * 4;
+            unsigned y0 = 0, y1 = 0, u = 0, v = 0;
+            for (int p = 0; p < factor; ++p) {
+                y0 += block[p * 2];
+                y1 += block[(factor + p) * 2];
+                u += block[p * 4 + 1];
+                v += block[p * 4 + 3];
+            }
+            dst[pair * 4 + 0] = static_cast<u_char>((y0 + half) / area);
+            dst[pair * 4 + 1] = static_cast<u_char>((u + half) / area);
+            dst[pair * 4 + 2] = static_cast<u_char>((y1 + half) / area);
+            dst[pair * 4 + 3] = static_cast<u_char>((v + half) / area);
+        }
+    }
+}
@@ -28,6 +28,8 @@ std::queue<std::vector<u_char>> packet_queue;
 std::mutex queue_mutex;
 std::condition_variable queue_cv;
 bool stop_processing = false;
+// PipelineClock tick per packet_queue entry, guarded by queue_mutex
+std::queue<uint64_t> packet_queue_ticks;
 std::queue<std::tuple<int, int, std::string, int, int, int, std::string, uint32_t, uint32_t, uint32_t, std::chrono::time_point<std::chrono::steady_clock>>> set_control_queue;
 
 
@@ -37,21 +39,13 @@ struct FrameInfo{
   int frame_format_subtype;
 };
 
-void clean_exit(int signum) {
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    stop_processing = true;
-  }
-  queue_cv.notify_all();
-
-//   if (log_file.is_open()) {
-//     log_file.close();
-//   }
+// Set by SIGINT/SIGTERM. The handler may land on any thread, even one holding a
+// queue or container lock, so it only raises the flag and main does the shutdown
+volatile std::sig_atomic_t exit_signal = 0;
+std::atomic<bool> capture_done{false};
 
-  CtrlPrint::v_cout_2 << "Exiting safely..." << std::endl;
-  std::cout << "End of the process: wait for other pipes to be closed" << std::endl;
-
-  exit(signum);
+void clean_exit(int signum) {
+  exit_signal = signum;
 }
 
 // Helper function to split the input line by a delimiter
@@ -76,34 +70,8 @@ std::chrono::time_point<std::chrono::steady_clock> convert_epoch_to_time_point(d
 }
 
 
-const std::array<u_char, 256> hex_lut = []() {
-    std::array<u_char, 256> table = {};
-    for (int i = 0; i < 256; ++i) table[i] = 0xFF;
-    for (char c = '0'; c <= '9'; ++c) table[static_cast<unsigned char>(c)] = c - '0';
-    for (char c = 'A'; c <= 'F'; ++c) table[static_cast<unsigned char>(c)] = c - 'A' + 10;
-    for (char c = 'a'; c <= 'f'; ++c) table[static_cast<unsigned char>(c)] = c - 'a' + 10;
-    return table;
-}();
-
-
-void hex_string_to_bytes_append(const std::string& hex_str, std::vector<u_char>& out_vec) {
-    size_t len = hex_str.length();
-    size_t num_bytes = len / 2;
-    size_t initial_size = out_vec.size();
-    out_vec.resize(initial_size + num_bytes);
-
-    const char* src = hex_str.data();
-    u_char* dst = out_vec.data() + initial_size;
-
-    for (size_t i = 0; i < num_bytes; ++i) {
-        u_char high = hex_lut[static_cast<unsigned char>(src[i * 2])];
-        u_char low = hex_lut[static_cast<unsigned char>(src[i * 2 + 1])];
-        dst[i] = (high << 4) | low;
-    }
-}
-
-
 void capture_packets() {
+    ALLOC_STATS_ONLY(AllocStats::set_thread_name("capture");)
 
     static std::vector<u_char> temp_buffer;
     static uint32_t bulk_maxlengthsize = 0;
@@ -111,11 +79,11 @@ void capture_packets() {
     std::string line;
 #ifdef GUI_SET
     gui_window_number = WIN_DEBUG;
-    CtrlPrint::v_cout_1 << "Waiting for input...     " << std::endl;
+    V_COUT_1 << "Waiting for input...     " << std::endl;
 #else
-    CtrlPrint::v_cout_1 << "Waiting for input...     " << std::endl;
+    V_COUT_1 << "Waiting for input...     " << std::endl;
 #endif
-    while (std::getline(std::cin, line)) {
+    while (exit_signal == 0 && std::getline(std::cin, line)) {
         // Split the line by semicolon 
         std::vector<std::string> tokens = split(line, ';');
 
@@ -166,6 +134,8 @@ void capture_packets() {
                   {
                       std::lock_guard<std::mutex> lock(queue_mutex);
                       packet_queue.push(std::move(temp_buffer));
+                      PIPELINE_LATENCY_ONLY(packet_queue_ticks.push(PIPELINE_STAMP());)
+                      UVCFD_PROBE2(payload_enqueue, packet_queue.back().size(), packet_queue.size());
 
                       std::lock_guard<std::mutex> time_lock(time_mutex);
                       time_records.push(std::move(time_point_d));
@@ -315,6 +285,8 @@ void capture_packets() {
               {
                   std::lock_guard<std::mutex> lock(queue_mutex);
                   packet_queue.push(std::move(temp_buffer));
+                  PIPELINE_LATENCY_ONLY(packet_queue_ticks.push(PIPELINE_STAMP());)
+                  UVCFD_PROBE2(payload_enqueue, packet_queue.back().size(), packet_queue.size());
 
                   std::lock_guard<std::mutex> time_lock(time_mutex);
                   time_records.push(std::move(time_point_d));
@@ -330,9 +302,9 @@ void capture_packets() {
         }
 
         // // Print each field separately
-        // CtrlPrint::v_cout_1 << "frame.time_epoch: " << frame_time_epoch << std::endl;
-        // CtrlPrint::v_cout_1 << "frame.len: " << frame_len << std::endl;
-        // CtrlPrint::v_cout_1 << "usb.capdata: " << usb_capdata << std::endl;
+        // V_COUT_1 << "frame.time_epoch: " << frame_time_epoch << std::endl;
+        // V_COUT_1 << "frame.len: " << frame_len << std::endl;
+        // V_COUT_1 << "usb.capdata: " << usb_capdata << std::endl;
 
         // // Log the separated fields
         // log_file << "usb_transfer_type: " << usb_transfer_type << std::endl;
@@ -344,13 +316,15 @@ void capture_packets() {
     }
 
     // log_file.close();
-    // CtrlPrint::v_cout_1 << "Log file closed." << std::endl;
+    // V_COUT_1 << "Log file closed." << std::endl;
 
 }
 
 
 void process_packets() {
+  ALLOC_STATS_ONLY(AllocStats::set_thread_name("process");)
   UVCPHeaderChecker header_checker;
+  std::chrono::time_point<std::chrono::steady_clock> last_depth_sample;
 
   while (true) {
     std::unique_lock<std::mutex> lock(queue_mutex);
@@ -375,13 +349,19 @@ void process_packets() {
         std::chrono::time_point<std::chrono::steady_clock> received_time;
         std::tie(vendor_id, product_id, device_name, width, height, fps, frame_format, max_frame_size, max_payload_size, time_frequency, received_time) = control_data;
 
-        CtrlPrint::v_cout_3 << "Processing control configuration" << std::endl;
+        V_COUT_3 << "Processing control configuration" << std::endl;
         header_checker.control_configuration_ctrl(vendor_id, product_id, device_name, width, height, fps, frame_format, max_frame_size, max_payload_size, time_frequency, received_time);
 
     }else if (!packet_queue.empty()) {
 
       auto packet = std::move(packet_queue.front());
       packet_queue.pop();
+      PIPELINE_LATENCY_ONLY(
+        PIPELINE_RECORD(STAGE_QUEUE_WAIT, packet_queue_ticks.front());
+        packet_queue_ticks.pop();
+      )
+      UVCFD_PROBE2(payload_dequeue, packet.size(), packet_queue.size());
+      const size_t queue_depth = packet_queue.size();
       lock.unlock();
 
       std::chrono::time_point<std::chrono::steady_clock> received_time;
@@ -390,54 +370,74 @@ void process_packets() {
         received_time = time_records.front();
         time_records.pop();
       }
+      if (TraceExporter::instance().enabled() &&
+          received_time - last_depth_sample >= std::chrono::milliseconds(TRACE_QUEUE_SAMPLE_MS)) {
+        TraceExporter::instance().counter("packet_queue_depth", received_time, static_cast<int64_t>(queue_depth));
+        last_depth_sample = received_time;
+      }
 
       if (!packet.empty()) {
-        CtrlPrint::v_cout_3 << "Processing packet of size: " << packet.size() << std::endl;
+        V_COUT_3 << "Processing packet of size: " << packet.size() << std::endl;
       }
 
       uint8_t valid_err =
           header_checker.payload_valid_ctrl(packet, received_time);
 
       if (valid_err) {
-        CtrlPrint::v_cerr_3 << "Invalid packet detected" << std::endl;
+        V_CERR_3 << "Invalid packet detected" << std::endl;
         continue;
       }
     } else {
       lock.unlock();
     }
   }
-  CtrlPrint::v_cout_1 << "Process packet() end" << std::endl;
+  V_COUT_1 << "Process packet() end" << std::endl;
 }
 
 
 
 
-void develope_frame_image() {
-    DevFImage& dev_f_image = DevFImage::instance();
-    while (true){
-        std::unique_lock<std::mutex> lock(dev_f_image.dev_f_image_mutex);
-        dev_f_image.dev_f_image_cv.wait(lock, [&dev_f_image] { 
-            return !dev_f_image.dev_f_image_queue.empty(); 
-        });
-        
-        auto frame_format = std::move(dev_f_image.dev_f_image_format_queue.front());
-        dev_f_image.dev_f_image_format_queue.pop();
-        auto frame_data = std::move(dev_f_image.dev_f_image_queue.front());
-        dev_f_image.dev_f_image_queue.pop();
-
-        lock.unlock();
-
-        dev_f_image.develope_photo(frame_format, frame_data);
+// Queue depths and log sink state next to the per checker counters
+void collect_pipeline_metrics(MetricsWriter& out) {
+    size_t packet_depth = 0;
+    size_t control_depth = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        packet_depth = packet_queue.size();
+        control_depth = set_control_queue.size();
     }
-}
+    out.gauge("uvcfd_packet_queue_depth", "Payloads waiting for the checker", {}, static_cast<double>(packet_depth));
+    out.gauge("uvcfd_control_queue_depth", "Control configurations waiting for the checker", {}, static_cast<double>(control_depth));
 
+    DevFImage& dev_f_image = DevFImage::instance();
+    DevelopQueueStats develop = dev_f_image.dev_f_image_queue.stats();
+    const MetricLabels policy = {{"policy", develop_drop_policy_name(dev_f_image.dev_f_image_queue.policy())}};
+    out.gauge("uvcfd_develop_queue_depth", "Frames waiting to be developed", {}, static_cast<double>(develop.depth));
+    out.gauge("uvcfd_develop_queue_high_water", "Deepest the develop queue has been", {}, static_cast<double>(develop.high_water));
+    out.counter("uvcfd_develop_dropped_total", "Frames dropped by the develop queue policy", policy, static_cast<int64_t>(develop.dropped));
+    out.counter("uvcfd_develop_dropped_error_frames_total", "Error or suspicious frames among the dropped", policy, static_cast<int64_t>(develop.dropped_errors));
+    out.counter("uvcfd_develop_frames_total", "Frames developed into images", {}, static_cast<int64_t>(dev_f_image.developed_frames()));
+
+    LogSink& sink = LogSink::instance();
+    out.gauge("uvcfd_log_pending_records", "Log records waiting for the writer thread", {}, static_cast<double>(sink.pending_records()));
+    out.counter("uvcfd_log_dropped_records_total", "Log records dropped because the ring was full", {}, static_cast<int64_t>(sink.dropped_records()));
+}
 
 int main(int argc, char* argv[]) {
 
     bool fw_set = false;
+    std::string metrics_address;
+    std::string trace_path;
     bool fh_set = false;
     bool fps_set = false;
     bool ff_set = false;
+    int jpeg_subsampling = -1;
+    int develop_workers = 0;
+    DevelopOutput save_output = DEVELOP_OUTPUT_JPEG;
+    RawStoreMode raw_store_mode = RAW_STORE_OFF;
+    unsigned capture_mask = 0;
+    size_t develop_capacity = DEVELOP_QUEUE_DEFAULT_CAPACITY;
+    DevelopDropPolicy develop_policy = DEVELOP_KEEP_ERRORS;
 
     ControlConfig& set_control = ControlConfig::instance();
 
@@ -460,11 +460,58 @@ int main(int argc, char* argv[]) {
         set_control.set_dwMaxPayloadTransferSize(std::atoi(argv[i + 1]));
         } else if (std::strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
         VerboseStream::verbose_level = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "-metrics") == 0 && i + 1 < argc) {
+        metrics_address = argv[i + 1];
+        } else if (std::strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+        trace_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "-yuyvjpg") == 0 && i + 1 < argc &&
+                   (std::strcmp(argv[i + 1], "planes") == 0 || std::strcmp(argv[i + 1], "rgb") == 0)) {
+        DevFImage::instance().yuyv_jpeg_path = std::strcmp(argv[i + 1], "rgb") == 0 ? YUYV_JPEG_RGB : YUYV_JPEG_PLANES;
+        } else if (std::strcmp(argv[i], "-jpgq") == 0 && i + 1 < argc) {
+        JpegSettings settings = jpeg_settings();
+        settings.quality = std::clamp(std::atoi(argv[i + 1]), 1, 100);
+        set_jpeg_settings(settings);
+        } else if (std::strcmp(argv[i], "-jpgsub") == 0 && i + 1 < argc &&
+                   parse_jpeg_subsampling(argv[i + 1], jpeg_subsampling)) {
+        JpegSettings settings = jpeg_settings();
+        settings.subsampling = jpeg_subsampling;
+        set_jpeg_settings(settings);
+        } else if (std::strcmp(argv[i], "-jpgdct") == 0 && i + 1 < argc &&
+                   (std::strcmp(argv[i + 1], "fast") == 0 || std::strcmp(argv[i + 1], "accurate") == 0)) {
+        JpegSettings settings = jpeg_settings();
+        settings.fast_dct = std::strcmp(argv[i + 1], "fast") == 0;
+        set_jpeg_settings(settings);
+        } else if (std::strcmp(argv[i], "-dw") == 0 && i + 1 < argc) {
+        develop_workers = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "-dq") == 0 && i + 1 < argc) {
+        develop_capacity = static_cast<size_t>(std::max(1, std::atoi(argv[i + 1])));
+        } else if (std::strcmp(argv[i], "-dpolicy") == 0 && i + 1 < argc &&
+                   parse_develop_drop_policy(argv[i + 1], develop_policy)) {
+        // parsed into develop_policy
+        } else if (std::strcmp(argv[i], "-fsync") == 0 && i + 1 < argc) {
+        set_frame_fsync_every(std::atoi(argv[i + 1]));
+        } else if (std::strcmp(argv[i], "-save") == 0 && i + 1 < argc &&
+                   parse_develop_output(argv[i + 1], save_output)) {
+        // parsed into save_output
+        } else if (std::strcmp(argv[i], "-raw") == 0 && i + 1 < argc &&
+                   parse_raw_store_mode(argv[i + 1], raw_store_mode)) {
+        // parsed into raw_store_mode
+        } else if (std::strcmp(argv[i], "-capture") == 0 && i + 1 < argc &&
+                   parse_capture_policies(argv[i + 1], capture_mask)) {
+        // a category given a policy is also switched on for capture
+        RunFlags& run_flags = RunFlags::instance();
+        if (capture_mask & (1u << CAPTURE_ERROR)) run_flags.capture_error_flag = true;
+        if (capture_mask & (1u << CAPTURE_SUSPICIOUS)) run_flags.capture_suspicious_flag = true;
+        if (capture_mask & (1u << CAPTURE_VALID)) run_flags.capture_valid_flag = true;
         } else {
-        CtrlPrint::v_cerr_1 << "Usage: " << argv[0]
+        V_CERR_1 << "Usage: " << argv[0]
                 <<  "[-fw frame_width] [-fh frame_height] [-fps frame_per_sec] "
                     "[-ff frame_format] [-mf max_frame_size] [-mp max_payload_size] "
-                    "[-v verbose_level]"
+                    "[-v verbose_level] [-metrics [host]:port] [-trace trace.json] [-yuyvjpg planes|rgb] "
+                    "[-jpgq quality] [-jpgsub 444|422|420|gray] [-jpgdct fast|accurate] "
+                    "[-dw develop_workers] [-dq develop_queue_frames] [-dpolicy block|newest|oldest|errors] "
+                    "[-fsync frames] [-save jpg|avi|none] [-raw off|errors|all] "
+                    "[-capture error|suspicious|valid=all|every:N|rate:K|reservoir:K[:ms]|burst:N[,...]]"
                 << std::endl;
         return 1;
         }
@@ -475,19 +522,19 @@ int main(int argc, char* argv[]) {
 #endif
     if (!fw_set || !fh_set || !fps_set || !ff_set) {
         if (!fw_set) {
-        CtrlPrint::v_cout_1 << "Frame width not specified, using default: "
+        V_COUT_1 << "Frame width not specified, using default: "
                     << set_control.get_width() << std::endl;
         }
         if (!fh_set) {
-        CtrlPrint::v_cout_1 << "Frame height not specified, using default: "
+        V_COUT_1 << "Frame height not specified, using default: "
                     << set_control.get_height() << std::endl;
         }
         if (!fps_set) {
-        CtrlPrint::v_cout_1 << "FPS not specified, using default: "
+        V_COUT_1 << "FPS not specified, using default: "
                     << set_control.get_fps() << std::endl;
         }
         if (!ff_set) {
-        CtrlPrint::v_cout_1 << "Frame format not specified, using default: "
+        V_COUT_1 << "Frame format not specified, using default: "
                     << set_control.get_frame_format() << std::endl;
         }
     }
@@ -495,42 +542,112 @@ int main(int argc, char* argv[]) {
 #ifdef GUI_SET
     gui_window_number = temp_window_number;
 #else
-    CtrlPrint::v_cout_1 << "Frame Width: " << set_control.get_width() << std::endl;
-    CtrlPrint::v_cout_1 << "Frame Height: " << set_control.get_height() << std::endl;
-    CtrlPrint::v_cout_1 << "Frame FPS: " << set_control.get_fps() << std::endl;
-    CtrlPrint::v_cout_1 << "Frame Format: " << set_control.get_frame_format()
+    V_COUT_1 << "Frame Width: " << set_control.get_width() << std::endl;
+    V_COUT_1 << "Frame Height: " << set_control.get_height() << std::endl;
+    V_COUT_1 << "Frame FPS: " << set_control.get_fps() << std::endl;
+    V_COUT_1 << "Frame Format: " << set_control.get_frame_format()
             << std::endl;
 #endif
 
     std::signal(SIGINT, clean_exit);
     std::signal(SIGTERM, clean_exit);
 
+    if (!metrics_address.empty()) {
+        MetricsRegistry::instance().add_collector(collect_pipeline_metrics);
+        if (!MetricsServer::instance().start(metrics_address)) {
+            return 1;
+        }
+    }
+    if (!trace_path.empty() && !TraceExporter::instance().open(trace_path)) {
+        return 1;
+    }
+
+#ifdef _WIN32
+    const std::string capture_path = timestamped_capture_path("images\\");
+#else
+    const std::string capture_path = timestamped_capture_path("./images/");
+#endif
+    if (save_output == DEVELOP_OUTPUT_AVI) {
+        if (!DevFImage::instance().open_container(capture_path, set_control.get_fps())) {
+            return 1;
+        }
+        V_COUT_1 << "Saving frames to " << capture_path << ".avi" << std::endl;
+    }
+    DevFImage::instance().develop_output = save_output;
+    if (raw_store_mode != RAW_STORE_OFF) {
+        if (!DevFImage::instance().open_raw_store(capture_path, raw_store_mode)) {
+            return 1;
+        }
+        V_COUT_1 << "Storing raw frames to " << capture_path << ".uvcraw" << std::endl;
+    }
+
+    // Develop workers first, so the first frames already find one
+    DevFImage::instance().dev_f_image_queue.configure(develop_capacity, develop_policy);
+    DevFImage::instance().start_workers(develop_workers);
+    V_COUT_1 << "Develop Workers: " << DevFImage::instance().worker_count() << ", queue " << develop_capacity
+             << " frames, drop policy " << develop_drop_policy_name(develop_policy) << std::endl;
+
     // Create threads for capture and processing
-    std::thread capture_thread(capture_packets);
+    std::thread capture_thread([] {
+        capture_packets();
+        capture_done = true;
+    });
 
     std::thread process_thread(process_packets);
 
-    std::thread fdevelope_thread(develope_frame_image);
-
 #ifdef GUI_SET
+    // The viewer takes developed error frames from memory
+    FramePreview::instance().set_enabled(true);
     if (start_screen() == -1) {
         return -1;
     }
     screen();
 #endif
 
-    // Wait for the threads to finish
-    capture_thread.join();
+    // Wait for the input to end. After a signal the reader gets a moment to see the flag,
+    // and is left behind if it stays blocked on stdin
+    std::chrono::steady_clock::time_point signalled_at;
+    while (!capture_done) {
+        if (exit_signal != 0) {
+            const auto now = std::chrono::steady_clock::now();
+            if (signalled_at == std::chrono::steady_clock::time_point{}) {
+                signalled_at = now;
+            } else if (now - signalled_at > std::chrono::seconds(1)) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (capture_done) {
+        capture_thread.join();
+    } else {
+        capture_thread.detach();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stop_processing = true;
+    }
+    queue_cv.notify_all();
     process_thread.join();
-    fdevelope_thread.join();
-    
-    clean_exit(0);
+
+    // Frames already queued are still written
+    DevFImage::instance().stop_workers(true);
+    DevFImage::instance().close_container();
+    DevFImage::instance().close_raw_store();
+
+    MetricsServer::instance().stop();
+    TraceExporter::instance().close();
+
+    V_COUT_2 << "Exiting safely..." << std::endl;
+    LogSink::instance().flush();
+    std::cout << "End of the process: wait for other pipes to be closed" << std::endl;
 #ifdef GUI_SET
   end_screen();
 #else
-    CtrlPrint::v_cout_1 << "End of main" << std::endl;
+    V_COUT_1 << "End of main" << std::endl;
 #endif
 
 
-    return 0;
+    return exit_signal;
 }
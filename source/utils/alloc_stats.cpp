@@ -0,0 +1,286 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#include "utils/alloc_stats.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "utils/metrics.hpp"
+#include "utils/verbose.hpp"
+
+#ifdef ALLOC_STATS
+  #if defined(_WIN32)
+    #include <malloc.h>
+    #define ALLOC_USABLE_SIZE(ptr) _msize(ptr)
+    #define ALLOC_ALIGNED_USABLE_SIZE(ptr, alignment) _aligned_msize(ptr, alignment, 0)
+  #elif defined(__APPLE__)
+    #include <malloc/malloc.h>
+    #define ALLOC_USABLE_SIZE(ptr) malloc_size(ptr)
+    #define ALLOC_ALIGNED_USABLE_SIZE(ptr, alignment) ((void)(alignment), malloc_size(ptr))
+  #else
+    #include <malloc.h>
+    #define ALLOC_USABLE_SIZE(ptr) malloc_usable_size(ptr)
+    #define ALLOC_ALIGNED_USABLE_SIZE(ptr, alignment) ((void)(alignment), malloc_usable_size(ptr))
+  #endif
+#endif
+
+namespace {
+
+// Everything here is constant initialised: operator new can run before any
+// static constructor and on threads that are being torn down
+struct alignas(64) ThreadAllocRow {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> allocations[ALLOC_STAGE_SLOTS];
+    std::atomic<uint64_t> frees[ALLOC_STAGE_SLOTS];
+    std::atomic<uint64_t> allocated_bytes[ALLOC_STAGE_SLOTS];
+    std::atomic<uint64_t> freed_bytes[ALLOC_STAGE_SLOTS];
+};
+
+ThreadAllocRow alloc_rows[ALLOC_STATS_MAX_THREADS];
+std::atomic<size_t> alloc_rows_claimed{0};
+
+thread_local int alloc_row_index = -1;
+thread_local uint8_t alloc_current_stage = ALLOC_STAGE_UNTAGGED;
+
+ThreadAllocRow& alloc_row() {
+    if (alloc_row_index < 0) {
+        size_t claimed = alloc_rows_claimed.fetch_add(1, std::memory_order_relaxed);
+        alloc_row_index = static_cast<int>(claimed < ALLOC_STATS_MAX_THREADS ? claimed : ALLOC_STATS_MAX_THREADS - 1);
+    }
+    return alloc_rows[alloc_row_index];
+}
+
+AllocCounts read_row(const ThreadAllocRow& row, size_t stage) {
+    AllocCounts counts;
+    counts.allocations = row.allocations[stage].load(std::memory_order_relaxed);
+    counts.frees = row.frees[stage].load(std::memory_order_relaxed);
+    counts.allocated_bytes = row.allocated_bytes[stage].load(std::memory_order_relaxed);
+    counts.freed_bytes = row.freed_bytes[stage].load(std::memory_order_relaxed);
+    return counts;
+}
+
+#ifdef ALLOC_STATS
+void note_allocation(size_t bytes) {
+    ThreadAllocRow& row = alloc_row();
+    row.allocations[alloc_current_stage].fetch_add(1, std::memory_order_relaxed);
+    row.allocated_bytes[alloc_current_stage].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void note_free(size_t bytes) {
+    ThreadAllocRow& row = alloc_row();
+    row.frees[alloc_current_stage].fetch_add(1, std::memory_order_relaxed);
+    row.freed_bytes[alloc_current_stage].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void* counted_alloc(std::size_t size) noexcept {
+    void* ptr = std::malloc(size != 0 ? size : 1);
+    if (ptr != nullptr) {
+        note_allocation(ALLOC_USABLE_SIZE(ptr));
+    }
+    return ptr;
+}
+
+void counted_free(void* ptr) noexcept {
+    if (ptr != nullptr) {
+        note_free(ALLOC_USABLE_SIZE(ptr));
+        std::free(ptr);
+    }
+}
+
+// Over-aligned types (alignas(64) counters and ring slots) come through here
+void* counted_aligned_alloc(std::size_t size, std::align_val_t align) noexcept {
+    const std::size_t alignment = static_cast<std::size_t>(align);
+#ifdef _WIN32
+    void* ptr = _aligned_malloc(size != 0 ? size : 1, alignment);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment < sizeof(void*) ? sizeof(void*) : alignment, size != 0 ? size : 1) != 0) {
+        ptr = nullptr;
+    }
+#endif
+    if (ptr != nullptr) {
+        note_allocation(ALLOC_ALIGNED_USABLE_SIZE(ptr, alignment));
+    }
+    return ptr;
+}
+
+void counted_aligned_free(void* ptr, std::align_val_t align) noexcept {
+    if (ptr != nullptr) {
+        note_free(ALLOC_ALIGNED_USABLE_SIZE(ptr, static_cast<std::size_t>(align)));
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+}
+#endif
+
+} // namespace
+
+#ifdef ALLOC_STATS
+void* operator new(std::size_t size) {
+    void* ptr = counted_alloc(size);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](std::size_t size) {
+    void* ptr = counted_alloc(size);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { counted_free(ptr); }
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    void* ptr = counted_aligned_alloc(size, align);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](std::size_t size, std::align_val_t align) {
+    void* ptr = counted_aligned_alloc(size, align);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return counted_aligned_alloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return counted_aligned_alloc(size, align); }
+void operator delete(void* ptr, std::align_val_t align) noexcept { counted_aligned_free(ptr, align); }
+void operator delete[](void* ptr, std::align_val_t align) noexcept { counted_aligned_free(ptr, align); }
+void operator delete(void* ptr, std::size_t, std::align_val_t align) noexcept { counted_aligned_free(ptr, align); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t align) noexcept { counted_aligned_free(ptr, align); }
+void operator delete(void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept { counted_aligned_free(ptr, align); }
+void operator delete[](void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept { counted_aligned_free(ptr, align); }
+#endif
+
+AllocStats& AllocStats::instance() {
+    static AllocStats instance;
+    return instance;
+}
+
+AllocStats::AllocStats() {
+    metrics_collector_id_ = MetricsRegistry::instance().add_collector(
+        [this](MetricsWriter& out) { collect_metrics(out); });
+}
+
+AllocStats::~AllocStats() {
+    MetricsRegistry::instance().remove_collector(metrics_collector_id_);
+}
+
+bool AllocStats::enabled() {
+#ifdef ALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocStats::set_thread_name(const char* name) {
+    alloc_row().name.store(name, std::memory_order_relaxed);
+}
+
+PipelineStage AllocStats::current_stage() {
+    return static_cast<PipelineStage>(alloc_current_stage);
+}
+
+void AllocStats::set_current_stage(PipelineStage stage) {
+    alloc_current_stage = static_cast<uint8_t>(stage);
+}
+
+AllocCounts AllocStats::stage_counts(PipelineStage stage) const {
+    AllocCounts total;
+    const size_t slots = thread_slots();
+    for (size_t i = 0; i < slots; ++i) {
+        total += read_row(alloc_rows[i], stage);
+    }
+    return total;
+}
+
+AllocCounts AllocStats::thread_counts(size_t thread_slot) const {
+    AllocCounts total;
+    for (size_t stage = 0; stage < ALLOC_STAGE_SLOTS; ++stage) {
+        total += read_row(alloc_rows[thread_slot], stage);
+    }
+    return total;
+}
+
+size_t AllocStats::thread_slots() const {
+    size_t claimed = alloc_rows_claimed.load(std::memory_order_relaxed);
+    return claimed < ALLOC_STATS_MAX_THREADS ? claimed : ALLOC_STATS_MAX_THREADS;
+}
+
+const char* AllocStats::thread_name(size_t thread_slot) const {
+    return alloc_rows[thread_slot].name.load(std::memory_order_relaxed);
+}
+
+const char* AllocStats::stage_name(PipelineStage stage) {
+    return stage == ALLOC_STAGE_UNTAGGED ? "untagged" : PipelineLatency::stage_name(stage);
+}
+
+void AllocStats::print_stats() const {
+    V_COUT_1 << "\nHeap Allocations (allocs / frees / bytes):\n";
+    for (size_t i = 0; i < ALLOC_STAGE_SLOTS; ++i) {
+        AllocCounts c = stage_counts(static_cast<PipelineStage>(i));
+        V_COUT_1 << stage_name(static_cast<PipelineStage>(i)) << ": " << c.allocations << " / "
+                 << c.frees << " / " << c.allocated_bytes << "\n";
+    }
+    const size_t slots = thread_slots();
+    for (size_t i = 0; i < slots; ++i) {
+        AllocCounts c = thread_counts(i);
+        const char* name = thread_name(i);
+        V_COUT_1 << "thread " << (name != nullptr ? name : std::to_string(i).c_str()) << ": "
+                 << c.allocations << " / " << c.frees << " / " << c.allocated_bytes << "\n";
+    }
+}
+
+void AllocStats::collect_metrics(MetricsWriter& out) const {
+    if (!enabled()) {
+        return;
+    }
+    const size_t slots = thread_slots();
+    for (size_t i = 0; i < slots; ++i) {
+        const char* name = thread_name(i);
+        const std::string thread = name != nullptr ? name : std::to_string(i);
+        for (size_t stage = 0; stage < ALLOC_STAGE_SLOTS; ++stage) {
+            AllocCounts c = read_row(alloc_rows[i], stage);
+            if (c.allocations == 0 && c.frees == 0) {
+                continue;
+            }
+            MetricLabels labels = {{"thread", thread}, {"stage", stage_name(static_cast<PipelineStage>(stage))}};
+            out.counter("uvcfd_allocations_total", "Heap allocations by thread and pipeline stage", labels,
+                        static_cast<int64_t>(c.allocations));
+            out.counter("uvcfd_frees_total", "Heap frees by thread and pipeline stage", labels,
+                        static_cast<int64_t>(c.frees));
+            out.counter("uvcfd_allocated_bytes_total", "Heap bytes allocated, allocator rounding included", labels,
+                        static_cast<int64_t>(c.allocated_bytes));
+            out.counter("uvcfd_freed_bytes_total", "Heap bytes freed, allocator rounding included", labels,
+                        static_cast<int64_t>(c.freed_bytes));
+        }
+    }
+}
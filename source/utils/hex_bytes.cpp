@@ -0,0 +1,67 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#include "utils/hex_bytes.hpp"
+
+#include <array>
+
+namespace {
+
+const std::array<unsigned char, 256> hex_lut = []() {
+    std::array<unsigned char, 256> table = {};
+    for (int i = 0; i < 256; ++i) table[i] = 0xFF;
+    for (char c = '0'; c <= '9'; ++c) table[static_cast<unsigned char>(c)] = c - '0';
+    for (char c = 'A'; c <= 'F'; ++c) table[static_cast<unsigned char>(c)] = c - 'A' + 10;
+    for (char c = 'a'; c <= 'f'; ++c) table[static_cast<unsigned char>(c)] = c - 'a' + 10;
+    return table;
+}();
+
+} // namespace
+
+void hex_string_to_bytes_append(const std::string& hex_str, std::vector<unsigned char>& out_vec) {
+    hex_chars_to_bytes_append(hex_str.data(), hex_str.length(), out_vec);
+}
+
+void hex_chars_to_bytes_append(const char* hex, size_t length, std::vector<unsigned char>& out_vec) {
+    size_t num_bytes = length / 2;
+    size_t initial_size = out_vec.size();
+    out_vec.resize(initial_size + num_bytes);
+
+    unsigned char* dst = out_vec.data() + initial_size;
+
+    for (size_t i = 0; i < num_bytes; ++i) {
+        unsigned char high = hex_lut[static_cast<unsigned char>(hex[i * 2])];
+        unsigned char low = hex_lut[static_cast<unsigned char>(hex[i * 2 + 1])];
+        dst[i] = (high << 4) | low;
+    }
+}
+
+void bytes_to_hex_append(const unsigned char* data, size_t size, std::string& out_str) {
+    static const char digits[] = "0123456789abcdef";
+    const size_t start = out_str.size();
+    out_str.resize(start + size * 2);
+    char* dst = &out_str[start];
+    for (size_t i = 0; i < size; ++i) {
+        dst[2 * i] = digits[data[i] >> 4];
+        dst[2 * i + 1] = digits[data[i] & 15];
+    }
+}
@@ -0,0 +1,195 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#include "utils/log_sink.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#include "utils/verbose.hpp"
+#ifdef GUI_SET
+#include "gui/window_manager.hpp"
+#endif
+
+// Upper bound of records handled before the touched streams are flushed
+#define LOG_SINK_BATCH 256
+
+LogSink& LogSink::instance() {
+    static LogSink instance;
+    return instance;
+}
+
+LogSink::LogSink() {
+    writer_ = std::thread(&LogSink::writer_loop, this);
+}
+
+LogSink::~LogSink() {
+    stop_.store(true, std::memory_order_release);
+    wake_cv_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    if (dropped_.load() > 0) {
+        std::cerr << "[log] " << dropped_.load() << " records dropped (ring full)" << std::endl;
+    }
+}
+
+bool LogSink::submit(LogRecord&& record) {
+    if (!ring_.try_push(std::move(record))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    submitted_.fetch_add(1, std::memory_order_release);
+    // notify only when the writer is parked; it also wakes up on its own timeout
+    if (writer_idle_.load(std::memory_order_acquire)) {
+        wake_cv_.notify_one();
+    }
+    return true;
+}
+
+void LogSink::flush() {
+    if (std::this_thread::get_id() == writer_.get_id()) {
+        return;
+    }
+    const uint64_t target = submitted_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (written_.load(std::memory_order_acquire) < target && writer_.joinable()) {
+        wake_cv_.notify_one();
+        drained_cv_.wait_for(lock, std::chrono::milliseconds(2));
+    }
+}
+
+void LogSink::writer_loop() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (drain() == 0) {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            writer_idle_.store(true, std::memory_order_release);
+            drained_cv_.notify_all();
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(5));
+            writer_idle_.store(false, std::memory_order_release);
+        }
+    }
+    while (drain() > 0) {
+    }
+    drained_cv_.notify_all();
+}
+
+size_t LogSink::drain() {
+    LogRecord record;
+    size_t count = 0;
+
+    // Consecutive records for the same stream are joined into one write
+    std::ostream* pending_stream = nullptr;
+    std::string pending;
+    std::ostream* touched[4] = {nullptr, nullptr, nullptr, nullptr};
+    size_t touched_count = 0;
+
+    auto write_pending = [&]() {
+        if (pending_stream != nullptr && !pending.empty()) {
+            pending_stream->write(pending.data(), static_cast<std::streamsize>(pending.size()));
+            bool seen = false;
+            for (size_t i = 0; i < touched_count; ++i) {
+                if (touched[i] == pending_stream) seen = true;
+            }
+            if (!seen) {
+                if (touched_count == 4) {
+                    touched[0]->flush();
+                    touched[0] = touched[--touched_count];
+                }
+                touched[touched_count++] = pending_stream;
+            }
+        }
+        pending.clear();
+        pending_stream = nullptr;
+    };
+
+    while (count < LOG_SINK_BATCH && ring_.try_pop(record)) {
+        ++count;
+        if (record.target == LOG_TARGET_WINDOW) {
+            write_pending();
+            write_window(record);
+            continue;
+        }
+        if (record.stream == nullptr) {
+            continue;
+        }
+        if (record.stream != pending_stream) {
+            write_pending();
+            pending_stream = record.stream;
+        }
+        pending += record.text;
+    }
+    write_pending();
+
+    for (size_t i = 0; i < touched_count; ++i) {
+        touched[i]->flush();
+    }
+
+    if (count > 0) {
+        ring_.publish_consumed();
+        written_.fetch_add(count, std::memory_order_release);
+        drained_cv_.notify_all();
+    }
+    return count;
+}
+
+void LogSink::write_window(LogRecord& record) {
+#ifdef GUI_SET
+    WindowManager& uvcfd_win = WindowManager::getInstance();
+
+    WindowData* data = nullptr;
+
+    switch (record.window) {
+      case WIN_ERROR_FRAME: data = &uvcfd_win.getWin_ErrorFrame(); break;
+      case WIN_FRAME_TIME: data = &uvcfd_win.getWin_FrameTime(); break;
+      case WIN_SUMMARY: data = &uvcfd_win.getWin_Summary(); break;
+      case WIN_CONTROL_CONFIG: data = &uvcfd_win.getWin_ControlConfig(); break;
+      case WIN_STATISTICS: data = &uvcfd_win.getWin_Statistics(); break;
+      case WIN_DEBUG: data = &uvcfd_win.getWin_Debug(); break;
+
+      case WIN_PREVIOUS_VALID: data = &uvcfd_win.getWin_PreviousValid(); break;
+      case WIN_LOST_IN_BETWEEN_ERROR: data = &uvcfd_win.getWin_LostInbetweenError(); break;
+      case WIN_CURRENT_ERROR: data = &uvcfd_win.getWin_CurrentError(); break;
+
+      case WIN_LOG_BUTTONS: data = &uvcfd_win.getWin_LogButtons(); break;
+      case WIN_VALID_FRAME: data = &uvcfd_win.getWin_ValidFrame(); break;
+      default: break;
+    }
+
+    if (data == nullptr) {
+        return;
+    }
+    if (record.flags & LOG_FLAG_FRAME_ERROR) {
+        data->pushback_errorlog(record.text);
+    }
+    if (record.flags & LOG_FLAG_FRAME_SUSPICIOUS) {
+        data->pushback_suspiciouslog(record.text);
+    }
+    if (record.flags & LOG_FLAG_PRINT_WHOLE) {
+        data->set_move_customtext(std::move(record.text));
+    } else {
+        data->add_move_customtext(std::move(record.text));
+    }
+#else
+    (void)record;
+#endif
+}
@@ -24,6 +24,7 @@
 
 #include <iostream>
 
+#include "utils/log_sink.hpp"
 #include "utils/verbose.hpp"
 
 // Define the global log verbose level
@@ -32,6 +33,9 @@ int log_verbose_level = 0;
 // Constructor: Initialize with log directory and file name
 Logger::Logger(const std::string& log_dir_path,
                const std::string& log_file_name) {
+  // Create the sink first so it outlives this logger at static destruction
+  LogSink::instance();
+
   // Ensure the log directory exists
   ensure_log_directory(log_dir_path);
 
@@ -40,16 +44,17 @@ Logger::Logger(const std::string& log_dir_path,
 
   // Open log file
   if (!open_log_file(log_path)) {
-    CtrlPrint::v_cerr_1 << "Failed to open log file: " + log_path
+    V_CERR_1 << "Failed to open log file: " + log_path
              << std::endl;  
   } else {
-    CtrlPrint::v_cout_2 << "Log file created: " + log_path << std::endl; 
+    V_COUT_2 << "Log file created: " + log_path << std::endl; 
   }
 }
 
 // Destructor: Close log file if it's open
 Logger::~Logger() {
   if (log_file.is_open()) {
+    LogSink::instance().flush();
     log_file.close();
   }
 }
@@ -71,9 +76,19 @@ bool Logger::open_log_file(const std::string& log_path) {
 void Logger::log(int level, const std::string& level_name,
                  const std::string& message) {
   if (log_verbose_level >= level) {
-    if (log_file.is_open()) {
-      log_file << level_name << ": " << message << std::endl; 
-    }
+    write_file(level_name, message);
+  }
+}
+
+// File lines are written by the LogSink thread, no flush per line
+void Logger::write_file(const std::string& level_name, const std::string& message) {
+  if (log_file.is_open()) {
+    LogRecord record;
+    record.target = LOG_TARGET_FILE;
+    record.stream = &log_file;
+    record.text.reserve(level_name.size() + message.size() + 3);
+    record.text.append(level_name).append(": ").append(message).push_back('\n');
+    LogSink::instance().submit(std::move(record));
   }
 }
 
@@ -83,26 +98,24 @@ void Logger::cout_log(int level, const std::string& level_name,
   if (log_verbose_level >= level) {
     switch (level) {
       case 1:
-        CtrlPrint::v_cout_1 << level_name + ": " + message << std::endl;
+        V_COUT_1 << level_name + ": " + message << std::endl;
         break; 
       case 2:
-        CtrlPrint::v_cout_2 << level_name + ": " + message << std::endl;
+        V_COUT_2 << level_name + ": " + message << std::endl;
         break; 
       case 3:
-        CtrlPrint::v_cout_3 << level_name + ": " + message << std::endl;
+        V_COUT_3 << level_name + ": " + message << std::endl;
         break; 
       case 4:
-        CtrlPrint::v_cout_4 << level_name + ": " + message << std::endl;
+        V_COUT_4 << level_name + ": " + message << std::endl;
         break; 
       case 5:
-        CtrlPrint::v_cout_5 << level_name + ": " + message << std::endl;
+        V_COUT_5 << level_name + ": " + message << std::endl;
         break;  
       default:
         break;
     }
-    if (log_file.is_open()) {
-      log_file << level_name << ": " << message << std::endl;
-    }
+    write_file(level_name, message);
   }
 }
 
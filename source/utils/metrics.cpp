@@ -0,0 +1,354 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#include "utils/metrics.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+  typedef SOCKET socket_t;
+  #define METRICS_INVALID_SOCKET INVALID_SOCKET
+  #define metrics_close_socket closesocket
+  #define METRICS_SEND_FLAGS 0
+#else
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/select.h>
+  #include <sys/socket.h>
+  #include <sys/time.h>
+  #include <unistd.h>
+  typedef int socket_t;
+  #define METRICS_INVALID_SOCKET (-1)
+  #define metrics_close_socket close
+  #define METRICS_SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#include "utils/verbose.hpp"
+
+// Largest request head read from a scraper, the body is never used
+#define METRICS_REQUEST_MAX 4096
+
+namespace {
+
+std::string escape_label_value(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+std::string format_double(double value) {
+    if (std::isnan(value)) return "NaN";
+    if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+    // shortest form that reads back exactly, so 0.99 stays "0.99"
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (std::strtod(buffer, nullptr) != value) {
+        std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    }
+    return buffer;
+}
+
+bool send_all(socket_t socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(socket, data.data() + sent, static_cast<int>(data.size() - sent), METRICS_SEND_FLAGS);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void send_response(socket_t socket, const char* status, const char* content_type, const std::string& body) {
+    std::string response = std::string("HTTP/1.0 ") + status + "\r\n";
+    response += std::string("Content-Type: ") + content_type + "\r\n";
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+    send_all(socket, response);
+}
+
+}  // namespace
+
+void MetricsWriter::counter(const std::string& name, const std::string& help, const MetricLabels& labels, int64_t value) {
+    family(name, help, "counter").samples.push_back(sample_prefix(name, labels) + " " + std::to_string(value));
+}
+
+void MetricsWriter::gauge(const std::string& name, const std::string& help, const MetricLabels& labels, double value) {
+    family(name, help, "gauge").samples.push_back(sample_prefix(name, labels) + " " + format_double(value));
+}
+
+void MetricsWriter::summary(const std::string& name, const std::string& help, const MetricLabels& labels,
+                            const std::vector<std::pair<double, double>>& quantiles, double sum, uint64_t count) {
+    Family& f = family(name, help, "summary");
+    for (const auto& quantile : quantiles) {
+        MetricLabels quantile_labels = labels;
+        quantile_labels.emplace_back("quantile", format_double(quantile.first));
+        f.samples.push_back(sample_prefix(name, quantile_labels) + " " + format_double(quantile.second));
+    }
+    f.samples.push_back(sample_prefix(name + "_sum", labels) + " " + format_double(sum));
+    f.samples.push_back(sample_prefix(name + "_count", labels) + " " + std::to_string(count));
+}
+
+std::string MetricsWriter::str() const {
+    std::string out;
+    for (const Family& f : families_) {
+        out += "# HELP " + f.name + " " + f.help + "\n";
+        out += "# TYPE " + f.name + " " + f.type + "\n";
+        for (const std::string& sample : f.samples) {
+            out += sample;
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+MetricsWriter::Family& MetricsWriter::family(const std::string& name, const std::string& help, const char* type) {
+    for (Family& f : families_) {
+        if (f.name == name) {
+            return f;
+        }
+    }
+    families_.push_back(Family{name, help, type, {}});
+    return families_.back();
+}
+
+std::string MetricsWriter::sample_prefix(const std::string& name, const MetricLabels& labels) {
+    if (labels.empty()) {
+        return name;
+    }
+    std::string prefix = name + "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i) prefix += ",";
+        prefix += labels[i].first + "=\"" + escape_label_value(labels[i].second) + "\"";
+    }
+    prefix += "}";
+    return prefix;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+int MetricsRegistry::add_collector(Collector collector) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = next_id_++;
+    collectors_.emplace_back(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::remove_collector(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = collectors_.begin(); it != collectors_.end(); ++it) {
+        if (it->first == id) {
+            collectors_.erase(it);
+            return;
+        }
+    }
+}
+
+std::string MetricsRegistry::render() {
+    MetricsWriter writer;
+    {
+        // Held while collecting so a checker cannot unregister (and be destroyed) mid scrape
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : collectors_) {
+            entry.second(writer);
+        }
+    }
+    return writer.str();
+}
+
+MetricsServer& MetricsServer::instance() {
+    static MetricsServer instance;
+    return instance;
+}
+
+MetricsServer::MetricsServer() : listen_socket_(static_cast<intptr_t>(METRICS_INVALID_SOCKET)) {
+    // Collectors must outlive the server thread that calls them
+    MetricsRegistry::instance();
+#ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool MetricsServer::start(const std::string& listen_address) {
+    if (running()) {
+        return true;
+    }
+
+    size_t colon = listen_address.rfind(':');
+    std::string host = colon == std::string::npos ? std::string() : listen_address.substr(0, colon);
+    std::string port_str = colon == std::string::npos ? listen_address : listen_address.substr(colon + 1);
+    char* end = nullptr;
+    long port = std::strtol(port_str.c_str(), &end, 10);
+    if (port_str.empty() || *end != '\0' || port < 0 || port > 65535) {
+        V_CERR_1 << "metrics: invalid listen address " << listen_address << std::endl;
+        return false;
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (host.empty() || host == "*" || host == "0.0.0.0") {
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (host == "localhost") {
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    } else if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        V_CERR_1 << "metrics: invalid listen host " << host << std::endl;
+        return false;
+    }
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == METRICS_INVALID_SOCKET) {
+        V_CERR_1 << "metrics: socket() failed" << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(s, 8) != 0) {
+        V_CERR_1 << "metrics: cannot listen on " << listen_address << std::endl;
+        metrics_close_socket(s);
+        return false;
+    }
+
+    sockaddr_in bound;
+    socklen_t bound_len = sizeof(bound);
+    if (getsockname(s, reinterpret_cast<sockaddr*>(&bound), &bound_len) == 0) {
+        port_ = ntohs(bound.sin_port);
+    } else {
+        port_ = static_cast<int>(port);
+    }
+
+    listen_socket_ = static_cast<intptr_t>(s);
+    running_.store(true, std::memory_order_release);
+    server_thread_ = std::thread(&MetricsServer::serve_loop, this);
+
+    V_COUT_1 << "Metrics served on http://" << (host.empty() ? "0.0.0.0" : host) << ":" << port_ << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    running_.store(false, std::memory_order_release);
+    if (server_thread_.joinable()) {
+        server_thread_.join();
+    }
+    socket_t s = static_cast<socket_t>(listen_socket_);
+    if (s != METRICS_INVALID_SOCKET) {
+        metrics_close_socket(s);
+        listen_socket_ = static_cast<intptr_t>(METRICS_INVALID_SOCKET);
+    }
+}
+
+void MetricsServer::serve_loop() {
+    socket_t s = static_cast<socket_t>(listen_socket_);
+    while (running_.load(std::memory_order_acquire)) {
+        // Wake up regularly so stop() never waits on a scraper
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(s, &read_set);
+        timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 200000;
+        int ready = select(static_cast<int>(s) + 1, &read_set, nullptr, nullptr, &timeout);
+        if (ready <= 0) {
+            continue;
+        }
+
+        socket_t client = accept(s, nullptr, nullptr);
+        if (client == METRICS_INVALID_SOCKET) {
+            continue;
+        }
+        handle_client(static_cast<intptr_t>(client));
+        metrics_close_socket(client);
+    }
+}
+
+void MetricsServer::handle_client(intptr_t client_handle) {
+    socket_t client = static_cast<socket_t>(client_handle);
+
+#ifdef _WIN32
+    DWORD recv_timeout = 1000;
+#else
+    timeval recv_timeout;
+    recv_timeout.tv_sec = 1;
+    recv_timeout.tv_usec = 0;
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&recv_timeout), sizeof(recv_timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.size() < METRICS_REQUEST_MAX && request.find("\r\n\r\n") == std::string::npos) {
+        int n = recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    size_t line_end = request.find("\r\n");
+    std::string request_line = request.substr(0, line_end);
+    size_t method_end = request_line.find(' ');
+    size_t path_end = request_line.find(' ', method_end == std::string::npos ? 0 : method_end + 1);
+    if (method_end == std::string::npos || path_end == std::string::npos) {
+        send_response(client, "400 Bad Request", "text/plain", "bad request\n");
+        return;
+    }
+
+    std::string method = request_line.substr(0, method_end);
+    std::string path = request_line.substr(method_end + 1, path_end - method_end - 1);
+    if (method != "GET") {
+        send_response(client, "405 Method Not Allowed", "text/plain", "only GET is supported\n");
+        return;
+    }
+    if (path != "/metrics" && path.compare(0, 9, "/metrics?") != 0) {
+        send_response(client, "404 Not Found", "text/plain", "metrics are served on /metrics\n");
+        return;
+    }
+
+    send_response(client, "200 OK", "text/plain; version=0.0.4; charset=utf-8", MetricsRegistry::instance().render());
+}
@@ -0,0 +1,182 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#include "utils/pipeline_latency.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "utils/metrics.hpp"
+#include "utils/verbose.hpp"
+
+namespace {
+
+// Taken at static initialisation so the first report does not have to wait for a calibration window
+const uint64_t clock_anchor_tick = PipelineClock::now();
+const std::chrono::steady_clock::time_point clock_anchor_time = std::chrono::steady_clock::now();
+
+std::string format_latency(double ns) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1);
+    if (ns < 1000.0) {
+        oss << ns << " ns";
+    } else if (ns < 1000000.0) {
+        oss << ns / 1000.0 << " us";
+    } else {
+        oss << ns / 1000000.0 << " ms";
+    }
+    return oss.str();
+}
+
+}  // namespace
+
+double PipelineClock::ns_per_tick() {
+#ifdef PIPELINE_CLOCK_TSC
+    static std::atomic<double> settled{0.0};
+    double cached = settled.load(std::memory_order_relaxed);
+    if (cached > 0.0) {
+        return cached;
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - clock_anchor_time;
+    if (elapsed < std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+    }
+    uint64_t ticks = now() - clock_anchor_tick;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - clock_anchor_time).count();
+    double ratio = ticks ? static_cast<double>(ns) / static_cast<double>(ticks) : 1.0;
+
+    // After a second the error is well below the bucket resolution, keep it
+    if (ns >= 1000000000) {
+        settled.store(ratio, std::memory_order_relaxed);
+    }
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int exponent = static_cast<int>(index / SUB_BUCKETS) + SUB_BITS - 1;
+    uint64_t mantissa = index % SUB_BUCKETS;
+    uint64_t lower = (SUB_BUCKETS + mantissa) << (exponent - SUB_BITS);
+    return lower + ((uint64_t(1) << (exponent - SUB_BITS)) - 1);
+}
+
+uint64_t LatencyHistogram::percentile_ticks(double quantile) const {
+    std::vector<uint64_t> counts(BUCKETS);
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.999999);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    uint64_t max_value = max_ticks();
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(i);
+            return upper < max_value ? upper : max_value;
+        }
+    }
+    return max_value;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    Summary result;
+    result.count = count();
+    if (result.count == 0) {
+        return result;
+    }
+    const double scale = PipelineClock::ns_per_tick();
+    result.p50_ns = percentile_ticks(0.5) * scale;
+    result.p99_ns = percentile_ticks(0.99) * scale;
+    result.p999_ns = percentile_ticks(0.999) * scale;
+    result.max_ns = max_ticks() * scale;
+    result.sum_ns = sum_.load(std::memory_order_relaxed) * scale;
+    return result;
+}
+
+PipelineLatency& PipelineLatency::instance() {
+    static PipelineLatency instance;
+    return instance;
+}
+
+PipelineLatency::PipelineLatency() {
+    metrics_collector_id_ = MetricsRegistry::instance().add_collector(
+        [this](MetricsWriter& out) { collect_metrics(out); });
+}
+
+PipelineLatency::~PipelineLatency() {
+    MetricsRegistry::instance().remove_collector(metrics_collector_id_);
+}
+
+const char* PipelineLatency::stage_name(PipelineStage stage) {
+    switch (stage) {
+        case STAGE_QUEUE_WAIT: return "queue_wait";
+        case STAGE_VALIDATE: return "validate";
+        case STAGE_DEVELOP_WAIT: return "develop_wait";
+        case STAGE_DEVELOP: return "develop";
+        default: return "unknown";
+    }
+}
+
+void PipelineLatency::print_stats() const {
+    V_COUT_1 << "\nPipeline Latency (p50 / p99 / p99.9 / max):\n";
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        PipelineStage stage = static_cast<PipelineStage>(i);
+        LatencyHistogram::Summary s = histograms_[i].summary();
+        V_COUT_1 << stage_name(stage) << ": ";
+        if (s.count == 0) {
+            V_COUT_1 << "-\n";
+            continue;
+        }
+        V_COUT_1 << format_latency(s.p50_ns) << " / " << format_latency(s.p99_ns) << " / "
+                 << format_latency(s.p999_ns) << " / " << format_latency(s.max_ns)
+                 << " (n=" << s.count << ")\n";
+    }
+}
+
+void PipelineLatency::collect_metrics(MetricsWriter& out) const {
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        PipelineStage stage = static_cast<PipelineStage>(i);
+        LatencyHistogram::Summary s = histograms_[i].summary();
+        MetricLabels labels = {{"stage", stage_name(stage)}};
+        out.summary("uvcfd_stage_latency_seconds", "Time spent in each pipeline stage", labels,
+                    {{0.5, s.p50_ns * 1e-9}, {0.99, s.p99_ns * 1e-9}, {0.999, s.p999_ns * 1e-9}},
+                    s.sum_ns * 1e-9, s.count);
+        out.gauge("uvcfd_stage_latency_max_seconds", "Longest time spent in each pipeline stage", labels,
+                  s.max_ns * 1e-9);
+    }
+}
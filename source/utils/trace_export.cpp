@@ -0,0 +1,268 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+#include "utils/trace_export.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "utils/verbose.hpp"
+
+// Formatted bytes kept in memory before they are handed to the file
+#define TRACE_EXPORT_WRITE_CHUNK (256 * 1024)
+// Upper bound of events formatted per wake up
+#define TRACE_EXPORT_BATCH 1024
+
+#define TRACE_EXPORT_PID 1
+
+TraceExporter& TraceExporter::instance() {
+    static TraceExporter instance;
+    return instance;
+}
+
+TraceExporter::~TraceExporter() {
+    close();
+}
+
+bool TraceExporter::open(const std::string& path) {
+    if (enabled() || writer_.joinable()) {
+        V_CERR_1 << "[trace] already writing to " << path_ << std::endl;
+        return false;
+    }
+    file_.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!file_.is_open()) {
+        V_CERR_1 << "[trace] cannot open " << path << std::endl;
+        return false;
+    }
+    if (!ring_) {
+        ring_.reset(new MpscRing<TraceEvent, TRACE_EXPORT_CAPACITY>());
+    }
+    path_ = path;
+    device_anchored_ = false;
+    dropped_.store(0, std::memory_order_relaxed);
+    written_.store(0, std::memory_order_relaxed);
+    stop_.store(false, std::memory_order_relaxed);
+
+    // Track names, written once so the rows read well in both viewers
+    static const struct { TraceTrack track; const char* name; } tracks[] = {
+        {TRACK_FRAMES, "Frames"},
+        {TRACK_PAYLOAD_ERRORS, "Payload errors"},
+        {TRACK_DEVICE_TIME, "Device time (PTS)"},
+        {TRACK_COUNTERS, "Counters"},
+    };
+    pending_ = "[\n";
+    char line[192];
+    std::snprintf(line, sizeof(line),
+                  "{\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"uvcfd\"}}",
+                  TRACE_EXPORT_PID);
+    pending_ += line;
+    for (const auto& t : tracks) {
+        std::snprintf(line, sizeof(line),
+                      ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}"
+                      ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%d}}",
+                      TRACE_EXPORT_PID, static_cast<int>(t.track), t.name,
+                      TRACE_EXPORT_PID, static_cast<int>(t.track), static_cast<int>(t.track));
+        pending_ += line;
+    }
+
+    writer_ = std::thread(&TraceExporter::writer_loop, this);
+    enabled_.store(true, std::memory_order_release);
+    V_COUT_1 << "[trace] writing timeline to " << path << std::endl;
+    return true;
+}
+
+void TraceExporter::close() {
+    if (!writer_.joinable()) {
+        return;
+    }
+    enabled_.store(false, std::memory_order_release);
+    stop_.store(true, std::memory_order_release);
+    wake_cv_.notify_one();
+    writer_.join();
+
+    pending_ += "\n]\n";
+    file_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+    pending_.clear();
+    file_.close();
+
+    V_COUT_1 << "[trace] " << written_.load() << " events written to " << path_ << std::endl;
+    if (dropped_.load() > 0) {
+        V_CERR_1 << "[trace] " << dropped_.load() << " events dropped (ring full)" << std::endl;
+    }
+}
+
+int64_t TraceExporter::to_us(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+void TraceExporter::submit(TraceEvent&& event) {
+    if (!ring_->try_push(std::move(event))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TraceExporter::frame(uint64_t frame_number, std::chrono::steady_clock::time_point first_payload,
+                          std::chrono::steady_clock::time_point last_payload, TraceFrameState state,
+                          int frame_error, int frame_suspicious, uint32_t payload_count, uint64_t frame_bytes) {
+    if (!enabled()) return;
+    TraceEvent event;
+    event.phase = 'X';
+    event.track = TRACK_FRAMES;
+    switch (state) {
+      case TRACE_FRAME_ERROR: event.name = "frame (error)"; event.color = "terrible"; break;
+      case TRACE_FRAME_SUSPICIOUS: event.name = "frame (suspicious)"; event.color = "yellow"; break;
+      default: event.name = "frame"; event.color = "good"; break;
+    }
+    event.ts_us = to_us(first_payload);
+    event.dur_us = to_us(last_payload) - event.ts_us;
+    event.arg("frame", static_cast<int64_t>(frame_number))
+         .arg("error", frame_error)
+         .arg("suspicious", frame_suspicious)
+         .arg("payloads", payload_count);
+    submit(std::move(event));
+
+    TraceEvent size;
+    size.phase = 'C';
+    size.track = TRACK_COUNTERS;
+    size.name = "frame_bytes";
+    size.ts_us = to_us(last_payload);
+    size.arg("bytes", static_cast<int64_t>(frame_bytes));
+    submit(std::move(size));
+}
+
+void TraceExporter::payload_error(std::chrono::steady_clock::time_point time, int error, uint64_t payload_size) {
+    if (!enabled()) return;
+    TraceEvent event;
+    event.phase = 'i';
+    event.track = TRACK_PAYLOAD_ERRORS;
+    event.name = "payload error";
+    event.color = "bad";
+    event.ts_us = to_us(time);
+    event.arg("error", error).arg("size", static_cast<int64_t>(payload_size));
+    submit(std::move(event));
+}
+
+void TraceExporter::device_time(uint64_t frame_number, std::chrono::steady_clock::time_point host_time,
+                                std::chrono::steady_clock::time_point device_time) {
+    if (!enabled()) return;
+    const int64_t host_us = to_us(host_time);
+    const int64_t device_us = to_us(device_time);
+    if (!device_anchored_) {
+        device_anchored_ = true;
+        host_anchor_us_ = host_us;
+        device_anchor_us_ = device_us;
+    }
+    const int64_t device_on_host_us = host_anchor_us_ + (device_us - device_anchor_us_);
+
+    TraceEvent event;
+    event.phase = 'i';
+    event.track = TRACK_DEVICE_TIME;
+    event.name = "pts";
+    event.ts_us = device_on_host_us;
+    event.arg("frame", static_cast<int64_t>(frame_number)).arg("pts_us", device_us);
+    submit(std::move(event));
+
+    // Positive drift: the device clock runs ahead of the arrival times
+    TraceEvent drift;
+    drift.phase = 'C';
+    drift.track = TRACK_COUNTERS;
+    drift.name = "pts_drift_us";
+    drift.ts_us = host_us;
+    drift.arg("drift", device_on_host_us - host_us);
+    submit(std::move(drift));
+}
+
+void TraceExporter::counter(const char* name, std::chrono::steady_clock::time_point time, int64_t value) {
+    if (!enabled()) return;
+    TraceEvent event;
+    event.phase = 'C';
+    event.track = TRACK_COUNTERS;
+    event.name = name;
+    event.ts_us = to_us(time);
+    event.arg("value", value);
+    submit(std::move(event));
+}
+
+void TraceExporter::writer_loop() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (drain(pending_) == 0) {
+            // Idle: hand what is formatted to the file so a killed session keeps most of its trace
+            if (!pending_.empty()) {
+                file_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+                file_.flush();
+                pending_.clear();
+            }
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        if (pending_.size() >= TRACE_EXPORT_WRITE_CHUNK) {
+            file_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+            pending_.clear();
+        }
+    }
+    while (drain(pending_) > 0) {
+    }
+}
+
+size_t TraceExporter::drain(std::string& out) {
+    TraceEvent event;
+    size_t count = 0;
+    while (count < TRACE_EXPORT_BATCH && ring_->try_pop(event)) {
+        append_event(out, event);
+        ++count;
+    }
+    if (count > 0) {
+        ring_->publish_consumed();
+        written_.fetch_add(count, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void TraceExporter::append_event(std::string& out, const TraceEvent& event) {
+    char line[512];
+    int n = std::snprintf(line, sizeof(line),
+                          ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"ts\":%" PRId64,
+                          event.phase, TRACE_EXPORT_PID, static_cast<int>(event.track), event.name, event.ts_us);
+    out.append(line, static_cast<size_t>(n));
+
+    if (event.phase == 'X') {
+        n = std::snprintf(line, sizeof(line), ",\"dur\":%" PRId64, event.dur_us);
+        out.append(line, static_cast<size_t>(n));
+    } else if (event.phase == 'i') {
+        out += ",\"s\":\"t\"";
+    }
+    if (event.color != nullptr) {
+        out += ",\"cname\":\"";
+        out += event.color;
+        out += '"';
+    }
+    if (event.arg_count > 0) {
+        out += ",\"args\":{";
+        for (uint8_t i = 0; i < event.arg_count; ++i) {
+            n = std::snprintf(line, sizeof(line), "%s\"%s\":%" PRId64,
+                              i == 0 ? "" : ",", event.arg_names[i], event.arg_values[i]);
+            out.append(line, static_cast<size_t>(n));
+        }
+        out += '}';
+    }
+    out += '}';
+}
@@ -21,20 +21,24 @@
 *********************************************************************/
 
 #include "utils/verbose.hpp"
-#include <functional>
-#ifdef GUI_SET
-#include "gui/gui_win.hpp"
-#endif
+#include "utils/log_sink.hpp"
 
-WindowName gui_window_number = WIN_DEBUG;
-bool print_whole_flag = false;
-WindowName temp_window_number = WIN_DEBUG;
-bool frame_error_flag = false;
-bool frame_suspicious_flag = false;
+#include <array>
+#include <atomic>
+
+thread_local WindowName gui_window_number = WIN_DEBUG;
+thread_local bool print_whole_flag = false;
+thread_local WindowName temp_window_number = WIN_DEBUG;
+thread_local bool frame_error_flag = false;
+thread_local bool frame_suspicious_flag = false;
 
 // Initialize verbose level
 int VerboseStream::verbose_level = 2;
 
+namespace {
+  std::atomic<int> next_stream_slot{0};
+}
+
 // VerboseStream definitions
 namespace CtrlPrint {
   VerboseStream v_cout_1(1, "", std::cout);
@@ -52,59 +56,50 @@ namespace CtrlPrint {
 // VerboseStream constructor implementation
 VerboseStream::VerboseStream(int level, const std::string& prefix,
                              std::ostream& output_stream)
-    : level_(level), prefix_(prefix), output_stream_(output_stream) {}
+    : level_(level),
+      slot_(next_stream_slot.fetch_add(1) % VERBOSE_MAX_STREAMS),
+      prefix_(prefix),
+      output_stream_(output_stream) {}
+
+// Each thread formats into its own buffer for each stream
+std::ostringstream& VerboseStream::local_buffer() {
+  thread_local std::array<std::ostringstream, VERBOSE_MAX_STREAMS> buffers;
+  return buffers[slot_];
+}
 
 // VerboseStream implementation
 VerboseStream& VerboseStream::operator<<(std::ostream& (*manip)(std::ostream&) ) {
   if (VerboseStream::verbose_level >= level_) {
-    buffer_ << manip;
+    // std::endl / std::flush only end the record, the writer thread flushes the console in batches
+    if (manip != static_cast<std::ostream& (*)(std::ostream&)>(std::flush)) {
+      local_buffer() << manip;
+    }
     flush();
   }
   return *this;
 }
 
-
-
 void VerboseStream::flush() {
   if (VerboseStream::verbose_level >= level_) {
-#ifdef GUI_SET
-    WindowManager& uvcfd_win = WindowManager::getInstance();
+    std::ostringstream& buffer = local_buffer();
 
-    WindowData* data = nullptr;
-    
-    switch (gui_window_number) {
-      case 0: data = &uvcfd_win.getWin_ErrorFrame(); break;
-      case 1: data = &uvcfd_win.getWin_FrameTime(); break;
-      case 2: data = &uvcfd_win.getWin_Summary(); break;
-      case 3: data = &uvcfd_win.getWin_ControlConfig(); break;
-      case 4: data = &uvcfd_win.getWin_Statistics(); break;
-      case 5: data = &uvcfd_win.getWin_Debug(); break;
-      
-      case 6: data = &uvcfd_win.getWin_PreviousValid(); break;
-      case 7: data = &uvcfd_win.getWin_LostInbetweenError(); break;
-      case 8: data = &uvcfd_win.getWin_CurrentError(); break;
-
-      case 11: data = &uvcfd_win.getWin_LogButtons(); break;
-      case 13: data = &uvcfd_win.getWin_ValidFrame(); break;
-      default: break;
+    LogRecord record;
+    record.text = buffer.str();
+    buffer.str("");  // Clear the buffer after flushing
+    if (record.text.empty() && !print_whole_flag) {
+      return;
     }
 
-    if (data != nullptr) {
-      if (frame_error_flag){
-        data->pushback_errorlog(buffer_.str());
-      }
-      if (frame_suspicious_flag){
-        data->pushback_suspiciouslog(buffer_.str());
-      }
-      if (print_whole_flag){
-        data->set_move_customtext(std::move(buffer_.str()));
-      } else {
-        data->add_move_customtext(buffer_.str());
-      }
-    }
+#ifdef GUI_SET
+    record.target = LOG_TARGET_WINDOW;
+    record.window = gui_window_number;
+    if (print_whole_flag) record.flags |= LOG_FLAG_PRINT_WHOLE;
+    if (frame_error_flag) record.flags |= LOG_FLAG_FRAME_ERROR;
+    if (frame_suspicious_flag) record.flags |= LOG_FLAG_FRAME_SUSPICIOUS;
 #else
-    output_stream_ << buffer_.str();
+    record.target = LOG_TARGET_STREAM;
+    record.stream = &output_stream_;
 #endif
-    buffer_.str("");  // Clear the buffer after flushing
+    LogSink::instance().submit(std::move(record));
   }
 }
@@ -0,0 +1,173 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+// uvcfd_convert: converts captures between the formats the tools and tests read
+//
+//   uvcfd_convert -in capture.pcapng -o capture.uvcrec                  (fixture for tests/corpus)
+//   uvcfd_convert -in capture.uvcrec -to tshark | ./oldmanandsea           (replay)
+//   uvcfd_convert -in brio_dissect.txt -to timed -o brio_new.txt           (was change_shark/shkwhl_b.py, shkwhl_i.py)
+//   uvcfd_convert -in input.txt -to tph -o ../tph_iso_0.txt                (was change_shark/phf.py)
+//
+// The input format is detected from the first bytes (-from overrides), the output format
+// follows the file extension (.uvcrec record, .pcap / .pcapng pcap, otherwise tshark) unless -to is given.
+// Formats without a stream configuration take it from -ff -fw -fh -fps -payload -framesize -clock.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "validuvc/capture_convert.hpp"
+
+namespace {
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " [-in file|-] [-o file|-] [-from auto|record|pcap|hexdump|dissection|tshark|timed|hex]"
+                 " [-to record|pcap|tshark|timed|hex|tph] [-ff yuyv|mjpeg|h264] [-fw width] [-fh height] [-fps fps]"
+                 " [-payload dwMaxPayloadTransferSize] [-framesize dwMaxVideoFrameSize] [-clock dwTimeFrequency]"
+                 " [-stream iso|bulk] [-ep bus:device:endpoint] [-urb bulk URB size] [-linktype 189|220|249]"
+                 " [-threads n] [-chunk MB]" << std::endl;
+}
+
+bool ends_with(const std::string& text, const char* suffix) {
+    const size_t n = std::strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ConvertOptions options;
+    options.output = CAPTURE_AUTO;
+    std::string in_path = "-";
+    std::string out_path = "-";
+    bool frame_size_set = false;
+
+    options.config.width = 1280;
+    options.config.height = 720;
+    options.config.fps = 30;
+    options.config.format = FRAME_FORMAT_MJPEG;
+    options.config.dwMaxPayloadTransferSize = 3072;
+    options.config.dwTimeFrequency = 48000000;
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[i + 1];
+        if (std::strcmp(argv[i], "-in") == 0) {
+            in_path = value;
+        } else if (std::strcmp(argv[i], "-o") == 0) {
+            out_path = value;
+        } else if (std::strcmp(argv[i], "-from") == 0) {
+            if (!parse_capture_format(value, options.input) || options.input == CAPTURE_PACKET_HEX) {
+                std::cerr << "Unknown input format: " << value << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "-to") == 0) {
+            if (!parse_capture_format(value, options.output) || options.output == CAPTURE_AUTO ||
+                options.output == CAPTURE_HEXDUMP || options.output == CAPTURE_DISSECTION) {
+                std::cerr << "Unknown output format: " << value << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "-ff") == 0) {
+            if (!parse_frame_format(value, options.config.format)) {
+                std::cerr << "Unsupported frame format: " << value << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "-fw") == 0) {
+            options.config.width = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-fh") == 0) {
+            options.config.height = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-fps") == 0) {
+            options.config.fps = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-payload") == 0) {
+            options.config.dwMaxPayloadTransferSize = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (std::strcmp(argv[i], "-framesize") == 0) {
+            options.config.dwMaxVideoFrameSize = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+            frame_size_set = true;
+        } else if (std::strcmp(argv[i], "-clock") == 0) {
+            options.config.dwTimeFrequency = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (std::strcmp(argv[i], "-stream") == 0) {
+            options.transfer = value == "bulk" ? TRANSFER_BULK : TRANSFER_ISO;
+        } else if (std::strcmp(argv[i], "-ep") == 0) {
+            // bus:device:endpoint, endpoint in hex (1:3:0x81)
+            char* end = nullptr;
+            const unsigned long bus = std::strtoul(value.c_str(), &end, 10);
+            const unsigned long device = (*end == ':') ? std::strtoul(end + 1, &end, 10) : 0;
+            const unsigned long endpoint = (*end == ':') ? std::strtoul(end + 1, &end, 16) : 0;
+            if (*end != '\0' || endpoint == 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            options.stream = static_cast<uint32_t>((bus << 16) | ((device & 0xFF) << 8) | (endpoint & 0xFF));
+        } else if (std::strcmp(argv[i], "-urb") == 0) {
+            options.bulk_urb_size = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (std::strcmp(argv[i], "-linktype") == 0) {
+            options.hexdump_linktype = static_cast<uint16_t>(std::atoi(value.c_str()));
+        } else if (std::strcmp(argv[i], "-threads") == 0) {
+            options.workers = static_cast<size_t>(std::atoi(value.c_str()));
+        } else if (std::strcmp(argv[i], "-chunk") == 0) {
+            options.chunk_bytes = static_cast<size_t>(std::max(std::atof(value.c_str()), 0.0625) * (1 << 20));
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!frame_size_set) {
+        options.config.dwMaxVideoFrameSize = static_cast<uint32_t>(size_t(options.config.width) * options.config.height * 2);
+    }
+    if (options.output == CAPTURE_AUTO) {
+        options.output = ends_with(out_path, ".uvcrec") ? CAPTURE_RECORD
+                       : (ends_with(out_path, ".pcapng") || ends_with(out_path, ".pcap")) ? CAPTURE_PCAP
+                       : CAPTURE_TSHARK;
+    }
+
+    CaptureConverter converter(options);
+    const bool ok = converter.run(in_path, out_path);
+    const ConvertStats& stats = converter.stats();
+    for (const std::string& note : stats.notes) {
+        std::cerr << "Note: " << note << std::endl;
+    }
+    if (!ok) {
+        std::cerr << "uvcfd_convert: " << converter.error() << std::endl;
+        return 1;
+    }
+
+    std::cerr << capture_format_name(options.output) << ": " << stats.packets << " packets, " << stats.payloads
+              << " written (" << stats.payload_bytes << " bytes), " << stats.skipped << " skipped";
+    if (stats.malformed) std::cerr << ", " << stats.malformed << " malformed";
+    if (stats.truncated) std::cerr << ", " << stats.truncated << " truncated";
+    if (stats.configs) std::cerr << ", " << stats.configs << " stream configurations";
+    if (stats.stream) {
+        std::cerr << ", stream " << (stats.stream >> 16) << ":" << ((stats.stream >> 8) & 0xFF) << ":0x" << std::hex
+                  << (stats.stream & 0xFF) << std::dec;
+    }
+    std::cerr << std::endl;
+    std::cerr << stats.input_bytes << " input bytes in " << stats.seconds << " s ("
+              << (stats.seconds > 0 ? stats.input_bytes / stats.seconds / 1e6 : 0) << " MB/s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+// uvcfd_gen: synthetic UVC payload streams for load and accuracy tests
+//
+//   uvcfd_gen -ff mjpeg -fw 1920 -fh 1080 -fps 30 -stream bulk -frames 300 -format tshark -o stream.txt
+//   uvcfd_gen -fault err_bit=0.01 -fault missing_eof=0.005 -format pcapng -o faults.pcapng -truth faults.csv
+//   uvcfd_gen -format record -o tests/corpus/name.uvcrec   (corpus fixture, see payload_record.hpp)
+//   uvcfd_gen -format none -frames 10000        (generation rate only)
+//
+// tshark output starts with the descriptor / commit lines, so it can be piped straight into oldmanandsea
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "validuvc/payload_record.hpp"
+#include "validuvc/stream_generator.hpp"
+
+namespace {
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " [-ff yuyv|mjpeg|h264] [-fw width] [-fh height] [-fps fps] [-stream iso|bulk]"
+                 " [-payload dwMaxPayloadTransferSize] [-clock dwTimeFrequency] [-ratio compression]"
+                 " [-frames count] [-seed n] [-fault name=probability ...] [-faults probability]"
+                 " [-format tshark|pcapng|record|none] [-o file] [-truth file.csv]\n"
+              << "Faults:";
+    for (int f = 0; f < FAULT_COUNT; ++f) {
+        std::cerr << " " << stream_fault_name(static_cast<StreamFault>(f));
+    }
+    std::cerr << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GeneratorConfig config;
+    uint64_t frames = 300;
+    std::string format = "tshark";
+    std::string out_path;
+    std::string truth_path;
+    bool payload_set = false;
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[i + 1];
+        if (std::strcmp(argv[i], "-ff") == 0) {
+            if (!parse_frame_format(value, config.format) || config.format == FRAME_FORMAT_RGB) {
+                std::cerr << "Unsupported frame format: " << value << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "-fw") == 0) {
+            config.width = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-fh") == 0) {
+            config.height = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-fps") == 0) {
+            config.fps = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-stream") == 0) {
+            config.transfer = value == "bulk" ? TRANSFER_BULK : TRANSFER_ISO;
+        } else if (std::strcmp(argv[i], "-payload") == 0) {
+            config.max_payload_transfer_size = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+            payload_set = true;
+        } else if (std::strcmp(argv[i], "-clock") == 0) {
+            config.time_frequency = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (std::strcmp(argv[i], "-ratio") == 0) {
+            config.compression_ratio = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (std::strcmp(argv[i], "-frames") == 0) {
+            frames = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (std::strcmp(argv[i], "-seed") == 0) {
+            config.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (std::strcmp(argv[i], "-fault") == 0) {
+            const size_t eq = value.find('=');
+            StreamFault fault;
+            if (eq == std::string::npos || !parse_stream_fault(value.substr(0, eq), fault)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            config.fault_probability[fault] = std::atof(value.c_str() + eq + 1);
+        } else if (std::strcmp(argv[i], "-faults") == 0) {
+            for (double& p : config.fault_probability) p = std::atof(value.c_str());
+        } else if (std::strcmp(argv[i], "-format") == 0) {
+            format = value;
+        } else if (std::strcmp(argv[i], "-o") == 0) {
+            out_path = value;
+        } else if (std::strcmp(argv[i], "-truth") == 0) {
+            truth_path = value;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.width <= 0 || config.height <= 0 || config.fps <= 0 ||
+        (format != "tshark" && format != "pcapng" && format != "record" && format != "none")) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    // Bulk devices usually move a whole frame or a large chunk per payload
+    if (!payload_set && config.transfer == TRANSFER_BULK) {
+        config.max_payload_transfer_size = 512 * 1024;
+    }
+
+    if (format == "record" && out_path.empty()) {
+        std::cerr << "-format record needs -o file" << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    std::ostream* out = &std::cout;
+    if (format != "none" && format != "record" && !out_path.empty()) {
+        file.open(out_path, format == "pcapng" ? std::ios::binary : std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Unable to open file: " << out_path << std::endl;
+            return 1;
+        }
+        out = &file;
+    }
+    std::ofstream truth;
+    if (!truth_path.empty()) {
+        truth.open(truth_path);
+        truth << "frame,pts,payloads,data_bytes,faults\n";
+    }
+
+    UVCStreamGenerator generator(config);
+    std::unique_ptr<TsharkFieldsWriter> tshark;
+    std::unique_ptr<UsbmonPcapngWriter> pcapng;
+    PayloadRecordWriter record;
+    if (format == "record" && !record.open(out_path, config.stream_config())) {
+        std::cerr << "Unable to open file: " << out_path << std::endl;
+        return 1;
+    }
+    if (format == "tshark") {
+        tshark = std::make_unique<TsharkFieldsWriter>(*out, config.transfer);
+        tshark->write_config(config, config.start_time);
+    } else if (format == "pcapng") {
+        pcapng = std::make_unique<UsbmonPcapngWriter>(*out, config.transfer);
+    }
+
+    const StreamConfig stream = config.stream_config();
+    std::cerr << frame_format_name(config.format) << " " << config.width << "x" << config.height << " " << config.fps
+              << " fps, dwMaxVideoFrameSize " << stream.dwMaxVideoFrameSize << ", dwMaxPayloadTransferSize "
+              << stream.dwMaxPayloadTransferSize << ", dwTimeFrequency " << stream.dwTimeFrequency << std::endl;
+
+    uint64_t payloads = 0;
+    uint64_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t f = 0; f < frames; ++f) {
+        const std::vector<PayloadView>& frame = generator.next_frame();
+        for (const PayloadView& payload : frame) bytes += payload.size;
+        payloads += frame.size();
+        if (tshark) tshark->write(frame);
+        if (pcapng) pcapng->write(frame);
+        if (format == "record") {
+            for (const PayloadView& payload : frame) record.write(payload.data, payload.size, payload.time);
+        }
+
+        if (truth.is_open()) {
+            const GeneratedFrame& t = generator.frame_truth();
+            truth << t.frame_number << "," << t.pts << "," << t.payload_count << "," << t.data_bytes << ",";
+            bool first = true;
+            for (int fault = 0; fault < FAULT_COUNT; ++fault) {
+                if (t.has(static_cast<StreamFault>(fault))) {
+                    truth << (first ? "" : "|") << stream_fault_name(static_cast<StreamFault>(fault));
+                    first = false;
+                }
+            }
+            truth << "\n";
+        }
+    }
+    out->flush();
+    record.close();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << frames << " frames, " << payloads << " payloads, " << bytes << " bytes in " << seconds << " s ("
+              << (seconds > 0 ? bytes / seconds / 1e9 : 0) << " GB/s)" << std::endl;
+    for (int fault = 0; fault < FAULT_COUNT; ++fault) {
+        if (generator.injected(static_cast<StreamFault>(fault))) {
+            std::cerr << "  " << stream_fault_name(static_cast<StreamFault>(fault)) << ": "
+                      << generator.injected(static_cast<StreamFault>(fault)) << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+// uvcfd_rawframes: reads the raw frame store written with -raw errors|all
+//
+//   uvcfd_rawframes -in images/capture_2024-10-01-12-00-00 -list
+//   uvcfd_rawframes -in images/capture_2024-10-01-12-00-00 -frame 1234 -o frame_1234.jpg
+//   uvcfd_rawframes -in images/capture_2024-10-01-12-00-00 -frame 1234 -o frame_1234.yuyv   (exact bytes)
+//   uvcfd_rawframes -in images/capture_2024-10-01-12-00-00 -export out_dir/
+//
+// -in takes the base path, without .uvcraw / .uvcridx.
+// JPEG output decodes YUYV and RGB frames; MJPEG frames are already JPEG and are copied.
+// Any other extension writes the stored bytes unchanged.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "frame_file.hpp"
+#include "raw_frame_store.hpp"
+#include "rgb_to_jpeg.hpp"
+#include "yuyv_to_rgb.hpp"
+
+namespace {
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " -in base_path [-list] [-frame frame_number -o file] [-export directory]"
+              << std::endl;
+}
+
+bool ends_with(const std::string& text, const char* suffix) {
+    const size_t n = std::strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+bool write_frame(RawFrameReader& reader, const RawFrameEntry& entry, const std::string& path) {
+    std::vector<u_char> data;
+    if (!reader.read(entry, data)) {
+        std::cerr << "Could not read frame " << entry.frame_number << std::endl;
+        return false;
+    }
+    const bool jpeg = ends_with(path, ".jpg") || ends_with(path, ".jpeg");
+    if (!jpeg || entry.format == FRAME_FORMAT_MJPEG) {
+        const FrameSegment segment = {data.data(), data.size()};
+        return write_frame_file(path, &segment, 1);
+    }
+    if (entry.format == FRAME_FORMAT_YUYV) {
+        // Short (error) frames are decoded as far as they go, the rest stays black
+        data.resize(size_t(entry.width) * entry.height * 2, 0);
+        std::vector<u_char> rgb;
+        convertYUYVtoRGB(data, entry.width, entry.height, rgb);
+        return saveJPEG(rgb, entry.width, entry.height, path);
+    }
+    if (entry.format == FRAME_FORMAT_RGB) {
+        data.resize(size_t(entry.width) * entry.height * 3, 0);
+        return saveJPEG(data, entry.width, entry.height, path);
+    }
+    std::cerr << "Frame " << entry.frame_number << " is " << frame_format_name(entry.format)
+              << ", write it with a raw extension instead" << std::endl;
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string base_path;
+    std::string out_path;
+    std::string export_dir;
+    bool list = false;
+    bool frame_set = false;
+    uint32_t frame_number = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-list") == 0) {
+            list = true;
+        } else if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        } else if (std::strcmp(argv[i], "-in") == 0) {
+            base_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-frame") == 0) {
+            frame_number = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            frame_set = true;
+        } else if (std::strcmp(argv[i], "-o") == 0) {
+            out_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-export") == 0) {
+            export_dir = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (base_path.empty() || (frame_set && out_path.empty()) || (!list && !frame_set && export_dir.empty())) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    RawFrameReader reader;
+    if (!reader.open(base_path)) {
+        std::cerr << "uvcfd_rawframes: " << reader.error() << std::endl;
+        return 1;
+    }
+
+    if (list) {
+        std::cout << "frame_number,format,width,height,bytes,frame_error,frame_suspicious,pts,first_ns,last_ns\n";
+        for (const RawFrameEntry& entry : reader.entries()) {
+            std::cout << entry.frame_number << ',' << frame_format_name(entry.format) << ',' << entry.width << ','
+                      << entry.height << ',' << entry.size << ',' << entry.frame_error << ','
+                      << entry.frame_suspicious << ',' << entry.pts << ',' << entry.first_received_ns << ','
+                      << entry.last_received_ns << '\n';
+        }
+        std::cout.flush();
+    }
+
+    if (frame_set) {
+        const RawFrameEntry* entry = reader.find(frame_number);
+        if (entry == nullptr) {
+            std::cerr << "Frame " << frame_number << " is not in " << base_path << ".uvcridx" << std::endl;
+            return 1;
+        }
+        if (!write_frame(reader, *entry, out_path)) {
+            return 1;
+        }
+    }
+
+    if (!export_dir.empty()) {
+        if (export_dir.back() != '/' && export_dir.back() != '\\') {
+            export_dir += '/';
+        }
+        size_t exported = 0;
+        for (const RawFrameEntry& entry : reader.entries()) {
+            const std::string path = export_dir + "frame_" + std::to_string(entry.frame_number) +
+                                     (entry.format == FRAME_FORMAT_H264 ? ".h264" : ".jpg");
+            if (write_frame(reader, entry, path)) {
+                ++exported;
+            }
+        }
+        std::cerr << exported << " of " << reader.entries().size() << " frames exported to " << export_dir << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,1504 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "validuvc/capture_convert.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+  #include <fcntl.h>
+  #include <io.h>
+#endif
+
+#include "utils/hex_bytes.hpp"
+#include "validuvc/payload_record.hpp"
+
+namespace {
+
+const char* const capture_format_names[CAPTURE_FORMAT_COUNT] = {
+    "auto", "record", "pcap", "hexdump", "dissection", "tshark", "timed", "hex", "tph"
+};
+
+constexpr uint16_t kLinktypeUsbLinux = 189;             // usbmon, 48 byte header
+constexpr uint16_t kLinktypeUsbLinuxMmapped = 220;      // usbmon, 64 byte header with iso descriptors
+constexpr uint16_t kLinktypeUsbPcap = 249;              // Windows USBPcap
+
+constexpr size_t kPacketHeader = 16;                    // normalized packet: u32 caplen, u16 link type, u16 0, i64 ns
+constexpr size_t kFlushBytes = 1 << 20;
+
+uint64_t le(const u_char* in, int bytes) {
+    uint64_t value = 0;
+    for (int b = 0; b < bytes; ++b) value |= static_cast<uint64_t>(in[b]) << (8 * b);
+    return value;
+}
+
+void put_le(u_char* out, uint64_t value, int bytes) {
+    for (int b = 0; b < bytes; ++b) out[b] = static_cast<u_char>(value >> (8 * b));
+}
+
+bool starts_with(const char* line, size_t length, const char* prefix) {
+    const size_t n = std::strlen(prefix);
+    return length >= n && std::memcmp(line, prefix, n) == 0;
+}
+
+bool is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// "1727331234.123456789" to ns without going through a double
+int64_t parse_seconds_ns(const char* text, size_t length) {
+    size_t i = 0;
+    bool negative = false;
+    while (i < length && text[i] == ' ') ++i;
+    if (i < length && text[i] == '-') {
+        negative = true;
+        ++i;
+    }
+    int64_t seconds = 0;
+    while (i < length && text[i] >= '0' && text[i] <= '9') seconds = seconds * 10 + (text[i++] - '0');
+    int64_t fraction = 0;
+    int digits = 0;
+    if (i < length && text[i] == '.') {
+        ++i;
+        while (i < length && text[i] >= '0' && text[i] <= '9') {
+            if (digits < 9) {
+                fraction = fraction * 10 + (text[i] - '0');
+                ++digits;
+            }
+            ++i;
+        }
+    }
+    while (digits < 9) {
+        fraction *= 10;
+        ++digits;
+    }
+    const int64_t ns = seconds * 1000000000 + fraction;
+    return negative ? -ns : ns;
+}
+
+// Payload header that a UVC device would send: HLE matching the PTS / SCR bits
+// (EOH is not required, some devices never set it)
+bool looks_like_uvc(const u_char* data, size_t size) {
+    if (size < 2) return false;
+    const uint8_t hle = data[0];
+    const uint8_t bfh = data[1];
+    const size_t expected = 2 + ((bfh & 0x04) ? 4 : 0) + ((bfh & 0x08) ? 6 : 0);
+    return hle == expected && hle <= size;
+}
+
+// ---- decode side ----
+
+enum ItemKind : uint8_t {
+    ITEM_PAYLOAD = 0,       // one whole payload (iso packet, record, text line)
+    ITEM_BULK,              // data of one bulk URB, payloads are reassembled in order
+    ITEM_BULK_SUBMIT,       // bulk IN submission, length is the URB size
+    ITEM_TIME,              // time for the following items that carry none (timed text)
+    ITEM_PACKET,            // whole captured packet (tph output)
+    ITEM_CONTROL,           // usbmon control URB, 8 byte setup first when length is 1
+    ITEM_TSHARK_CONFIG      // tshark 0x02 line
+};
+
+struct Item {
+    uint8_t kind = ITEM_PAYLOAD;
+    uint8_t transfer = 0xFF;    // StreamTransfer, 0xFF when the input does not say
+    bool decoded = false;       // bytes live in Batch::decoded instead of Batch::input
+    bool has_time = true;
+    bool urb_end = true;        // last payload of its URB, iso payloads are written per URB
+    bool submit = false;
+    uint32_t stream = 0;
+    uint32_t length = 0;
+    uint64_t id = 0;
+    int64_t ns = 0;
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+struct Chunk {
+    uint64_t sequence = 0;
+    std::vector<u_char> bytes;
+};
+
+struct Batch {
+    uint64_t sequence = 0;
+    std::vector<u_char> input;
+    std::vector<u_char> decoded;
+    std::vector<Item> items;
+    uint64_t packets = 0;
+    uint64_t skipped = 0;
+    uint64_t malformed = 0;
+    uint64_t truncated = 0;
+    std::string note;
+
+    const u_char* data(const Item& item) const {
+        return (item.decoded ? decoded.data() : input.data()) + item.offset;
+    }
+};
+
+class ChunkDecoder {
+public:
+    ChunkDecoder(const ConvertOptions& options, CaptureFormat input)
+        : options_(options), input_(input), keep_packets_(options.output == CAPTURE_PACKET_HEX) {}
+
+    void decode(Chunk& chunk, Batch& batch) {
+        batch.sequence = chunk.sequence;
+        batch.input = std::move(chunk.bytes);
+        switch (input_) {
+          case CAPTURE_RECORD: decode_records(batch); break;
+          case CAPTURE_PCAP: decode_packets(batch); break;
+          case CAPTURE_HEXDUMP: decode_hexdump(batch); break;
+          case CAPTURE_DISSECTION: decode_dissection(batch); break;
+          default: decode_lines(batch); break;
+        }
+    }
+
+private:
+    Item& add(Batch& batch, uint8_t kind, bool decoded, size_t offset, size_t size, int64_t ns) {
+        batch.items.emplace_back();
+        Item& item = batch.items.back();
+        item.kind = kind;
+        item.decoded = decoded;
+        item.offset = offset;
+        item.size = size;
+        item.ns = ns;
+        return item;
+    }
+
+    // Hex text with optional separators (spaces, ':', ',') into batch.decoded; returns the byte count
+    size_t append_hex(const char* text, size_t length, Batch& batch) {
+        const size_t start = batch.decoded.size();
+        if (std::memchr(text, ' ', length) == nullptr && std::memchr(text, ':', length) == nullptr) {
+            hex_chars_to_bytes_append(text, length & ~size_t(1), batch.decoded);
+            return batch.decoded.size() - start;
+        }
+        int high = -1;
+        for (size_t i = 0; i < length; ++i) {
+            const char c = text[i];
+            if (!is_hex(c)) {
+                high = -1;
+                continue;
+            }
+            const int v = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+            if (high < 0) {
+                high = v;
+            } else {
+                batch.decoded.push_back(static_cast<u_char>((high << 4) | v));
+                high = -1;
+            }
+        }
+        return batch.decoded.size() - start;
+    }
+
+    void decode_records(Batch& batch) {
+        const std::vector<u_char>& in = batch.input;
+        size_t offset = 0;
+        while (in.size() - offset >= PAYLOAD_RECORD_ENTRY_HEADER) {
+            const size_t size = static_cast<size_t>(le(in.data() + offset, 4));
+            const int64_t ns = static_cast<int64_t>(le(in.data() + offset + 4, 8));
+            if (in.size() - offset - PAYLOAD_RECORD_ENTRY_HEADER < size) break;
+            add(batch, ITEM_PAYLOAD, false, offset + PAYLOAD_RECORD_ENTRY_HEADER, size, ns);
+            offset += PAYLOAD_RECORD_ENTRY_HEADER + size;
+            ++batch.packets;
+        }
+        if (offset != in.size()) ++batch.malformed;
+    }
+
+    // Packets normalized by the reader (kPacketHeader each)
+    void decode_packets(Batch& batch) {
+        size_t offset = 0;
+        while (batch.input.size() - offset >= kPacketHeader) {
+            const u_char* header = batch.input.data() + offset;
+            const size_t caplen = static_cast<size_t>(le(header, 4));
+            const uint16_t linktype = static_cast<uint16_t>(le(header + 4, 2));
+            const int64_t ns = static_cast<int64_t>(le(header + 8, 8));
+            decode_packet(batch, linktype, ns, false, offset + kPacketHeader, caplen);
+            offset += kPacketHeader + caplen;
+        }
+    }
+
+    void decode_packet(Batch& batch, uint16_t linktype, int64_t ns, bool decoded, size_t offset, size_t caplen) {
+        ++batch.packets;
+        if (keep_packets_) {
+            add(batch, ITEM_PACKET, decoded, offset, caplen, ns);
+            return;
+        }
+        if (linktype == kLinktypeUsbLinux || linktype == kLinktypeUsbLinuxMmapped) {
+            decode_usbmon(batch, linktype == kLinktypeUsbLinuxMmapped ? 64 : 48, decoded, offset, caplen);
+        } else if (linktype == kLinktypeUsbPcap) {
+            decode_usbpcap(batch, ns, decoded, offset, caplen);
+        } else {
+            ++batch.skipped;
+            if (batch.note.empty()) {
+                batch.note = "link type " + std::to_string(linktype) + " is neither usbmon nor USBPcap, packets skipped";
+            }
+        }
+    }
+
+    // Iso descriptors (offset, length pairs relative to data) to payload items
+    void add_iso(Batch& batch, bool decoded, size_t data_offset, size_t data_size, const u_char* descriptors,
+                 size_t count, size_t stride, size_t offset_at, size_t length_at, uint32_t stream, int64_t ns) {
+        const size_t first = batch.items.size();
+        for (size_t i = 0; i < count; ++i) {
+            const u_char* descriptor = descriptors + i * stride;
+            const size_t at = static_cast<size_t>(le(descriptor + offset_at, 4));
+            size_t length = static_cast<size_t>(le(descriptor + length_at, 4));
+            if (at > data_size) {
+                ++batch.truncated;
+                continue;
+            }
+            if (length > data_size - at) {
+                length = data_size - at;
+                ++batch.truncated;
+            }
+            Item& item = add(batch, ITEM_PAYLOAD, decoded, data_offset + at, length, ns);
+            item.transfer = TRANSFER_ISO;
+            item.stream = stream;
+            item.urb_end = false;
+        }
+        if (batch.items.size() > first) batch.items.back().urb_end = true;
+    }
+
+    // Linux usbmon: id, type 'S' / 'C' / 'E', transfer type, endpoint, device, bus, setup flag,
+    // data flag, seconds, microseconds, status, length, captured length, setup or iso header,
+    // (mmapped only: interval, start frame, transfer flags, descriptor count, then descriptors)
+    void decode_usbmon(Batch& batch, size_t header_size, bool decoded, size_t offset, size_t caplen) {
+        if (caplen < header_size) {
+            ++batch.malformed;
+            return;
+        }
+        const std::vector<u_char>& source = decoded ? batch.decoded : batch.input;
+        const u_char* urb = source.data() + offset;
+        const uint64_t id = le(urb, 8);
+        const u_char type = urb[8];
+        const uint8_t transfer = urb[9];
+        const uint8_t endpoint = urb[10];
+        const uint32_t stream = (static_cast<uint32_t>(le(urb + 12, 2)) << 16) | (urb[11] << 8) | endpoint;
+        const int64_t ns = static_cast<int64_t>(le(urb + 16, 8)) * 1000000000 + static_cast<int64_t>(le(urb + 24, 4)) * 1000;
+        const uint32_t urb_length = static_cast<uint32_t>(le(urb + 32, 4));
+        size_t data_size = std::min(static_cast<size_t>(le(urb + 36, 4)), caplen - header_size);
+        if (data_size < le(urb + 36, 4)) ++batch.truncated;
+        const size_t data_offset = offset + header_size;
+
+        if (transfer == 0x02) {
+            // Setup packet and data are not adjacent; copy them next to each other
+            const bool has_setup = type == 'S' && urb[14] == 0;
+            std::vector<u_char> control;
+            if (has_setup) control.assign(urb + 40, urb + 48);
+            control.insert(control.end(), source.data() + data_offset, source.data() + data_offset + data_size);
+            const size_t at = batch.decoded.size();
+            batch.decoded.insert(batch.decoded.end(), control.begin(), control.end());
+            Item& item = add(batch, ITEM_CONTROL, true, at, control.size(), ns);
+            item.id = id;
+            item.submit = type == 'S';
+            item.length = has_setup ? 1 : 0;
+            return;
+        }
+        if (!(endpoint & 0x80) || (transfer != 0x00 && transfer != 0x03) || type == 'E') {
+            ++batch.skipped;
+            return;
+        }
+        if (transfer == 0x03) {
+            if (type == 'S') {
+                Item& item = add(batch, ITEM_BULK_SUBMIT, decoded, data_offset, 0, ns);
+                item.stream = stream;
+                item.length = urb_length;
+            } else {
+                Item& item = add(batch, ITEM_BULK, decoded, data_offset, data_size, ns);
+                item.stream = stream;
+                item.transfer = TRANSFER_BULK;
+            }
+            return;
+        }
+        if (type != 'C') {
+            ++batch.skipped;
+            return;
+        }
+        if (header_size == 48) {
+            // No descriptors in the short header, the URB data is taken as one payload
+            Item& item = add(batch, ITEM_PAYLOAD, decoded, data_offset, data_size, ns);
+            item.stream = stream;
+            item.transfer = TRANSFER_ISO;
+            return;
+        }
+        const size_t count = static_cast<size_t>(le(urb + 60, 4));
+        if (count * 16 > data_size) {
+            ++batch.malformed;
+            return;
+        }
+        // add_iso may grow batch.decoded, so the descriptors are read through a stable copy
+        std::vector<u_char> descriptors(source.data() + data_offset, source.data() + data_offset + count * 16);
+        add_iso(batch, decoded, data_offset + count * 16, data_size - count * 16, descriptors.data(), count, 16, 4, 8,
+                stream, ns);
+    }
+
+    // USBPcap: header length, IRP id, status, function, info (bit 0: completion), bus, device,
+    // endpoint, transfer, data length; iso adds start frame, packet count, error count, packets
+    void decode_usbpcap(Batch& batch, int64_t ns, bool decoded, size_t offset, size_t caplen) {
+        const std::vector<u_char>& source = decoded ? batch.decoded : batch.input;
+        const u_char* packet = source.data() + offset;
+        if (caplen < 27) {
+            ++batch.malformed;
+            return;
+        }
+        const size_t header_size = static_cast<size_t>(le(packet, 2));
+        const bool completion = packet[16] & 1;
+        const uint8_t endpoint = packet[21];
+        const uint8_t transfer = packet[22];
+        const uint32_t stream = (static_cast<uint32_t>(le(packet + 17, 2)) << 16) |
+                                ((static_cast<uint32_t>(le(packet + 19, 2)) & 0xFF) << 8) | endpoint;
+        if (header_size > caplen) {
+            ++batch.malformed;
+            return;
+        }
+        const size_t data_offset = offset + header_size;
+        size_t data_size = static_cast<size_t>(le(packet + 23, 4));
+        if (data_size > caplen - header_size) {
+            data_size = caplen - header_size;
+            ++batch.truncated;
+        }
+        if (!completion || !(endpoint & 0x80) || (transfer != 0x00 && transfer != 0x03)) {
+            ++batch.skipped;
+            return;
+        }
+        if (transfer == 0x03) {
+            Item& item = add(batch, ITEM_BULK, decoded, data_offset, data_size, ns);
+            item.stream = stream;
+            item.transfer = TRANSFER_BULK;
+            return;
+        }
+        const size_t count = header_size >= 39 ? static_cast<size_t>(le(packet + 31, 4)) : 0;
+        if (39 + count * 12 > header_size) {
+            ++batch.malformed;
+            return;
+        }
+        std::vector<u_char> descriptors(packet + 39, packet + 39 + count * 12);
+        add_iso(batch, decoded, data_offset, data_size, descriptors.data(), count, 12, 0, 4, stream, ns);
+    }
+
+    template <typename Fn>
+    void for_each_line(const Batch& batch, Fn fn) {
+        const char* text = reinterpret_cast<const char*>(batch.input.data());
+        const size_t size = batch.input.size();
+        size_t start = 0;
+        while (start < size) {
+            const char* end = static_cast<const char*>(std::memchr(text + start, '\n', size - start));
+            const size_t stop = end ? static_cast<size_t>(end - text) : size;
+            size_t length = stop - start;
+            if (length > 0 && text[start + length - 1] == '\r') --length;
+            fn(text + start, length, start);
+            start = stop + 1;
+        }
+    }
+
+    // tshark fields, timed text and hex lines
+    void decode_lines(Batch& batch) {
+        for_each_line(batch, [&](const char* line, size_t length, size_t line_offset) {
+            if (length == 0) return;
+            if (input_ == CAPTURE_TSHARK) {
+                decode_tshark_line(batch, line, length, line_offset);
+                return;
+            }
+            if (input_ == CAPTURE_TIMED && starts_with(line, length, "Converted Monotonic Time:")) {
+                const size_t prefix = std::strlen("Converted Monotonic Time:");
+                add(batch, ITEM_TIME, false, 0, 0, parse_seconds_ns(line + prefix, length - prefix));
+                return;
+            }
+            ++batch.packets;
+            const size_t at = batch.decoded.size();
+            const size_t size = append_hex(line, length, batch);
+            add(batch, ITEM_PAYLOAD, true, at, size, 0).has_time = false;
+        });
+    }
+
+    // usb.transfer_type;frame.time_epoch;frame.len;usb.capdata;usb.iso.data;descriptor fields...
+    void decode_tshark_line(Batch& batch, const char* line, size_t length, size_t line_offset) {
+        const char* fields[5] = {line, line, line, line, line};
+        size_t sizes[5] = {0, 0, 0, 0, 0};
+        size_t field = 0;
+        size_t start = 0;
+        for (size_t i = 0; i <= length && field < 5; ++i) {
+            if (i == length || line[i] == ';') {
+                fields[field] = line + start;
+                sizes[field] = i - start;
+                ++field;
+                start = i + 1;
+            }
+        }
+        ++batch.packets;
+        const int64_t ns = parse_seconds_ns(fields[1], sizes[1]);
+        if (starts_with(fields[0], sizes[0], "0x00")) {
+            const size_t first = batch.items.size();
+            const char* iso = fields[4];
+            size_t token = 0;
+            for (size_t i = 0; i <= sizes[4]; ++i) {
+                if (i == sizes[4] || iso[i] == ',') {
+                    const size_t at = batch.decoded.size();
+                    hex_chars_to_bytes_append(iso + token, (i - token) & ~size_t(1), batch.decoded);
+                    Item& item = add(batch, ITEM_PAYLOAD, true, at, batch.decoded.size() - at, ns);
+                    item.transfer = TRANSFER_ISO;
+                    item.urb_end = false;
+                    token = i + 1;
+                }
+            }
+            if (sizes[4] == 0) batch.items.resize(first);
+            if (batch.items.size() > first) batch.items.back().urb_end = true;
+        } else if (starts_with(fields[0], sizes[0], "0x03")) {
+            if (sizes[3] == 0 && std::strtoul(std::string(fields[2], sizes[2]).c_str(), nullptr, 10) > 64) {
+                ++batch.truncated;
+            }
+            // uvcfd takes every bulk line as one payload, so does the conversion
+            const size_t at = batch.decoded.size();
+            hex_chars_to_bytes_append(fields[3], sizes[3] & ~size_t(1), batch.decoded);
+            Item& item = add(batch, ITEM_PAYLOAD, true, at, batch.decoded.size() - at, ns);
+            item.transfer = TRANSFER_BULK;
+        } else if (starts_with(fields[0], sizes[0], "0x02")) {
+            add(batch, ITEM_TSHARK_CONFIG, false, line_offset, length, ns);
+        } else {
+            ++batch.skipped;
+        }
+    }
+
+    // Offsets reset to 0000 at every packet
+    void decode_hexdump(Batch& batch) {
+        size_t packet_start = batch.decoded.size();
+        bool in_packet = false;
+        auto finish = [&]() {
+            if (in_packet) {
+                decode_packet(batch, options_.hexdump_linktype, 0, true, packet_start,
+                              batch.decoded.size() - packet_start);
+            }
+            in_packet = false;
+        };
+        for_each_line(batch, [&](const char* line, size_t length, size_t) {
+            size_t i = 0;
+            while (i < length && line[i] == ' ') ++i;
+            size_t digits = 0;
+            uint64_t line_offset = 0;
+            while (i < length && is_hex(line[i])) {
+                line_offset = (line_offset << 4) | (line[i] <= '9' ? line[i] - '0' : (line[i] | 0x20) - 'a' + 10);
+                ++i;
+                ++digits;
+            }
+            if (digits < 4 || i >= length || line[i] != ' ') {
+                finish();
+                return;
+            }
+            if (line_offset == 0) {
+                finish();
+                // The packet has to stay last in decoded until it is complete
+                packet_start = batch.decoded.size();
+                in_packet = true;
+            }
+            if (!in_packet) return;
+            if (line_offset != batch.decoded.size() - packet_start) ++batch.malformed;
+
+            // Up to 16 "hh" tokens; a wider gap ends them (ASCII column) except the one after 8 bytes
+            int bytes = 0;
+            size_t gap = 0;
+            while (i < length && bytes < 16) {
+                if (line[i] == ' ') {
+                    ++gap;
+                    ++i;
+                    continue;
+                }
+                if (bytes > 0 && gap > 1 && !(bytes == 8 && gap == 2)) break;
+                if (i + 1 >= length || !is_hex(line[i]) || !is_hex(line[i + 1]) ||
+                    (i + 2 < length && line[i + 2] != ' ')) {
+                    break;
+                }
+                hex_chars_to_bytes_append(line + i, 2, batch.decoded);
+                ++bytes;
+                i += 2;
+                gap = 0;
+            }
+        });
+        finish();
+    }
+
+    // Fields of interest in a fully expanded dissection
+    struct DissectedPacket {
+        bool started = false;
+        int64_t ns = 0;
+        char urb_type = 'C';
+        int transfer = -1;
+        uint32_t endpoint = 0x81;
+        uint32_t device = 0;
+        uint32_t bus = 0;
+        size_t first_item = 0;
+    };
+
+    void decode_dissection(Batch& batch) {
+        DissectedPacket packet;
+        bool collecting = false;
+        auto finish = [&]() {
+            if (!packet.started) return;
+            ++batch.packets;
+            const uint32_t stream = (packet.bus << 16) | ((packet.device & 0xFF) << 8) | (packet.endpoint & 0xFF);
+            const bool keep = packet.urb_type == 'C' && (packet.endpoint & 0x80);
+            if (!keep) {
+                batch.skipped += batch.items.size() > packet.first_item ? 1 : 0;
+                batch.items.resize(packet.first_item);
+            }
+            for (size_t i = packet.first_item; i < batch.items.size(); ++i) {
+                Item& item = batch.items[i];
+                item.stream = stream;
+                item.ns = packet.ns;
+                item.urb_end = i + 1 == batch.items.size();
+            }
+            packet = DissectedPacket{};
+            packet.first_item = batch.items.size();
+        };
+        packet.first_item = batch.items.size();
+
+        for_each_line(batch, [&](const char* raw, size_t raw_length, size_t) {
+            if (starts_with(raw, raw_length, "Frame ") || starts_with(raw, raw_length, "No.")) {
+                collecting = false;
+                if (packet.started && starts_with(raw, raw_length, "No.")) finish();
+                if (starts_with(raw, raw_length, "Frame ")) {
+                    finish();
+                    packet.started = true;
+                }
+                return;
+            }
+            size_t i = 0;
+            while (i < raw_length && (raw[i] == ' ' || raw[i] == '\t')) ++i;
+            const char* line = raw + i;
+            const size_t length = raw_length - i;
+            if (length == 0) {
+                collecting = false;
+                return;
+            }
+            const char* colon = static_cast<const char*>(std::memchr(line, ':', length));
+            const size_t value_at = colon ? static_cast<size_t>(colon - line) + 2 : length;
+            const char* value = line + std::min(value_at, length);
+            const size_t value_length = length - std::min(value_at, length);
+
+            const bool iso_data = starts_with(line, length, "ISO Data");
+            const bool bulk_data = starts_with(line, length, "Leftover Capture Data");
+            if (iso_data || bulk_data) {
+                if (!colon) return;
+                if (std::memchr(line, '[', std::min(value_at, length)) != nullptr) ++batch.truncated;
+                const size_t at = batch.decoded.size();
+                size_t hex_length = 0;
+                while (hex_length < value_length && is_hex(value[hex_length])) ++hex_length;
+                hex_chars_to_bytes_append(value, hex_length & ~size_t(1), batch.decoded);
+                Item& item = add(batch, iso_data ? ITEM_PAYLOAD : ITEM_BULK, true, at, batch.decoded.size() - at, 0);
+                item.transfer = iso_data ? TRANSFER_ISO : TRANSFER_BULK;
+                collecting = true;
+                return;
+            }
+            if (collecting) {
+                // Continuation of a data field: a line of hex only
+                size_t hex_length = 0;
+                while (hex_length < length && is_hex(line[hex_length])) ++hex_length;
+                if (hex_length == length && !batch.items.empty()) {
+                    hex_chars_to_bytes_append(line, hex_length & ~size_t(1), batch.decoded);
+                    batch.items.back().size = batch.decoded.size() - batch.items.back().offset;
+                    return;
+                }
+                collecting = false;
+            }
+            if (starts_with(line, length, "Epoch Arrival Time:") || starts_with(line, length, "Epoch Time:")) {
+                packet.ns = parse_seconds_ns(value, value_length);
+            } else if (starts_with(line, length, "URB type:")) {
+                const char* quote = static_cast<const char*>(std::memchr(value, '\'', value_length));
+                if (quote && quote + 1 < value + value_length) packet.urb_type = quote[1];
+            } else if (starts_with(line, length, "Endpoint:")) {
+                packet.endpoint = static_cast<uint32_t>(std::strtoul(std::string(value, value_length).c_str(), nullptr, 16));
+            } else if (starts_with(line, length, "Device:")) {
+                packet.device = static_cast<uint32_t>(std::strtoul(std::string(value, value_length).c_str(), nullptr, 10));
+            } else if (starts_with(line, length, "URB bus id:")) {
+                packet.bus = static_cast<uint32_t>(std::strtoul(std::string(value, value_length).c_str(), nullptr, 10));
+            }
+        });
+        finish();
+    }
+
+    const ConvertOptions& options_;
+    CaptureFormat input_;
+    bool keep_packets_;
+};
+
+// ---- write side ----
+
+// Sequential part: stream selection, bulk reassembly, configuration tracking and the writers
+class ConvertSink {
+public:
+    ConvertSink(const ConvertOptions& options, ConvertStats& stats, const std::string& output, std::ostream* out)
+        : options_(options), stats_(stats), output_(output), out_(out), config_(options.config) {}
+
+    void set_config(const StreamConfig& config) {
+        config_ = config;
+        config_changed();
+    }
+
+    bool consume(Batch& batch) {
+        stats_.packets += batch.packets;
+        stats_.skipped += batch.skipped;
+        stats_.malformed += batch.malformed;
+        stats_.truncated += batch.truncated;
+        if (!batch.note.empty() && !noted_link_) {
+            stats_.notes.push_back(batch.note);
+            noted_link_ = true;
+        }
+        for (const Item& item : batch.items) {
+            const u_char* data = batch.data(item);
+            if (item.has_time) time_ns_ = item.ns;
+            switch (item.kind) {
+              case ITEM_TIME: break;
+              case ITEM_PAYLOAD:
+                if (accept(item.stream, data, item.size)) {
+                    add_payload(data, item.size, item.transfer, item.urb_end);
+                } else {
+                    ++stats_.skipped;
+                }
+                break;
+              case ITEM_BULK: add_bulk(item, data); break;
+              case ITEM_BULK_SUBMIT:
+                if (item.length > submitted_urb_size_) submitted_urb_size_ = item.length;
+                break;
+              case ITEM_PACKET: write_packet(data, item.size); break;
+              case ITEM_CONTROL: control(item, data); break;
+              case ITEM_TSHARK_CONFIG:
+                tshark_config(std::string(reinterpret_cast<const char*>(data), item.size));
+                break;
+            }
+            if (!ok_) return false;
+        }
+        flush_iso();
+        return ok_;
+    }
+
+    bool finish() {
+        // An empty capture still gives a readable file
+        if (!opened_ && options_.output != CAPTURE_PACKET_HEX) open_writers(0xFF);
+        if (!bulk_.empty()) {
+            ++stats_.truncated;
+            write_payload(bulk_.data(), bulk_.size(), TRANSFER_BULK);
+            bulk_.clear();
+        }
+        flush_iso();
+        flush_text();
+        if (record_) record_->close();
+        if (out_) out_->flush();
+        stats_.stream = selected_ ? stream_ : options_.stream;
+        return ok_;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    bool accept(uint32_t stream, const u_char* data, size_t size) {
+        if (options_.stream != 0) return stream == options_.stream;
+        if (selected_) return stream == stream_;
+        if (stream != 0 && !looks_like_uvc(data, size)) return false;
+        selected_ = true;
+        stream_ = stream;
+        return true;
+    }
+
+    // Full URBs continue a payload, a short (or zero length) one ends it
+    void add_bulk(const Item& item, const u_char* data) {
+        if (!accept(item.stream, data, item.size)) {
+            ++stats_.skipped;
+            return;
+        }
+        if (item.size > largest_urb_) largest_urb_ = static_cast<uint32_t>(item.size);
+        const uint32_t urb_size = options_.bulk_urb_size ? options_.bulk_urb_size
+                                                         : std::max(submitted_urb_size_, largest_urb_);
+        bulk_.insert(bulk_.end(), data, data + item.size);
+        if (item.size < urb_size || urb_size == 0) {
+            if (!bulk_.empty()) write_payload(bulk_.data(), bulk_.size(), TRANSFER_BULK);
+            bulk_.clear();
+        }
+    }
+
+    void add_payload(const u_char* data, size_t size, uint8_t transfer, bool urb_end) {
+        const uint8_t kind = transfer == 0xFF ? static_cast<uint8_t>(options_.transfer) : transfer;
+        if (kind == TRANSFER_ISO && (options_.output == CAPTURE_TSHARK || options_.output == CAPTURE_PCAP)) {
+            // Kept together so the output groups payloads into URBs the way the input did
+            if (!open_writers(TRANSFER_ISO)) return;
+            iso_.push_back(PayloadView{data, size, time_point()});
+            ++stats_.payloads;
+            stats_.payload_bytes += size;
+            if (urb_end) flush_iso();
+            return;
+        }
+        write_payload(data, size, kind);
+    }
+
+    std::chrono::steady_clock::time_point time_point() const {
+        return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(time_ns_));
+    }
+
+    void flush_iso() {
+        if (iso_.empty()) return;
+        if (tshark_) tshark_->write(iso_);
+        if (pcapng_) pcapng_->write(iso_);
+        iso_.clear();
+    }
+
+    void write_payload(const u_char* data, size_t size, uint8_t transfer) {
+        if (!open_writers(transfer)) return;
+        flush_iso();
+        ++stats_.payloads;
+        stats_.payload_bytes += size;
+        switch (options_.output) {
+          case CAPTURE_RECORD:
+            record_->write(data, size, time_point());
+            break;
+          case CAPTURE_TSHARK:
+          case CAPTURE_PCAP: {
+            one_[0] = PayloadView{data, size, time_point()};
+            if (tshark_) tshark_->write(one_);
+            if (pcapng_) pcapng_->write(one_);
+            break;
+          }
+          case CAPTURE_TIMED: {
+            char text[64];
+            const int64_t ns = time_ns_;
+            std::snprintf(text, sizeof(text), "Converted Monotonic Time: %s%lld.%09lld seconds\n", ns < 0 ? "-" : "",
+                          static_cast<long long>(std::llabs(ns) / 1000000000), static_cast<long long>(std::llabs(ns) % 1000000000));
+            text_ += text;
+            bytes_to_hex_append(data, size, text_);
+            text_ += '\n';
+            break;
+          }
+          default:
+            bytes_to_hex_append(data, size, text_);
+            text_ += '\n';
+            break;
+        }
+        if (text_.size() >= kFlushBytes) flush_text();
+    }
+
+    void write_packet(const u_char* data, size_t size) {
+        if (!open_writers(options_.transfer)) return;
+        ++stats_.payloads;
+        stats_.payload_bytes += size;
+        for (size_t i = 0; i < size; ++i) {
+            if (i > 0) text_ += ' ';
+            bytes_to_hex_append(data + i, 1, text_);
+        }
+        text_ += '\n';
+        if (text_.size() >= kFlushBytes) flush_text();
+    }
+
+    void flush_text() {
+        if (!text_.empty() && out_) out_->write(text_.data(), static_cast<std::streamsize>(text_.size()));
+        text_.clear();
+    }
+
+    // Writers need the transfer type (and for records the configuration), so they open with the first payload
+    bool open_writers(uint8_t transfer) {
+        if (opened_) return ok_;
+        opened_ = true;
+        transfer_ = transfer == 0xFF ? options_.transfer : static_cast<StreamTransfer>(transfer);
+        const uint32_t stream = selected_ && stream_ != 0 ? stream_ : (options_.stream ? options_.stream : 0x00010281);
+        switch (options_.output) {
+          case CAPTURE_RECORD:
+            record_ = std::make_unique<PayloadRecordWriter>();
+            if (!record_->open(output_, config_)) {
+                error_ = "cannot write " + output_;
+                ok_ = false;
+            }
+            break;
+          case CAPTURE_TSHARK:
+            tshark_ = std::make_unique<TsharkFieldsWriter>(*out_, transfer_);
+            tshark_->write_config(config_, time_point());
+            break;
+          case CAPTURE_PCAP: {
+            const uint32_t urb_size = options_.bulk_urb_size ? options_.bulk_urb_size
+                                                             : std::max<uint32_t>(std::max(submitted_urb_size_, largest_urb_), 512);
+            pcapng_ = std::make_unique<UsbmonPcapngWriter>(*out_, transfer_, static_cast<uint8_t>(stream >> 16),
+                                                           static_cast<uint8_t>(stream >> 8), static_cast<uint8_t>(stream),
+                                                           32, transfer_ == TRANSFER_BULK ? urb_size : 16384);
+            break;
+          }
+          default:
+            break;
+        }
+        return ok_;
+    }
+
+    void config_changed() {
+        ++stats_.configs;
+        if (record_ && !noted_record_config_) {
+            stats_.notes.push_back("stream configuration changed after the record header was written; "
+                                   "the record keeps the first one");
+            noted_record_config_ = true;
+        }
+        if (tshark_) {
+            flush_iso();
+            tshark_->write_config(config_, time_point());
+        }
+    }
+
+    // usbmon control URBs: GET_DESCRIPTOR (configuration) gives the frame sizes, SET_CUR VS_COMMIT_CONTROL the rest
+    void control(const Item& item, const u_char* data) {
+        if (item.submit) {
+            if (item.length == 0 || item.size < 8) return;
+            const uint8_t request_type = data[0];
+            const uint8_t request = data[1];
+            const uint16_t value = static_cast<uint16_t>(le(data + 2, 2));
+            if (request_type == 0x80 && request == 0x06 && (value >> 8) == 0x02) {
+                pending_descriptors_[item.id] = true;
+            } else if (request_type == 0x21 && request == 0x01 && (value >> 8) == 0x02 && item.size >= 8 + 26) {
+                commit(data + 8, item.size - 8);
+            }
+            return;
+        }
+        auto pending = pending_descriptors_.find(item.id);
+        if (pending == pending_descriptors_.end()) return;
+        pending_descriptors_.erase(pending);
+        descriptors(data, item.size);
+    }
+
+    struct FrameDescriptor {
+        int width = 0;
+        int height = 0;
+        FrameFormat format = FRAME_FORMAT_MJPEG;
+    };
+
+    void descriptors(const u_char* data, size_t size) {
+        bool streaming = false;
+        uint8_t format_index = 0;
+        FrameFormat format = FRAME_FORMAT_MJPEG;
+        size_t i = 0;
+        while (i + 2 <= size && data[i] >= 2 && i + data[i] <= size) {
+            const u_char* d = data + i;
+            const uint8_t length = d[0];
+            if (d[1] == 0x04 && length >= 7) {
+                // Interface: video class, streaming subclass
+                streaming = d[5] == 0x0E && d[6] == 0x02;
+            } else if (streaming && d[1] == 0x24 && length >= 4) {
+                const uint8_t subtype = d[2];
+                if (subtype == 0x04 || subtype == 0x06 || subtype == 0x10) {
+                    format_index = d[3];
+                    format = subtype == 0x04 ? FRAME_FORMAT_YUYV : subtype == 0x06 ? FRAME_FORMAT_MJPEG : FRAME_FORMAT_H264;
+                } else if ((subtype == 0x05 || subtype == 0x07 || subtype == 0x11) && length >= 9) {
+                    FrameDescriptor frame;
+                    frame.width = static_cast<int>(le(d + 5, 2));
+                    frame.height = static_cast<int>(le(d + 7, 2));
+                    frame.format = format;
+                    frames_[(format_index << 8) | d[3]] = frame;
+                }
+            }
+            i += length;
+        }
+    }
+
+    // bmHint, bFormatIndex, bFrameIndex, dwFrameInterval, ..., dwMaxVideoFrameSize at 18,
+    // dwMaxPayloadTransferSize at 22, dwClockFrequency at 26 (UVC 1.1)
+    void commit(const u_char* probe, size_t size) {
+        StreamConfig next = config_;
+        auto frame = frames_.find((probe[2] << 8) | probe[3]);
+        if (frame != frames_.end()) {
+            next.width = frame->second.width;
+            next.height = frame->second.height;
+            next.format = frame->second.format;
+        }
+        const uint32_t interval = static_cast<uint32_t>(le(probe + 4, 4));
+        if (interval > 0) next.fps = static_cast<int>(10000000 / interval);
+        next.dwMaxVideoFrameSize = static_cast<uint32_t>(le(probe + 18, 4));
+        next.dwMaxPayloadTransferSize = static_cast<uint32_t>(le(probe + 22, 4));
+        if (size >= 30 && le(probe + 26, 4) != 0) next.dwTimeFrequency = static_cast<uint32_t>(le(probe + 26, 4));
+        config_ = next;
+        config_changed();
+    }
+
+    static std::vector<std::string> split(const std::string& text, char delimiter) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (true) {
+            const size_t end = text.find(delimiter, start);
+            parts.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            if (end == std::string::npos) return parts;
+            start = end + 1;
+        }
+    }
+
+    static int number(const std::vector<std::string>& list, size_t index) {
+        return index < list.size() ? std::atoi(list[index].c_str()) : 0;
+    }
+
+    // Same reading of the descriptor / commit lines as moncapwer.cpp
+    void tshark_config(const std::string& line) {
+        const std::vector<std::string> fields = split(line, ';');
+        auto field = [&](size_t index) { return index < fields.size() ? fields[index] : std::string(); };
+        const std::vector<std::string> format_indices = split(field(5), ',');
+        const std::vector<std::string> frame_indices = split(field(6), ',');
+
+        if (!field(7).empty() && !field(8).empty()) {
+            const std::vector<std::string> widths = split(field(7), ',');
+            const std::vector<std::string> heights = split(field(8), ',');
+            const std::vector<std::string> descriptors_per_format = split(field(13), ',');
+            // Format descriptors (and color matching) share the subtype list with the frame descriptors
+            std::vector<int> subtypes;
+            for (const std::string& value : split(field(9), ',')) {
+                const int subtype = std::atoi(value.c_str());
+                if (subtype != 1 && subtype != 4 && subtype != 6 && subtype != 12 && subtype != 13 && subtype != 16) {
+                    subtypes.push_back(subtype);
+                }
+            }
+            size_t format_counter = 0;
+            int count = 0;
+            for (size_t i = 0; i < frame_indices.size(); ++i) {
+                if (count >= number(descriptors_per_format, format_counter)) {
+                    ++format_counter;
+                    count = 0;
+                }
+                FrameDescriptor frame;
+                frame.width = number(widths, i);
+                frame.height = number(heights, i);
+                const int subtype = i < subtypes.size() ? subtypes[i] : 7;
+                frame.format = subtype == 5 ? FRAME_FORMAT_YUYV : subtype == 17 ? FRAME_FORMAT_H264 : FRAME_FORMAT_MJPEG;
+                frames_[(number(format_indices, format_counter) << 8) | number(frame_indices, i)] = frame;
+                ++count;
+            }
+            if (!field(14).empty()) tshark_time_frequency_ = static_cast<uint32_t>(std::strtoul(field(14).c_str(), nullptr, 10));
+        }
+        if (!field(11).empty() && !field(12).empty()) {
+            StreamConfig next = config_;
+            auto frame = frames_.find((number(format_indices, 0) << 8) | number(frame_indices, 0));
+            if (frame != frames_.end()) {
+                next.width = frame->second.width;
+                next.height = frame->second.height;
+                next.format = frame->second.format;
+            }
+            const int interval = std::atoi(field(10).c_str());
+            if (interval > 0) next.fps = 10000000 / interval;
+            next.dwMaxVideoFrameSize = static_cast<uint32_t>(std::strtoul(field(11).c_str(), nullptr, 10));
+            next.dwMaxPayloadTransferSize = static_cast<uint32_t>(std::strtoul(field(12).c_str(), nullptr, 10));
+            if (tshark_time_frequency_) next.dwTimeFrequency = tshark_time_frequency_;
+            config_ = next;
+            config_changed();
+        }
+    }
+
+    const ConvertOptions& options_;
+    ConvertStats& stats_;
+    std::string output_;
+    std::ostream* out_;
+    StreamConfig config_;
+    std::string error_;
+    bool ok_ = true;
+
+    bool selected_ = false;
+    uint32_t stream_ = 0;
+    int64_t time_ns_ = 0;
+
+    std::vector<u_char> bulk_;
+    uint32_t submitted_urb_size_ = 0;
+    uint32_t largest_urb_ = 0;
+
+    std::unordered_map<uint64_t, bool> pending_descriptors_;
+    std::map<int, FrameDescriptor> frames_;
+    uint32_t tshark_time_frequency_ = 0;
+
+    bool opened_ = false;
+    StreamTransfer transfer_ = TRANSFER_ISO;
+    std::unique_ptr<PayloadRecordWriter> record_;
+    std::unique_ptr<TsharkFieldsWriter> tshark_;
+    std::unique_ptr<UsbmonPcapngWriter> pcapng_;
+    std::vector<PayloadView> iso_;
+    std::vector<PayloadView> one_ = std::vector<PayloadView>(1);
+    std::string text_;
+
+    bool noted_link_ = false;
+    bool noted_record_config_ = false;
+};
+
+// ---- read side ----
+
+class ChunkReader {
+public:
+    ChunkReader(std::istream& in, const ConvertOptions& options, CaptureFormat format, ConvertStats& stats)
+        : in_(in), options_(options), format_(format), stats_(stats) {}
+
+    // First bytes, already consumed for format detection
+    void prepend(std::vector<u_char>&& head) { pending_ = std::move(head); }
+
+    // Record header (config) before the threads start; false when it is not a record file
+    bool read_record_header(StreamConfig& config, std::string& error) {
+        fill(pending_, 4096);
+        const size_t header = parse_payload_record_header(pending_.data(), pending_.size(), config, error);
+        if (header == 0) return false;
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(header));
+        return true;
+    }
+
+    // False at the end of the input; error() tells a broken capture from a complete one
+    bool next(Chunk& chunk) {
+        chunk.bytes.clear();
+        if (!error_.empty()) return false;
+        if (format_ == CAPTURE_PCAP) return next_packets(chunk);
+        return next_cut(chunk);
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    // Appends up to `bytes` more input to buffer
+    size_t fill(std::vector<u_char>& buffer, size_t bytes) {
+        if (eof_) return 0;
+        const size_t at = buffer.size();
+        buffer.resize(at + bytes);
+        in_.read(reinterpret_cast<char*>(buffer.data() + at), static_cast<std::streamsize>(bytes));
+        const size_t got = static_cast<size_t>(in_.gcount());
+        buffer.resize(at + got);
+        stats_.input_bytes += got;
+        if (got < bytes) eof_ = true;
+        return got;
+    }
+
+    bool read_exact(u_char* out, size_t bytes) {
+        size_t from_pending = std::min(bytes, pending_.size() - pending_used_);
+        std::memcpy(out, pending_.data() + pending_used_, from_pending);
+        pending_used_ += from_pending;
+        if (from_pending == bytes) return true;
+        in_.read(reinterpret_cast<char*>(out + from_pending), static_cast<std::streamsize>(bytes - from_pending));
+        const size_t got = static_cast<size_t>(in_.gcount());
+        stats_.input_bytes += got;
+        return got == bytes - from_pending;
+    }
+
+    // Text and records: read a block, cut at the last record boundary, keep the rest for the next chunk
+    bool next_cut(Chunk& chunk) {
+        chunk.bytes.swap(pending_);
+        pending_.clear();
+        while (true) {
+            if (chunk.bytes.size() < options_.chunk_bytes) {
+                fill(chunk.bytes, options_.chunk_bytes - chunk.bytes.size());
+            }
+            if (chunk.bytes.empty()) return false;
+            if (eof_) return true;
+            const size_t cut = boundary(chunk.bytes);
+            if (cut > 0) {
+                pending_.assign(chunk.bytes.begin() + static_cast<std::ptrdiff_t>(cut), chunk.bytes.end());
+                chunk.bytes.resize(cut);
+                return true;
+            }
+            // One record larger than a chunk: read on until it ends
+            fill(chunk.bytes, options_.chunk_bytes);
+        }
+    }
+
+    size_t boundary(const std::vector<u_char>& bytes) const {
+        const char* text = reinterpret_cast<const char*>(bytes.data());
+        if (format_ == CAPTURE_RECORD) {
+            size_t offset = 0;
+            while (bytes.size() - offset >= PAYLOAD_RECORD_ENTRY_HEADER) {
+                const size_t next = offset + PAYLOAD_RECORD_ENTRY_HEADER + static_cast<size_t>(le(bytes.data() + offset, 4));
+                if (next > bytes.size()) break;
+                offset = next;
+            }
+            return offset;
+        }
+        // Start of the last line that begins a record
+        size_t end = bytes.size();
+        while (end > 0) {
+            const char* newline = nullptr;
+            for (size_t i = end; i > 0; --i) {
+                if (text[i - 1] == '\n') {
+                    newline = text + i - 1;
+                    break;
+                }
+            }
+            if (!newline) return 0;
+            const size_t line = static_cast<size_t>(newline - text) + 1;
+            const size_t rest = bytes.size() - line;
+            if (format_ == CAPTURE_HEXDUMP) {
+                if (starts_with(text + line, rest, "0000 ") || starts_with(text + line, rest, "00000000 ")) return line;
+            } else if (format_ == CAPTURE_DISSECTION) {
+                if (starts_with(text + line, rest, "Frame ") || starts_with(text + line, rest, "No.")) return line;
+            } else {
+                return line;
+            }
+            end = line - 1;
+        }
+        return 0;
+    }
+
+    // pcap / pcapng packets copied into the normalized layout, whole packets per chunk
+    bool next_packets(Chunk& chunk) {
+        if (!started_ && !start_pcap()) return false;
+        while (chunk.bytes.size() < options_.chunk_bytes) {
+            if (pcapng_ ? !next_pcapng(chunk) : !next_pcap(chunk)) break;
+        }
+        return !chunk.bytes.empty();
+    }
+
+    bool start_pcap() {
+        started_ = true;
+        u_char magic[4];
+        if (!read_exact(magic, 4)) return false;
+        const uint32_t value = static_cast<uint32_t>(le(magic, 4));
+        if (value == 0x0A0D0D0A) {
+            pcapng_ = true;
+            // The section header is read like any other block
+            block_type_known_ = true;
+            return true;
+        }
+        if (value != 0xA1B2C3D4 && value != 0xA1B23C4D) {
+            error_ = (value == 0xD4C3B2A1 || value == 0x4D3CB2A1) ? "big endian pcap files are not supported"
+                                                                  : "not a pcap or pcapng file";
+            return false;
+        }
+        u_char global[20];
+        if (!read_exact(global, 20)) {
+            error_ = "truncated pcap header";
+            return false;
+        }
+        nanosecond_ = value == 0xA1B23C4D;
+        interfaces_.push_back({static_cast<uint16_t>(le(global + 16, 2)), nanosecond_ ? 1 : 1000});
+        return true;
+    }
+
+    void add_packet(Chunk& chunk, uint16_t linktype, int64_t ns, size_t caplen) {
+        const size_t at = chunk.bytes.size();
+        chunk.bytes.resize(at + kPacketHeader + caplen);
+        put_le(chunk.bytes.data() + at, caplen, 4);
+        put_le(chunk.bytes.data() + at + 4, linktype, 2);
+        put_le(chunk.bytes.data() + at + 6, 0, 2);
+        put_le(chunk.bytes.data() + at + 8, static_cast<uint64_t>(ns), 8);
+    }
+
+    bool next_pcap(Chunk& chunk) {
+        u_char header[16];
+        if (!read_exact(header, 16)) return false;
+        const int64_t seconds = static_cast<int64_t>(le(header, 4));
+        const int64_t fraction = static_cast<int64_t>(le(header + 4, 4));
+        const size_t caplen = static_cast<size_t>(le(header + 8, 4));
+        if (caplen > (256u << 20)) {
+            error_ = "pcap record length " + std::to_string(caplen) + " is not plausible";
+            return false;
+        }
+        const size_t at = chunk.bytes.size();
+        add_packet(chunk, interfaces_[0].linktype, seconds * 1000000000 + fraction * interfaces_[0].ns_per_unit, caplen);
+        if (!read_exact(chunk.bytes.data() + at + kPacketHeader, caplen)) {
+            chunk.bytes.resize(at);
+            error_ = "truncated pcap record";
+            return false;
+        }
+        return true;
+    }
+
+    bool next_pcapng(Chunk& chunk) {
+        u_char prefix[8];
+        if (block_type_known_) {
+            put_le(prefix, 0x0A0D0D0A, 4);
+            block_type_known_ = false;
+            if (!read_exact(prefix + 4, 4)) return false;
+        } else if (!read_exact(prefix, 8)) {
+            return false;
+        }
+        const uint32_t type = static_cast<uint32_t>(le(prefix, 4));
+        const size_t length = static_cast<size_t>(le(prefix + 4, 4));
+        if (length < 12 || length % 4 != 0 || length > (256u << 20)) {
+            error_ = "broken pcapng block length " + std::to_string(length);
+            return false;
+        }
+        block_.resize(length - 8);
+        if (!read_exact(block_.data(), block_.size())) {
+            error_ = "truncated pcapng block";
+            return false;
+        }
+        const u_char* body = block_.data();
+        const size_t body_size = length - 12;
+        if (type == 0x0A0D0D0A) {
+            if (body_size < 4 || le(body, 4) != 0x1A2B3C4D) {
+                error_ = "big endian pcapng files are not supported";
+                return false;
+            }
+            interfaces_.clear();
+        } else if (type == 0x00000001 && body_size >= 8) {
+            Interface interface{static_cast<uint16_t>(le(body, 2)), 1000};
+            // if_tsresol: power of ten (or of two with the top bit), microseconds by default
+            size_t option = 8;
+            while (option + 4 <= body_size) {
+                const uint16_t code = static_cast<uint16_t>(le(body + option, 2));
+                const uint16_t option_length = static_cast<uint16_t>(le(body + option + 2, 2));
+                if (code == 0) break;
+                if (code == 9 && option_length >= 1 && option + 5 <= body_size) {
+                    const uint8_t resolution = body[option + 4];
+                    int64_t units = 1;
+                    if (resolution & 0x80) {
+                        units = int64_t(1) << std::min(resolution & 0x7F, 62);
+                    } else {
+                        for (int i = 0; i < (resolution & 0x7F) && units < 1000000000; ++i) units *= 10;
+                    }
+                    interface.ns_per_unit = std::max<int64_t>(1000000000 / units, 1);
+                }
+                option += 4 + ((option_length + 3u) & ~3u);
+            }
+            interfaces_.push_back(interface);
+        } else if (type == 0x00000006 && body_size >= 20) {
+            const size_t index = static_cast<size_t>(le(body, 4));
+            const uint64_t stamp = (le(body + 4, 4) << 32) | le(body + 8, 4);
+            const size_t caplen = std::min(static_cast<size_t>(le(body + 12, 4)), body_size - 20);
+            const Interface interface = index < interfaces_.size() ? interfaces_[index] : Interface{0, 1000};
+            const size_t at = chunk.bytes.size();
+            add_packet(chunk, interface.linktype, static_cast<int64_t>(stamp) * interface.ns_per_unit, caplen);
+            std::memcpy(chunk.bytes.data() + at + kPacketHeader, body + 20, caplen);
+        } else if (type == 0x00000003 && body_size >= 4) {
+            const size_t caplen = std::min(static_cast<size_t>(le(body, 4)), body_size - 4);
+            const Interface interface = interfaces_.empty() ? Interface{0, 1000} : interfaces_[0];
+            const size_t at = chunk.bytes.size();
+            add_packet(chunk, interface.linktype, 0, caplen);
+            std::memcpy(chunk.bytes.data() + at + kPacketHeader, body + 4, caplen);
+        }
+        return true;
+    }
+
+    struct Interface {
+        uint16_t linktype;
+        int64_t ns_per_unit;
+    };
+
+    std::istream& in_;
+    const ConvertOptions& options_;
+    CaptureFormat format_;
+    ConvertStats& stats_;
+    std::string error_;
+
+    std::vector<u_char> pending_;
+    size_t pending_used_ = 0;
+    bool eof_ = false;
+
+    bool started_ = false;
+    bool pcapng_ = false;
+    bool nanosecond_ = false;
+    bool block_type_known_ = false;
+    std::vector<Interface> interfaces_;
+    std::vector<u_char> block_;
+};
+
+} // namespace
+
+const char* capture_format_name(CaptureFormat format) {
+    return format < CAPTURE_FORMAT_COUNT ? capture_format_names[format] : "unknown";
+}
+
+bool parse_capture_format(const std::string& name, CaptureFormat& format) {
+    for (int f = 0; f < CAPTURE_FORMAT_COUNT; ++f) {
+        if (name == capture_format_names[f]) {
+            format = static_cast<CaptureFormat>(f);
+            return true;
+        }
+    }
+    if (name == "pcapng") {
+        format = CAPTURE_PCAP;
+        return true;
+    }
+    return false;
+}
+
+CaptureFormat detect_capture_format(const u_char* head, size_t size) {
+    if (size >= 8 && std::memcmp(head, PAYLOAD_RECORD_MAGIC, 8) == 0) return CAPTURE_RECORD;
+    if (size >= 4) {
+        const uint32_t magic = static_cast<uint32_t>(le(head, 4));
+        if (magic == 0x0A0D0D0A || magic == 0xA1B2C3D4 || magic == 0xA1B23C4D || magic == 0xD4C3B2A1 ||
+            magic == 0x4D3CB2A1) {
+            return CAPTURE_PCAP;
+        }
+    }
+    // First non empty line of text
+    const char* text = reinterpret_cast<const char*>(head);
+    size_t start = 0;
+    while (start < size && (text[start] == '\n' || text[start] == '\r')) ++start;
+    const char* end = static_cast<const char*>(std::memchr(text + start, '\n', size - start));
+    const size_t length = (end ? static_cast<size_t>(end - text) : size) - start;
+    const char* line = text + start;
+    if (starts_with(line, length, "Converted Monotonic Time:")) return CAPTURE_TIMED;
+    if (starts_with(line, length, "Frame ") || starts_with(line, length, "No.")) return CAPTURE_DISSECTION;
+    if (starts_with(line, length, "0x0") && std::memchr(line, ';', length) != nullptr) return CAPTURE_TSHARK;
+    if (starts_with(line, length, "0000 ") || starts_with(line, length, "00000000 ")) return CAPTURE_HEXDUMP;
+    size_t hex = 0;
+    while (hex < length && (is_hex(line[hex]) || line[hex] == ' ' || line[hex] == '\r')) ++hex;
+    if (length > 0 && hex == length) return CAPTURE_HEX;
+    return CAPTURE_AUTO;
+}
+
+bool CaptureConverter::run(const std::string& input, const std::string& output) {
+    stats_ = ConvertStats{};
+    error_.clear();
+    const auto start = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    std::ifstream file;
+    std::vector<char> in_buffer(1 << 20);
+    std::istream* in = &std::cin;
+    if (input != "-") {
+        file.rdbuf()->pubsetbuf(in_buffer.data(), static_cast<std::streamsize>(in_buffer.size()));
+        file.open(input, std::ios::binary);
+        if (!file.is_open()) {
+            error_ = "cannot open " + input;
+            return false;
+        }
+        in = &file;
+    }
+
+    // Format detection reads ahead; those bytes go back in front of the stream
+    std::vector<u_char> head(4096);
+    in->read(reinterpret_cast<char*>(head.data()), static_cast<std::streamsize>(head.size()));
+    head.resize(static_cast<size_t>(in->gcount()));
+    stats_.input_bytes += head.size();
+    CaptureFormat format = options_.input;
+    if (format == CAPTURE_AUTO) format = detect_capture_format(head.data(), head.size());
+    if (format == CAPTURE_AUTO || format == CAPTURE_PACKET_HEX) {
+        error_ = "cannot tell the input format, use -from";
+        return false;
+    }
+    if (options_.output == CAPTURE_AUTO) {
+        error_ = "no output format";
+        return false;
+    }
+    if (options_.output == CAPTURE_PACKET_HEX && format != CAPTURE_PCAP && format != CAPTURE_HEXDUMP) {
+        error_ = "tph output needs packets (pcap or hexdump input)";
+        return false;
+    }
+    if (options_.output == CAPTURE_RECORD && output == "-") {
+        error_ = "record output needs a file";
+        return false;
+    }
+
+    std::ofstream out_file;
+    std::vector<char> out_buffer(1 << 20);
+    std::ostream* out = &std::cout;
+    if (options_.output != CAPTURE_RECORD && output != "-") {
+        out_file.rdbuf()->pubsetbuf(out_buffer.data(), static_cast<std::streamsize>(out_buffer.size()));
+        out_file.open(output, std::ios::binary | std::ios::trunc);
+        if (!out_file.is_open()) {
+            error_ = "cannot write " + output;
+            return false;
+        }
+        out = &out_file;
+    }
+
+    ChunkReader reader(*in, options_, format, stats_);
+    reader.prepend(std::move(head));
+    ConvertSink sink(options_, stats_, output, options_.output == CAPTURE_RECORD ? nullptr : out);
+    if (format == CAPTURE_RECORD) {
+        StreamConfig config;
+        if (!reader.read_record_header(config, error_)) return false;
+        sink.set_config(config);
+    }
+
+    const size_t workers = std::max<size_t>(1, options_.workers ? options_.workers : std::thread::hardware_concurrency());
+    const size_t in_flight = options_.chunks_in_flight ? options_.chunks_in_flight : workers * 2;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Chunk> todo;
+    std::map<uint64_t, Batch> done;
+    uint64_t read = 0;
+    uint64_t written = 0;
+    bool reader_done = false;
+    bool stop = false;
+
+    std::thread reader_thread([&]() {
+        while (true) {
+            Chunk chunk;
+            const bool more = reader.next(chunk);
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!more || stop) break;
+            changed.wait(lock, [&]() { return read - written < in_flight || stop; });
+            if (stop) break;
+            chunk.sequence = read++;
+            todo.push_back(std::move(chunk));
+            changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        reader_done = true;
+        changed.notify_all();
+    });
+
+    std::vector<std::thread> worker_threads;
+    for (size_t w = 0; w < workers; ++w) {
+        worker_threads.emplace_back([&]() {
+            ChunkDecoder decoder(options_, format);
+            while (true) {
+                Chunk chunk;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&]() { return !todo.empty() || reader_done || stop; });
+                    if (todo.empty()) return;
+                    chunk = std::move(todo.front());
+                    todo.pop_front();
+                }
+                Batch batch;
+                decoder.decode(chunk, batch);
+                std::lock_guard<std::mutex> lock(mutex);
+                const uint64_t sequence = batch.sequence;
+                done.emplace(sequence, std::move(batch));
+                changed.notify_all();
+            }
+        });
+    }
+
+    bool ok = true;
+    while (true) {
+        Batch batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return done.count(written) > 0 || (reader_done && written == read); });
+            auto next = done.find(written);
+            if (next == done.end()) break;
+            batch = std::move(next->second);
+            done.erase(next);
+        }
+        ok = sink.consume(batch);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++written;
+        stop = !ok;
+        changed.notify_all();
+        if (!ok) break;
+    }
+    reader_thread.join();
+    for (std::thread& worker : worker_threads) worker.join();
+
+    ok = sink.finish() && ok;
+    if (!ok) error_ = sink.error();
+    if (ok && !reader.error().empty()) {
+        error_ = reader.error();
+        ok = false;
+    }
+    stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
@@ -0,0 +1,361 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "validuvc/capture_policy.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+std::mutex& config_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+CapturePolicyConfig& current_config(CaptureCategory category) {
+    static CapturePolicyConfig configs[CAPTURE_CATEGORY_COUNT];
+    return configs[category];
+}
+
+// Positive decimal number ending at end or at ':'
+bool parse_count(const char*& text, uint32_t& value) {
+    char* end = nullptr;
+    const long parsed = std::strtol(text, &end, 10);
+    if (end == text || parsed <= 0 || (*end != '\0' && *end != ':')) {
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    text = end;
+    return true;
+}
+
+bool parse_category(const char* name, size_t length, CaptureCategory& category) {
+    const CaptureCategory categories[] = {CAPTURE_ERROR, CAPTURE_SUSPICIOUS, CAPTURE_VALID};
+    for (CaptureCategory candidate : categories) {
+        const char* candidate_name = capture_category_name(candidate);
+        if (std::strlen(candidate_name) == length && std::strncmp(name, candidate_name, length) == 0) {
+            category = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const char* capture_category_name(CaptureCategory category) {
+    switch (category) {
+      case CAPTURE_ERROR: return "error";
+      case CAPTURE_SUSPICIOUS: return "suspicious";
+      case CAPTURE_VALID: return "valid";
+    }
+    return "unknown";
+}
+
+bool parse_capture_policy(const char* text, CapturePolicyConfig& config) {
+    static const struct { const char* name; CaptureSampling sampling; } names[] = {
+        {"every", CAPTURE_SAMPLE_EVERY_NTH}, {"rate", CAPTURE_SAMPLE_RATE},
+        {"reservoir", CAPTURE_SAMPLE_RESERVOIR}, {"burst", CAPTURE_SAMPLE_BURST},
+    };
+    if (std::strcmp(text, "all") == 0) {
+        config = CapturePolicyConfig{};
+        return true;
+    }
+    for (const auto& entry : names) {
+        const size_t length = std::strlen(entry.name);
+        if (std::strncmp(text, entry.name, length) != 0 || text[length] != ':') {
+            continue;
+        }
+        CapturePolicyConfig parsed;
+        parsed.sampling = entry.sampling;
+        const char* cursor = text + length + 1;
+        if (!parse_count(cursor, parsed.count)) {
+            return false;
+        }
+        if (*cursor == ':') {
+            uint32_t window_ms = 0;
+            ++cursor;
+            if (entry.sampling != CAPTURE_SAMPLE_RESERVOIR || !parse_count(cursor, window_ms) || *cursor != '\0') {
+                return false;
+            }
+            parsed.window = std::chrono::milliseconds(window_ms);
+        }
+        config = parsed;
+        return true;
+    }
+    return false;
+}
+
+std::string capture_policy_name(const CapturePolicyConfig& config) {
+    const std::string count = std::to_string(config.count);
+    switch (config.sampling) {
+      case CAPTURE_SAMPLE_ALL: return "all";
+      case CAPTURE_SAMPLE_EVERY_NTH: return "every:" + count;
+      case CAPTURE_SAMPLE_RATE: return "rate:" + count;
+      case CAPTURE_SAMPLE_RESERVOIR: return "reservoir:" + count + ":" + std::to_string(config.window.count());
+      case CAPTURE_SAMPLE_BURST: return "burst:" + count;
+    }
+    return "unknown";
+}
+
+CapturePolicyConfig capture_policy_config(CaptureCategory category) {
+    std::lock_guard<std::mutex> lock(config_mutex());
+    return current_config(category);
+}
+
+void set_capture_policy_config(CaptureCategory category, const CapturePolicyConfig& config) {
+    std::lock_guard<std::mutex> lock(config_mutex());
+    current_config(category) = config;
+}
+
+bool parse_capture_policies(const char* text, unsigned& mask) {
+    CapturePolicyConfig configs[CAPTURE_CATEGORY_COUNT];
+    unsigned parsed_mask = 0;
+    const std::string list(text);
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string item = list.substr(begin, end - begin);
+        const size_t equals = item.find('=');
+        CaptureCategory category;
+        if (equals == std::string::npos || !parse_category(item.c_str(), equals, category) ||
+            !parse_capture_policy(item.c_str() + equals + 1, configs[category])) {
+            return false;
+        }
+        parsed_mask |= 1u << category;
+        begin = end + 1;
+    }
+
+    for (int category = 0; category < CAPTURE_CATEGORY_COUNT; ++category) {
+        if (parsed_mask & (1u << category)) {
+            set_capture_policy_config(static_cast<CaptureCategory>(category), configs[category]);
+        }
+    }
+    mask = parsed_mask;
+    return true;
+}
+
+CapturePolicy::CapturePolicy() : random_state_(0x9E3779B97F4A7C15ull) {
+    configure(config_);
+}
+
+void CapturePolicy::configure(const CapturePolicyConfig& config) {
+    config_ = config;
+    config_.count = std::max<uint32_t>(1, config_.count);
+    limit_ = config_.count;
+    if (config_.sampling == CAPTURE_SAMPLE_RESERVOIR || config_.sampling == CAPTURE_SAMPLE_BURST) {
+        limit_ = std::min<uint32_t>(limit_, CAPTURE_MAX_HELD);
+    }
+
+    skipped_.fetch_add(static_cast<int64_t>(held_count_), std::memory_order_relaxed);
+    held_frames_.store(0, std::memory_order_relaxed);
+    held_.clear();
+    held_.resize(limit_);
+    occupied_.assign(limit_, false);
+    held_count_ = 0;
+    ring_start_ = 0;
+    seen_ = 0;
+    burst_closed_ = false;
+    window_open_ = false;
+    tokens_ = config_.count;
+    last_refill_ = {};
+}
+
+CaptureDecision CapturePolicy::decide(std::chrono::steady_clock::time_point now) {
+    switch (config_.sampling) {
+      case CAPTURE_SAMPLE_ALL:
+        sampled_.fetch_add(1, std::memory_order_relaxed);
+        return CAPTURE_NOW;
+
+      case CAPTURE_SAMPLE_EVERY_NTH:
+        if (seen_++ % config_.count == 0) {
+            sampled_.fetch_add(1, std::memory_order_relaxed);
+            return CAPTURE_NOW;
+        }
+        break;
+
+      case CAPTURE_SAMPLE_RATE: {
+        // Token bucket holding up to count frames, refilled at count frames per second
+        if (last_refill_ != std::chrono::steady_clock::time_point{} && now > last_refill_) {
+            const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+            tokens_ = std::min<double>(config_.count, tokens_ + elapsed * config_.count);
+        }
+        last_refill_ = now;
+        if (tokens_ >= 1.0) {
+            tokens_ -= 1.0;
+            sampled_.fetch_add(1, std::memory_order_relaxed);
+            return CAPTURE_NOW;
+        }
+        break;
+      }
+
+      case CAPTURE_SAMPLE_RESERVOIR: {
+        if (!window_open_) {
+            window_open_ = true;
+            window_start_ = now;
+            seen_ = 0;
+        }
+        // Algorithm R: the n-th frame of the window replaces a random slot with probability limit / n
+        const uint64_t position = seen_++;
+        size_t slot = static_cast<size_t>(position);
+        if (position >= limit_) {
+            slot = static_cast<size_t>(next_random() % (position + 1));
+            if (slot >= limit_) {
+                break;
+            }
+        }
+        if (occupied_[slot]) {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        hold_slot_ = slot;
+        return CAPTURE_HOLD;
+      }
+
+      case CAPTURE_SAMPLE_BURST: {
+        if (burst_closed_) {
+            burst_closed_ = false;
+            seen_ = 0;
+        }
+        if (seen_++ < limit_) {
+            sampled_.fetch_add(1, std::memory_order_relaxed);
+            return CAPTURE_NOW;
+        }
+        // Past the head of the run only the latest limit frames are kept
+        if (held_count_ < limit_) {
+            hold_slot_ = (ring_start_ + held_count_) % limit_;
+        } else {
+            hold_slot_ = ring_start_;
+            ring_start_ = (ring_start_ + 1) % limit_;
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return CAPTURE_HOLD;
+      }
+    }
+
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+    return CAPTURE_SKIP;
+}
+
+void CapturePolicy::hold(DevelopJob&& job) {
+    held_[hold_slot_] = std::move(job);
+    if (!occupied_[hold_slot_]) {
+        occupied_[hold_slot_] = true;
+        ++held_count_;
+        held_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CapturePolicy::interrupt() {
+    burst_closed_ = true;
+}
+
+void CapturePolicy::release(std::chrono::steady_clock::time_point now, std::vector<DevelopJob>& out, bool flush) {
+    if (flush) {
+        release_held(out);
+        window_open_ = false;
+        burst_closed_ = true;
+        return;
+    }
+    if (config_.sampling == CAPTURE_SAMPLE_RESERVOIR && window_open_ && now - window_start_ >= config_.window) {
+        release_held(out);
+        window_open_ = false;
+    } else if (config_.sampling == CAPTURE_SAMPLE_BURST && burst_closed_ && held_count_ > 0) {
+        release_held(out);
+    }
+}
+
+void CapturePolicy::release_held(std::vector<DevelopJob>& out) {
+    const size_t first = out.size();
+    for (size_t i = 0; i < held_.size(); ++i) {
+        const size_t slot = (ring_start_ + i) % held_.size();
+        if (occupied_[slot]) {
+            out.push_back(std::move(held_[slot]));
+            held_[slot] = DevelopJob{};
+            occupied_[slot] = false;
+        }
+    }
+    // Reservoir slots fill in random order; hand them over in stream order
+    std::sort(out.begin() + first, out.end(), [](const DevelopJob& a, const DevelopJob& b) {
+        return a.format.frame_number < b.format.frame_number;
+    });
+
+    const int64_t released = static_cast<int64_t>(out.size() - first);
+    sampled_.fetch_add(released, std::memory_order_relaxed);
+    held_frames_.fetch_sub(released, std::memory_order_relaxed);
+    held_count_ = 0;
+    ring_start_ = 0;
+}
+
+CaptureCounts CapturePolicy::counts() const {
+    CaptureCounts counts;
+    counts.sampled = sampled_.load(std::memory_order_relaxed);
+    counts.skipped = skipped_.load(std::memory_order_relaxed);
+    counts.held = held_frames_.load(std::memory_order_relaxed);
+    return counts;
+}
+
+uint64_t CapturePolicy::next_random() {
+    // xorshift64*, enough for picking reservoir slots
+    random_state_ ^= random_state_ >> 12;
+    random_state_ ^= random_state_ << 25;
+    random_state_ ^= random_state_ >> 27;
+    return random_state_ * 0x2545F4914F6CDD1Dull;
+}
+
+PayloadDemand& PayloadDemand::instance() {
+    static PayloadDemand demand;
+    return demand;
+}
+
+void PayloadDemand::add(unsigned category_mask) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsigned mask = 0;
+    for (int category = 0; category < CAPTURE_CATEGORY_COUNT; ++category) {
+        if (category_mask & (1u << category)) {
+            ++counts_[category];
+        }
+        if (counts_[category] > 0) {
+            mask |= 1u << category;
+        }
+    }
+    mask_.store(mask, std::memory_order_release);
+}
+
+void PayloadDemand::remove(unsigned category_mask) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsigned mask = 0;
+    for (int category = 0; category < CAPTURE_CATEGORY_COUNT; ++category) {
+        if ((category_mask & (1u << category)) && counts_[category] > 0) {
+            --counts_[category];
+        }
+        if (counts_[category] > 0) {
+            mask |= 1u << category;
+        }
+    }
+    mask_.store(mask, std::memory_order_release);
+}
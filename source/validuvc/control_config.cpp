@@ -26,75 +26,119 @@
 #include <iostream>
 #include <cstdint>
 
+const char* frame_format_name(FrameFormat format) {
+    switch (format) {
+        case FRAME_FORMAT_MJPEG: return "mjpeg";
+        case FRAME_FORMAT_H264: return "h264";
+        case FRAME_FORMAT_YUYV: return "yuyv";
+        case FRAME_FORMAT_RGB: return "rgb";
+        default: return "mjpeg";
+    }
+}
+
+bool parse_frame_format(const std::string& name, FrameFormat& format) {
+    std::string format_lower = name;
+    std::transform(format_lower.begin(), format_lower.end(), format_lower.begin(), ::tolower);
+
+    if (format_lower == "mjpeg") { format = FRAME_FORMAT_MJPEG; return true; }
+    if (format_lower == "h264") { format = FRAME_FORMAT_H264; return true; }
+    if (format_lower == "yuyv") { format = FRAME_FORMAT_YUYV; return true; }
+    if (format_lower == "rgb") { format = FRAME_FORMAT_RGB; return true; }
+    return false;
+}
+
+void StreamConfig::derive() {
+    expected_yuyv_size = static_cast<size_t>(width) * static_cast<size_t>(height) * 2;
+    // dwTimeFrequency is in Hz; 0 would mean an unset device clock, treat it as 1 kHz
+    pts_to_ms = 1000.0 / static_cast<double>(dwTimeFrequency ? dwTimeFrequency : 1000);
+    pts_wrap = pts_to_milliseconds(0xFFFFFFFFU);
+}
+
 ControlConfig& ControlConfig::instance() {
     static ControlConfig instance; // Guaranteed to be destroyed, instantiated on first use.
     return instance;
 }
 
-ControlConfig::ControlConfig() 
-    : vendor_id(0), product_id(0), device_name("-"), width(1), height(1), fps(1), frame_format("mjpeg"),
-      dwMaxVideoFrameSize(1), dwMaxPayloadTransferSize(1), dwTimeFrequency(1) {}
+ControlConfig::ControlConfig() : current_(nullptr) {
+    StreamConfig initial;
+    initial.derive();
+    publish(initial);
+}
 
+const StreamConfig* ControlConfig::publish(const StreamConfig& next) {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    return publish_locked(StreamConfig(next));
+}
 
-void ControlConfig::set_vendor_id(int v) {vendor_id = v;}
+const StreamConfig* ControlConfig::publish_locked(StreamConfig&& next) {
+    auto version = std::make_unique<StreamConfig>(std::move(next));
+    version->version = versions_.size() + 1;
+    version->derive();
 
-void ControlConfig::set_product_id(int p) {product_id = p;}
+    const StreamConfig* published = version.get();
+    versions_.push_back(std::move(version));
+    current_.store(published, std::memory_order_release);
+    return published;
+}
 
-void ControlConfig::set_device_name(const std::string& name) {device_name = name;}
 
+void ControlConfig::set_vendor_id(int v) {modify([&](StreamConfig& c) {c.vendor_id = v;});}
 
-void ControlConfig::set_width(int w) {width = w;}
+void ControlConfig::set_product_id(int p) {modify([&](StreamConfig& c) {c.product_id = p;});}
 
-void ControlConfig::set_height(int h) {height = h;}
+void ControlConfig::set_device_name(const std::string& name) {modify([&](StreamConfig& c) {c.device_name = name;});}
 
-void ControlConfig::set_fps(int f) {fps = f;}
 
-void ControlConfig::set_frame_format(const std::string& format) {
-    std::string format_lower = format;
-    std::transform(format_lower.begin(), format_lower.end(), format_lower.begin(), ::tolower);
+void ControlConfig::set_width(int w) {modify([&](StreamConfig& c) {c.width = w;});}
+
+void ControlConfig::set_height(int h) {modify([&](StreamConfig& c) {c.height = h;});}
 
-    if (format_lower == "mjpeg" || format_lower == "h264" ||
-        format_lower == "yuyv" || format_lower == "rgb") {
-        frame_format = format_lower;
-    } else {
+void ControlConfig::set_fps(int f) {modify([&](StreamConfig& c) {c.fps = f;});}
+
+void ControlConfig::set_frame_format(const std::string& format) {
+    FrameFormat parsed;
+    if (!parse_frame_format(format, parsed)) {
         std::cerr << "Unsupported frame format: " << format
                   << ". Using default format 'mjpeg'." << std::endl;
-        frame_format = "mjpeg";
+        parsed = FRAME_FORMAT_MJPEG;
     }
+    modify([&](StreamConfig& c) {c.format = parsed;});
 }
 
 void ControlConfig::set_dwMaxVideoFrameSize(uint32_t max_video_frame_size) {
-    dwMaxVideoFrameSize = max_video_frame_size;
+    modify([&](StreamConfig& c) {c.dwMaxVideoFrameSize = max_video_frame_size;});
 }
 
 void ControlConfig::set_dwMaxPayloadTransferSize(uint32_t max_payload_transfer_size) {
-    dwMaxPayloadTransferSize = max_payload_transfer_size;
+    modify([&](StreamConfig& c) {c.dwMaxPayloadTransferSize = max_payload_transfer_size;});
 }
 
 void ControlConfig::set_dwTimeFrequency(uint32_t time_frequency) {
-    dwTimeFrequency = time_frequency;
+    modify([&](StreamConfig& c) {c.dwTimeFrequency = time_frequency;});
 }
 
 
-int ControlConfig::get_vendor_id() const {return vendor_id;}
+int ControlConfig::get_vendor_id() const {return current()->vendor_id;}
 
-int ControlConfig::get_product_id() const {return product_id;}
+int ControlConfig::get_product_id() const {return current()->product_id;}
 
-std::string ControlConfig::get_device_name() const {return device_name;}
+std::string ControlConfig::get_device_name() const {return current()->device_name;}
 
 
-int ControlConfig::get_width() const {return width;}
+int ControlConfig::get_width() const {return current()->width;}
 
-int ControlConfig::get_height() const {return height;}
+int ControlConfig::get_height() const {return current()->height;}
 
-int ControlConfig::get_fps() const {return fps;}
+int ControlConfig::get_fps() const {return current()->fps;}
 
-std::string ControlConfig::get_frame_format() const {return frame_format;}
+std::string ControlConfig::get_frame_format() const {return frame_format_name(current()->format);}
 
-uint32_t ControlConfig::get_dwMaxVideoFrameSize() const {return dwMaxVideoFrameSize;}
+FrameFormat ControlConfig::get_format() const {return current()->format;}
 
-uint32_t ControlConfig::get_dwMaxPayloadTransferSize() const {return dwMaxPayloadTransferSize;}
+uint32_t ControlConfig::get_dwMaxVideoFrameSize() const {return current()->dwMaxVideoFrameSize;}
 
-uint32_t ControlConfig::get_dwTimeFrequency() const {return dwTimeFrequency;}
+uint32_t ControlConfig::get_dwMaxPayloadTransferSize() const {return current()->dwMaxPayloadTransferSize;}
 
+uint32_t ControlConfig::get_dwTimeFrequency() const {return current()->dwTimeFrequency;}
 
+uint64_t ControlConfig::get_version() const {return current()->version;}
@@ -22,6 +22,7 @@
 
 #include "moncapler.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <csignal>
@@ -47,7 +48,14 @@
 #endif
 
 
+#include "develope_photo.hpp"
+#include "frame_file.hpp"
+#include "utils/log_sink.hpp"
 #include "utils/logger.hpp"
+#include "utils/metrics.hpp"
+#include "utils/pipeline_latency.hpp"
+#include "utils/trace_export.hpp"
+#include "utils/trace_probes.hpp"
 #include "utils/verbose.hpp"
 #include "validuvc/control_config.hpp"
 #include "validuvc/uvcpheader_checker.hpp"
@@ -83,6 +91,8 @@ std::queue<std::vector<u_char>> packet_queue;
 std::mutex queue_mutex;
 std::condition_variable queue_cv;
 bool stop_processing = false;
+// PipelineClock tick per packet_queue entry, guarded by queue_mutex
+std::queue<uint64_t> packet_queue_ticks;
 
 extern int log_verbose_level;
 
@@ -174,7 +184,7 @@ void log_packet_xxd_format(std::ofstream* log_file, const u_char* data,
 
 void coutnlog(const std::string& message, std::ofstream* log_file) {
   // Print to console
-  CtrlPrint::v_cout_2 << message << std::endl;
+  V_COUT_2 << message << std::endl;
 
   // Print to log file if it's open
   if (log_file && log_file->is_open()) {
@@ -228,11 +238,20 @@ void print_capture_statistics(const pcap_stat& stats,
   coutnlog("\n", log_file);
 }
 
+// SIGINT/SIGTERM may land on any thread, even one holding a queue or container lock,
+// so the handler only breaks pcap_loop (which is made for that) and main shuts down
 void clean_exit(int signum) {
+  (void)signum;
+  if (handle != nullptr) {
+    pcap_breakloop(handle);
+  }
+}
+
+// Runs on main once pcap_loop has returned
+void print_exit_statistics() {
   struct pcap_stat stats;
 
   if (handle != nullptr) {
-    pcap_breakloop(handle);
     // Get capture statistics
 
     if (pcap_stats(handle, &stats) >= 0) {
@@ -243,22 +262,40 @@ void clean_exit(int signum) {
                                filtered_total_packet_length,
                                filtered_total_captured_length, &log_file);
     } else {
-      CtrlPrint::v_cerr_3 << "pcap_stats failed: " << pcap_geterr(handle) << std::endl;
+      V_CERR_3 << "pcap_stats failed: " << pcap_geterr(handle) << std::endl;
     }
   }
+}
 
+// Queue depth and kernel side drops next to the per checker counters
+void collect_capture_metrics(MetricsWriter& out) {
+  size_t packet_depth = 0;
   {
     std::lock_guard<std::mutex> lock(queue_mutex);
-    stop_processing = true;
+    packet_depth = packet_queue.size();
   }
-  queue_cv.notify_all();
+  out.gauge("uvcfd_packet_queue_depth", "Payloads waiting for the checker", {}, static_cast<double>(packet_depth));
 
-  if (log_file.is_open()) {
-    log_file.close();
+  // usbmon answers pcap_stats from its own counters, safe next to pcap_loop
+  struct pcap_stat stats;
+  if (handle != nullptr && pcap_stats(handle, &stats) >= 0) {
+    out.counter("uvcfd_pcap_received_total", "Packets seen by usbmon", {}, stats.ps_recv);
+    out.counter("uvcfd_pcap_dropped_total", "Packets dropped by the kernel buffer", {}, stats.ps_drop);
+    out.counter("uvcfd_pcap_interface_dropped_total", "Packets dropped by the interface", {}, stats.ps_ifdrop);
   }
 
-  CtrlPrint::v_cout_2 << "Exiting safely..." << std::endl;
-  //exit(signum);
+  DevFImage& dev_f_image = DevFImage::instance();
+  DevelopQueueStats develop = dev_f_image.dev_f_image_queue.stats();
+  const MetricLabels policy = {{"policy", develop_drop_policy_name(dev_f_image.dev_f_image_queue.policy())}};
+  out.gauge("uvcfd_develop_queue_depth", "Frames waiting to be developed", {}, static_cast<double>(develop.depth));
+  out.gauge("uvcfd_develop_queue_high_water", "Deepest the develop queue has been", {}, static_cast<double>(develop.high_water));
+  out.counter("uvcfd_develop_dropped_total", "Frames dropped by the develop queue policy", policy, static_cast<int64_t>(develop.dropped));
+  out.counter("uvcfd_develop_dropped_error_frames_total", "Error or suspicious frames among the dropped", policy, static_cast<int64_t>(develop.dropped_errors));
+  out.counter("uvcfd_develop_frames_total", "Frames developed into images", {}, static_cast<int64_t>(dev_f_image.developed_frames()));
+
+  LogSink& sink = LogSink::instance();
+  out.gauge("uvcfd_log_pending_records", "Log records waiting for the writer thread", {}, static_cast<double>(sink.pending_records()));
+  out.counter("uvcfd_log_dropped_records_total", "Log records dropped because the ring was full", {}, static_cast<int64_t>(sink.dropped_records()));
 }
 
 std::string getCurrentTimeFormatted() {
@@ -333,6 +370,7 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
       target_busnum == -1 && target_devnum == -1 ||
       target_busnum == -1 && device_address == target_devnum ||
       bus_number == target_busnum && target_devnum == -1) {
+    UVCFD_PROBE4(urb_accepted, bus_number, device_address, urb_data->urb_transfer_type, pkthdr->caplen);
     filtered_packet_count++;
     filtered_total_packet_length += pkthdr->len;
     filtered_total_captured_length += pkthdr->caplen;
@@ -342,16 +380,16 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
     // URB_SUBMIT 0x53
 
     if (urb_data->urb_type == 0x43) {
-      // CtrlPrint::v_cout_3 << "URB_COMPLETE" << std::endl;
+      // V_COUT_3 << "URB_COMPLETE" << std::endl;
 
       if (urb_data->urb_status != 0) {
-        CtrlPrint::v_cerr_5 << "urb_status set, skipping this packet" << std::endl;
+        V_CERR_5 << "urb_status set, skipping this packet" << std::endl;
         return;
       }
 
       if (urb_data->urb_transfer_type ==
           0x02) {  // Control Transfer Type (0x02)
-        // CtrlPrint::v_cerr_3 << "Control || Interrupt Transfer detected, skipping this
+        // V_CERR_3 << "Control || Interrupt Transfer detected, skipping this
         // packet" << std::endl;
         // find setcur getcur here
         // currently, device and wireshark do not give this data, or just i
@@ -360,17 +398,17 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
 
         // Interrupt Transfer Type (0x01)
       } else if (urb_data->urb_transfer_type == 0x01) {
-        // CtrlPrint::v_cerr_3 << "Interrupt transfer detected, skipping this packet"
+        // V_CERR_3 << "Interrupt transfer detected, skipping this packet"
 
         // Bulk Transfer Type (0x03)
       } else if (urb_data->urb_transfer_type == 0x03) {
-        // CtrlPrint::v_cout_3 << "Bulk transfer detected" << std::endl;
+        // V_COUT_3 << "Bulk transfer detected" << std::endl;
         if (urb_data->data_length != 16384) {
-          CtrlPrint::v_cout_3 << "Data Length: " << urb_data->data_length << std::endl;
+          V_COUT_3 << "Data Length: " << urb_data->data_length << std::endl;
         }
 
-        // CtrlPrint::v_cout_3 << "Max Length Size: " << bulk_usbmon_bulk_maxlengthsize <<
-        // std::endl; CtrlPrint::v_cout_3 << "size of URB_Data: " << sizeof(URB_Data) <<
+        // V_COUT_3 << "Max Length Size: " << bulk_usbmon_bulk_maxlengthsize <<
+        // std::endl; V_COUT_3 << "size of URB_Data: " << sizeof(URB_Data) <<
         // std::endl;
 
         // update the max urb length size
@@ -380,12 +418,12 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
             bulk_usbmon_bulk_maxlengthsize =
                 (urb_data->data_length + sizeof(URB_Data) + 8 -
                  (urb_data->data_length + sizeof(URB_Data) % 8));
-            CtrlPrint::v_cerr_3 << "Error incorrect max length size: "
+            V_CERR_3 << "Error incorrect max length size: "
                      << bulk_usbmon_bulk_maxlengthsize << std::endl;
           } else {
             bulk_usbmon_bulk_maxlengthsize =
                 urb_data->data_length + sizeof(URB_Data);
-            CtrlPrint::v_cout_3 << "update the max length size: "
+            V_COUT_3 << "update the max length size: "
                      << bulk_usbmon_bulk_maxlengthsize << std::endl;
           }
         }
@@ -393,7 +431,7 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
         if (bulk_usbmon_bulk_maxlengthsize >
             urb_data->data_length + sizeof(URB_Data)) {
           // finish the transfer
-          CtrlPrint::v_cout_3 << "Finish the transfer" << std::endl;
+          V_COUT_3 << "Finish the transfer" << std::endl;
 
           temp_buffer.insert(temp_buffer.end(), packet + sizeof(URB_Data),
                              packet + pkthdr->caplen);
@@ -410,6 +448,8 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
           {
             std::lock_guard<std::mutex> lock(queue_mutex);
             packet_queue.push(temp_buffer);
+            PIPELINE_LATENCY_ONLY(packet_queue_ticks.push(PIPELINE_STAMP());)
+            UVCFD_PROBE2(payload_enqueue, packet_queue.back().size(), packet_queue.size());
 
             std::lock_guard<std::mutex> time_lock(time_mutex);
             time_records.push(now);
@@ -420,17 +460,17 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
         } else if (bulk_usbmon_bulk_maxlengthsize ==
                    urb_data->data_length + sizeof(URB_Data)) {
           // continue the transfer
-          //  CtrlPrint::v_cout_3 << "Continue the transfer" << std::endl;
+          //  V_COUT_3 << "Continue the transfer" << std::endl;
           temp_buffer.insert(temp_buffer.end(), packet + sizeof(URB_Data),
                              packet + pkthdr->caplen);
         } else {
-          CtrlPrint::v_cerr_3 << "Invalid data length for bulk transfer" << std::endl;
+          V_CERR_3 << "Invalid data length for bulk transfer" << std::endl;
           return;
         }
 
         // Isochronous Transfer (0x00)
       } else if (urb_data->urb_transfer_type == 0x00) {
-        // CtrlPrint::v_cout_3 << "Isochronous transfer detected" << std::endl;
+        // V_COUT_3 << "Isochronous transfer detected" << std::endl;
 
         if (urb_data->iso_descriptor_number > 0) {
           std::vector<ISO_Descriptor> iso_descriptors(
@@ -453,8 +493,8 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
 
             // checks if the packet is the last packet
             if (i == urb_data->iso_descriptor_number - 1) {
-              CtrlPrint::v_cout_3 << "Last iso descriptor" << std::endl;
-              CtrlPrint::v_cout_3 << end_offset << " " << pkthdr->caplen << std::endl;
+              V_COUT_3 << "Last iso descriptor" << std::endl;
+              V_COUT_3 << end_offset << " " << pkthdr->caplen << std::endl;
             }
 
             temp_buffer.insert(temp_buffer.end(), packet + start_offset,
@@ -473,6 +513,8 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
             {
               std::lock_guard<std::mutex> lock(queue_mutex);
               packet_queue.push(temp_buffer);
+              PIPELINE_LATENCY_ONLY(packet_queue_ticks.push(PIPELINE_STAMP());)
+              UVCFD_PROBE2(payload_enqueue, packet_queue.back().size(), packet_queue.size());
 
               std::lock_guard<std::mutex> time_lock(time_mutex);
               time_records.push(now);
@@ -482,7 +524,7 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
           }
         } else {
 
-          CtrlPrint::v_cerr_3 << "No iso descriptor detected, skipping this packet"
+          V_CERR_3 << "No iso descriptor detected, skipping this packet"
                    << std::endl;
           return;
         }
@@ -490,27 +532,27 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
       } else {
         // //packet_push_count++;
 
-        CtrlPrint::v_cerr_3 << "Unknown transfer type detected, skipping this packet"
+        V_CERR_3 << "Unknown transfer type detected, skipping this packet"
                  << std::endl;
         return;
       }
     } else if (urb_data->urb_type == 0x53) {
-      // CtrlPrint::v_cout_3 << "URB_SUBMIT" << std::endl;
+      // V_COUT_3 << "URB_SUBMIT" << std::endl;
       if (urb_data->urb_transfer_type ==
           0x02) {  // Control Transfer Type (0x02)
 
         // Interrupt Transfer Type (0x01)
       } else if (urb_data->urb_transfer_type == 0x01) {
-        CtrlPrint::v_cerr_5 << "Interrupt transfer detected, skipping this packet"
+        V_CERR_5 << "Interrupt transfer detected, skipping this packet"
                  << std::endl;
         return;
         // Bulk Transfer Type (0x03)
       } else if (urb_data->urb_transfer_type == 0x03) {
-        CtrlPrint::v_cout_5 << "Bulk Transfer SUBMIT detected skipping this packet"
+        V_COUT_5 << "Bulk Transfer SUBMIT detected skipping this packet"
                  << std::endl;
         return;
       } else {
-        CtrlPrint::v_cerr_3 << "Unknown transfer type detected, skipping this packet"
+        V_CERR_3 << "Unknown transfer type detected, skipping this packet"
                  << std::endl;
         return;
       }
@@ -520,13 +562,13 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
 //     //packet_push_count++;
 // #endif
 
-      CtrlPrint::v_cout_2 << "URB_ERROR" << std::endl;
+      V_COUT_2 << "URB_ERROR" << std::endl;
     } else {
 #ifdef UNIT_TEST
     //packet_push_count++;
 #endif
 
-      // CtrlPrint::v_cout_3 << "Unknown URB Type" << std::endl;
+      // V_COUT_3 << "Unknown URB Type" << std::endl;
     }
     
 #ifdef UNIT_TEST
@@ -556,15 +598,20 @@ void packet_handler(u_char* user_data, const struct pcap_pkthdr* pkthdr,
     //           << ", epnum: " << endpoint_number << "]" << std::endl;
 
     // log_packet_xxd_format(log_file, packet, pkthdr->caplen, 0);
+  } else {
+    UVCFD_PROBE4(urb_filtered, bus_number, device_address, urb_data->urb_transfer_type, pkthdr->caplen);
   }
 }
 
 void capture_packets() {
+  ALLOC_STATS_ONLY(AllocStats::set_thread_name("capture");)
   pcap_loop(handle, 0, packet_handler, reinterpret_cast<u_char*>(&log_file));
 }
 
 void process_packets() {
+  ALLOC_STATS_ONLY(AllocStats::set_thread_name("process");)
   UVCPHeaderChecker header_checker;
+  std::chrono::time_point<std::chrono::steady_clock> last_depth_sample;
 
   while (true) {
     std::unique_lock<std::mutex> lock(queue_mutex);
@@ -581,6 +628,12 @@ void process_packets() {
 
       auto packet = packet_queue.front();
       packet_queue.pop();
+      PIPELINE_LATENCY_ONLY(
+        PIPELINE_RECORD(STAGE_QUEUE_WAIT, packet_queue_ticks.front());
+        packet_queue_ticks.pop();
+      )
+      UVCFD_PROBE2(payload_dequeue, packet.size(), packet_queue.size());
+      const size_t queue_depth = packet_queue.size();
       lock.unlock();
 
       std::chrono::time_point<std::chrono::steady_clock> received_time;
@@ -589,16 +642,21 @@ void process_packets() {
         received_time = time_records.front();
         time_records.pop();
       }
+      if (TraceExporter::instance().enabled() &&
+          received_time - last_depth_sample >= std::chrono::milliseconds(TRACE_QUEUE_SAMPLE_MS)) {
+        TraceExporter::instance().counter("packet_queue_depth", received_time, static_cast<int64_t>(queue_depth));
+        last_depth_sample = received_time;
+      }
 
       if (!packet.empty()) {
-        CtrlPrint::v_cout_3 << "Processing packet of size: " << packet.size() << std::endl;
+        V_COUT_3 << "Processing packet of size: " << packet.size() << std::endl;
       }
 
       uint8_t valid_err =
           header_checker.payload_valid_ctrl(packet, received_time);
 
       if (valid_err) {
-        CtrlPrint::v_cerr_3 << "Invalid packet detected" << std::endl;
+        V_CERR_3 << "Invalid packet detected" << std::endl;
         continue;
       }
     } else {
@@ -606,13 +664,13 @@ void process_packets() {
     }
     // header_checker.print_packet(packet);
   }
-  CtrlPrint::v_cout_1 << "Process packet() end" << std::endl;
+  V_COUT_1 << "Process packet() end" << std::endl;
 }
 
 void test_print_process_packets() {
   std::ofstream log_file("mid_log.log", std::ios::out | std::ios::app);
   if (!log_file) {
-    CtrlPrint::v_cerr_3 << "Failed to open log file" << std::endl;
+    V_CERR_3 << "Failed to open log file" << std::endl;
     return;
   }
 
@@ -628,18 +686,19 @@ void test_print_process_packets() {
 
     auto packet = packet_queue.front();
     packet_queue.pop();
+    PIPELINE_LATENCY_ONLY(packet_queue_ticks.pop();)
     lock.unlock();
 
     // Test for the packet foramt whether queue is having hex format
     if (!packet.empty() && packet[0] == 0x0c && packet[1] == 0x0c) {
-      CtrlPrint::v_cout_3 << "=================================0x0c." << std::endl;
+      V_COUT_3 << "=================================0x0c." << std::endl;
     }
 
     if (!packet.empty() && packet[0] == 0x0c && packet[1] == 0x0d) {
-      CtrlPrint::v_cout_3 << "=================================0x0d." << std::endl;
+      V_COUT_3 << "=================================0x0d." << std::endl;
     }
 
-    CtrlPrint::v_cout_3 << "Processing packet of size: " << packet.size() << std::endl;
+    V_COUT_3 << "Processing packet of size: " << packet.size() << std::endl;
 
     for (const auto& byte : packet) {
       log_file << std::hex << std::setw(2) << std::setfill('0')
@@ -660,6 +719,14 @@ int main(int argc, char* argv[]) {
   bool fh_set = false;
   bool fps_set = false;
   bool ff_set = false;
+  std::string metrics_address;
+  std::string trace_path;
+  int develop_workers = 0;
+  DevelopOutput save_output = DEVELOP_OUTPUT_JPEG;
+  RawStoreMode raw_store_mode = RAW_STORE_OFF;
+  unsigned capture_mask = 0;
+  size_t develop_capacity = DEVELOP_QUEUE_DEFAULT_CAPACITY;
+  DevelopDropPolicy develop_policy = DEVELOP_KEEP_ERRORS;
 
   // Parse command line arguments
   for (int i = 1; i < argc; i += 2) {
@@ -691,63 +758,95 @@ int main(int argc, char* argv[]) {
       VerboseStream::verbose_level = std::atoi(argv[i + 1]);
     } else if (std::strcmp(argv[i], "-lv") == 0 && i + 1 < argc) {
       log_verbose_level = std::atoi(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "-metrics") == 0 && i + 1 < argc) {
+      metrics_address = argv[i + 1];
+    } else if (std::strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+      trace_path = argv[i + 1];
+    } else if (std::strcmp(argv[i], "-dw") == 0 && i + 1 < argc) {
+      develop_workers = std::atoi(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "-dq") == 0 && i + 1 < argc) {
+      develop_capacity = static_cast<size_t>(std::max(1, std::atoi(argv[i + 1])));
+    } else if (std::strcmp(argv[i], "-dpolicy") == 0 && i + 1 < argc &&
+               parse_develop_drop_policy(argv[i + 1], develop_policy)) {
+      // parsed into develop_policy
+    } else if (std::strcmp(argv[i], "-fsync") == 0 && i + 1 < argc) {
+      set_frame_fsync_every(std::atoi(argv[i + 1]));
+    } else if (std::strcmp(argv[i], "-save") == 0 && i + 1 < argc &&
+               parse_develop_output(argv[i + 1], save_output)) {
+      // parsed into save_output
+    } else if (std::strcmp(argv[i], "-raw") == 0 && i + 1 < argc &&
+               parse_raw_store_mode(argv[i + 1], raw_store_mode)) {
+      // parsed into raw_store_mode
+    } else if (std::strcmp(argv[i], "-capture") == 0 && i + 1 < argc &&
+               parse_capture_policies(argv[i + 1], capture_mask)) {
+      // a category given a policy is also switched on for capture
+      RunFlags& run_flags = RunFlags::instance();
+      if (capture_mask & (1u << CAPTURE_ERROR)) run_flags.capture_error_flag = true;
+      if (capture_mask & (1u << CAPTURE_SUSPICIOUS)) run_flags.capture_suspicious_flag = true;
+      if (capture_mask & (1u << CAPTURE_VALID)) run_flags.capture_valid_flag = true;
     } else {
-      CtrlPrint::v_cerr_1 << "Usage: " << argv[0]
+      V_CERR_1 << "Usage: " << argv[0]
                << " [-in usbmonX] [-bs buffer_size] [-bn busnum] [-dn devnum]  "
                   "[-fw frame_width] [-fh frame_height] [-fps frame_per_sec] "
                   "[-ff frame_format] [-mf max_frame_size] [-mp max_payload_size] "
-                  "[-v verbose_level] [-lv log_verbose_level]"
+                  "[-v verbose_level] [-lv log_verbose_level] [-metrics [host]:port] "
+                  "[-trace trace.json] [-dw develop_workers] [-dq develop_queue_frames] "
+                  "[-dpolicy block|newest|oldest|errors] [-fsync frames] [-save jpg|avi|none] [-raw off|errors|all] "
+                  "[-capture error|suspicious|valid=all|every:N|rate:K|reservoir:K[:ms]|burst:N[,...]]"
                << std::endl;
       return 1;
     }
   }
 
   if (selected_device.empty()) {
-    CtrlPrint::v_cerr_1 << "Error: Device not specified" << std::endl;
-    CtrlPrint::v_cerr_1 << "Usage: " << argv[0]
+    V_CERR_1 << "Error: Device not specified" << std::endl;
+    V_CERR_1 << "Usage: " << argv[0]
              << " [-in usbmonX] [-bs buffer_size] [-bn busnum] [-dn devnum] "
                 "[-fw frame_width] [-fh frame_height] [-fps frame_per_sec] "
                 "[-ff frame_format] [-mf max_frame_size] [-mp max_payload_size] "
-                "[-v verbose_level] [-lv log_verbose_level]"
+                "[-v verbose_level] [-lv log_verbose_level] [-metrics [host]:port] "
+                  "[-trace trace.json] [-dw develop_workers] [-dq develop_queue_frames] "
+                  "[-dpolicy block|newest|oldest|errors] [-fsync frames] [-save jpg|avi|none] [-raw off|errors|all] "
+                  "[-capture error|suspicious|valid=all|every:N|rate:K|reservoir:K[:ms]|burst:N[,...]]"
              << std::endl;
     return 1;
   }
 
   if (target_busnum == -1 || target_devnum == -1) {
-    CtrlPrint::v_cout_1 << "busnum or devnum not specified" << std::endl;
-    CtrlPrint::v_cout_1 << "All packets will be captured" << std::endl;
+    V_COUT_1 << "busnum or devnum not specified" << std::endl;
+    V_COUT_1 << "All packets will be captured" << std::endl;
   }
 
   if (!fw_set || !fh_set || !fps_set || !ff_set) {
     if (!fw_set) {
-      CtrlPrint::v_cout_1 << "Frame width not specified, using default: "
+      V_COUT_1 << "Frame width not specified, using default: "
                 << ControlConfig::instance().get_width() << std::endl;
     }
     if (!fh_set) {
-      CtrlPrint::v_cout_1 << "Frame height not specified, using default: "
+      V_COUT_1 << "Frame height not specified, using default: "
                 << ControlConfig::instance().get_height() << std::endl;
     }
     if (!fps_set) {
-      CtrlPrint::v_cout_1 << "FPS not specified, using default: "
+      V_COUT_1 << "FPS not specified, using default: "
                 << ControlConfig::instance().get_fps() << std::endl;
     }
     if (!ff_set) {
-      CtrlPrint::v_cout_1 << "Frame format not specified, using default: "
+      V_COUT_1 << "Frame format not specified, using default: "
                 << ControlConfig::instance().get_frame_format() << std::endl;
     }
   }
-  CtrlPrint::v_cout_1 << "Frame Width: " << ControlConfig::instance().get_width() << std::endl;
-  CtrlPrint::v_cout_1 << "Frame Height: " << ControlConfig::instance().get_height() << std::endl;
-  CtrlPrint::v_cout_1 << "Frame FPS: " << ControlConfig::instance().get_fps() << std::endl;
-  CtrlPrint::v_cout_1 << "Frame Format: " << ControlConfig::instance().get_frame_format()
+  V_COUT_1 << "Frame Width: " << ControlConfig::instance().get_width() << std::endl;
+  V_COUT_1 << "Frame Height: " << ControlConfig::instance().get_height() << std::endl;
+  V_COUT_1 << "Frame FPS: " << ControlConfig::instance().get_fps() << std::endl;
+  V_COUT_1 << "Frame Format: " << ControlConfig::instance().get_frame_format()
            << std::endl;
 
   // Register signal handler for safe exit
   std::signal(SIGINT, clean_exit);
   std::signal(SIGTERM, clean_exit);
 
-  CtrlPrint::v_cout_1 << "If code is not working try sudo modprobe usbmon" << std::endl;
-  CtrlPrint::v_cout_1 << std::endl;
+  V_COUT_1 << "If code is not working try sudo modprobe usbmon" << std::endl;
+  V_COUT_1 << std::endl;
 
   struct pcap_stat stats;
 
@@ -765,17 +864,17 @@ int main(int argc, char* argv[]) {
   pcap_if_t *interfaces, *device;
 
   if (pcap_findalldevs(&interfaces, error_buffer) == -1) {
-    CtrlPrint::v_cerr_1 << "Error finding Device: " << error_buffer << std::endl;
+    V_CERR_1 << "Error finding Device: " << error_buffer << std::endl;
     return 1;
   }
 
   // Print the list of devices
   int i = 0;
   for (device = interfaces; device != nullptr; device = device->next) {
-    CtrlPrint::v_cout_1 << ++i << ": " << (device->name ? device->name : "No name")
+    V_COUT_1 << ++i << ": " << (device->name ? device->name : "No name")
              << std::endl;
     if (device->description)
-      CtrlPrint::v_cout_1 << " (" << device->description << ")" << std::endl;
+      V_COUT_1 << " (" << device->description << ")" << std::endl;
   }
 
   // Find the specified device
@@ -786,7 +885,7 @@ int main(int argc, char* argv[]) {
   }
 
   if (device == nullptr) {
-    CtrlPrint::v_cerr_1 << "Error: Device " << selected_device << " not found"
+    V_CERR_1 << "Error: Device " << selected_device << " not found"
              << std::endl;
     pcap_freealldevs(interfaces);
     return 1;
@@ -794,7 +893,7 @@ int main(int argc, char* argv[]) {
 
   handle = pcap_open_live(device->name, buffer_size, 1, 1000, error_buffer);
   if (handle == nullptr) {
-    CtrlPrint::v_cerr_1 << "Error opening device: " << error_buffer << std::endl;
+    V_CERR_1 << "Error opening device: " << error_buffer << std::endl;
     pcap_freealldevs(interfaces);
     return 1;
   }
@@ -805,26 +904,77 @@ int main(int argc, char* argv[]) {
   // // Open log file
   // log_file.open(log_path, std::ios::out);
   // if (!log_file) {
-  //   CtrlPrint::v_cerr_3 << "Failed to open log file" << std::endl;
+  //   V_CERR_3 << "Failed to open log file" << std::endl;
   //   return 1;
   // }
-  // CtrlPrint::v_cout_3 << "Log file created" << std::endl;
+  // V_COUT_3 << "Log file created" << std::endl;
   std::ofstream log_file(nullptr);
 
   // Free the device list
   pcap_freealldevs(interfaces);
 
+  if (!metrics_address.empty()) {
+    MetricsRegistry::instance().add_collector(collect_capture_metrics);
+    if (!MetricsServer::instance().start(metrics_address)) {
+      pcap_close(handle);
+      handle = nullptr;
+      return 1;
+    }
+  }
+  if (!trace_path.empty() && !TraceExporter::instance().open(trace_path)) {
+    pcap_close(handle);
+    handle = nullptr;
+    return 1;
+  }
+
+  const std::string capture_path = timestamped_capture_path("./images/");
+  if (save_output == DEVELOP_OUTPUT_AVI) {
+    if (!DevFImage::instance().open_container(capture_path, ControlConfig::instance().get_fps())) {
+      pcap_close(handle);
+      handle = nullptr;
+      return 1;
+    }
+    V_COUT_1 << "Saving frames to " << capture_path << ".avi" << std::endl;
+  }
+  DevFImage::instance().develop_output = save_output;
+  if (raw_store_mode != RAW_STORE_OFF) {
+    if (!DevFImage::instance().open_raw_store(capture_path, raw_store_mode)) {
+      pcap_close(handle);
+      handle = nullptr;
+      return 1;
+    }
+    V_COUT_1 << "Storing raw frames to " << capture_path << ".uvcraw" << std::endl;
+  }
+
+  DevFImage::instance().dev_f_image_queue.configure(develop_capacity, develop_policy);
+  DevFImage::instance().start_workers(develop_workers);
+  V_COUT_1 << "Develop Workers: " << DevFImage::instance().worker_count() << ", queue " << develop_capacity
+           << " frames, drop policy " << develop_drop_policy_name(develop_policy) << std::endl;
+
   std::thread capture_thread(capture_packets);
 
   std::thread process_thread(process_packets);
   // std::thread process_thread(test_print_process_packets);
 
-  CtrlPrint::v_cout_1 << " Thread started" << std::endl;
+  V_COUT_1 << " Thread started" << std::endl;
 
   capture_thread.join();
   // // Start packet capture
   // pcap_loop(handle, 0, packet_handler, reinterpret_cast<u_char*>(&log_file));
+  print_exit_statistics();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    stop_processing = true;
+  }
+  queue_cv.notify_all();
   process_thread.join();
+  DevFImage::instance().stop_workers(true);
+  DevFImage::instance().close_container();
+  DevFImage::instance().close_raw_store();
+  TraceExporter::instance().close();
+
+  // The capture collector reads the pcap handle
+  MetricsServer::instance().stop();
 
   if(handle!=nullptr){
     pcap_close(handle);
@@ -833,10 +983,10 @@ int main(int argc, char* argv[]) {
   if(log_file.is_open()){
     log_file.close();
   }
-  // This code will not be reached if pcap_loop runs indefinitely
-  clean_exit(0);
 
-  CtrlPrint::v_cout_1 << "End of main" << std::endl;
+  V_COUT_2 << "Exiting safely..." << std::endl;
+  LogSink::instance().flush();
+  V_COUT_1 << "End of main" << std::endl;
 
   return 0;
 }
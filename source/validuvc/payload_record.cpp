@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "validuvc/payload_record.hpp"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t kMagicSize = 8;
+constexpr size_t kHeaderSize = kMagicSize + 4 * 9;
+constexpr size_t kRecordHeader = PAYLOAD_RECORD_ENTRY_HEADER;
+constexpr size_t kFlushBytes = 1 << 20;
+
+void append_le(std::vector<u_char>& out, uint64_t value, int bytes) {
+    const size_t at = out.size();
+    out.resize(at + bytes);
+    for (int b = 0; b < bytes; ++b) out[at + b] = static_cast<u_char>(value >> (8 * b));
+}
+
+uint64_t read_le(const u_char* in, int bytes) {
+    uint64_t value = 0;
+    for (int b = 0; b < bytes; ++b) value |= static_cast<uint64_t>(in[b]) << (8 * b);
+    return value;
+}
+
+} // namespace
+
+size_t parse_payload_record_header(const u_char* head, size_t size, StreamConfig& config, std::string& error) {
+    if (size < kHeaderSize || std::memcmp(head, PAYLOAD_RECORD_MAGIC, kMagicSize) != 0) {
+        error = "not a payload record file";
+        return 0;
+    }
+    const u_char* header = head + kMagicSize;
+    const uint32_t version = static_cast<uint32_t>(read_le(header, 4));
+    const size_t header_size = static_cast<size_t>(read_le(header + 4, 4));
+    if (version > PAYLOAD_RECORD_VERSION || header_size < kHeaderSize || header_size > size) {
+        error = "unsupported record version or header";
+        return 0;
+    }
+    config = StreamConfig{};
+    config.width = static_cast<int>(read_le(header + 8, 4));
+    config.height = static_cast<int>(read_le(header + 12, 4));
+    config.fps = static_cast<int>(read_le(header + 16, 4));
+    config.format = static_cast<FrameFormat>(read_le(header + 20, 4));
+    config.dwMaxVideoFrameSize = static_cast<uint32_t>(read_le(header + 24, 4));
+    config.dwMaxPayloadTransferSize = static_cast<uint32_t>(read_le(header + 28, 4));
+    config.dwTimeFrequency = static_cast<uint32_t>(read_le(header + 32, 4));
+    return header_size;
+}
+
+bool PayloadRecordWriter::open(const std::string& path, const StreamConfig& config) {
+    close();
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+    buffer_.assign(PAYLOAD_RECORD_MAGIC, PAYLOAD_RECORD_MAGIC + kMagicSize);
+    append_le(buffer_, PAYLOAD_RECORD_VERSION, 4);
+    append_le(buffer_, kHeaderSize, 4);
+    append_le(buffer_, static_cast<uint32_t>(config.width), 4);
+    append_le(buffer_, static_cast<uint32_t>(config.height), 4);
+    append_le(buffer_, static_cast<uint32_t>(config.fps), 4);
+    append_le(buffer_, config.format, 4);
+    append_le(buffer_, config.dwMaxVideoFrameSize, 4);
+    append_le(buffer_, config.dwMaxPayloadTransferSize, 4);
+    append_le(buffer_, config.dwTimeFrequency, 4);
+    records_ = 0;
+    return true;
+}
+
+void PayloadRecordWriter::write(const u_char* data, size_t size, std::chrono::steady_clock::time_point time) {
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    append_le(buffer_, static_cast<uint32_t>(size), 4);
+    append_le(buffer_, static_cast<uint64_t>(ns), 8);
+    buffer_.insert(buffer_.end(), data, data + size);
+    ++records_;
+    if (buffer_.size() >= kFlushBytes) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void PayloadRecordWriter::close() {
+    if (!file_.is_open()) {
+        return;
+    }
+    file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+    file_.close();
+}
+
+bool PayloadRecordReader::open(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error_ = "cannot open " + path;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    file_.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(file_.data()), static_cast<std::streamsize>(file_.size()));
+
+    header_size_ = parse_payload_record_header(file_.data(), file_.size(), config_, error_);
+    if (header_size_ == 0) {
+        error_ = path + ": " + error_;
+        return false;
+    }
+    offset_ = header_size_;
+    error_.clear();
+    return true;
+}
+
+bool PayloadRecordReader::next(const u_char*& data, size_t& size, std::chrono::steady_clock::time_point& time) {
+    if (offset_ == file_.size()) {
+        return false;
+    }
+    if (file_.size() - offset_ < kRecordHeader) {
+        error_ = "truncated record header";
+        return false;
+    }
+    const u_char* record = file_.data() + offset_;
+    size = static_cast<size_t>(read_le(record, 4));
+    if (file_.size() - offset_ - kRecordHeader < size) {
+        error_ = "truncated record";
+        return false;
+    }
+    time = std::chrono::steady_clock::time_point(
+        std::chrono::nanoseconds(static_cast<int64_t>(read_le(record + 4, 8))));
+    data = record + kRecordHeader;
+    offset_ += kRecordHeader + size;
+    return true;
+}
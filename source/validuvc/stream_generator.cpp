@@ -0,0 +1,485 @@
+/*********************************************************************
+ * Copyright (c) 2024 Vaultmicro, Inc
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*********************************************************************/
+
+
+#include "validuvc/stream_generator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "utils/hex_bytes.hpp"
+
+namespace {
+
+const char* const fault_names[FAULT_COUNT] = {
+    "empty_payload", "payload_overflow", "err_bit", "length_out_of_range", "length_invalid",
+    "reserved_bit", "eoh_cleared", "toggle_overlap", "fid_mismatch", "swap", "missing_eof",
+    "frame_drop", "frame_overflow", "yuyv_short", "pts_mixed", "time_jitter", "frame_shrink",
+    "pts_decrease", "stc_decrease", "overcompressed"
+};
+
+constexpr size_t kHeaderLength = 12;            // PTS + SCR
+constexpr size_t kOverflowBytes = 16;           // FAULT_PAYLOAD_OVERFLOW goes this far past the limit
+constexpr uint32_t kDeviceClockBase = 0x10000;  // keeps PTS / STC away from 0, which the checker treats as absent
+
+constexpr uint8_t BFH_FID = 0x01;
+constexpr uint8_t BFH_EOF = 0x02;
+constexpr uint8_t BFH_PTS = 0x04;
+constexpr uint8_t BFH_SCR = 0x08;
+constexpr uint8_t BFH_RES = 0x10;
+constexpr uint8_t BFH_ERR = 0x40;
+constexpr uint8_t BFH_EOH = 0x80;
+
+void put_le16(u_char* out, uint16_t value) {
+    out[0] = static_cast<u_char>(value);
+    out[1] = static_cast<u_char>(value >> 8);
+}
+
+void put_le32(u_char* out, uint32_t value) {
+    for (int b = 0; b < 4; ++b) out[b] = static_cast<u_char>(value >> (8 * b));
+}
+
+void put_le64(u_char* out, uint64_t value) {
+    for (int b = 0; b < 8; ++b) out[b] = static_cast<u_char>(value >> (8 * b));
+}
+
+int64_t since_epoch_ns(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* stream_fault_name(StreamFault fault) {
+    return fault < FAULT_COUNT ? fault_names[fault] : "unknown";
+}
+
+bool parse_stream_fault(const std::string& name, StreamFault& fault) {
+    for (int i = 0; i < FAULT_COUNT; ++i) {
+        if (name == fault_names[i]) {
+            fault = static_cast<StreamFault>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+StreamConfig GeneratorConfig::stream_config() const {
+    StreamConfig config;
+    config.width = width;
+    config.height = height;
+    config.fps = fps;
+    config.format = format;
+    // Devices report the uncompressed size as the bound for every format
+    config.dwMaxVideoFrameSize = static_cast<uint32_t>(size_t(width) * height * 2);
+    config.dwMaxPayloadTransferSize = max_payload_transfer_size;
+    config.dwTimeFrequency = time_frequency;
+    return config;
+}
+
+UVCStreamGenerator::UVCStreamGenerator(const GeneratorConfig& config)
+    : config_(config), rng_state_(config.seed ? config.seed : 0x9E3779B97F4A7C15ULL) {
+    if (config_.fps < 1) config_.fps = 1;
+    if (config_.max_payload_transfer_size <= kHeaderLength) config_.max_payload_transfer_size = kHeaderLength + 1;
+    if (config_.compression_ratio < 1) config_.compression_ratio = 1;
+
+    const size_t yuyv_size = size_t(config_.width) * config_.height * 2;
+    payload_data_size_ = config_.max_payload_transfer_size - kHeaderLength;
+    frame_data_size_ = config_.format == FRAME_FORMAT_YUYV ? yuyv_size
+                                                          : std::max<size_t>(yuyv_size / config_.compression_ratio, 8);
+    slot_size_ = kHeaderLength + payload_data_size_ + kOverflowBytes;
+
+    // Largest frame is FAULT_FRAME_OVERFLOW: one payload past dwMaxVideoFrameSize
+    const size_t max_payloads = (yuyv_size + payload_data_size_) / payload_data_size_ + 2;
+    buffer_.resize(max_payloads * slot_size_);
+
+    // YUYV: horizontal luma ramp over grey chroma, so a developed frame is recognisable
+    size_t offset = 0;
+    for (size_t slot = 0; slot < max_payloads; ++slot) {
+        u_char* data = buffer_.data() + slot * slot_size_ + kHeaderLength;
+        for (size_t i = 0; i < payload_data_size_ + kOverflowBytes; ++i, ++offset) {
+            const size_t x = (offset / 2) % static_cast<size_t>(config_.width);
+            data[i] = (offset & 1) ? 128 : static_cast<u_char>(16 + x * 219 / config_.width);
+        }
+        offset -= kOverflowBytes;
+    }
+    views_.reserve(max_payloads + 2);
+    touched_.reserve(FAULT_COUNT);
+    fid_ = 1;
+}
+
+double UVCStreamGenerator::uniform() {
+    // xorshift64*, deterministic for a given seed on every platform
+    rng_state_ ^= rng_state_ >> 12;
+    rng_state_ ^= rng_state_ << 25;
+    rng_state_ ^= rng_state_ >> 27;
+    return static_cast<double>((rng_state_ * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool UVCStreamGenerator::roll(StreamFault fault) {
+    const double p = config_.fault_probability[fault];
+    return p > 0 && uniform() < p;
+}
+
+// A payload other than the first (FID transitions) and the last (EOF), not yet used by another fault
+size_t UVCStreamGenerator::pick_middle(size_t payload_count) {
+    if (payload_count < 3) {
+        return SIZE_MAX;
+    }
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        const size_t index = 1 + static_cast<size_t>(uniform() * (payload_count - 2));
+        if (std::find(touched_.begin(), touched_.end(), index) == touched_.end()) {
+            touched_.push_back(index);
+            return index;
+        }
+    }
+    return SIZE_MAX;
+}
+
+uint32_t UVCStreamGenerator::device_clock(std::chrono::steady_clock::time_point time) const {
+    const double seconds = std::chrono::duration<double>(time - config_.start_time).count();
+    return static_cast<uint32_t>(static_cast<uint64_t>(seconds * config_.time_frequency) + kDeviceClockBase);
+}
+
+void UVCStreamGenerator::write_header(u_char* header, uint8_t bfh, uint32_t pts, uint32_t stc, uint16_t sof) {
+    header[0] = static_cast<u_char>(kHeaderLength);
+    header[1] = bfh;
+    put_le32(header + 2, pts);
+    put_le32(header + 6, stc);
+    put_le16(header + 10, sof & 0x7FF);
+}
+
+const std::vector<PayloadView>& UVCStreamGenerator::next_frame() {
+    views_.clear();
+    touched_.clear();
+    truth_ = GeneratedFrame{};
+    truth_.frame_number = frame_number_++;
+
+    auto mark = [this](StreamFault fault) {
+        truth_.faults |= 1u << fault;
+        ++injected_[fault];
+    };
+
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / config_.fps));
+    const uint32_t interval_ticks = config_.time_frequency / static_cast<uint32_t>(config_.fps);
+    const bool compressed = config_.format != FRAME_FORMAT_YUYV;
+
+    // The device skipped a frame: its time slot passes without payloads, FID is not toggled for it
+    if (roll(FAULT_FRAME_DROP)) {
+        ++device_frame_;
+        mark(FAULT_FRAME_DROP);
+    }
+    const auto frame_start = config_.start_time + interval * static_cast<int64_t>(device_frame_++);
+
+    uint32_t pts = device_clock(frame_start);
+    bool toggle = true;
+    if (truth_.frame_number > 0 && roll(FAULT_SWAP)) {
+        pts = previous_pts_;
+        toggle = false;
+        mark(FAULT_SWAP);
+    } else if (truth_.frame_number > 0 && roll(FAULT_FID_MISMATCH)) {
+        toggle = false;
+        mark(FAULT_FID_MISMATCH);
+    } else if (truth_.frame_number > 0 && roll(FAULT_PTS_DECREASE)) {
+        pts = previous_pts_ - interval_ticks;
+        mark(FAULT_PTS_DECREASE);
+    }
+    if (toggle) {
+        fid_ ^= 1;
+    }
+    previous_pts_ = pts;
+    truth_.pts = pts;
+
+    size_t data_size = frame_data_size_;
+    if (compressed) {
+        // Compressed frames vary a little with content, well inside the checker's 10% band
+        data_size = static_cast<size_t>(data_size * (0.98 + 0.04 * uniform()));
+        if (roll(FAULT_OVERCOMPRESSED)) {
+            data_size = std::max<size_t>(size_t(config_.width) * config_.height * 2 / 50, 8);
+            mark(FAULT_OVERCOMPRESSED);
+        } else if (roll(FAULT_FRAME_SHRINK)) {
+            data_size /= 2;
+            mark(FAULT_FRAME_SHRINK);
+        }
+    }
+    if (roll(FAULT_FRAME_OVERFLOW)) {
+        data_size = size_t(config_.width) * config_.height * 2 + payload_data_size_;
+        mark(FAULT_FRAME_OVERFLOW);
+    }
+
+    const size_t payload_count = (data_size + payload_data_size_ - 1) / payload_data_size_;
+    for (size_t i = 0; i < payload_count; ++i) {
+        u_char* slot = buffer_.data() + i * slot_size_;
+        const size_t data = std::min(payload_data_size_, data_size - i * payload_data_size_);
+        const auto time = frame_start + interval * static_cast<int64_t>(i) / static_cast<int64_t>(payload_count);
+        const uint8_t bfh = BFH_EOH | BFH_SCR | BFH_PTS | fid_ | (i + 1 == payload_count ? BFH_EOF : 0);
+        const uint16_t sof = static_cast<uint16_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(time - config_.start_time).count());
+        write_header(slot, bfh, pts, device_clock(time), sof);
+        views_.push_back(PayloadView{slot, kHeaderLength + data, time});
+    }
+
+    auto header_of = [this](size_t index) { return buffer_.data() + index * slot_size_; };
+
+    // Format markers the developers and decoders look for
+    u_char* first_data = header_of(0) + kHeaderLength;
+    if (config_.format == FRAME_FORMAT_MJPEG) {
+        first_data[0] = 0xFF;
+        first_data[1] = 0xD8;
+        if (views_.back().size >= kHeaderLength + 2) {
+            u_char* end = header_of(payload_count - 1) + views_.back().size;
+            end[-2] = 0xFF;
+            end[-1] = 0xD9;
+        }
+    } else if (config_.format == FRAME_FORMAT_H264) {
+        static const u_char idr_start[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+        std::memcpy(first_data, idr_start, std::min(sizeof(idr_start), payload_data_size_));
+    }
+
+    if (roll(FAULT_MISSING_EOF)) {
+        header_of(payload_count - 1)[1] &= static_cast<u_char>(~BFH_EOF);
+        mark(FAULT_MISSING_EOF);
+    }
+
+    static const StreamFault header_faults[] = {
+        FAULT_ERR_BIT, FAULT_LENGTH_OUT_OF_RANGE, FAULT_LENGTH_INVALID, FAULT_RESERVED_BIT,
+        FAULT_EOH_CLEARED, FAULT_TOGGLE_OVERLAP, FAULT_PTS_MIXED, FAULT_STC_DECREASE, FAULT_TIME_JITTER,
+        FAULT_PAYLOAD_OVERFLOW
+    };
+    for (StreamFault fault : header_faults) {
+        if (!roll(fault)) continue;
+        const size_t index = pick_middle(payload_count);
+        if (index == SIZE_MAX) continue;
+        u_char* header = header_of(index);
+        switch (fault) {
+            case FAULT_ERR_BIT: header[1] |= BFH_ERR; break;
+            case FAULT_LENGTH_OUT_OF_RANGE: header[0] = 0x0D; break;
+            case FAULT_LENGTH_INVALID: header[0] = 0x06; break;
+            case FAULT_RESERVED_BIT: header[1] |= BFH_RES; break;
+            case FAULT_EOH_CLEARED: header[1] &= static_cast<u_char>(~BFH_EOH); break;
+            case FAULT_TOGGLE_OVERLAP: header[1] ^= BFH_FID; break;
+            case FAULT_PTS_MIXED: put_le32(header + 2, pts + 1); break;
+            case FAULT_STC_DECREASE: put_le32(header + 6, device_clock(views_[index].time) - interval_ticks); break;
+            case FAULT_TIME_JITTER: views_[index].time += interval / 2; break;
+            case FAULT_PAYLOAD_OVERFLOW: views_[index].size = config_.max_payload_transfer_size + kOverflowBytes; break;
+            default: break;
+        }
+        mark(fault);
+    }
+
+    // Index changing faults last: a lost payload, then an empty one
+    if (config_.format == FRAME_FORMAT_YUYV && roll(FAULT_YUYV_SHORT)) {
+        const size_t index = pick_middle(payload_count);
+        if (index != SIZE_MAX) {
+            views_.erase(views_.begin() + static_cast<std::ptrdiff_t>(index));
+            data_size -= payload_data_size_;
+            mark(FAULT_YUYV_SHORT);
+        }
+    }
+    if (views_.size() >= 2 && roll(FAULT_EMPTY_PAYLOAD)) {
+        const size_t index = 1 + static_cast<size_t>(uniform() * (views_.size() - 1));
+        views_.insert(views_.begin() + static_cast<std::ptrdiff_t>(index),
+                      PayloadView{views_[index].data, 0, views_[index - 1].time});
+        mark(FAULT_EMPTY_PAYLOAD);
+    }
+
+    truth_.payload_count = views_.size();
+    truth_.data_bytes = data_size;
+    return views_;
+}
+
+namespace {
+
+void append_epoch(std::string& line, std::chrono::steady_clock::time_point time) {
+    const int64_t ns = since_epoch_ns(time);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%lld.%09lld", static_cast<long long>(ns / 1000000000),
+                  static_cast<long long>(ns % 1000000000));
+    line += text;
+}
+
+} // namespace
+
+void TsharkFieldsWriter::write_config(const GeneratorConfig& config, std::chrono::steady_clock::time_point time) {
+    write_config(config.stream_config(), time);
+}
+
+void TsharkFieldsWriter::write_config(const StreamConfig& config, std::chrono::steady_clock::time_point time) {
+    // bFrameDescriptorSubtype: 5 uncompressed, 7 MJPEG, 17 frame based
+    const int subtype = config.format == FRAME_FORMAT_YUYV ? 5 : config.format == FRAME_FORMAT_MJPEG ? 7 : 17;
+    const int interval = 10000000 / std::max(config.fps, 1);
+
+    line_.clear();
+    line_ += "0x02;";
+    append_epoch(line_, time);
+    line_ += ";64;;;1;1;" + std::to_string(config.width) + ";" + std::to_string(config.height) + ";" +
+             std::to_string(subtype) + ";" + std::to_string(interval) + ";;;1;" +
+             std::to_string(config.dwTimeFrequency) + ";;\n";
+    line_ += "0x02;";
+    append_epoch(line_, time);
+    line_ += ";90;;;1;1;;;;" + std::to_string(interval) + ";" + std::to_string(config.dwMaxVideoFrameSize) + ";" +
+             std::to_string(config.dwMaxPayloadTransferSize) + ";;;;\n";
+    out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+}
+
+void TsharkFieldsWriter::write(const std::vector<PayloadView>& payloads) {
+    if (transfer_ == TRANSFER_BULK) {
+        for (const PayloadView& payload : payloads) {
+            line_.clear();
+            line_ += "0x03;";
+            append_epoch(line_, payload.time);
+            line_ += ";" + std::to_string(64 + payload.size) + ";";
+            bytes_to_hex_append(payload.data, payload.size, line_);
+            line_ += ";\n";
+            out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+        }
+        return;
+    }
+    const size_t per_urb = std::max<size_t>(iso_packets_per_urb_, 1);
+    for (size_t first = 0; first < payloads.size(); first += per_urb) {
+        const size_t count = std::min(per_urb, payloads.size() - first);
+        size_t length = 64 + 16 * count;
+        for (size_t i = 0; i < count; ++i) length += payloads[first + i].size;
+
+        line_.clear();
+        line_ += "0x00;";
+        append_epoch(line_, payloads[first + count - 1].time);
+        line_ += ";" + std::to_string(length) + ";;";
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) line_ += ',';
+            bytes_to_hex_append(payloads[first + i].data, payloads[first + i].size, line_);
+        }
+        line_ += '\n';
+        out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    }
+}
+
+namespace {
+
+constexpr size_t kUsbmonHeader = 64;
+constexpr size_t kIsoDescriptor = 16;
+constexpr uint16_t kLinktypeUsbLinuxMmapped = 220;
+
+void write_block(std::ostream& out, uint32_t type, const std::vector<u_char>& body) {
+    const size_t padded = (body.size() + 3) & ~size_t(3);
+    const uint32_t total = static_cast<uint32_t>(12 + padded);
+    u_char head[8];
+    put_le32(head, type);
+    put_le32(head + 4, total);
+    out.write(reinterpret_cast<const char*>(head), 8);
+    out.write(reinterpret_cast<const char*>(body.data()), static_cast<std::streamsize>(body.size()));
+    static const char zeros[4] = {};
+    out.write(zeros, static_cast<std::streamsize>(padded - body.size()));
+    out.write(reinterpret_cast<const char*>(head + 4), 4);
+}
+
+} // namespace
+
+UsbmonPcapngWriter::UsbmonPcapngWriter(std::ostream& out, StreamTransfer transfer, uint8_t bus, uint8_t device,
+                                       uint8_t endpoint, size_t iso_packets_per_urb, uint32_t bulk_urb_size)
+    : out_(out), transfer_(transfer), bus_(bus), device_(device), endpoint_(endpoint),
+      iso_packets_per_urb_(std::max<size_t>(iso_packets_per_urb, 1)), bulk_urb_size_(std::max<uint32_t>(bulk_urb_size, 1)) {
+    // Section header: byte order magic, version 1.0, unknown section length
+    std::vector<u_char> shb(16);
+    put_le32(shb.data(), 0x1A2B3C4D);
+    put_le16(shb.data() + 4, 1);
+    put_le16(shb.data() + 6, 0);
+    put_le64(shb.data() + 8, ~uint64_t(0));
+    write_block(out_, 0x0A0D0D0A, shb);
+
+    // One interface, usbmon mmapped link type, no snap length, microsecond timestamps
+    std::vector<u_char> idb(8);
+    put_le16(idb.data(), kLinktypeUsbLinuxMmapped);
+    put_le16(idb.data() + 2, 0);
+    put_le32(idb.data() + 4, 0);
+    write_block(out_, 0x00000001, idb);
+}
+
+void UsbmonPcapngWriter::write_urb(std::chrono::steady_clock::time_point time, const PayloadView* iso,
+                                   size_t iso_count, const u_char* bulk_data, size_t bulk_size) {
+    size_t data_length = bulk_size;
+    for (size_t i = 0; i < iso_count; ++i) data_length += iso[i].size;
+    const size_t captured = kUsbmonHeader + kIsoDescriptor * iso_count + data_length;
+    const int64_t us = since_epoch_ns(time) / 1000;
+
+    // Enhanced packet block body: interface, timestamp, lengths, then the usbmon record
+    block_.assign(20 + captured, 0);
+    put_le32(block_.data() + 4, static_cast<uint32_t>(static_cast<uint64_t>(us) >> 32));
+    put_le32(block_.data() + 8, static_cast<uint32_t>(us));
+    put_le32(block_.data() + 12, static_cast<uint32_t>(captured));
+    put_le32(block_.data() + 16, static_cast<uint32_t>(captured));
+
+    u_char* urb = block_.data() + 20;
+    put_le64(urb, ++urb_id_);
+    urb[8] = 'C';                                               // URB complete
+    urb[9] = transfer_ == TRANSFER_ISO ? 0x00 : 0x03;
+    urb[10] = endpoint_;
+    urb[11] = device_;
+    put_le16(urb + 12, bus_);
+    urb[14] = '-';                                              // no setup packet
+    urb[15] = 0;                                                // data present
+    put_le64(urb + 16, static_cast<uint64_t>(us / 1000000));
+    put_le32(urb + 24, static_cast<uint32_t>(us % 1000000));
+    put_le32(urb + 28, 0);                                      // status
+    put_le32(urb + 32, static_cast<uint32_t>(data_length));     // urb length
+    put_le32(urb + 36, static_cast<uint32_t>(captured - kUsbmonHeader));
+    put_le32(urb + 40, 0);                                      // iso error count
+    put_le32(urb + 44, static_cast<uint32_t>(iso_count));       // iso packet count
+    put_le32(urb + 48, transfer_ == TRANSFER_ISO ? 1 : 0);      // interval
+    put_le32(urb + 52, 0);                                      // start frame
+    put_le32(urb + 56, 0);                                      // transfer flags
+    put_le32(urb + 60, static_cast<uint32_t>(iso_count));       // descriptors in this record
+
+    u_char* descriptor = urb + kUsbmonHeader;
+    u_char* data = descriptor + kIsoDescriptor * iso_count;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < iso_count; ++i) {
+        put_le32(descriptor + i * kIsoDescriptor + 4, offset);
+        put_le32(descriptor + i * kIsoDescriptor + 8, static_cast<uint32_t>(iso[i].size));
+        std::memcpy(data + offset, iso[i].data, iso[i].size);
+        offset += static_cast<uint32_t>(iso[i].size);
+    }
+    if (bulk_size > 0) {
+        std::memcpy(data, bulk_data, bulk_size);
+    }
+    write_block(out_, 0x00000006, block_);
+}
+
+void UsbmonPcapngWriter::write(const std::vector<PayloadView>& payloads) {
+    if (transfer_ == TRANSFER_ISO) {
+        for (size_t first = 0; first < payloads.size(); first += iso_packets_per_urb_) {
+            const size_t count = std::min(iso_packets_per_urb_, payloads.size() - first);
+            write_urb(payloads[first + count - 1].time, &payloads[first], count, nullptr, 0);
+        }
+        return;
+    }
+    // A short (or zero length) URB ends the transfer, the way moncapler reassembles bulk payloads
+    for (const PayloadView& payload : payloads) {
+        size_t offset = 0;
+        while (payload.size - offset >= bulk_urb_size_) {
+            write_urb(payload.time, nullptr, 0, payload.data + offset, bulk_urb_size_);
+            offset += bulk_urb_size_;
+        }
+        write_urb(payload.time, nullptr, 0, payload.data + offset, payload.size - offset);
+    }
+}
@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cassert>
 
+#include "utils/pipeline_latency.hpp"
 #include "utils/verbose.hpp"
 #include "validuvc/uvcpheader_checker.hpp"
 #include "validuvc/control_config.hpp"
@@ -44,25 +45,25 @@
   typedef unsigned char u_char;
 #endif
 
-//Initialize values here
-bool UVCPHeaderChecker::play_pause_flag = 1;
-bool UVCPHeaderChecker::capture_image_flag = 1;
-bool UVCPHeaderChecker::capture_error_flag = 0;
-bool UVCPHeaderChecker::capture_suspicious_flag = 0;
-bool UVCPHeaderChecker::capture_valid_flag = 0;
-bool UVCPHeaderChecker::filter_on_off_flag = 1;
-bool UVCPHeaderChecker::irregular_define_flag = 0;
-bool UVCPHeaderChecker::pts_decrease_filter_flag = 0;
-bool UVCPHeaderChecker::stc_decrease_filter_flag = 0;
+RunFlags& RunFlags::instance() {
+  static RunFlags instance;
+  return instance;
+}
 
 uint8_t UVCPHeaderChecker::payload_valid_ctrl(
     const std::vector<u_char>& uvc_payload,
     std::chrono::time_point<std::chrono::steady_clock> received_time) {
-      
+
+  PIPELINE_SCOPE(STAGE_VALIDATE);
+  ALLOC_STAGE(STAGE_VALIDATE);
+
+  // Latest published config; frames keep the version they started under
+  ctx.sync_config();
+
 #ifdef GUI_SET
   WindowManager& uvcfd_win = WindowManager::getInstance();
   GraphManager& uvcfd_graph = GraphManager::getInstance(); 
-  if (!play_pause_flag) {
+  if (!ctx.flags->play_pause_flag) {
     uvcfd_graph.getGraph_URBGraph().reset_reference_timepoint();
     uvcfd_graph.getGraph_SOFGraph().reset_reference_timepoint();
     uvcfd_graph.getGraph_PTSGraph().reset_reference_timepoint();
@@ -76,19 +77,22 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
   std::chrono::milliseconds::rep pass_time_count = std::chrono::duration_cast<std::chrono::seconds>(received_time - temp_received_time).count();
   // std::chrono::time_point<std::chrono::steady_clock> current_pts_chrono;
 
-  received_time_clock = std::chrono::duration_cast<std::chrono::milliseconds>(received_time.time_since_epoch()).count();
-  formatted_time = formatTime(std::chrono::milliseconds(received_time_clock));
+  // Formatting is deferred to the log statements that actually print it
+  current_received_time = received_time;
+
+  received_payloads++;
+  received_bytes += static_cast<int64_t>(uvc_payload.size());
 
   if (uvc_payload.empty()) {          
-    CtrlPrint::v_cerr_2 << "["<< formatted_time << "]" << " UVC payload is empty." << std::endl;
-    update_payload_error_stat(ERR_EMPTY_PAYLOAD);
+    V_CERR_2 << "[" << formatTime(current_received_time) << "]" << " UVC payload is empty." << std::endl;
+    update_payload_error_stat(ERR_EMPTY_PAYLOAD, uvc_payload.size());
     return ERR_EMPTY_PAYLOAD;
   }
-  if (uvc_payload.size() > ControlConfig::instance().get_dwMaxPayloadTransferSize()) {
+  if (uvc_payload.size() > ctx.config->dwMaxPayloadTransferSize) {
 
-    CtrlPrint::v_cerr_2 << "["<< formatted_time << "]" << " Payload size exceeds maximum transfer size." << std::endl;
+    V_CERR_2 << "[" << formatTime(current_received_time) << "]" << " Payload size exceeds maximum transfer size." << std::endl;
 
-    update_payload_error_stat(ERR_MAX_PAYLAOD_OVERFLOW);
+    update_payload_error_stat(ERR_MAX_PAYLAOD_OVERFLOW, uvc_payload.size());
     return ERR_MAX_PAYLAOD_OVERFLOW;
   }  
 
@@ -100,14 +104,16 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
         for (int i = 1; i < pass_time_count; ++i) {
             frame_count = 0;
             throughput = 0;
+            last_second_frames.store(0, std::memory_order_relaxed);
+            last_second_bytes.store(0, std::memory_order_relaxed);
 
-            int fps_difference = ControlConfig::instance().get_fps() - frame_count;
-            if (frame_count != ControlConfig::instance().get_fps()) {
+            int fps_difference = ctx.config->fps - frame_count;
+            if (frame_count != ctx.config->fps) {
                 frame_stats.count_frame_drop += fps_difference;
             }
             average_frame_rate = (average_frame_rate * received_frames_count + frame_count) / (received_frames_count + 1);
             received_frames_count++;
-            CtrlPrint::v_cerr_1 << "[" << formatted_time << "] " <<  frame_count << " FPS  " 
+            V_CERR_1 << "[" << formatTime(current_received_time) << "] " <<  frame_count << " FPS  " 
             << throughput * 8 / 1000000 << " mbps" << std::endl;
 #ifdef GUI_SET
             print_stats();
@@ -116,17 +122,23 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
         }
     }
 
-    CtrlPrint::v_cerr_1 << "[" << formatted_time << "] " <<  frame_count << " FPS  " 
+    V_CERR_1 << "[" << formatTime(current_received_time) << "] " <<  frame_count << " FPS  " 
     << throughput * 8 / 1000000 << " mbps" << std::endl;
 
-    int fps_difference = ControlConfig::instance().get_fps() - frame_count;
-    if (frame_count != ControlConfig::instance().get_fps()){
+    int fps_difference = ctx.config->fps - frame_count;
+    if (frame_count != ctx.config->fps){
       frame_stats.count_frame_drop += fps_difference;
     }
 
     average_frame_rate = (average_frame_rate * received_frames_count + frame_count)/(received_frames_count + 1);
     received_frames_count++;
 
+    last_second_frames.store(frame_count, std::memory_order_relaxed);
+    last_second_bytes.store(static_cast<int64_t>(throughput), std::memory_order_relaxed);
+    TraceExporter::instance().counter("fps", current_received_time, frame_count);
+    TraceExporter::instance().counter("throughput_bytes_per_second", current_received_time,
+                                      static_cast<int64_t>(throughput));
+
     frame_count = 0;
     temp_received_time += std::chrono::seconds(1);
     throughput = 0;
@@ -139,14 +151,14 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
   graph_throughput += uvc_payload.size();
   throughput += uvc_payload.size();
 
-
-  static UVC_Payload_Header previous_previous_payload_header;
-  static UVC_Payload_Header previous_payload_header;
-  static UVC_Payload_Header temp_error_payload_header;
+  UVC_Payload_Header& previous_previous_payload_header = ctx.previous_previous_payload_header;
+  UVC_Payload_Header& previous_payload_header = ctx.previous_payload_header;
+  UVC_Payload_Header& temp_error_payload_header = ctx.temp_error_payload_header;
 
 
   UVC_Payload_Header payload_header =
       parse_uvc_payload_header(uvc_payload, received_time);
+  UVCFD_PROBE4(header_parsed, payload_header.HLE, payload_header.BFH, payload_header.PTS, uvc_payload.size());
 
   UVCError payload_header_valid_return =
       payload_header_valid(payload_header, previous_payload_header, previous_previous_payload_header);
@@ -156,15 +168,14 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
 
   if (payload_header.PTS && uvc_payload.size() > payload_header.HLE) {
     
-    // std::cerr << "CLK: " << formatted_time << std::endl;
+    // std::cerr << "CLK: " << formatTime(current_received_time) << std::endl;
     // std::cerr << "PTS: " << std::hex <<  payload_header.PTS << std::endl;
     previous_pts_chrono = current_pts_chrono;
 
     current_pts_chrono = std::chrono::time_point<std::chrono::steady_clock>(
-        std::chrono::milliseconds(payload_header.PTS / (ControlConfig::instance().get_dwTimeFrequency() / 1000)));
+        ctx.config->pts_to_milliseconds(payload_header.PTS));
 
-    const std::chrono::milliseconds PTS_OVERFLOW_THRESHOLD_MS(
-        static_cast<long long>(0xFFFFFFFFU / (ControlConfig::instance().get_dwTimeFrequency() / 1000)));
+    const std::chrono::milliseconds PTS_OVERFLOW_THRESHOLD_MS = ctx.config->pts_wrap;
     
     //overflow check
     if (previous_pts_chrono != std::chrono::time_point<std::chrono::steady_clock>()){
@@ -182,7 +193,7 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
 
     //Process(Finish) the last frame when EOF is missing
     if (payload_header_valid_return == ERR_MISSING_EOF) {
-      CtrlPrint::v_cerr_3 << "Missing EOF." << std::endl;
+      V_CERR_3 << "Missing EOF." << std::endl;
       if (!frames.empty()) {
         auto& last_frame = frames.back();
         last_frame->frame_error = ERR_FRAME_MISSING_EOF;
@@ -220,9 +231,12 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
 
 
         }
-        if (capture_error_flag && capture_image_flag){
-          last_frame->push_queue();
-        }
+        capture_frame(*last_frame, CAPTURE_ERROR,
+                      ctx.flags->capture_error_flag && ctx.flags->capture_image_flag);
+        UVCFD_PROBE4(frame_finish, last_frame->frame_number, static_cast<int>(last_frame->frame_error),
+                     static_cast<int>(last_frame->frame_suspicious), last_frame->packet_number);
+        trace_frame_finish(*last_frame);
+        finished_frames++;
         processed_frames.push_back(std::move(frames.back()));
         frames.pop_back();
         frame_count++;
@@ -256,13 +270,13 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
 
 #ifdef GUI_SET
         uvcfd_graph.getGraph_URBGraph().set_move_graph_custom_text("[ " + std::to_string(frame->frame_number) + " ]"
-            + std::to_string(ControlConfig::instance().get_width()) + "x" 
-            + std::to_string(ControlConfig::instance().get_height()) + " " 
-            + ControlConfig::instance().get_frame_format());
+            + std::to_string(ctx.config->width) + "x" 
+            + std::to_string(ctx.config->height) + " " 
+            + frame_format_name(ctx.config->format));
         // uvcfd_graph.getGraph_PTSGraph().set_move_graph_custom_text("[ " + std::to_string(frame->frame_number) + " ]"
-        //     + std::to_string(ControlConfig::instance().get_width()) + "x" 
-        //     + std::to_string(ControlConfig::instance().get_height()) + " " 
-        //     + ControlConfig::instance().get_frame_format());
+        //     + std::to_string(ctx.config->width) + "x" 
+        //     + std::to_string(ctx.config->height) + " " 
+        //     + frame_format_name(ctx.config->format));
 
         if (uvc_payload.size() > payload_header.HLE){
           uvcfd_graph.getGraph_URBGraph().plot_graph(received_time ,uvc_payload.size()-payload_header.HLE);
@@ -279,7 +293,7 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
           frame->add_received_valid_time(received_time);
 
           size_t total_payload_size = std::accumulate(frame->payload_sizes.begin(), frame->payload_sizes.end(), size_t(0));
-          if (total_payload_size > ControlConfig::instance().get_dwMaxVideoFrameSize()) {
+          if (total_payload_size > frame->stream_config->dwMaxVideoFrameSize) {
             frame->frame_error = ERR_FRAME_MAX_FRAME_OVERFLOW;  
           }
 
@@ -300,6 +314,7 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
       auto& new_frame = frames.back();
 
       new_frame->toggle_bit = payload_header.bmBFH.BFH_FID;
+      UVCFD_PROBE2(frame_open, new_frame->frame_number, new_frame->toggle_bit);
 
       if (payload_header.PTS){
         if (!previous_frame_pts) {
@@ -320,17 +335,18 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
       } else {
         new_frame->add_received_valid_time(received_time);
       }
-      new_frame->set_frame_format(ControlConfig::instance().get_width(), ControlConfig::instance().get_height(), ControlConfig::instance().get_frame_format());
+      new_frame->set_stream_config(ctx.config);
+      new_frame->payload_demand = payload_demand_mask();
 
 #ifdef GUI_SET
         uvcfd_graph.getGraph_URBGraph().set_move_graph_custom_text("[ " + std::to_string(new_frame->frame_number) + " ]"
-            + std::to_string(ControlConfig::instance().get_width()) + "x" 
-            + std::to_string(ControlConfig::instance().get_height()) + " " 
-            + ControlConfig::instance().get_frame_format());
+            + std::to_string(ctx.config->width) + "x" 
+            + std::to_string(ctx.config->height) + " " 
+            + frame_format_name(ctx.config->format));
         // uvcfd_graph.getGraph_PTSGraph().set_move_graph_custom_text("[ " + std::to_string(new_frame->frame_number) + " ]"
-        //     + std::to_string(ControlConfig::instance().get_width()) + "x" 
-        //     + std::to_string(ControlConfig::instance().get_height()) + " " 
-        //     + ControlConfig::instance().get_frame_format());
+        //     + std::to_string(ctx.config->width) + "x" 
+        //     + std::to_string(ctx.config->height) + " " 
+        //     + frame_format_name(ctx.config->format));
         uvcfd_graph.getGraph_URBGraph().count_sof();
         temp_new_frame_flag = true;
 
@@ -344,7 +360,7 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
         }
 #endif
       size_t total_payload_size = std::accumulate(new_frame->payload_sizes.begin(), new_frame->payload_sizes.end(), size_t(0));
-      if (total_payload_size > ControlConfig::instance().get_dwMaxVideoFrameSize()) {
+      if (total_payload_size > ctx.config->dwMaxVideoFrameSize) {
         new_frame->frame_error = ERR_FRAME_MAX_FRAME_OVERFLOW;
       }
 
@@ -356,7 +372,11 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
 
     //add image data here
     auto& last_frame = frames.back();
-    last_frame->add_image_data(payload_header, uvc_payload);
+    if (last_frame->keeps_payload()) {
+      last_frame->add_image_data(payload_header, uvc_payload);
+    } else if (!last_frame->payload_datas.empty()) {
+      last_frame->drop_image_data();
+    }
 
     //suspicious update
     if (suspicious_return != SUSPICIOUS_NO_SUSPICIOUS && suspicious_return != SUSPICIOUS_UNCHECKED) {
@@ -373,10 +393,11 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
       // Check the Frame width x height in here
       // For YUYV format, the width x height should be 1280 x 720 x 2 excluding
       // the headerlength If not then there is a problem with the frame
-      if (ControlConfig::instance().get_frame_format() == "yuyv") {
+      // Validate against the config the frame started under, not the latest one
+      const StreamConfig& frame_config = last_frame->stream_config ? *last_frame->stream_config : *ctx.config;
+      if (frame_config.is_yuyv()) {
         // Calculate the expected size for the YUYV frame
-        size_t expected_frame_size =
-            ControlConfig::instance().get_width() * ControlConfig::instance().get_height() * 2;
+        size_t expected_frame_size = frame_config.expected_yuyv_size;
 
         // Calculate the actual size by summing up all payload sizes and
         // subtracting the total header lengths
@@ -386,7 +407,7 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
         }
 
         if (actual_frame_size != expected_frame_size) {
-          CtrlPrint::v_cerr_2 << "[" << formatted_time << "] "
+          V_CERR_2 << "[" << formatTime(current_received_time) << "] "
                   << std::dec
                   << actual_frame_size << "/" << expected_frame_size
                   << " YUYV size mismatch"
@@ -397,8 +418,8 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
       }
 
 
-      if (filter_on_off_flag && irregular_define_flag){
-        if (ControlConfig::instance().get_frame_format() == "mjpeg"){
+      if (ctx.flags->filter_on_off_flag && ctx.flags->irregular_define_flag){
+        if (frame_config.is_mjpeg()){
           size_t total_size_sum = 0;
           size_t total_payload_count_sum = 0;
           for (const auto& frame : processed_frames) {
@@ -410,18 +431,18 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
           size_t last_frame_sum = std::accumulate(last_frame->payload_sizes.begin(), last_frame->payload_sizes.end(), size_t(0));
           if (last_frame_sum < average_size * 0.9) {
             last_frame->frame_suspicious = SUSPICIOUS_FRAME_SIZE_INCONSISTENT;
-            CtrlPrint::v_cout_2 << "[" << formatted_time << "] " << "Inconsistent frame size detected." << std::endl;
+            V_COUT_2 << "[" << formatTime(current_received_time) << "] " << "Inconsistent frame size detected." << std::endl;
           }
 
-          if (total_size_sum < ControlConfig::instance().get_height() * ControlConfig::instance().get_width() * 2 * 0.05) {
+          if (total_size_sum < frame_config.expected_yuyv_size * 0.05) {
             last_frame->frame_suspicious = SUSPICIOUS_OVERCOMPRESSED;
-            CtrlPrint::v_cout_2 << "[" << formatted_time << "] " << "Overcompressed frame detected." << std::endl;
+            V_COUT_2 << "[" << formatTime(current_received_time) << "] " << "Overcompressed frame detected." << std::endl;
           }
 
           double average_payload_count = static_cast<double>(total_payload_count_sum) / processed_frames.size();
           if (last_frame->packet_number < average_payload_count) {
             last_frame->frame_suspicious = SUSPICIOUS_PAYLOAD_COUNT_INCONSISTENT;
-            CtrlPrint::v_cout_2 << "[" << formatted_time << "] " << "Inconsistent payload count detected." << std::endl;
+            V_COUT_2 << "[" << formatTime(current_received_time) << "] " << "Inconsistent payload count detected." << std::endl;
           }
 
         }
@@ -459,9 +480,8 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
         plot_received_chrono_times(last_frame->received_valid_times, last_frame->received_error_times);
 #endif
 
-        if (capture_error_flag && capture_image_flag){
-          last_frame->push_queue();
-        }
+        capture_frame(*last_frame, CAPTURE_ERROR,
+                      ctx.flags->capture_error_flag && ctx.flags->capture_image_flag);
       } else if (last_frame->frame_suspicious && last_frame->frame_suspicious != SUSPICIOUS_UNCHECKED) {
       
         update_suspicious_stats(last_frame->frame_suspicious);
@@ -478,18 +498,20 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
         
         frame_suspicious_flag = false;
 #endif
-        if (capture_suspicious_flag && capture_image_flag){
-          last_frame->push_queue();
-        }
+        capture_frame(*last_frame, CAPTURE_SUSPICIOUS,
+                      ctx.flags->capture_suspicious_flag && ctx.flags->capture_image_flag);
 
       }else{
 
       update_suspicious_stats(last_frame->frame_suspicious);
       print_frame_data(*last_frame);
-        if (capture_valid_flag && capture_image_flag){
-          last_frame->push_queue();
-        }
+        capture_frame(*last_frame, CAPTURE_VALID,
+                      ctx.flags->capture_valid_flag && ctx.flags->capture_image_flag);
       }
+      UVCFD_PROBE4(frame_finish, last_frame->frame_number, static_cast<int>(last_frame->frame_error),
+                   static_cast<int>(last_frame->frame_suspicious), last_frame->packet_number);
+      trace_frame_finish(*last_frame);
+      finished_frames++;
       processed_frames.push_back(std::move(frames.back()));
       frames.pop_back();
       frame_count++;
@@ -504,10 +526,10 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
     previous_payload_header = payload_header;
     previous_previous_payload_header = previous_payload_header;
     temp_error_payload_header = {};
-    p_formatted_time = formatted_time;
-    e_formatted_time = "";
+    p_received_time = current_received_time;
+    e_received_time = {};
 
-    update_payload_error_stat(payload_header_valid_return);
+    update_payload_error_stat(payload_header_valid_return, uvc_payload.size());
 
     return payload_header_valid_return;
 
@@ -533,21 +555,23 @@ uint8_t UVCPHeaderChecker::payload_valid_ctrl(
     //   }
     // }
 #else
-    auto& last_frame = frames.back();
-    plot_received_chrono_times(last_frame->received_valid_times, last_frame->received_error_times);
+    if (!frames.empty()) {
+      auto& last_frame = frames.back();
+      plot_received_chrono_times(last_frame->received_valid_times, last_frame->received_error_times);
+    }
 #endif
 
     print_error_bits(previous_payload_header, temp_error_payload_header ,payload_header);
 
     temp_error_payload_header = payload_header;
-    e_formatted_time = formatted_time;
+    e_received_time = current_received_time;
 
-    update_payload_error_stat(payload_header_valid_return);
+    update_payload_error_stat(payload_header_valid_return, uvc_payload.size());
 
     return payload_header_valid_return;
   }
 
-  update_payload_error_stat(ERR_UNKNOWN);
+  update_payload_error_stat(ERR_UNKNOWN, uvc_payload.size());
   return ERR_UNKNOWN;
 }
 
@@ -558,23 +582,31 @@ void UVCPHeaderChecker::control_configuration_ctrl(int vendor_id, int product_id
   
   ControlConfig& control_config = ControlConfig::instance();
 
-  control_config.set_vendor_id(vendor_id);
-  control_config.set_product_id(product_id);
-  control_config.set_device_name(device_name);        
-  control_config.set_width(width);
-  control_config.set_height(height);
-  control_config.set_fps(fps);
-  control_config.set_frame_format(frame_format);
-  control_config.set_dwMaxVideoFrameSize(max_frame_size);
-  control_config.set_dwMaxPayloadTransferSize(max_payload_size);
-  control_config.set_dwTimeFrequency(time_frequency);
-
-  if (control_config.get_vendor_id() == 0x054c && control_config.get_product_id() == 0x0e4f){
-    control_config.set_dwTimeFrequency(time_frequency / 1000);
+  // Build the whole probe/commit result and publish it as one version,
+  // frames already in flight keep the version they started with
+  StreamConfig next = *control_config.current();
+  next.vendor_id = vendor_id;
+  next.product_id = product_id;
+  next.device_name = device_name;
+  next.width = width;
+  next.height = height;
+  next.fps = fps;
+  if (!parse_frame_format(frame_format, next.format)) {
+    V_CERR_1 << "Unsupported frame format: " << frame_format
+             << ". Using default format 'mjpeg'." << std::endl;
+    next.format = FRAME_FORMAT_MJPEG;
+  }
+  next.dwMaxVideoFrameSize = max_frame_size;
+  next.dwMaxPayloadTransferSize = max_payload_size;
+  next.dwTimeFrequency = time_frequency;
+
+  if (next.vendor_id == 0x054c && next.product_id == 0x0e4f){
+    next.dwTimeFrequency = time_frequency / 1000;
   }
 
-  received_time_clock = std::chrono::duration_cast<std::chrono::milliseconds>(received_time.time_since_epoch()).count();
-  formatted_time = formatTime(std::chrono::milliseconds(received_time_clock));
+  ctx.config = control_config.publish(next);
+
+  current_received_time = received_time;
   int control_last_frame_number;
 
   if (!frames.empty()) {
@@ -585,17 +617,18 @@ void UVCPHeaderChecker::control_configuration_ctrl(int vendor_id, int product_id
   }
   std::ostringstream logStream;
   logStream << "[ " << control_last_frame_number << " ]\n";
-  logStream << "[ " << formatted_time << " ]\n";
-  logStream << "vendor_id: 0x" << std::setw(4) << std::setfill('0') << std::hex << control_config.get_vendor_id() << std::dec << "\n";
-  logStream << "product_id: 0x" << std::setw(4) << std::setfill('0') << std::hex << control_config.get_product_id() << std::dec << "\n";
-  logStream << "device_name: " << control_config.get_device_name() << "\n";
-  logStream << "width: " << control_config.get_width() << "\n";
-  logStream << "height: " << control_config.get_height() << "\n";
-  logStream << "frame_format: " << control_config.get_frame_format() << "\n";
-  logStream << "fps: " << control_config.get_fps() << "\n";
-  logStream << "max_frame_size: " << control_config.get_dwMaxVideoFrameSize() << "\n";
-  logStream << "max_payload_size: " << control_config.get_dwMaxPayloadTransferSize() << "\n";
-  logStream << "time_frequency: " << control_config.get_dwTimeFrequency() << "\n";
+  logStream << "[ " << formatTime(current_received_time) << " ]\n";
+  logStream << "vendor_id: 0x" << std::setw(4) << std::setfill('0') << std::hex << ctx.config->vendor_id << std::dec << "\n";
+  logStream << "product_id: 0x" << std::setw(4) << std::setfill('0') << std::hex << ctx.config->product_id << std::dec << "\n";
+  logStream << "device_name: " << ctx.config->device_name << "\n";
+  logStream << "width: " << ctx.config->width << "\n";
+  logStream << "height: " << ctx.config->height << "\n";
+  logStream << "frame_format: " << frame_format_name(ctx.config->format) << "\n";
+  logStream << "fps: " << ctx.config->fps << "\n";
+  logStream << "max_frame_size: " << ctx.config->dwMaxVideoFrameSize << "\n";
+  logStream << "max_payload_size: " << ctx.config->dwMaxPayloadTransferSize << "\n";
+  logStream << "time_frequency: " << ctx.config->dwTimeFrequency << "\n";
+  logStream << "config_version: " << ctx.config->version << "\n";
   logStream << "\n";
 
 #ifdef GUI_SET
@@ -613,7 +646,7 @@ UVC_Payload_Header UVCPHeaderChecker::parse_uvc_payload_header(
 
   UVC_Payload_Header payload_header = {};
   if (uvc_payload.size() < 2) {
-    // CtrlPrint::v_cerr_2 << "Error: UVC payload size is too small." << std::endl;
+    // V_CERR_2 << "Error: UVC payload size is too small." << std::endl;
     //save_payload_header_to_log(payload_header, received_time);
     return payload_header;  // check if payload is too small for payload header
   }
@@ -656,13 +689,13 @@ UVCError UVCPHeaderChecker::payload_header_valid(
 
   // Checks if the Error bit is set
   if (payload_header.bmBFH.BFH_ERR) {
-    CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "Error bit is set." << std::endl;
+    V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "Error bit is set." << std::endl;
     return ERR_ERR_BIT_SET;
   }
 
   // Checks if the header length is valid
   if (payload_header.HLE < 0x02 || payload_header.HLE > 0x0C) {
-    CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "Unexpected start byte 0x"
+    V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "Unexpected start byte 0x"
                 << std::hex << std::setw(2) << std::setfill('0')
                 << static_cast<int>(payload_header.HLE) << "." << std::endl;
     return ERR_LENGTH_OUT_OF_RANGE; 
@@ -672,26 +705,26 @@ UVCError UVCPHeaderChecker::payload_header_valid(
   // Checks if the Source Clock Reference bit is set
   if (payload_header.bmBFH.BFH_PTS && payload_header.bmBFH.BFH_SCR &&
       payload_header.HLE != 0x0C) {
-    CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " <<"Both Presentation Time Stamp and "
+    V_CERR_2 << "[" << formatTime(current_received_time) << "] " <<"Both Presentation Time Stamp and "
                 "Source Clock Reference bits are set."
                 << std::endl;
     return ERR_LENGTH_INVALID;
   } else if (payload_header.bmBFH.BFH_PTS && !payload_header.bmBFH.BFH_SCR &&
              payload_header.HLE != 0x06) {
-    CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "Presentation Time Stamp bit is "
+    V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "Presentation Time Stamp bit is "
                 "set but header length is less than 6."
                  << std::endl;
     return ERR_LENGTH_INVALID;
   } else if (!payload_header.bmBFH.BFH_PTS && payload_header.bmBFH.BFH_SCR &&
              payload_header.HLE != 0x08) {
-    CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "Source Clock Reference bit is "
+    V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "Source Clock Reference bit is "
                 "set but header length is less than 12."
                 << std::endl;
     return ERR_LENGTH_INVALID;
   } else if (!payload_header.bmBFH.BFH_PTS && !payload_header.bmBFH.BFH_SCR &&
              payload_header.HLE != 0x02) {
-    CtrlPrint::v_cerr_2
-        << "[" << formatted_time << "] " << "Neither Presentation Time Stamp nor "
+    V_CERR_2
+        << "[" << formatTime(current_received_time) << "] " << "Neither Presentation Time Stamp nor "
            "Source Clock Reference bits are set but header length is not 2."
         << std::endl;
     return ERR_LENGTH_INVALID;
@@ -702,7 +735,7 @@ UVCError UVCPHeaderChecker::payload_header_valid(
   if (payload_header.bmBFH.BFH_EOF) {
   } else {
     if (payload_header.bmBFH.BFH_RES) {
-      CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "Reserved bit is set."
+      V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "Reserved bit is set."
                << std::endl;
       return ERR_RESERVED_BIT_SET;
     }
@@ -714,20 +747,20 @@ UVCError UVCPHeaderChecker::payload_header_valid(
         previous_payload_header.bmBFH.BFH_EOF && 
         (payload_header.PTS == previous_payload_header.PTS) && 
         payload_header.PTS != 0) {
-        CtrlPrint::v_cerr_2 << "[" << formatted_time << "] Same FID "
+        V_CERR_2 << "[" << formatTime(current_received_time) << "] Same FID "
                     "and prev frame and PTS matches0. "  << std::endl;
         return ERR_SWAP;
 
   } else if (payload_header.bmBFH.BFH_FID == previous_payload_header.bmBFH.BFH_FID && 
             previous_payload_header.bmBFH.BFH_EOF &&  previous_payload_header.HLE !=0) {
-      CtrlPrint::v_cerr_2 << "[" << formatted_time << "] Same FID "
+      V_CERR_2 << "[" << formatTime(current_received_time) << "] Same FID "
                   "and prev frame EOF is set."  << std::endl;
       return ERR_FID_MISMATCH;
 
   } else if (payload_header.bmBFH.BFH_FID != previous_payload_header.bmBFH.BFH_FID && 
             !previous_payload_header.bmBFH.BFH_EOF && 
             previous_payload_header.HLE != 0) {
-      CtrlPrint::v_cerr_2  << "[" << formatted_time << "] Missing EOF.   " << std::endl;
+      V_CERR_2  << "[" << formatTime(current_received_time) << "] Missing EOF.   " << std::endl;
       return ERR_MISSING_EOF;      
   } 
 
@@ -735,33 +768,33 @@ UVCError UVCPHeaderChecker::payload_header_valid(
 
   // //Checks if the End of Header bit is set 0 for iso and 1 for bulk
   // if (!payload_header.bmBFH.BFH_EOH) {
-  //     CtrlPrint::v_cerr_2 << " : End of Header (EOH) bit is
+  //     V_CERR_2 << " : End of Header (EOH) bit is
   //     not set." << std::endl; return 1;
   // }
 
-  // CtrlPrint::v_cout_2 << "UVC payload header is valid." << std::endl;
+  // V_COUT_2 << "UVC payload header is valid." << std::endl;
   return ERR_NO_ERROR;
 }
 
 FrameSuspicious UVCPHeaderChecker::frame_suspicious_check(const UVC_Payload_Header& payload_header, const UVC_Payload_Header& previous_payload_header, const UVC_Payload_Header& previous_previous_payload_header){
-  if (!filter_on_off_flag){
+  if (!ctx.flags->filter_on_off_flag){
     return SUSPICIOUS_UNCHECKED;
   }
   
-  if (pts_decrease_filter_flag){  
+  if (ctx.flags->pts_decrease_filter_flag){  
     if (payload_header.PTS != 0 && previous_payload_header.PTS != 0 &&
         payload_header.PTS < previous_payload_header.PTS && 
         (previous_payload_header.PTS - payload_header.PTS) < 0x80000000) {
-      CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "PTS decreased."  << std::endl;
+      V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "PTS decreased."  << std::endl;
       return SUSPICIOUS_PTS_DECREASE;
     }
   }
 
-  if (stc_decrease_filter_flag){
+  if (ctx.flags->stc_decrease_filter_flag){
     if (payload_header.bmSCR.SCR_STC != 0 && previous_payload_header.bmSCR.SCR_STC != 0 &&
         payload_header.bmSCR.SCR_STC < previous_payload_header.bmSCR.SCR_STC &&
         (previous_payload_header.bmSCR.SCR_STC - payload_header.bmSCR.SCR_STC) < 0x80000000) {
-      CtrlPrint::v_cerr_2 << "[" << formatted_time << "] " << "STC decreased." << std::endl;
+      V_CERR_2 << "[" << formatTime(current_received_time) << "] " << "STC decreased." << std::endl;
       return SUSPICIOUS_SCR_STC_DECREASE;
     }
   }
@@ -771,35 +804,36 @@ FrameSuspicious UVCPHeaderChecker::frame_suspicious_check(const UVC_Payload_Head
 
 
 void UVCPHeaderChecker::print_error_bits(const UVC_Payload_Header& previous_payload_header, const UVC_Payload_Header& temp_error_payload_header, const UVC_Payload_Header& payload_header) {
-    // CtrlPrint::v_cout_2 << "Frame Error Type__: " << frame_error << std::endl;
+  if (!VERBOSE_ON(2)) return;
+    // V_COUT_2 << "Frame Error Type__: " << frame_error << std::endl;
 
 #ifdef GUI_SET
   frame_error_flag = true;
   gui_window_number = WIN_PREVIOUS_VALID;
   print_whole_flag = true;
 #endif
-    CtrlPrint::v_cout_2 << "[" << p_formatted_time << "] \n\n" << previous_payload_header << "\n" <<  std::endl;
+    V_COUT_2 << "[" << formatTime(p_received_time) << "] \n\n" << previous_payload_header << "\n" <<  std::endl;
 
 #ifdef GUI_SET
   gui_window_number = WIN_LOST_IN_BETWEEN_ERROR;
 #endif
-if (!e_formatted_time.empty()) {
-    CtrlPrint::v_cout_2 << "[" << e_formatted_time << "] \n\n" << temp_error_payload_header << "\n" <<  std::endl;
+if (e_received_time != std::chrono::time_point<std::chrono::steady_clock>()) {
+    V_COUT_2 << "[" << formatTime(e_received_time) << "] \n\n" << temp_error_payload_header << "\n" <<  std::endl;
 } else {
-    CtrlPrint::v_cout_2 << "-" << std::endl;
+    V_COUT_2 << "-" << std::endl;
 }
 
 #ifdef GUI_SET
   gui_window_number = WIN_CURRENT_ERROR;
 #endif
-    CtrlPrint::v_cout_2 << "[" << formatted_time << "] \n\n" << payload_header << "\n" <<  std::endl;
+    V_COUT_2 << "[" << formatTime(current_received_time) << "] \n\n" << payload_header << "\n" <<  std::endl;
 
 #ifdef GUI_SET
   gui_window_number = WIN_DEBUG;
   print_whole_flag = false;
   frame_error_flag = false;
 #else
-    CtrlPrint::v_cout_2 <<  std::endl;
+    V_COUT_2 <<  std::endl;
 #endif
 }
 
@@ -830,6 +864,8 @@ std::ostream& operator<<(std::ostream& os, const UVC_Payload_Header& header) {
 }
 
 void UVCPHeaderChecker::print_received_times(const ValidFrame& frame) {
+    if (!VERBOSE_ON(2)) return;
+
 #ifdef GUI_SET
     gui_window_number = WIN_FRAME_TIME;
 #endif
@@ -841,36 +877,34 @@ void UVCPHeaderChecker::print_received_times(const ValidFrame& frame) {
     });
 
     // Print sorted times with labels and matching payload sizes
-    CtrlPrint::v_cout_2 << "[ " << frame.frame_number << " ] \n";
+    V_COUT_2 << "[ " << frame.frame_number << " ] \n";
 
     for (size_t i = 0; i < sorted_times.size(); ++i) {
         auto time_point = std::get<0>(sorted_times[i]);
         bool is_valid = std::get<1>(sorted_times[i]);
 
-        auto formatted_time = formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch()));
-
-        CtrlPrint::v_cout_2 << "[" << formatted_time << "] " 
+        V_COUT_2 << "[" << formatTime(time_point) << "] " 
                             << (is_valid ? "[Valid]" : "[Error]");
 
         // Match with payload size if available
         if (i < frame.payload_sizes.size()) {
-            CtrlPrint::v_cout_2 << " Payload Size: " << frame.payload_sizes[i];
+            V_COUT_2 << " Payload Size: " << frame.payload_sizes[i];
         }
 
-        CtrlPrint::v_cout_2 << "\n";
+        V_COUT_2 << "\n";
     }
 
     if (!sorted_times.empty()) {
         auto first_time = std::get<0>(sorted_times.front());
         auto last_time = std::get<0>(sorted_times.back());
         auto time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(last_time - first_time).count();
-        CtrlPrint::v_cout_2 << "Time Taken: " << time_diff << " ms" << "\n";
+        V_COUT_2 << "Time Taken: " << time_diff << " ms" << "\n";
     }
 
     // Calculate total payload size
     size_t total_payload_size = std::accumulate(frame.payload_sizes.begin(), frame.payload_sizes.end(), size_t(0));
-    CtrlPrint::v_cout_2 << "Total Size: " << total_payload_size << " bytes";
-    CtrlPrint::v_cout_2 << "\n\n" << std::endl;
+    V_COUT_2 << "Total Size: " << total_payload_size << " bytes";
+    V_COUT_2 << "\n\n" << std::endl;
 
 #ifdef GUI_SET
     gui_window_number = WIN_DEBUG;
@@ -878,6 +912,132 @@ void UVCPHeaderChecker::print_received_times(const ValidFrame& frame) {
 }
 
 
+void UVCPHeaderChecker::collect_metrics(MetricsWriter& out) const {
+  const std::string id = std::to_string(checker_id);
+
+  out.counter("uvcfd_payloads_total", "UVC payloads handed to the checker", {{"checker", id}},
+              received_payloads.value());
+  out.counter("uvcfd_payload_bytes_total", "UVC payload bytes handed to the checker, headers included", {{"checker", id}},
+              received_bytes.value());
+  out.gauge("uvcfd_frames_last_second", "Frames completed in the last full second", {{"checker", id}},
+            static_cast<double>(last_second_frames.load(std::memory_order_relaxed)));
+  out.gauge("uvcfd_bytes_last_second", "Payload bytes received in the last full second", {{"checker", id}},
+            static_cast<double>(last_second_bytes.load(std::memory_order_relaxed)));
+  out.counter("uvcfd_frames_total", "Frames completed by the checker", {{"checker", id}},
+              finished_frames.value());
+
+#ifdef ALLOC_STATS
+  // Validation allocations are process wide; with one checker per process the ratio is exact
+  const double validate_allocations =
+      static_cast<double>(AllocStats::instance().stage_counts(STAGE_VALIDATE).allocations);
+  out.gauge("uvcfd_validate_allocations_per_payload", "Heap allocations in payload_valid_ctrl per payload",
+            {{"checker", id}}, validate_allocations / std::max<int64_t>(received_payloads.value(), 1));
+  out.gauge("uvcfd_validate_allocations_per_frame", "Heap allocations in payload_valid_ctrl per completed frame",
+            {{"checker", id}}, validate_allocations / std::max<int64_t>(finished_frames.value(), 1));
+#endif
+
+  const PayloadErrorCounts payload_counts = payload_stats.snapshot();
+#define UVC_METRIC_PAYLOAD(field, metric, label) \
+  out.counter("uvcfd_payload_errors_total", "Payloads by validation result", {{"checker", id}, {"error", metric}}, payload_counts.field);
+  UVC_PAYLOAD_ERROR_COUNTERS(UVC_METRIC_PAYLOAD)
+#undef UVC_METRIC_PAYLOAD
+
+  const FrameErrorCounts frame_counts = frame_stats.snapshot();
+#define UVC_METRIC_FRAME(field, metric, label) \
+  out.counter("uvcfd_frame_errors_total", "Frames by validation result", {{"checker", id}, {"error", metric}}, frame_counts.field);
+  UVC_FRAME_ERROR_COUNTERS(UVC_METRIC_FRAME)
+#undef UVC_METRIC_FRAME
+
+  const FrameSuspiciousCounts suspicious_counts = frame_suspicious_stats.snapshot();
+#define UVC_METRIC_SUSPICIOUS(field, metric, label) \
+  out.counter("uvcfd_frame_suspicious_total", "Frames by suspicious check result", {{"checker", id}, {"kind", metric}}, suspicious_counts.field);
+  UVC_FRAME_SUSPICIOUS_COUNTERS(UVC_METRIC_SUSPICIOUS)
+#undef UVC_METRIC_SUSPICIOUS
+  out.counter("uvcfd_frame_suspicious_total", "Frames by suspicious check result", {{"checker", id}, {"kind", "unchecked"}},
+              suspicious_counts.count_unchecked);
+
+  for (int category = 0; category < CAPTURE_CATEGORY_COUNT; ++category) {
+    const CaptureCounts counts = capture_policies[category].counts();
+    const char* name = capture_category_name(static_cast<CaptureCategory>(category));
+    out.counter("uvcfd_capture_frames_total", "Frames offered to the capture policy by outcome",
+                {{"checker", id}, {"category", name}, {"outcome", "sampled"}}, counts.sampled);
+    out.counter("uvcfd_capture_frames_total", "Frames offered to the capture policy by outcome",
+                {{"checker", id}, {"category", name}, {"outcome", "skipped"}}, counts.skipped);
+  }
+}
+
+void UVCPHeaderChecker::capture_frame(ValidFrame& frame, CaptureCategory category, bool enabled) {
+  for (int other = 0; other < CAPTURE_CATEGORY_COUNT; ++other) {
+    if (other != category) {
+      capture_policies[other].interrupt();
+    }
+  }
+  queue_captures(false);
+
+  // A frame opened before its category was switched on does not have all of its bytes
+  if (enabled && (frame.payload_demand & (1u << category))) {
+    CapturePolicy& policy = capture_policies[category];
+    switch (policy.decide(current_received_time)) {
+      case CAPTURE_NOW:
+        frame.push_queue();
+        break;
+      case CAPTURE_HOLD:
+        policy.hold(frame.take_develop_job());
+        break;
+      case CAPTURE_SKIP:
+        break;
+    }
+  }
+  frame.drop_image_data();
+}
+
+unsigned UVCPHeaderChecker::payload_demand_mask() const {
+  unsigned mask = PayloadDemand::instance().mask();
+  if (ctx.flags->capture_image_flag) {
+    if (ctx.flags->capture_error_flag) mask |= 1u << CAPTURE_ERROR;
+    if (ctx.flags->capture_suspicious_flag) mask |= 1u << CAPTURE_SUSPICIOUS;
+    if (ctx.flags->capture_valid_flag) mask |= 1u << CAPTURE_VALID;
+  }
+  return mask;
+}
+
+void UVCPHeaderChecker::queue_captures(bool flush) {
+  for (CapturePolicy& policy : capture_policies) {
+    policy.release(current_received_time, capture_released, flush);
+  }
+  for (DevelopJob& job : capture_released) {
+    // Latency is measured from the release, not from the time the frame was held back
+    job.format.queued_tick = PIPELINE_STAMP();
+    DevFImage::instance().queue_frame(job.format, std::move(job.data));
+  }
+  capture_released.clear();
+}
+
+void UVCPHeaderChecker::trace_frame_finish(const ValidFrame& frame) {
+  TraceExporter& trace = TraceExporter::instance();
+  if (!trace.enabled() || frame.received_chrono_times.empty()) {
+    return;
+  }
+
+  TraceFrameState state = TRACE_FRAME_VALID;
+  if (frame.frame_error != ERR_FRAME_NO_ERROR) {
+    state = TRACE_FRAME_ERROR;
+  } else if (frame.frame_suspicious != SUSPICIOUS_NO_SUSPICIOUS && frame.frame_suspicious != SUSPICIOUS_UNCHECKED) {
+    state = TRACE_FRAME_SUSPICIOUS;
+  }
+
+  const auto first_payload = std::get<0>(frame.received_chrono_times.front());
+  const uint64_t frame_bytes = std::accumulate(frame.payload_sizes.begin(), frame.payload_sizes.end(), uint64_t(0));
+  trace.frame(frame.frame_number, first_payload, current_received_time, state,
+              static_cast<int>(frame.frame_error), static_cast<int>(frame.frame_suspicious),
+              frame.packet_number, frame_bytes);
+
+  // final_pts_chrono is the wrap corrected PTS of the payload that closed the frame
+  if (frame.frame_pts != 0) {
+    trace.device_time(frame.frame_number, first_payload, final_pts_chrono);
+  }
+}
+
 void UVCPHeaderChecker::print_stats() const {
 #ifdef GUI_SET
   gui_window_number = WIN_STATISTICS;
@@ -887,7 +1047,25 @@ void UVCPHeaderChecker::print_stats() const {
     payload_stats.print_stats();
     frame_stats.print_stats();
     frame_suspicious_stats.print_stats();
-    CtrlPrint::v_cout_1 << std::flush;
+    V_COUT_1 << "\nCapture Statistics:\n";
+    for (int category = 0; category < CAPTURE_CATEGORY_COUNT; ++category) {
+      const CaptureCounts counts = capture_policies[category].counts();
+      V_COUT_1 << capture_category_name(static_cast<CaptureCategory>(category))
+               << " (" << capture_policy_name(capture_policies[category].config()) << "): sampled "
+               << counts.sampled << ", skipped " << counts.skipped << ", held " << counts.held << "\n";
+    }
+    PIPELINE_LATENCY_ONLY(PipelineLatency::instance().print_stats();)
+#ifdef ALLOC_STATS
+    {
+      const uint64_t validate_allocations = AllocStats::instance().stage_counts(STAGE_VALIDATE).allocations;
+      AllocStats::instance().print_stats();
+      V_COUT_1 << "validate allocations per payload: "
+               << static_cast<double>(validate_allocations) / std::max<int64_t>(received_payloads.value(), 1)
+               << ", per frame: "
+               << static_cast<double>(validate_allocations) / std::max<int64_t>(finished_frames.value(), 1) << "\n";
+    }
+#endif
+    V_COUT_1 << std::flush;
 
 #ifdef GUI_SET
     print_whole_flag = false;
@@ -896,6 +1074,44 @@ void UVCPHeaderChecker::print_stats() const {
 }
 
 void UVCPHeaderChecker::print_frame_data(const ValidFrame& frame) {
+    // A frame made only of error payloads has no valid times to measure from
+    if (frame.received_valid_times.empty()) {
+        if (!VERBOSE_ON(2)) return;
+#ifdef GUI_SET
+        gui_window_number = ((frame.frame_error || frame.frame_suspicious) && frame.frame_suspicious != SUSPICIOUS_UNCHECKED)
+            ? WIN_ERROR_FRAME : WIN_VALID_FRAME;
+#endif
+        V_COUT_2 << "[ " << frame.frame_number << " ]"<< "\n";
+        V_COUT_2 << "No Valid Times Recorded" << "\n" << std::endl;
+#ifdef GUI_SET
+        gui_window_number = WIN_DEBUG;
+#endif
+        return;
+    }
+
+    // PTS wrap and first gap history advance on every frame, printed or not
+    const StreamConfig& frame_config = frame.stream_config ? *frame.stream_config : *ctx.config;
+    std::chrono::time_point<std::chrono::steady_clock> start_frame_pts_chrono = std::chrono::time_point<std::chrono::steady_clock>(
+        frame_config.pts_to_milliseconds(frame.frame_pts));
+    std::chrono::time_point<std::chrono::steady_clock> previous_frame_pts_chrono = std::chrono::time_point<std::chrono::steady_clock>(
+        frame_config.pts_to_milliseconds(frame.prev_frame_pts));
+
+    std::chrono::milliseconds& stack_overflow_pts = ctx.stack_overflow_pts;
+    const std::chrono::milliseconds PTS_OVERFLOW_THRESHOLD_MS = frame_config.pts_wrap;
+    if (start_frame_pts_chrono < previous_frame_pts_chrono) {
+      stack_overflow_pts += std::chrono::milliseconds(PTS_OVERFLOW_THRESHOLD_MS);
+    }
+    start_frame_pts_chrono += stack_overflow_pts;
+
+    auto now_gap = std::chrono::duration_cast<std::chrono::milliseconds>(frame.received_valid_times.front().time_since_epoch()-start_frame_pts_chrono.time_since_epoch());
+    if (!ctx.very_first_gap_set) {
+      ctx.very_first_gap = now_gap;
+      ctx.very_first_gap_set = true;
+    }
+
+    // Runs for every finished frame; nothing below is formatted unless it is printed
+    if (!VERBOSE_ON(2)) return;
+
 #ifdef GUI_SET
   if ((frame.frame_error || frame.frame_suspicious) && frame.frame_suspicious != SUSPICIOUS_UNCHECKED) {
     gui_window_number = WIN_ERROR_FRAME;
@@ -904,7 +1120,7 @@ void UVCPHeaderChecker::print_frame_data(const ValidFrame& frame) {
   }
 #endif
 
-    CtrlPrint::v_cout_2 << "[ " << frame.frame_number << " ]"<< "\n";
+    V_COUT_2 << "[ " << frame.frame_number << " ]"<< "\n";
 
     // Calculate time taken from valid start to the last of error or valid times
     // if (!frame.received_valid_times.empty()) {
@@ -919,109 +1135,94 @@ void UVCPHeaderChecker::print_frame_data(const ValidFrame& frame) {
         auto valid_start_ms = formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(valid_start.time_since_epoch()));
         auto final_end_ms = formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(final_end.time_since_epoch()));
 
-        CtrlPrint::v_cout_2 << "[ " << valid_start_ms << "  ~ " << final_end_ms << "  ]: " << time_taken << " ms" << "\n";
+        V_COUT_2 << "[ " << valid_start_ms << "  ~ " << final_end_ms << "  ]: " << time_taken << " ms" << "\n";
     // } else {
-    //     CtrlPrint::v_cout_2 << "No Valid Times Recorded" << "\n";
+    //     V_COUT_2 << "No Valid Times Recorded" << "\n";
     // }
 
-    CtrlPrint::v_cout_2 << "Toggle Bit (FID): " << static_cast<int>(frame.toggle_bit) << "\n";
-    CtrlPrint::v_cout_2 << "Payload Count: " << frame.packet_number << "\n";
-    CtrlPrint::v_cout_2 << "Frame PTS: " << frame.frame_pts << "\n";
-    // CtrlPrint::v_cout_2 << "Prev Frame PTS: " << frame.prev_frame_pts << "\n";
+    V_COUT_2 << "Toggle Bit (FID): " << static_cast<int>(frame.toggle_bit) << "\n";
+    V_COUT_2 << "Payload Count: " << frame.packet_number << "\n";
+    V_COUT_2 << "Frame PTS: " << frame.frame_pts << "\n";
+    // V_COUT_2 << "Prev Frame PTS: " << frame.prev_frame_pts << "\n";
     // Print Frame Error directly with switch statement
-    CtrlPrint::v_cout_2 << "Frame Error: ";
+    V_COUT_2 << "Frame Error: ";
     switch (frame.frame_error) {
         case ERR_FRAME_NO_ERROR:
-            CtrlPrint::v_cout_2 << "No Error";
+            V_COUT_2 << "No Error";
             break;
         case ERR_FRAME_DROP:
-            CtrlPrint::v_cout_2 << "Frame Drop";
+            V_COUT_2 << "Frame Drop";
             break;
         case ERR_FRAME_ERROR:
-            CtrlPrint::v_cout_2 << "Frame Error by Payload Header";
+            V_COUT_2 << "Frame Error by Payload Header";
             break;
         case ERR_FRAME_MAX_FRAME_OVERFLOW:
-            CtrlPrint::v_cout_2 << "Max Frame Overflow";
+            V_COUT_2 << "Max Frame Overflow";
             break;
         case ERR_FRAME_INVALID_YUYV_RAW_SIZE:
-            CtrlPrint::v_cout_2 << "Invalid YUYV Raw Size";
+            V_COUT_2 << "Invalid YUYV Raw Size";
             break;
         case ERR_FRAME_SAME_DIFFERENT_PTS:
-            CtrlPrint::v_cout_2 << "Same Different PTS";
+            V_COUT_2 << "Same Different PTS";
             break;
         case ERR_FRAME_MISSING_EOF:
-            CtrlPrint::v_cout_2 << "Missing EOF";
+            V_COUT_2 << "Missing EOF";
             break;
         case ERR_FRAME_FID_MISMATCH:
-            CtrlPrint::v_cout_2 << "Frame FID Mismatch";
+            V_COUT_2 << "Frame FID Mismatch";
             break;
         default:
-            CtrlPrint::v_cout_2 << "Unknown Error";
+            V_COUT_2 << "Unknown Error";
             break;
     }
-    CtrlPrint::v_cout_2 << "\n";
-    CtrlPrint::v_cout_2 << "Frame Suspicious: ";
+    V_COUT_2 << "\n";
+    V_COUT_2 << "Frame Suspicious: ";
     switch (frame.frame_suspicious) {
         case SUSPICIOUS_NO_SUSPICIOUS:
-            CtrlPrint::v_cout_2 << "No Suspicious";
+            V_COUT_2 << "No Suspicious";
             break;
         case SUSPICIOUS_PAYLOAD_TIME_INCONSISTENT:
-            CtrlPrint::v_cout_2 << "Payload Time Inconsistent";
+            V_COUT_2 << "Payload Time Inconsistent";
             break;
         case SUSPICIOUS_FRAME_SIZE_INCONSISTENT:
-            CtrlPrint::v_cout_2 << "Frame Size Inconsistent";
+            V_COUT_2 << "Frame Size Inconsistent";
             break;
         case SUSPICIOUS_PAYLOAD_COUNT_INCONSISTENT:
-            CtrlPrint::v_cout_2 << "Payload Count Inconsistent";
+            V_COUT_2 << "Payload Count Inconsistent";
             break;
         case SUSPICIOUS_PTS_DECREASE:
-            CtrlPrint::v_cout_2 << "PTS Decrease";
+            V_COUT_2 << "PTS Decrease";
             break;
         case SUSPICIOUS_SCR_STC_DECREASE:
-            CtrlPrint::v_cout_2 << "SCR STC Decrease";
+            V_COUT_2 << "SCR STC Decrease";
             break;
         case SUSPICIOUS_OVERCOMPRESSED:
-            CtrlPrint::v_cout_2 << "Overcompressed";
+            V_COUT_2 << "Overcompressed";
             break;
         case SUSPICIOUS_ERROR_CHECKED:
-            CtrlPrint::v_cout_2 << "Error Checked";
+            V_COUT_2 << "Error Checked";
             break;
         case SUSPICIOUS_UNCHECKED:
-            CtrlPrint::v_cout_2 << "Unchecked";
+            V_COUT_2 << "Unchecked";
             break;
         default:
-            CtrlPrint::v_cout_2 << "Unknown Suspicious";
+            V_COUT_2 << "Unknown Suspicious";
             break;
     }
-    CtrlPrint::v_cout_2 << "\n";
-    CtrlPrint::v_cout_2 << "EOF Reached: " << (frame.eof_reached ? "Yes" : "No") << "\n";
+    V_COUT_2 << "\n";
+    V_COUT_2 << "EOF Reached: " << (frame.eof_reached ? "Yes" : "No") << "\n";
 
     // Calculate total payload size
     size_t total_payload_size = std::accumulate(frame.payload_sizes.begin(), frame.payload_sizes.end(), size_t(0));
-    CtrlPrint::v_cout_2 << "Frame Size: " << total_payload_size << " bytes" << "\n";
-
-    std::chrono::time_point<std::chrono::steady_clock> start_frame_pts_chrono = std::chrono::time_point<std::chrono::steady_clock>(
-        std::chrono::milliseconds(frame.frame_pts / (ControlConfig::instance().get_dwTimeFrequency() / 1000)));
-    std::chrono::time_point<std::chrono::steady_clock> previous_frame_pts_chrono = std::chrono::time_point<std::chrono::steady_clock>(
-        std::chrono::milliseconds(frame.prev_frame_pts / (ControlConfig::instance().get_dwTimeFrequency() / 1000)));
-
-    static auto stack_overflow_pts = std::chrono::milliseconds(0);
-    const std::chrono::milliseconds PTS_OVERFLOW_THRESHOLD_MS(
-        static_cast<long long>(0xFFFFFFFFU / (ControlConfig::instance().get_dwTimeFrequency() / 1000)));
-    if (start_frame_pts_chrono < previous_frame_pts_chrono) {
-      stack_overflow_pts += std::chrono::milliseconds(PTS_OVERFLOW_THRESHOLD_MS);
-    }
-    start_frame_pts_chrono += stack_overflow_pts;
+    V_COUT_2 << "Frame Size: " << total_payload_size << " bytes" << "\n";
 
-    static auto very_first_gap = std::chrono::duration_cast<std::chrono::milliseconds>(frame.received_valid_times.front().time_since_epoch()-start_frame_pts_chrono.time_since_epoch());
-    auto now_gap = std::chrono::duration_cast<std::chrono::milliseconds>(frame.received_valid_times.front().time_since_epoch()-start_frame_pts_chrono.time_since_epoch());
-    auto time_intv = formatTime(now_gap-very_first_gap);
+    auto time_intv = formatTime(now_gap-ctx.very_first_gap);
 
-    CtrlPrint::v_cout_2 << "Time: " << formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(frame.received_valid_times.front().time_since_epoch())) << "\n";
-    CtrlPrint::v_cout_2 << "PTS: " << formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(start_frame_pts_chrono.time_since_epoch())) << "\n"; 
-    CtrlPrint::v_cout_2 << "Time-PTS: " << time_intv << "\n";
+    V_COUT_2 << "Time: " << formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(frame.received_valid_times.front().time_since_epoch())) << "\n";
+    V_COUT_2 << "PTS: " << formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(start_frame_pts_chrono.time_since_epoch())) << "\n"; 
+    V_COUT_2 << "Time-PTS: " << time_intv << "\n";
 
-    CtrlPrint::v_cout_2 << std::endl;
+    V_COUT_2 << std::endl;
 
 #ifdef GUI_SET
   gui_window_number = WIN_DEBUG;
@@ -1030,12 +1231,15 @@ void UVCPHeaderChecker::print_frame_data(const ValidFrame& frame) {
 
 
 void UVCPHeaderChecker::print_summary(const ValidFrame& frame) {
+    if (!VERBOSE_ON(2)) return;
+    const StreamConfig& frame_config = frame.stream_config ? *frame.stream_config : *ctx.config;
+
 #ifdef GUI_SET
     print_whole_flag = true;
     gui_window_number = WIN_SUMMARY;
 #endif
 
-    CtrlPrint::v_cout_2 << "Frame Number: " << frame.frame_number << "\n";
+    V_COUT_2 << "Frame Number: " << frame.frame_number << "\n";
 
     // Calculate time taken from valid start to the last of error or valid times
     if (!frame.received_valid_times.empty()) {
@@ -1050,35 +1254,35 @@ void UVCPHeaderChecker::print_summary(const ValidFrame& frame) {
         auto valid_start_ms = formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(valid_start.time_since_epoch()));
         auto final_end_ms = formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(final_end.time_since_epoch()));
 
-        CtrlPrint::v_cout_2 << "[ " << valid_start_ms << "  ~ " << final_end_ms << "  ]: " << time_taken << " ms" << "\n";
+        V_COUT_2 << "[ " << valid_start_ms << "  ~ " << final_end_ms << "  ]: " << time_taken << " ms" << "\n";
     } else {
-        CtrlPrint::v_cout_2 << "No Valid Times Recorded" << "\n";
+        V_COUT_2 << "No Valid Times Recorded" << "\n";
     }
 
-    CtrlPrint::v_cout_2 << "\nFrame Errors:" << "\n";
+    V_COUT_2 << "\nFrame Errors:" << "\n";
 
-      CtrlPrint::v_cout_2 << " - Frame Error: " << frame.frame_error << "\n";
+      V_COUT_2 << " - Frame Error: " << frame.frame_error << "\n";
       printFrameErrorExplanation(frame.frame_error);
       size_t actual_frame_size = std::accumulate(frame.payload_sizes.begin(), frame.payload_sizes.end(), size_t(0));
-      if (ControlConfig::instance().get_frame_format() == "yuyv") {
-        size_t expected_frame_size = ControlConfig::instance().get_width() * ControlConfig::instance().get_height() * 2;
-        CtrlPrint::v_cout_2 << " - Frame Format: YUYV\n";
-        CtrlPrint::v_cout_2 << "Expected frame size: " << expected_frame_size << " bytes excluding the header length.\n";
+      if (frame_config.is_yuyv()) {
+        size_t expected_frame_size = frame_config.expected_yuyv_size;
+        V_COUT_2 << " - Frame Format: YUYV\n";
+        V_COUT_2 << "Expected frame size: " << expected_frame_size << " bytes excluding the header length.\n";
         if (expected_frame_size != actual_frame_size) {
             std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(actual_frame_size) - static_cast<std::ptrdiff_t>(expected_frame_size);
-            CtrlPrint::v_cout_2 << "Data Loss :          " << diff << " bytes\n";
+            V_COUT_2 << "Data Loss :          " << diff << " bytes\n";
         }
       }
-      CtrlPrint::v_cout_2 << "Actual frame size:   " << actual_frame_size << "\n";
+      V_COUT_2 << "Actual frame size:   " << actual_frame_size << "\n";
 
-    CtrlPrint::v_cout_2 << "\nPayload Errors:" << "\n";
+    V_COUT_2 << "\nPayload Errors:" << "\n";
 
     if (frame.payload_errors.empty()) {
-        CtrlPrint::v_cout_2 << "NO ERROR, NO data loss for received payloads \n";
+        V_COUT_2 << "NO ERROR, NO data loss for received payloads \n";
     } else {
         size_t temp_lost_data_size = 0;
         for (size_t i = 0; i < frame.payload_errors.size(); ++i) {
-            CtrlPrint::v_cout_2 << " - Payload Error: " << frame.payload_errors[i] 
+            V_COUT_2 << " - Payload Error: " << frame.payload_errors[i] 
                     << ", Lost Data Size: " << frame.lost_data_sizes[i] << " bytes (includeing header) \n";
 
             printUVCErrorExplanation(frame.payload_errors[i]);
@@ -1087,8 +1291,8 @@ void UVCPHeaderChecker::print_summary(const ValidFrame& frame) {
         }
         
         if (temp_lost_data_size > 0) {
-            CtrlPrint::v_cout_2 << "Likely There is Data Loss in the Frame\n";
-            CtrlPrint::v_cout_2 << "Total Lost Data Size: " << temp_lost_data_size << " bytes\n";
+            V_COUT_2 << "Likely There is Data Loss in the Frame\n";
+            V_COUT_2 << "Total Lost Data Size: " << temp_lost_data_size << " bytes\n";
         }
     }
 
@@ -1102,19 +1306,19 @@ void UVCPHeaderChecker::print_summary(const ValidFrame& frame) {
         auto final_end = (error_end > valid_end) ? error_end : valid_end;
         auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(final_end - valid_start).count();
 
-        if (time_taken > (1000.0 / (ControlConfig::instance().get_fps())) + 20){
-          CtrlPrint::v_cout_2 << "Frame Drop May Cause because of Time Taken (Valid Start to Last Event): \n"
-          << "Should be " << (1000.0 / (ControlConfig::instance().get_fps())) << " ms, but " << time_taken << " ms \n"
+        if (time_taken > (1000.0 / (frame_config.fps)) + 20){
+          V_COUT_2 << "Frame Drop May Cause because of Time Taken (Valid Start to Last Event): \n"
+          << "Should be " << (1000.0 / (frame_config.fps)) << " ms, but " << time_taken << " ms \n"
           << "Or two frames could be overlapped \n";
         }
     }
 
-    CtrlPrint::v_cout_2 << "\nSuspicious:" << "\n";
+    V_COUT_2 << "\nSuspicious:" << "\n";
 
     printSuspiciousExplanation(frame.frame_suspicious);
 
 
-    CtrlPrint::v_cout_2 << "\n ---- \n";
+    V_COUT_2 << "\n ---- \n";
 
 // if current frame is out of boundary, likely data loss
 // if error bit is set and data is present likely data loss
@@ -1122,7 +1326,7 @@ void UVCPHeaderChecker::print_summary(const ValidFrame& frame) {
 // if fid is same but pts is different, likely massive frame loss
 
 // average frame size within boundary of 5% error 
-  CtrlPrint::v_cout_2 << std::flush;
+  V_COUT_2 << std::flush;
 
 #ifdef GUI_SET
     print_whole_flag = false;
@@ -1133,87 +1337,87 @@ void UVCPHeaderChecker::print_summary(const ValidFrame& frame) {
 void UVCPHeaderChecker::printUVCErrorExplanation(UVCError error) {
 
     if (error == ERR_NO_ERROR) {
-        CtrlPrint::v_cout_2 << "No Error, Valid - No errors detected.\n";
+        V_COUT_2 << "No Error, Valid - No errors detected.\n";
     } else if (error == ERR_EMPTY_PAYLOAD) {
-        CtrlPrint::v_cout_2 << "No Payload- UVC payload is empty.\nOccurs when there is no payload header.\n";
+        V_COUT_2 << "No Payload- UVC payload is empty.\nOccurs when there is no payload header.\n";
     } else if (error == ERR_MAX_PAYLAOD_OVERFLOW) {
-        CtrlPrint::v_cout_2 << "Payload Overflow - UVC payload size exceeds max transfer size.\nOccurs if payload size is larger than the max payload set in the interface descriptor.\n";
+        V_COUT_2 << "Payload Overflow - UVC payload size exceeds max transfer size.\nOccurs if payload size is larger than the max payload set in the interface descriptor.\n";
     } else if (error == ERR_ERR_BIT_SET) {
-        CtrlPrint::v_cout_2 << "BFH Error Bit Set - The Error bit in the UVC payload header is set.\n";
+        V_COUT_2 << "BFH Error Bit Set - The Error bit in the UVC payload header is set.\n";
     } else if (error == ERR_LENGTH_OUT_OF_RANGE) {
-        CtrlPrint::v_cout_2 << "Payload Header Length Out of Range - HLE is outside of expected range (2 to 12).\n";
+        V_COUT_2 << "Payload Header Length Out of Range - HLE is outside of expected range (2 to 12).\n";
     } else if (error == ERR_LENGTH_INVALID) {
-        CtrlPrint::v_cout_2 << "Payload Header Length Incorrect with BFH - Header length does not match BFH flags.\nExpected values: PTS=0, SCR=0, HLE=2; PTS=1, SCR=1, HLE=6; PTS=0, SCR=1, HLE=8; PTS=1, SCR=1, HLE=12.\n";
+        V_COUT_2 << "Payload Header Length Incorrect with BFH - Header length does not match BFH flags.\nExpected values: PTS=0, SCR=0, HLE=2; PTS=1, SCR=1, HLE=6; PTS=0, SCR=1, HLE=8; PTS=1, SCR=1, HLE=12.\n";
     } else if (error == ERR_RESERVED_BIT_SET) {
-        CtrlPrint::v_cout_2 << "BFH Reserved Bit Set - Reserved bit is set, only checked when EOF=0.\n";
+        V_COUT_2 << "BFH Reserved Bit Set - Reserved bit is set, only checked when EOF=0.\n";
     } else if (error == ERR_EOH_BIT) {
-        CtrlPrint::v_cout_2 << "EOH Bit Error - EOH is not properly set.\n";
+        V_COUT_2 << "EOH Bit Error - EOH is not properly set.\n";
     } else if (error == ERR_TOGGLE_BIT_OVERLAPPED) {
-        CtrlPrint::v_cout_2 << "Toggle Bit Frame Overlapped - Toggle Bit in BFH has overlapping error.\n";
+        V_COUT_2 << "Toggle Bit Frame Overlapped - Toggle Bit in BFH has overlapping error.\n";
     } else if (error == ERR_FID_MISMATCH) {
-        CtrlPrint::v_cout_2 << "FID Mismatch - Frame Identifier mismatch with previous frame.\n";
+        V_COUT_2 << "FID Mismatch - Frame Identifier mismatch with previous frame.\n";
     } else if (error == ERR_SWAP) {
-        CtrlPrint::v_cout_2 << "BFH Toggle Bit Error with PTS Difference - PTS matches but Toggle Bit mismatch detected.\n";
+        V_COUT_2 << "BFH Toggle Bit Error with PTS Difference - PTS matches but Toggle Bit mismatch detected.\n";
     } else if (error == ERR_MISSING_EOF) {
-        CtrlPrint::v_cout_2 << "Missing EOF - EOF expected but not found in payload header.\n";
+        V_COUT_2 << "Missing EOF - EOF expected but not found in payload header.\n";
     } else {
-        CtrlPrint::v_cout_2 << "Unknown Error - The error code is not recognized.\n";
+        V_COUT_2 << "Unknown Error - The error code is not recognized.\n";
     }
-  CtrlPrint::v_cout_2 << " \n";
+  V_COUT_2 << " \n";
 
 }
 
 void UVCPHeaderChecker::printFrameErrorExplanation(FrameError error) {
  
     if (error == ERR_FRAME_NO_ERROR) {
-        CtrlPrint::v_cout_2 << "No Frame Error - No frame errors detected.\n";
+        V_COUT_2 << "No Frame Error - No frame errors detected.\n";
     } else if (error == ERR_FRAME_DROP) {
-        CtrlPrint::v_cout_2 << "Frame Drop - Frame rate is lower than expected.\nIndicates missing frames based on FPS measurement.\n";
+        V_COUT_2 << "Frame Drop - Frame rate is lower than expected.\nIndicates missing frames based on FPS measurement.\n";
     } else if (error == ERR_FRAME_ERROR) {
-        CtrlPrint::v_cout_2 << "Frame Error - General frame error \nCaused by payload validation errors.\n";
+        V_COUT_2 << "Frame Error - General frame error \nCaused by payload validation errors.\n";
     } else if (error == ERR_FRAME_MAX_FRAME_OVERFLOW) {
-        CtrlPrint::v_cout_2 << "Max Frame Size Overflow - Frame size exceeds max frame size setting.\nIndicates potential dummy data or erroneous payload.\n";
-        CtrlPrint::v_cout_2 << "Max Frame Size is " << ControlConfig::instance().get_dwMaxVideoFrameSize() << " bytes.\n";
+        V_COUT_2 << "Max Frame Size Overflow - Frame size exceeds max frame size setting.\nIndicates potential dummy data or erroneous payload.\n";
+        V_COUT_2 << "Max Frame Size is " << ctx.config->dwMaxVideoFrameSize << " bytes.\n";
     } else if (error == ERR_FRAME_INVALID_YUYV_RAW_SIZE) {
-        CtrlPrint::v_cout_2 << "YUYV Frame Length Error - YUYV frame length mismatch.\nExpected size for YUYV is width * height * 2.\n";
+        V_COUT_2 << "YUYV Frame Length Error - YUYV frame length mismatch.\nExpected size for YUYV is width * height * 2.\n";
     } else if (error == ERR_FRAME_SAME_DIFFERENT_PTS) {
-        CtrlPrint::v_cout_2 << "Same Frame Different PTS - Only PTS mismatch detected without other validation errors.\nPTS mismatch occurs without errors in toggle validation.\n";
+        V_COUT_2 << "Same Frame Different PTS - Only PTS mismatch detected without other validation errors.\nPTS mismatch occurs without errors in toggle validation.\n";
     } else if (error == ERR_FRAME_MISSING_EOF) {
-        CtrlPrint::v_cout_2 << "Missing EOF - EOF is not found in the frame.\n";
+        V_COUT_2 << "Missing EOF - EOF is not found in the frame.\n";
     } else if (error == ERR_FRAME_FID_MISMATCH) {
-        CtrlPrint::v_cout_2 << "FID Mismatch - Frame Identifier mismatch with previous frame.\n May have had lost data at the start of the frame.\n";
+        V_COUT_2 << "FID Mismatch - Frame Identifier mismatch with previous frame.\n May have had lost data at the start of the frame.\n";
     } else {
-        CtrlPrint::v_cout_2 << "Unknown Frame Error - The frame error code is not recognized.\n";
+        V_COUT_2 << "Unknown Frame Error - The frame error code is not recognized.\n";
     }
-  CtrlPrint::v_cout_2 << " \n";
+  V_COUT_2 << " \n";
 
 }
 
 void UVCPHeaderChecker::printSuspiciousExplanation(FrameSuspicious error) {
     if (error == SUSPICIOUS_NO_SUSPICIOUS) {
-        CtrlPrint::v_cout_2 << "No Suspicious - No suspicious behavior detected.\n";
+        V_COUT_2 << "No Suspicious - No suspicious behavior detected.\n";
     } else if (error == SUSPICIOUS_PAYLOAD_TIME_INCONSISTENT) {
-        CtrlPrint::v_cout_2 << "Payload Time Inconsistent - Payload times are inconsistent.\n";
+        V_COUT_2 << "Payload Time Inconsistent - Payload times are inconsistent.\n";
     } else if (error == SUSPICIOUS_FRAME_SIZE_INCONSISTENT) {
-        CtrlPrint::v_cout_2 << "Frame Size Inconsistent - Frame size is inconsistent.\n";
+        V_COUT_2 << "Frame Size Inconsistent - Frame size is inconsistent.\n";
     } else if (error == SUSPICIOUS_PAYLOAD_COUNT_INCONSISTENT) {
-        CtrlPrint::v_cout_2 << "Payload Count Inconsistent - Payload count is inconsistent.\n";
+        V_COUT_2 << "Payload Count Inconsistent - Payload count is inconsistent.\n";
     } else if (error == SUSPICIOUS_PTS_DECREASE) {
-        CtrlPrint::v_cout_2 << "PTS Decrease - PTS value decreased. \n";
+        V_COUT_2 << "PTS Decrease - PTS value decreased. \n";
     } else if (error == SUSPICIOUS_SCR_STC_DECREASE) {
-        CtrlPrint::v_cout_2 << "SCR STC Decrease - SCR STC value decreased.\n";
+        V_COUT_2 << "SCR STC Decrease - SCR STC value decreased.\n";
     } else if (error == SUSPICIOUS_OVERCOMPRESSED) {
-        CtrlPrint::v_cout_2 << "Overcompressed - Frame is overcompressed.\nSmaller than " << 
-        ControlConfig::instance().get_width() << " x " << ControlConfig::instance().get_height() << " x 2 x 0.05\n" <<
-        ControlConfig::instance().get_width() * ControlConfig::instance().get_height() * 2 * 0.05 << "bytes .\n";
+        V_COUT_2 << "Overcompressed - Frame is overcompressed.\nSmaller than " << 
+        ctx.config->width << " x " << ctx.config->height << " x 2 x 0.05\n" <<
+        ctx.config->width * ctx.config->height * 2 * 0.05 << "bytes .\n";
     } else if (error == SUSPICIOUS_ERROR_CHECKED) {
-        CtrlPrint::v_cout_2 << "Error Checked - Frame is already set ERROR.\n";
+        V_COUT_2 << "Error Checked - Frame is already set ERROR.\n";
     } else if (error == SUSPICIOUS_UNCHECKED) {
-        CtrlPrint::v_cout_2 << "Unchecked - Suspicious error has not been checked.\n";
+        V_COUT_2 << "Unchecked - Suspicious error has not been checked.\n";
     } else {
-        CtrlPrint::v_cout_2 << "Unknown Suspicious Error - The suspicious error code is not recognized.\n";
+        V_COUT_2 << "Unknown Suspicious Error - The suspicious error code is not recognized.\n";
     }
-  CtrlPrint::v_cout_2 << " \n";
+  V_COUT_2 << " \n";
 }
 
 std::string UVCPHeaderChecker::formatTime(std::chrono::milliseconds ms) {
@@ -1237,6 +1441,10 @@ std::string UVCPHeaderChecker::formatTime(std::chrono::milliseconds ms) {
     return oss.str();
 }
 
+std::string UVCPHeaderChecker::formatTime(std::chrono::time_point<std::chrono::steady_clock> time_point) {
+    return formatTime(std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch()));
+}
+
 // saving log, not used
 void UVCPHeaderChecker::save_payload_header_to_log(
     const UVC_Payload_Header& payload_header,
@@ -1249,7 +1457,7 @@ void UVCPHeaderChecker::save_payload_header_to_log(
 #endif
 
   if (!log_file.is_open()) {
-    CtrlPrint::v_cerr_3 << "Error opening payload header log file." << std::endl;
+    V_CERR_3 << "Error opening payload header log file." << std::endl;
     return;
   }
 
@@ -1295,7 +1503,7 @@ void UVCPHeaderChecker::save_frames_to_log(
 #endif
 
   if (!log_file.is_open()) {
-    CtrlPrint::v_cerr_5 << "Error opening log file." << std::endl;
+    V_CERR_5 << "Error opening log file." << std::endl;
     return;
   }
 
@@ -1336,12 +1544,14 @@ void UVCPHeaderChecker::save_frames_to_log(
 void UVCPHeaderChecker::plot_received_chrono_times(const std::vector<std::chrono::steady_clock::time_point>& received_valid_times, 
                                                     const std::vector<std::chrono::steady_clock::time_point>& received_error_times) {
 // This was made for CLI                                                      
-    if (received_valid_times.empty() && received_error_times.empty()) return;
+    if (!VERBOSE_ON(2)) return;
+    // base_time is the first valid payload
+    if (received_valid_times.empty()) return;
 
     const int zoom = 4;
     const int cut = 20;
-    const int total_markers = ControlConfig::instance().get_fps() * zoom;         
-    const auto interval_ns = std::chrono::nanoseconds(static_cast<long long>(1e9 / static_cast<double>(ControlConfig::instance().get_fps()) / (zoom *cut)));
+    const int total_markers = ctx.config->fps * zoom;         
+    const auto interval_ns = std::chrono::nanoseconds(static_cast<long long>(1e9 / static_cast<double>(ctx.config->fps) / (zoom *cut)));
 
 
     auto base_time = received_valid_times[0];
@@ -1367,5 +1577,5 @@ void UVCPHeaderChecker::plot_received_chrono_times(const std::vector<std::chrono
         }
     }
     
-    CtrlPrint::v_cout_2 << graph << formatted_time << std::endl;
+    V_COUT_2 << graph << formatTime(current_received_time) << std::endl;
 }
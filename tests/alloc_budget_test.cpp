@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "utils/alloc_stats.hpp"
+#include "validuvc/control_config.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+
+#ifndef ALLOC_BUDGET_PER_FRAME
+#define ALLOC_BUDGET_PER_FRAME 32
+#endif
+
+namespace {
+
+// 16 x 8 YUYV, four payloads per frame
+constexpr int kWidth = 16;
+constexpr int kHeight = 8;
+constexpr int kPayloadsPerFrame = 4;
+constexpr size_t kPayloadData = kWidth * kHeight * 2 / kPayloadsPerFrame;
+
+void feed_frames(UVCPHeaderChecker& checker, int frames, int& frame_id,
+                 std::chrono::steady_clock::time_point& time) {
+  std::vector<u_char> payload(2 + kPayloadData, 0x80);
+  for (int f = 0; f < frames; ++f, ++frame_id) {
+    for (int p = 0; p < kPayloadsPerFrame; ++p) {
+      payload[0] = 0x02;
+      payload[1] = static_cast<u_char>((frame_id & 1) | (p == kPayloadsPerFrame - 1 ? 0x02 : 0x00));
+      ASSERT_EQ(checker.payload_valid_ctrl(payload, time), ERR_NO_ERROR);
+      time += std::chrono::microseconds(200);
+    }
+    time += std::chrono::microseconds(33333 - 200 * kPayloadsPerFrame);
+  }
+}
+
+}  // namespace
+
+TEST(alloc_stats_test, stage_scopes_nest) {
+  EXPECT_EQ(AllocStats::current_stage(), ALLOC_STAGE_UNTAGGED);
+  {
+    AllocStageScope validate(STAGE_VALIDATE);
+    EXPECT_EQ(AllocStats::current_stage(), STAGE_VALIDATE);
+    {
+      AllocStageScope develop(STAGE_DEVELOP);
+      EXPECT_EQ(AllocStats::current_stage(), STAGE_DEVELOP);
+    }
+    EXPECT_EQ(AllocStats::current_stage(), STAGE_VALIDATE);
+  }
+  EXPECT_EQ(AllocStats::current_stage(), ALLOC_STAGE_UNTAGGED);
+}
+
+TEST(alloc_stats_test, allocations_are_charged_to_the_current_stage) {
+  if (!AllocStats::enabled()) {
+    GTEST_SKIP() << "built without -DUVCFD_ALLOC_STATS=ON";
+  }
+  const AllocCounts before = AllocStats::instance().stage_counts(STAGE_DEVELOP);
+  {
+    AllocStageScope develop(STAGE_DEVELOP);
+    std::vector<int>* data = new std::vector<int>(1000);
+    delete data;
+  }
+  const AllocCounts after = AllocStats::instance().stage_counts(STAGE_DEVELOP);
+  EXPECT_EQ(after.allocations - before.allocations, 2u);
+  EXPECT_EQ(after.frees - before.frees, 2u);
+  EXPECT_GE(after.allocated_bytes - before.allocated_bytes, 1000 * sizeof(int));
+  EXPECT_EQ(after.allocated_bytes - before.allocated_bytes, after.freed_bytes - before.freed_bytes);
+}
+
+TEST(alloc_stats_test, over_aligned_allocations_are_counted) {
+  if (!AllocStats::enabled()) {
+    GTEST_SKIP() << "built without -DUVCFD_ALLOC_STATS=ON";
+  }
+  struct alignas(64) Slot {
+    u_char bytes[64];
+  };
+  const AllocCounts before = AllocStats::instance().stage_counts(STAGE_DEVELOP);
+  {
+    AllocStageScope develop(STAGE_DEVELOP);
+    Slot* one = new Slot;
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(one) % 64, 0u);
+    delete one;
+    Slot* many = new Slot[4];
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(many) % 64, 0u);
+    delete[] many;
+    Slot* maybe = new (std::nothrow) Slot;
+    delete maybe;
+  }
+  const AllocCounts after = AllocStats::instance().stage_counts(STAGE_DEVELOP);
+  EXPECT_EQ(after.allocations - before.allocations, 3u);
+  EXPECT_EQ(after.frees - before.frees, 3u);
+  EXPECT_GE(after.allocated_bytes - before.allocated_bytes, 6 * sizeof(Slot));
+  EXPECT_EQ(after.allocated_bytes - before.allocated_bytes, after.freed_bytes - before.freed_bytes);
+}
+
+// Fails the build's test run when steady state validation gets more allocation heavy
+// Budget: -DUVCFD_ALLOC_BUDGET_PER_FRAME=<n>
+TEST(alloc_budget_test, steady_state_validation_stays_in_budget) {
+  if (!AllocStats::enabled()) {
+    GTEST_SKIP() << "built without -DUVCFD_ALLOC_STATS=ON";
+  }
+  ControlConfig::instance().set_frame_format("yuyv");
+  ControlConfig::instance().set_width(kWidth);
+  ControlConfig::instance().set_height(kHeight);
+  ControlConfig::instance().set_fps(30);
+  ControlConfig::instance().set_dwMaxPayloadTransferSize(1310720);
+  ControlConfig::instance().set_dwMaxVideoFrameSize(16777216);
+  ControlConfig::instance().set_dwTimeFrequency(1000000);
+
+  RunFlags flags;
+  UVCPHeaderChecker checker(flags);
+  auto time = std::chrono::steady_clock::now();
+  int frame_id = 0;
+
+  // Warm up: processed_frames reaches its cap and the per second block has run
+  feed_frames(checker, 120, frame_id, time);
+
+  const int measured_frames = 600;
+  const uint64_t before = AllocStats::instance().stage_counts(STAGE_VALIDATE).allocations;
+  feed_frames(checker, measured_frames, frame_id, time);
+  const uint64_t allocations = AllocStats::instance().stage_counts(STAGE_VALIDATE).allocations - before;
+
+  const double per_frame = static_cast<double>(allocations) / measured_frames;
+  RecordProperty("allocations_per_frame", std::to_string(per_frame));
+  EXPECT_LE(per_frame, static_cast<double>(ALLOC_BUDGET_PER_FRAME))
+      << allocations << " allocations over " << measured_frames << " frames";
+}
@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "avi_writer.hpp"
+#include "develope_photo.hpp"
+
+namespace {
+
+std::vector<u_char> read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<u_char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+uint32_t get32(const std::vector<u_char>& data, size_t offset) {
+  return data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (static_cast<uint32_t>(data[offset + 3]) << 24);
+}
+
+bool fourcc_at(const std::vector<u_char>& data, size_t offset, const char* fourcc) {
+  return offset + 4 <= data.size() && std::memcmp(&data[offset], fourcc, 4) == 0;
+}
+
+std::vector<u_char> fake_jpeg(int frame, size_t size) {
+  std::vector<u_char> jpeg(size, static_cast<u_char>(frame));
+  jpeg[0] = 0xFF;
+  jpeg[1] = 0xD8;
+  return jpeg;
+}
+
+// Frames as the idx1 index of a complete AVI file points at them
+std::vector<std::vector<u_char>> indexed_frames(const std::vector<u_char>& avi) {
+  std::vector<std::vector<u_char>> frames;
+  EXPECT_TRUE(fourcc_at(avi, 0, "RIFF"));
+  EXPECT_TRUE(fourcc_at(avi, 8, "AVI "));
+  EXPECT_TRUE(fourcc_at(avi, 220, "movi"));
+  const size_t idx1 = 220 + get32(avi, 216);
+  if (!fourcc_at(avi, idx1, "idx1")) {
+    ADD_FAILURE() << "no idx1 after movi";
+    return frames;
+  }
+  EXPECT_EQ(get32(avi, 4) + 8, idx1 + 8 + get32(avi, idx1 + 4));
+  const uint32_t entries = get32(avi, idx1 + 4) / 16;
+  EXPECT_EQ(get32(avi, 48), entries);   // avih dwTotalFrames
+  EXPECT_EQ(get32(avi, 140), entries);  // strh dwLength
+  for (uint32_t i = 0; i < entries; ++i) {
+    const size_t entry = idx1 + 8 + i * 16;
+    EXPECT_TRUE(fourcc_at(avi, entry, "00dc"));
+    const size_t chunk = 220 + get32(avi, entry + 8);
+    const uint32_t size = get32(avi, entry + 12);
+    EXPECT_TRUE(fourcc_at(avi, chunk, "00dc"));
+    EXPECT_EQ(get32(avi, chunk + 4), size);
+    frames.emplace_back(avi.begin() + chunk + 8, avi.begin() + chunk + 8 + size);
+  }
+  return frames;
+}
+
+}  // namespace
+
+TEST(avi_writer_test, frames_come_back_through_the_index) {
+  const std::string path = "avi_writer_test.avi";
+  MjpegAviWriter writer;
+  ASSERT_TRUE(writer.open(path, 64, 48, 30));
+
+  std::vector<std::vector<u_char>> expected;
+  for (int frame = 0; frame < 5; ++frame) {
+    // Odd sizes need the pad byte, several segments are one chunk
+    std::vector<u_char> jpeg = fake_jpeg(frame, 101 + frame * 10);
+    const FrameSegment segments[2] = {{jpeg.data(), 40}, {jpeg.data() + 40, jpeg.size() - 40}};
+    EXPECT_EQ(writer.append(segments, 2), frame);
+    expected.push_back(jpeg);
+  }
+  writer.close();
+
+  const std::vector<u_char> avi = read_file(path);
+  EXPECT_EQ(get32(avi, 64), 64u);
+  EXPECT_EQ(get32(avi, 68), 48u);
+  EXPECT_EQ(indexed_frames(avi), expected);
+  std::remove(path.c_str());
+}
+
+TEST(avi_writer_test, max_bytes_per_sec_saturates) {
+  const std::string path = "avi_writer_test_rate.avi";
+  MjpegAviWriter writer;
+  ASSERT_TRUE(writer.open(path, 64, 48, 1000));
+  // 5 MB at 1000 fps is past 4 GiB/s
+  std::vector<u_char> jpeg = fake_jpeg(0, 5u << 20);
+  const FrameSegment segment = {jpeg.data(), jpeg.size()};
+  writer.append(&segment, 1);
+  writer.close();
+
+  const std::vector<u_char> avi = read_file(path);
+  EXPECT_EQ(get32(avi, 36), 0xFFFFFFFFu);   // avih dwMaxBytesPerSec
+  EXPECT_EQ(get32(avi, 60), 5u << 20);      // avih dwSuggestedBufferSize
+  std::remove(path.c_str());
+}
+
+TEST(avi_writer_test, checkpoint_leaves_a_complete_file_behind) {
+  const std::string path = "avi_writer_test_checkpoint.avi";
+  MjpegAviWriter writer;
+  ASSERT_TRUE(writer.open(path, 32, 32, 30));
+  for (int frame = 0; frame < 3; ++frame) {
+    std::vector<u_char> jpeg = fake_jpeg(frame, 64);
+    const FrameSegment segment = {jpeg.data(), jpeg.size()};
+    writer.append(&segment, 1);
+  }
+  ASSERT_TRUE(writer.checkpoint(false));
+
+  // Read while the writer is still open, as after a kill
+  EXPECT_EQ(indexed_frames(read_file(path)).size(), 3u);
+
+  std::vector<u_char> jpeg = fake_jpeg(3, 64);
+  const FrameSegment segment = {jpeg.data(), jpeg.size()};
+  writer.append(&segment, 1);
+  writer.close();
+  EXPECT_EQ(indexed_frames(read_file(path)).size(), 4u);
+  std::remove(path.c_str());
+}
+
+TEST(avi_writer_test, append_after_checkpoint_keeps_the_header_consistent) {
+  const std::string path = "avi_writer_test_after_checkpoint.avi";
+  MjpegAviWriter writer;
+  ASSERT_TRUE(writer.open(path, 32, 32, 30));
+  std::vector<u_char> jpeg = fake_jpeg(0, 65);
+  const FrameSegment segment = {jpeg.data(), jpeg.size()};
+  writer.append(&segment, 1);
+  ASSERT_TRUE(writer.checkpoint(false));
+  writer.append(&segment, 1);
+
+  // Read while the writer is still open: the idx1 of the checkpoint is gone, so the header must not claim it
+  const std::vector<u_char> avi = read_file(path);
+  ASSERT_TRUE(fourcc_at(avi, 220, "movi"));
+  EXPECT_EQ(get32(avi, 44) & 0x10, 0u);   // avih dwFlags, AVIF_HASINDEX
+  const size_t movi_end = 220 + get32(avi, 216);
+  EXPECT_EQ(get32(avi, 4) + 8, movi_end);
+  EXPECT_LE(movi_end, avi.size());
+
+  // The movi list holds whole frames up to the checkpoint
+  size_t chunks = 0;
+  for (size_t chunk = 224; chunk < movi_end; chunk += 8 + ((get32(avi, chunk + 4) + 1) & ~1u)) {
+    EXPECT_TRUE(fourcc_at(avi, chunk, "00dc"));
+    ++chunks;
+  }
+  EXPECT_EQ(chunks, 1u);
+  EXPECT_EQ(get32(avi, 48), 1u);
+
+  writer.close();
+  EXPECT_EQ(indexed_frames(read_file(path)).size(), 2u);
+  std::remove(path.c_str());
+}
+
+TEST(capture_container_test, sidecar_maps_frames_to_parts) {
+  const std::string base = "capture_container_test";
+  CaptureContainer container;
+  ASSERT_TRUE(container.open(base, 30, 2));
+
+  DevelopFrameFormat format;
+  format.format = FRAME_FORMAT_MJPEG;
+  format.width = 64;
+  format.height = 48;
+  for (int frame = 10; frame < 13; ++frame) {
+    format.frame_number = frame;
+    format.frame_error = frame == 11 ? 2 : 0;
+    std::vector<u_char> jpeg = fake_jpeg(frame, 50);
+    const FrameSegment segment = {jpeg.data(), jpeg.size()};
+    ASSERT_TRUE(container.write_frame(format, &segment, 1));
+  }
+  // A new resolution starts a new part
+  format.width = 32;
+  format.frame_number = 13;
+  std::vector<u_char> jpeg = fake_jpeg(13, 50);
+  const FrameSegment segment = {jpeg.data(), jpeg.size()};
+  ASSERT_TRUE(container.write_frame(format, &segment, 1));
+  EXPECT_EQ(container.frames_written(), 4u);
+  container.close();
+
+  EXPECT_EQ(indexed_frames(read_file(base + ".avi")).size(), 3u);
+  EXPECT_EQ(indexed_frames(read_file(base + "_001.avi")).size(), 1u);
+
+  std::ifstream sidecar(base + ".csv");
+  std::string line;
+  std::vector<std::string> lines;
+  while (std::getline(sidecar, line)) lines.push_back(line);
+  ASSERT_EQ(lines.size(), 5u);
+  EXPECT_EQ(lines[0], "frame_number,file,index,bytes,frame_error,frame_suspicious");
+  EXPECT_EQ(lines[2], "11,capture_container_test.avi,1,50,2,0");
+  EXPECT_EQ(lines[4], "13,capture_container_test_001.avi,0,50,0,0");
+
+  std::remove((base + ".avi").c_str());
+  std::remove((base + "_001.avi").c_str());
+  std::remove((base + ".csv").c_str());
+}
+
+TEST(capture_container_test, frames_are_stored_in_pop_order) {
+  const std::string base = "capture_container_test_order";
+  CaptureContainer container;
+  ASSERT_TRUE(container.open(base, 30, 30, 1));
+
+  DevelopFrameFormat format;
+  format.format = FRAME_FORMAT_MJPEG;
+  format.width = 32;
+  format.height = 32;
+  auto write = [&](int frame_number, uint64_t sequence) {
+    format.frame_number = frame_number;
+    format.develop_sequence = sequence;
+    std::vector<u_char> jpeg = fake_jpeg(frame_number, 40);
+    const FrameSegment segment = {jpeg.data(), jpeg.size()};
+    EXPECT_TRUE(container.write_frame(format, &segment, 1));
+  };
+
+  // Workers finish 3, 2 and 5 before 1; 4 was developed but not stored
+  write(103, 3);
+  container.frame_done(3);
+  write(102, 2);
+  container.frame_done(2);
+  container.frame_done(4);
+  write(105, 5);
+  container.frame_done(5);
+  EXPECT_EQ(container.frames_written(), 0u);
+  write(101, 1);
+  container.frame_done(1);
+  EXPECT_EQ(container.frames_written(), 4u);
+  container.close();
+
+  const std::vector<std::vector<u_char>> frames = indexed_frames(read_file(base + ".avi"));
+  ASSERT_EQ(frames.size(), 4u);
+  EXPECT_EQ(frames[0][2], 101);
+  EXPECT_EQ(frames[1][2], 102);
+  EXPECT_EQ(frames[2][2], 103);
+  EXPECT_EQ(frames[3][2], 105);
+
+  std::remove((base + ".avi").c_str());
+  std::remove((base + ".csv").c_str());
+}
+
+TEST(capture_container_test, develop_encodes_yuyv_frames_into_the_container) {
+  const std::string base = "capture_container_test_yuyv";
+  DevFImage& dev_f_image = DevFImage::instance();
+  ASSERT_TRUE(dev_f_image.open_container(base, 30));
+
+  DevelopFrameFormat format;
+  format.frame_number = 1;
+  format.format = FRAME_FORMAT_YUYV;
+  format.width = 32;
+  format.height = 16;
+  std::vector<std::vector<u_char>> frame_data(2, std::vector<u_char>(32 * 16, 0x80));
+  dev_f_image.develope_photo(format, frame_data);
+  dev_f_image.close_container();
+  EXPECT_EQ(dev_f_image.develop_output.load(), DEVELOP_OUTPUT_JPEG);
+
+  const std::vector<std::vector<u_char>> frames = indexed_frames(read_file(base + ".avi"));
+  ASSERT_EQ(frames.size(), 1u);
+  ASSERT_GT(frames[0].size(), 4u);
+  EXPECT_EQ(frames[0][0], 0xFF);
+  EXPECT_EQ(frames[0][1], 0xD8);
+  EXPECT_EQ(frames[0][frames[0].size() - 2], 0xFF);
+  EXPECT_EQ(frames[0][frames[0].size() - 1], 0xD9);
+
+  std::remove((base + ".avi").c_str());
+  std::remove((base + ".csv").c_str());
+}
@@ -0,0 +1,96 @@
+// Synthetic UVC streams and private checker access shared by the benchmark drivers
+
+#ifndef BENCH_STREAM_HPP
+#define BENCH_STREAM_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "validuvc/control_config.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+
+class UVCPHeaderCheckerBench {
+public:
+    static UVC_Payload_Header parse(UVCPHeaderChecker& checker, const std::vector<u_char>& payload,
+                                    std::chrono::steady_clock::time_point time) {
+        return checker.parse_uvc_payload_header(payload, time);
+    }
+    static UVCError valid(UVCPHeaderChecker& checker, const UVC_Payload_Header& header,
+                          const UVC_Payload_Header& previous, const UVC_Payload_Header& previous_previous) {
+        return checker.payload_header_valid(header, previous, previous_previous);
+    }
+    static uint64_t finished_frames(UVCPHeaderChecker& checker) {
+        return static_cast<uint64_t>(checker.finished_frames.value());
+    }
+};
+
+enum BenchStream { STREAM_BULK = 0, STREAM_ISO = 1, STREAM_ERRORS = 2 };
+enum BenchFormat { BENCH_YUYV = 0, BENCH_MJPEG = 1 };
+
+constexpr int kResolutions[][2] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+
+constexpr size_t kHeaderLength = 12;            // PTS + SCR
+constexpr size_t kBulkPayloadData = 512 * 1024;
+constexpr size_t kIsoPayloadData = 3072 - kHeaderLength;
+constexpr int kErrorEvery = 8;                  // STREAM_ERRORS: one payload in 8 has the ERR bit
+constexpr uint32_t kTimeFrequency = 48000000;
+constexpr int kFps = 30;
+
+inline size_t frame_bytes(int width, int height, BenchFormat format) {
+    // MJPEG: a typical 6:1 over YUYV
+    return format == BENCH_YUYV ? size_t(width) * height * 2 : size_t(width) * height / 3;
+}
+
+inline void configure(int width, int height, BenchFormat format, size_t payload_data, int fps = kFps) {
+    ControlConfig::instance().set_frame_format(format == BENCH_YUYV ? "yuyv" : "mjpeg");
+    ControlConfig::instance().set_width(width);
+    ControlConfig::instance().set_height(height);
+    ControlConfig::instance().set_fps(fps);
+    ControlConfig::instance().set_dwMaxPayloadTransferSize(static_cast<uint32_t>(payload_data + kHeaderLength));
+    ControlConfig::instance().set_dwMaxVideoFrameSize(static_cast<uint32_t>(size_t(width) * height * 2));
+    ControlConfig::instance().set_dwTimeFrequency(kTimeFrequency);
+}
+
+// One frame worth of payloads; headers are rewritten per frame by stamp()
+struct SyntheticFrame {
+    std::vector<std::vector<u_char>> payloads;
+    size_t bytes = 0;
+
+    void stamp(uint32_t frame_id, uint32_t pts, uint32_t& scr) {
+        for (size_t i = 0; i < payloads.size(); ++i) {
+            std::vector<u_char>& p = payloads[i];
+            p[1] = static_cast<u_char>(0x80 | 0x08 | 0x04 | (frame_id & 1) | (i + 1 == payloads.size() ? 0x02 : 0));
+            for (int b = 0; b < 4; ++b) p[2 + b] = static_cast<u_char>(pts >> (8 * b));
+            for (int b = 0; b < 4; ++b) p[6 + b] = static_cast<u_char>(scr >> (8 * b));
+            scr += 1000;
+        }
+    }
+};
+
+inline SyntheticFrame make_frame(BenchStream stream, int width, int height, BenchFormat format) {
+    SyntheticFrame frame;
+    const size_t total = frame_bytes(width, height, format);
+    const size_t chunk = stream == STREAM_BULK ? kBulkPayloadData : kIsoPayloadData;
+    for (size_t offset = 0; offset < total; offset += chunk) {
+        const size_t data = std::min(chunk, total - offset);
+        std::vector<u_char> payload(kHeaderLength + data);
+        payload[0] = static_cast<u_char>(kHeaderLength);
+        for (size_t i = 0; i < data; ++i) {
+            payload[kHeaderLength + i] = static_cast<u_char>((offset + i) * 7);
+        }
+        frame.payloads.push_back(std::move(payload));
+        frame.bytes += data;
+    }
+    if (format == BENCH_MJPEG) {
+        frame.payloads.front()[kHeaderLength] = 0xFF;
+        frame.payloads.front()[kHeaderLength + 1] = 0xD8;
+        frame.payloads.back()[frame.payloads.back().size() - 2] = 0xFF;
+        frame.payloads.back()[frame.payloads.back().size() - 1] = 0xD9;
+    }
+    return frame;
+}
+
+#endif // BENCH_STREAM_HPP
@@ -0,0 +1,384 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/hex_bytes.hpp"
+#include "validuvc/capture_convert.hpp"
+#include "validuvc/payload_record.hpp"
+#include "validuvc/stream_generator.hpp"
+
+namespace {
+
+using Payloads = std::vector<std::vector<u_char>>;
+
+std::string temp_path(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / ("uvcfd_convert_test_" + name)).string();
+}
+
+void write_file(const std::string& path, const std::string& bytes) {
+  std::ofstream(path, std::ios::binary) << bytes;
+}
+
+std::string read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+Payloads read_record(const std::string& path, StreamConfig* config = nullptr) {
+  PayloadRecordReader reader;
+  EXPECT_TRUE(reader.open(path)) << reader.error();
+  if (config) *config = reader.config();
+  Payloads payloads;
+  const u_char* data;
+  size_t size;
+  std::chrono::steady_clock::time_point time;
+  while (reader.next(data, size, time)) payloads.emplace_back(data, data + size);
+  return payloads;
+}
+
+ConvertStats convert(const std::string& in, const std::string& out, CaptureFormat output, ConvertOptions options = {}) {
+  options.output = output;
+  CaptureConverter converter(options);
+  EXPECT_TRUE(converter.run(in, out)) << converter.error();
+  return converter.stats();
+}
+
+GeneratorConfig small_stream(StreamTransfer transfer) {
+  GeneratorConfig config;
+  config.format = FRAME_FORMAT_MJPEG;
+  config.transfer = transfer;
+  config.width = 160;
+  config.height = 120;
+  config.max_payload_transfer_size = transfer == TRANSFER_ISO ? 1024 : 20000;
+  config.seed = 9;
+  config.fault_probability[FAULT_ERR_BIT] = 0.1;
+  return config;
+}
+
+// Generator output in one of its formats, plus the payloads it wrote
+Payloads generate(const GeneratorConfig& config, int frames, const std::string& format, std::string& bytes) {
+  UVCStreamGenerator generator(config);
+  std::ostringstream out;
+  TsharkFieldsWriter tshark(out, config.transfer);
+  std::unique_ptr<UsbmonPcapngWriter> pcapng;
+  if (format == "pcapng") pcapng = std::make_unique<UsbmonPcapngWriter>(out, config.transfer, 1, 4, 0x82, 8, 4096);
+  if (format == "tshark") tshark.write_config(config, config.start_time);
+  Payloads payloads;
+  for (int f = 0; f < frames; ++f) {
+    const std::vector<PayloadView>& frame = generator.next_frame();
+    for (const PayloadView& p : frame) payloads.emplace_back(p.data, p.data + p.size);
+    if (pcapng) pcapng->write(frame);
+    if (format == "tshark") tshark.write(frame);
+  }
+  bytes = out.str();
+  return payloads;
+}
+
+void put(std::vector<u_char>& out, uint64_t value, int bytes) {
+  for (int b = 0; b < bytes; ++b) out.push_back(static_cast<u_char>(value >> (8 * b)));
+}
+
+// usbmon (mmapped) URB: 64 byte header, then iso descriptors, then data
+std::vector<u_char> usbmon_urb(char type, uint8_t transfer, uint8_t endpoint, uint64_t id, const u_char* setup,
+                               const Payloads& iso, const std::vector<u_char>& data) {
+  std::vector<u_char> urb;
+  std::vector<u_char> body;
+  for (size_t i = 0, offset = 0; i < iso.size(); offset += iso[i].size(), ++i) {
+    put(body, 0, 4);
+    put(body, offset, 4);
+    put(body, iso[i].size(), 4);
+    put(body, 0, 4);
+  }
+  for (const auto& p : iso) body.insert(body.end(), p.begin(), p.end());
+  body.insert(body.end(), data.begin(), data.end());
+
+  put(urb, id, 8);
+  urb.push_back(static_cast<u_char>(type));
+  urb.push_back(transfer);
+  urb.push_back(endpoint);
+  urb.push_back(3);           // device
+  put(urb, 1, 2);             // bus
+  urb.push_back(setup ? 0 : '-');
+  urb.push_back(0);
+  put(urb, 1700000000, 8);
+  put(urb, 250000, 4);
+  put(urb, 0, 4);
+  put(urb, body.size(), 4);
+  put(urb, body.size(), 4);
+  if (setup) {
+    urb.insert(urb.end(), setup, setup + 8);
+  } else {
+    put(urb, 0, 4);
+    put(urb, iso.size(), 4);
+  }
+  put(urb, 1, 4);
+  put(urb, 0, 4);
+  put(urb, 0, 4);
+  put(urb, iso.size(), 4);
+  urb.insert(urb.end(), body.begin(), body.end());
+  return urb;
+}
+
+// Classic pcap, microsecond stamps
+std::string pcap_file(uint16_t linktype, const std::vector<std::vector<u_char>>& packets) {
+  std::vector<u_char> out;
+  put(out, 0xA1B2C3D4, 4);
+  put(out, 2, 2);
+  put(out, 4, 2);
+  put(out, 0, 8);
+  put(out, 262144, 4);
+  put(out, linktype, 4);
+  for (const auto& packet : packets) {
+    put(out, 1700000000, 4);
+    put(out, 500000, 4);
+    put(out, packet.size(), 4);
+    put(out, packet.size(), 4);
+    out.insert(out.end(), packet.begin(), packet.end());
+  }
+  return std::string(out.begin(), out.end());
+}
+
+const Payloads iso_payloads = {
+    {0x0c, 0x8d, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 0xaa, 0xbb},
+    {0x02, 0x8f, 0xcc},
+    {0x0c, 0x8d, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
+};
+
+}  // namespace
+
+TEST(capture_convert_test, formats_are_detected_from_the_first_bytes) {
+  const std::string samples[] = {"UVCFDREC", "\n\r\r\n", "0000   00 f8 07 03\n", "Frame 1: 1088 bytes on wire\n",
+                                 "0x00;1700000000.1;1088;;0c8d\n", "Converted Monotonic Time: 1.5 seconds\n",
+                                 "0c8d8f9c6800\n"};
+  const CaptureFormat expected[] = {CAPTURE_RECORD, CAPTURE_PCAP, CAPTURE_HEXDUMP, CAPTURE_DISSECTION,
+                                    CAPTURE_TSHARK, CAPTURE_TIMED, CAPTURE_HEX};
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+    const std::string& s = samples[i];
+    EXPECT_EQ(detect_capture_format(reinterpret_cast<const u_char*>(s.data()), s.size()), expected[i]) << s;
+  }
+}
+
+TEST(capture_convert_test, pcapng_and_tshark_give_the_generated_payloads) {
+  for (StreamTransfer transfer : {TRANSFER_ISO, TRANSFER_BULK}) {
+    const GeneratorConfig config = small_stream(transfer);
+    for (const std::string format : {"pcapng", "tshark"}) {
+      std::string bytes;
+      const Payloads expected = generate(config, 20, format, bytes);
+      const std::string in = temp_path("in." + format);
+      const std::string out = temp_path("out.uvcrec");
+      write_file(in, bytes);
+
+      // Small chunks and several workers must not change the order
+      ConvertOptions options;
+      options.config = config.stream_config();
+      options.workers = 3;
+      options.chunk_bytes = 4096;
+      const ConvertStats stats = convert(in, out, CAPTURE_RECORD, options);
+      StreamConfig written;
+      EXPECT_EQ(read_record(out, &written), expected) << format << " transfer " << int(transfer);
+      EXPECT_EQ(stats.payloads, expected.size());
+      EXPECT_EQ(written.dwMaxPayloadTransferSize, config.max_payload_transfer_size);
+      if (format == "pcapng") {
+        EXPECT_EQ(stats.stream, (1u << 16) | (4u << 8) | 0x82);
+      }
+      std::remove(in.c_str());
+      std::remove(out.c_str());
+    }
+  }
+}
+
+TEST(capture_convert_test, record_round_trips_through_text_formats) {
+  std::string bytes;
+  const GeneratorConfig config = small_stream(TRANSFER_ISO);
+  const Payloads expected = generate(config, 10, "none", bytes);
+  const std::string record = temp_path("source.uvcrec");
+  {
+    PayloadRecordWriter writer;
+    ASSERT_TRUE(writer.open(record, config.stream_config()));
+    int64_t ns = 1000;
+    for (const auto& p : expected) writer.write(p.data(), p.size(), std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ns += 125000)));
+  }
+  for (CaptureFormat format : {CAPTURE_TIMED, CAPTURE_HEX, CAPTURE_TSHARK, CAPTURE_PCAP}) {
+    const std::string text = temp_path("text");
+    const std::string back = temp_path("back.uvcrec");
+    convert(record, text, format);
+    ConvertOptions options;
+    options.config = config.stream_config();
+    convert(text, back, CAPTURE_RECORD, options);
+    EXPECT_EQ(read_record(back), expected) << capture_format_name(format);
+    std::remove(text.c_str());
+    std::remove(back.c_str());
+  }
+  std::remove(record.c_str());
+}
+
+TEST(capture_convert_test, hexdump_text_gives_packets_and_payloads) {
+  // Wireshark hex dump of one usbmon iso URB, like tests/change_shark/input.txt
+  const std::vector<u_char> urb = usbmon_urb('C', 0x00, 0x81, 1, nullptr, iso_payloads, {});
+  std::string dump;
+  for (size_t offset = 0; offset < urb.size(); offset += 16) {
+    char line[24];
+    std::snprintf(line, sizeof(line), "%04zx  ", offset);
+    dump += line;
+    for (size_t i = offset; i < std::min(offset + 16, urb.size()); ++i) {
+      std::snprintf(line, sizeof(line), " %02x", urb[i]);
+      dump += line;
+    }
+    dump += "\n";
+  }
+  const std::string in = temp_path("dump.txt");
+  const std::string out = temp_path("dump.out");
+  write_file(in, dump + "\n" + dump);
+
+  convert(in, out, CAPTURE_PACKET_HEX);
+  std::string line;
+  std::istringstream packets(read_file(out));
+  int count = 0;
+  while (std::getline(packets, line)) {
+    std::vector<u_char> bytes;
+    std::istringstream tokens(line);
+    std::string token;
+    while (tokens >> token) hex_string_to_bytes_append(token, bytes);
+    EXPECT_EQ(bytes, urb);
+    ++count;
+  }
+  EXPECT_EQ(count, 2);
+
+  convert(in, out, CAPTURE_HEX);
+  std::istringstream lines(read_file(out));
+  Payloads payloads;
+  while (std::getline(lines, line)) {
+    payloads.emplace_back();
+    hex_string_to_bytes_append(line, payloads.back());
+  }
+  Payloads twice = iso_payloads;
+  twice.insert(twice.end(), iso_payloads.begin(), iso_payloads.end());
+  EXPECT_EQ(payloads, twice);
+  std::remove(in.c_str());
+  std::remove(out.c_str());
+}
+
+TEST(capture_convert_test, dissection_text_keeps_completed_in_transfers) {
+  const std::string text =
+      "Frame 1: 1100 bytes on wire (8800 bits), 1100 bytes captured (8800 bits) on interface usbmon1, id 0\n"
+      "    Epoch Arrival Time: 1727331234.500000001\n"
+      "USB URB\n"
+      "    URB type: URB_COMPLETE ('C')\n"
+      "    URB transfer type: URB_ISOCHRONOUS (0x00)\n"
+      "    Endpoint: 0x81, Direction: IN\n"
+      "    Device: 3\n"
+      "    URB bus id: 1\n"
+      "    ISO Descriptor: Offset=0 Length=14 Status=Success\n"
+      "        ISO Data: 0c8d0102030405060708090a\n"
+      "        aabb\n"
+      "    ISO Descriptor: Offset=14 Length=3 Status=Success\n"
+      "        ISO Data: 028fcc\n"
+      "\n"
+      "Frame 2: 64 bytes on wire (512 bits), 64 bytes captured (512 bits) on interface usbmon1, id 0\n"
+      "    Epoch Arrival Time: 1727331234.600000000\n"
+      "    URB type: URB_SUBMIT ('S')\n"
+      "    URB transfer type: URB_ISOCHRONOUS (0x00)\n"
+      "    Endpoint: 0x81, Direction: IN\n"
+      "        ISO Data: 0c8d0102030405060708090a\n"
+      "\n";
+  const std::string in = temp_path("dissection.txt");
+  const std::string out = temp_path("dissection.timed");
+  write_file(in, text);
+  const ConvertStats stats = convert(in, out, CAPTURE_TIMED);
+  EXPECT_EQ(read_file(out),
+            "Converted Monotonic Time: 1727331234.500000001 seconds\n0c8d0102030405060708090aaabb\n"
+            "Converted Monotonic Time: 1727331234.500000001 seconds\n028fcc\n");
+  EXPECT_EQ(stats.packets, 2u);
+  EXPECT_EQ(stats.skipped, 1u);
+  std::remove(in.c_str());
+  std::remove(out.c_str());
+}
+
+TEST(capture_convert_test, usbmon_descriptors_and_commit_set_the_record_header) {
+  // Configuration descriptor: VS interface, MJPEG format 2 with frame 3 at 640x480
+  std::vector<u_char> descriptors = {9, 2, 0, 0, 1, 1, 0, 0x80, 50};
+  descriptors.insert(descriptors.end(), {9, 4, 1, 0, 1, 0x0E, 0x02, 0, 0});
+  descriptors.insert(descriptors.end(), {11, 0x24, 0x06, 2, 1, 0, 1, 0, 0, 0, 0});
+  descriptors.insert(descriptors.end(), {30, 0x24, 0x07, 3, 0, 0x80, 0x02, 0xE0, 0x01});
+  descriptors.resize(descriptors.size() + 21, 0);
+  descriptors[2] = static_cast<u_char>(descriptors.size());
+
+  const u_char get_descriptor[8] = {0x80, 0x06, 0x00, 0x02, 0, 0, 0xff, 0};
+  const u_char set_commit[8] = {0x21, 0x01, 0x00, 0x02, 1, 0, 34, 0};
+  std::vector<u_char> commit;
+  put(commit, 1, 2);
+  commit.push_back(2);
+  commit.push_back(3);
+  put(commit, 333333, 4);     // 30 fps
+  put(commit, 0, 10);
+  put(commit, 614400, 4);     // dwMaxVideoFrameSize
+  put(commit, 3072, 4);       // dwMaxPayloadTransferSize
+  put(commit, 48000000, 4);   // dwClockFrequency
+  put(commit, 0, 4);
+
+  const std::string in = temp_path("control.pcap");
+  const std::string out = temp_path("control.uvcrec");
+  write_file(in, pcap_file(220, {
+      usbmon_urb('S', 0x02, 0x80, 7, get_descriptor, {}, {}),
+      usbmon_urb('C', 0x02, 0x80, 7, nullptr, {}, descriptors),
+      usbmon_urb('S', 0x02, 0x00, 8, set_commit, {}, commit),
+      usbmon_urb('C', 0x00, 0x81, 9, nullptr, iso_payloads, {}),
+  }));
+  const ConvertStats stats = convert(in, out, CAPTURE_RECORD);
+  StreamConfig config;
+  EXPECT_EQ(read_record(out, &config), iso_payloads);
+  EXPECT_EQ(stats.configs, 1u);
+  EXPECT_EQ(config.width, 640);
+  EXPECT_EQ(config.height, 480);
+  EXPECT_EQ(config.format, FRAME_FORMAT_MJPEG);
+  EXPECT_EQ(config.fps, 30);
+  EXPECT_EQ(config.dwMaxVideoFrameSize, 614400u);
+  EXPECT_EQ(config.dwMaxPayloadTransferSize, 3072u);
+  EXPECT_EQ(config.dwTimeFrequency, 48000000u);
+  std::remove(in.c_str());
+  std::remove(out.c_str());
+}
+
+TEST(capture_convert_test, usbpcap_iso_packets_split_into_payloads) {
+  // USBPcap header (27 bytes) + iso header (12) + one 12 byte descriptor per packet
+  std::vector<u_char> packet;
+  const size_t header = 27 + 12 + 12 * iso_payloads.size();
+  size_t data = 0;
+  for (const auto& p : iso_payloads) data += p.size();
+  put(packet, header, 2);
+  put(packet, 0x1234, 8);
+  put(packet, 0, 4);
+  put(packet, 0x000A, 2);   // URB_FUNCTION_ISOCH_TRANSFER
+  packet.push_back(1);      // completion
+  put(packet, 1, 2);
+  put(packet, 5, 2);
+  packet.push_back(0x81);
+  packet.push_back(0x00);
+  put(packet, data, 4);
+  put(packet, 0, 4);
+  put(packet, iso_payloads.size(), 4);
+  put(packet, 0, 4);
+  for (size_t i = 0, offset = 0; i < iso_payloads.size(); offset += iso_payloads[i].size(), ++i) {
+    put(packet, offset, 4);
+    put(packet, iso_payloads[i].size(), 4);
+    put(packet, 0, 4);
+  }
+  for (const auto& p : iso_payloads) packet.insert(packet.end(), p.begin(), p.end());
+
+  const std::string in = temp_path("usbpcap.pcap");
+  const std::string out = temp_path("usbpcap.uvcrec");
+  write_file(in, pcap_file(249, {packet}));
+  const ConvertStats stats = convert(in, out, CAPTURE_RECORD);
+  EXPECT_EQ(read_record(out), iso_payloads);
+  EXPECT_EQ(stats.stream, (1u << 16) | (5u << 8) | 0x81);
+  std::remove(in.c_str());
+  std::remove(out.c_str());
+}
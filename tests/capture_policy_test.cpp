@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include "validuvc/capture_policy.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+DevelopJob make_job(int frame_number) {
+  DevelopJob job;
+  job.format.frame_number = frame_number;
+  job.data.push_back(std::vector<u_char>(8, static_cast<u_char>(frame_number)));
+  return job;
+}
+
+// Same order as UVCPHeaderChecker::capture_frame: release what closed, then decide
+void offer(CapturePolicy& policy, int frame_number, Clock::time_point now, std::vector<int>& captured) {
+  std::vector<DevelopJob> released;
+  policy.release(now, released);
+  for (const DevelopJob& job : released) captured.push_back(job.format.frame_number);
+  switch (policy.decide(now)) {
+    case CAPTURE_NOW: captured.push_back(frame_number); break;
+    case CAPTURE_HOLD: policy.hold(make_job(frame_number)); break;
+    case CAPTURE_SKIP: break;
+  }
+}
+
+void flush(CapturePolicy& policy, std::vector<int>& captured) {
+  std::vector<DevelopJob> released;
+  policy.release(Clock::now(), released, true);
+  for (const DevelopJob& job : released) captured.push_back(job.format.frame_number);
+}
+
+CapturePolicyConfig parsed(const char* text) {
+  CapturePolicyConfig config;
+  EXPECT_TRUE(parse_capture_policy(text, config)) << text;
+  return config;
+}
+
+} // namespace
+
+TEST(capture_policy_test, parses_policies) {
+  EXPECT_EQ(parsed("all").sampling, CAPTURE_SAMPLE_ALL);
+  EXPECT_EQ(parsed("every:30").count, 30u);
+  EXPECT_EQ(parsed("rate:5").sampling, CAPTURE_SAMPLE_RATE);
+  EXPECT_EQ(parsed("reservoir:4:250").window, std::chrono::milliseconds(250));
+  EXPECT_EQ(capture_policy_name(parsed("burst:3")), "burst:3");
+
+  CapturePolicyConfig config;
+  EXPECT_FALSE(parse_capture_policy("every:0", config));
+  EXPECT_FALSE(parse_capture_policy("rate:5:100", config));
+  EXPECT_FALSE(parse_capture_policy("sometimes", config));
+
+  unsigned mask = 0;
+  EXPECT_FALSE(parse_capture_policies("error=every:2,bogus=all", mask));
+  ASSERT_TRUE(parse_capture_policies("error=burst:2,valid=every:30", mask));
+  EXPECT_EQ(mask, (1u << CAPTURE_ERROR) | (1u << CAPTURE_VALID));
+  EXPECT_EQ(capture_policy_config(CAPTURE_ERROR).sampling, CAPTURE_SAMPLE_BURST);
+  EXPECT_EQ(capture_policy_config(CAPTURE_VALID).count, 30u);
+  EXPECT_EQ(capture_policy_config(CAPTURE_SUSPICIOUS).sampling, CAPTURE_SAMPLE_ALL);
+  set_capture_policy_config(CAPTURE_ERROR, CapturePolicyConfig{});
+  set_capture_policy_config(CAPTURE_VALID, CapturePolicyConfig{});
+}
+
+TEST(capture_policy_test, every_nth_frame) {
+  CapturePolicy policy;
+  policy.configure(parsed("every:3"));
+  std::vector<int> captured;
+  const Clock::time_point now = Clock::now();
+  for (int frame = 0; frame < 10; ++frame) offer(policy, frame, now, captured);
+
+  EXPECT_EQ(captured, (std::vector<int>{0, 3, 6, 9}));
+  EXPECT_EQ(policy.counts().sampled, 4);
+  EXPECT_EQ(policy.counts().skipped, 6);
+}
+
+TEST(capture_policy_test, rate_limit_refills_per_second) {
+  CapturePolicy policy;
+  policy.configure(parsed("rate:5"));
+  std::vector<int> captured;
+  const Clock::time_point start = Clock::now();
+  // 100 frames in 100 ms, then another 100 one second later
+  for (int frame = 0; frame < 100; ++frame) {
+    offer(policy, frame, start + std::chrono::milliseconds(frame), captured);
+  }
+  EXPECT_EQ(captured.size(), 5u);
+  for (int frame = 100; frame < 200; ++frame) {
+    offer(policy, frame, start + std::chrono::milliseconds(1000 + frame), captured);
+  }
+  EXPECT_EQ(captured.size(), 10u);
+  EXPECT_EQ(policy.counts().sampled + policy.counts().skipped, 200);
+}
+
+TEST(capture_policy_test, reservoir_keeps_count_frames_per_window) {
+  CapturePolicy policy;
+  policy.configure(parsed("reservoir:4:100"));
+  std::vector<int> captured;
+  const Clock::time_point start = Clock::now();
+  for (int frame = 0; frame < 50; ++frame) {
+    offer(policy, frame, start + std::chrono::milliseconds(frame), captured);
+  }
+  // The window is still open, nothing has left yet
+  EXPECT_TRUE(captured.empty());
+  EXPECT_EQ(policy.counts().held, 4);
+
+  // The first frame past the window releases the sample and opens the next window
+  offer(policy, 50, start + std::chrono::milliseconds(150), captured);
+  ASSERT_EQ(captured.size(), 4u);
+  EXPECT_EQ(std::set<int>(captured.begin(), captured.end()).size(), 4u);
+  for (size_t i = 0; i < captured.size(); ++i) {
+    EXPECT_LT(captured[i], 50);
+    if (i > 0) {
+      EXPECT_LT(captured[i - 1], captured[i]);
+    }
+  }
+
+  flush(policy, captured);
+  EXPECT_EQ(captured.back(), 50);
+  EXPECT_EQ(policy.counts().sampled, 5);
+  EXPECT_EQ(policy.counts().skipped, 46);
+  EXPECT_EQ(policy.counts().held, 0);
+}
+
+TEST(capture_policy_test, burst_keeps_head_and_tail) {
+  CapturePolicy policy;
+  policy.configure(parsed("burst:2"));
+  std::vector<int> captured;
+  const Clock::time_point now = Clock::now();
+  for (int frame = 0; frame < 10; ++frame) offer(policy, frame, now, captured);
+  EXPECT_EQ(captured, (std::vector<int>{0, 1}));
+
+  // A frame of another category ends the burst, the tail follows
+  policy.interrupt();
+  std::vector<DevelopJob> released;
+  policy.release(now, released);
+  for (const DevelopJob& job : released) captured.push_back(job.format.frame_number);
+  EXPECT_EQ(captured, (std::vector<int>{0, 1, 8, 9}));
+
+  // The next run starts with a fresh head
+  for (int frame = 20; frame < 23; ++frame) offer(policy, frame, now, captured);
+  flush(policy, captured);
+  EXPECT_EQ(captured, (std::vector<int>{0, 1, 8, 9, 20, 21, 22}));
+  EXPECT_EQ(policy.counts().sampled, 7);
+  EXPECT_EQ(policy.counts().skipped, 6);
+}
+
+TEST(capture_policy_test, skipped_frames_keep_their_bytes) {
+  CapturePolicy policy;
+  policy.configure(parsed("every:2"));
+  const Clock::time_point now = Clock::now();
+  EXPECT_EQ(policy.decide(now), CAPTURE_NOW);
+  EXPECT_EQ(policy.decide(now), CAPTURE_SKIP);
+  EXPECT_EQ(policy.counts().held, 0);
+}
+
+TEST(capture_policy_test, payload_demand_counts_registrations) {
+  PayloadDemand& demand = PayloadDemand::instance();
+  EXPECT_EQ(demand.mask(), 0u);
+  demand.add((1u << CAPTURE_ERROR) | (1u << CAPTURE_SUSPICIOUS));
+  demand.add(1u << CAPTURE_ERROR);
+  demand.remove((1u << CAPTURE_ERROR) | (1u << CAPTURE_SUSPICIOUS));
+  EXPECT_EQ(demand.mask(), 1u << CAPTURE_ERROR);
+  demand.remove(1u << CAPTURE_ERROR);
+  EXPECT_EQ(demand.mask(), 0u);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "validuvc/control_config.hpp"
+#include "validuvc/payload_record.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+
+// Replays every tests/corpus/*.uvcrec through UVCPHeaderChecker and compares the final
+// statistics and the per frame error sequence with the <name>.golden file next to it.
+// UVCFD_UPDATE_GOLDEN=1 rewrites the goldens instead of comparing them.
+// Throughput is printed and recorded per fixture; UVCFD_CORPUS_MIN_MBPS makes it a floor.
+
+#ifndef UVCFD_TEST_DATA_DIR
+#define UVCFD_TEST_DATA_DIR "tests"
+#endif
+
+namespace {
+
+std::vector<std::string> corpus_fixtures() {
+  std::vector<std::string> names;
+  const std::filesystem::path dir = std::filesystem::path(UVCFD_TEST_DATA_DIR) / "corpus";
+  if (std::filesystem::is_directory(dir)) {
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+      if (entry.path().extension() == ".uvcrec") names.push_back(entry.path().stem().string());
+    }
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+std::string fixture_path(const std::string& name, const char* extension) {
+  return (std::filesystem::path(UVCFD_TEST_DATA_DIR) / "corpus" / (name + extension)).string();
+}
+
+#define CORPUS_GOLDEN_LINE(field, metric, label) out << section << "." << metric << " " << counts.field << "\n";
+
+void write_frame(std::ostream& out, const char* kind, const ValidFrame& frame) {
+  out << kind << " " << frame.frame_number << " payloads " << frame.packet_number << " error "
+      << static_cast<int>(frame.frame_error) << " suspicious " << static_cast<int>(frame.frame_suspicious) << "\n";
+}
+
+// Golden text: statistics first, then one line per finished frame in completion order
+std::string replay_golden(PayloadRecordReader& reader) {
+  reader.rewind();
+  ControlConfig::instance().publish(reader.config());
+  RunFlags flags;
+  std::ostringstream frames;
+  std::ostringstream out;
+  {
+    UVCPHeaderChecker checker(flags);
+    std::vector<u_char> payload;
+    const u_char* data;
+    size_t size;
+    std::chrono::steady_clock::time_point time;
+    uint32_t last_frame = 0;
+    while (reader.next(data, size, time)) {
+      payload.assign(data, data + size);
+      checker.payload_valid_ctrl(payload, time);
+      for (const auto& frame : checker.processed_frames) {
+        if (frame->frame_number > last_frame) {
+          write_frame(frames, "frame", *frame);
+          last_frame = frame->frame_number;
+        }
+      }
+    }
+    for (const auto& frame : checker.frames) {
+      write_frame(frames, "open", *frame);
+    }
+
+    const char* section = "payload";
+    {
+      const PayloadErrorCounts counts = checker.payload_error_counts();
+      UVC_PAYLOAD_ERROR_COUNTERS(CORPUS_GOLDEN_LINE)
+    }
+    section = "frame";
+    {
+      const FrameErrorCounts counts = checker.frame_error_counts();
+      UVC_FRAME_ERROR_COUNTERS(CORPUS_GOLDEN_LINE)
+    }
+    section = "suspicious";
+    {
+      const FrameSuspiciousCounts counts = checker.frame_suspicious_counts();
+      UVC_FRAME_SUSPICIOUS_COUNTERS(CORPUS_GOLDEN_LINE)
+      out << "suspicious.unchecked " << counts.count_unchecked << "\n";
+    }
+  }
+  return out.str() + frames.str();
+}
+
+// Whole fixture passes with a fresh checker each, until enough time has passed to be measurable
+double replay_mbps(PayloadRecordReader& reader, uint64_t& payloads_per_second) {
+  ControlConfig::instance().publish(reader.config());
+  RunFlags flags;
+  std::vector<u_char> payload;
+  uint64_t bytes = 0;
+  uint64_t payloads = 0;
+  double seconds = 0;
+  for (int pass = 0; pass < 200 && seconds < 0.2; ++pass) {
+    reader.rewind();
+    UVCPHeaderChecker checker(flags);
+    const u_char* data;
+    size_t size;
+    std::chrono::steady_clock::time_point time;
+    const auto start = std::chrono::steady_clock::now();
+    while (reader.next(data, size, time)) {
+      payload.assign(data, data + size);
+      checker.payload_valid_ctrl(payload, time);
+      bytes += size;
+      ++payloads;
+    }
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  payloads_per_second = seconds > 0 ? static_cast<uint64_t>(payloads / seconds) : 0;
+  return seconds > 0 ? bytes * 8 / seconds / 1e6 : 0;
+}
+
+}  // namespace
+
+class corpus_test : public ::testing::TestWithParam<std::string> {
+ protected:
+  void SetUp() override { VerboseStream::verbose_level = 0; }
+};
+
+TEST_P(corpus_test, matches_golden) {
+  const std::string name = GetParam();
+  PayloadRecordReader reader;
+  ASSERT_TRUE(reader.open(fixture_path(name, ".uvcrec"))) << reader.error();
+
+  const std::string actual = replay_golden(reader);
+  EXPECT_TRUE(reader.error().empty()) << reader.error();
+
+  const std::string golden_path = fixture_path(name, ".golden");
+  const char* update = std::getenv("UVCFD_UPDATE_GOLDEN");
+  if (update && std::string(update) == "1") {
+    std::ofstream(golden_path, std::ios::binary) << actual;
+  } else {
+    std::ifstream golden_file(golden_path, std::ios::binary);
+    ASSERT_TRUE(golden_file.is_open()) << golden_path << " missing, run with UVCFD_UPDATE_GOLDEN=1";
+    std::stringstream expected;
+    expected << golden_file.rdbuf();
+
+    // First differing line, instead of two whole files
+    std::istringstream a(actual), e(expected.str());
+    std::string actual_line, expected_line;
+    int line = 1;
+    while (true) {
+      const bool more_a = static_cast<bool>(std::getline(a, actual_line));
+      const bool more_e = static_cast<bool>(std::getline(e, expected_line));
+      if (!more_a && !more_e) break;
+      ASSERT_EQ(actual_line, expected_line) << name << ".golden line " << line;
+      ++line;
+    }
+  }
+
+  uint64_t payloads_per_second = 0;
+  const double mbps = replay_mbps(reader, payloads_per_second);
+  std::cout << "[ corpus   ] " << name << ": " << mbps << " mbps, " << payloads_per_second << " payloads/s" << std::endl;
+  RecordProperty("mbps", std::to_string(static_cast<int64_t>(mbps)));
+  RecordProperty("payloads_per_second", std::to_string(payloads_per_second));
+  if (const char* floor = std::getenv("UVCFD_CORPUS_MIN_MBPS")) {
+    EXPECT_GE(mbps, std::atof(floor)) << name << " validated below the throughput floor";
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(fixtures, corpus_test, ::testing::ValuesIn(corpus_fixtures()),
+                         [](const ::testing::TestParamInfo<std::string>& info) { return info.param; });
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(corpus_test);
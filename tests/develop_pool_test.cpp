@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "develope_photo.hpp"
+#include "develope_queue.hpp"
+#include "frame_file.hpp"
+
+namespace {
+
+DevelopJob make_job(int frame_number, bool error_frame = false) {
+  DevelopJob job;
+  job.format.frame_number = frame_number;
+  job.format.width = 4;
+  job.format.height = 2;
+  job.format.format = FRAME_FORMAT_H264;
+  job.format.error_frame = error_frame;
+  job.data.push_back(std::vector<u_char>(16, static_cast<u_char>(frame_number)));
+  return job;
+}
+
+std::vector<int> drain(DevelopQueue& queue) {
+  std::vector<int> frames;
+  DevelopJob job;
+  while (queue.try_pop(job)) {
+    frames.push_back(job.format.frame_number);
+  }
+  return frames;
+}
+
+std::vector<u_char> read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<u_char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TEST(develop_queue_test, policy_names_round_trip) {
+  const DevelopDropPolicy policies[] = {DEVELOP_BLOCK, DEVELOP_DROP_NEWEST, DEVELOP_DROP_OLDEST, DEVELOP_KEEP_ERRORS};
+  for (DevelopDropPolicy policy : policies) {
+    DevelopDropPolicy parsed = DEVELOP_BLOCK;
+    ASSERT_TRUE(parse_develop_drop_policy(develop_drop_policy_name(policy), parsed));
+    EXPECT_EQ(parsed, policy);
+  }
+  DevelopDropPolicy parsed = DEVELOP_BLOCK;
+  EXPECT_FALSE(parse_develop_drop_policy("sometimes", parsed));
+}
+
+TEST(develop_queue_test, drop_newest_rejects_the_incoming_frame) {
+  DevelopQueue queue(2, DEVELOP_DROP_NEWEST);
+  EXPECT_TRUE(queue.push(make_job(1)));
+  EXPECT_TRUE(queue.push(make_job(2)));
+  EXPECT_FALSE(queue.push(make_job(3, true)));
+
+  DevelopQueueStats stats = queue.stats();
+  EXPECT_EQ(stats.dropped, 1u);
+  EXPECT_EQ(stats.dropped_errors, 1u);
+  EXPECT_EQ(stats.high_water, 2u);
+  EXPECT_EQ(drain(queue), (std::vector<int>{1, 2}));
+}
+
+TEST(develop_queue_test, drop_oldest_makes_room) {
+  DevelopQueue queue(2, DEVELOP_DROP_OLDEST);
+  for (int frame = 1; frame <= 5; ++frame) {
+    EXPECT_TRUE(queue.push(make_job(frame)));
+  }
+  EXPECT_EQ(queue.stats().dropped, 3u);
+  EXPECT_EQ(drain(queue), (std::vector<int>{4, 5}));
+}
+
+TEST(develop_queue_test, keep_errors_evicts_valid_frames_first) {
+  DevelopQueue queue(3, DEVELOP_KEEP_ERRORS);
+  EXPECT_TRUE(queue.push(make_job(1)));
+  EXPECT_TRUE(queue.push(make_job(2, true)));
+  EXPECT_TRUE(queue.push(make_job(3)));
+
+  // Full: an error frame pushes out the oldest valid one
+  EXPECT_TRUE(queue.push(make_job(4, true)));
+  // A valid frame still replaces a valid one
+  EXPECT_TRUE(queue.push(make_job(5)));
+  // Only error frames would be left to evict
+  EXPECT_TRUE(queue.push(make_job(6, true)));
+  EXPECT_FALSE(queue.push(make_job(7)));
+
+  DevelopQueueStats stats = queue.stats();
+  EXPECT_EQ(stats.dropped, 4u);
+  EXPECT_EQ(stats.dropped_errors, 0u);
+  EXPECT_EQ(drain(queue), (std::vector<int>{2, 4, 6}));
+
+  // With errors only, the oldest error frame goes
+  EXPECT_TRUE(queue.push(make_job(8, true)));
+  EXPECT_TRUE(queue.push(make_job(9, true)));
+  EXPECT_TRUE(queue.push(make_job(10, true)));
+  EXPECT_TRUE(queue.push(make_job(11, true)));
+  EXPECT_EQ(queue.stats().dropped_errors, 1u);
+  EXPECT_EQ(drain(queue), (std::vector<int>{9, 10, 11}));
+}
+
+TEST(develop_queue_test, block_waits_for_a_free_slot) {
+  DevelopQueue queue(1, DEVELOP_BLOCK);
+  ASSERT_TRUE(queue.push(make_job(1)));
+
+  std::atomic<bool> pushed{false};
+  std::thread producer([&]() {
+    EXPECT_TRUE(queue.push(make_job(2)));
+    pushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(pushed.load());
+
+  DevelopJob job;
+  ASSERT_TRUE(queue.pop(job));
+  EXPECT_EQ(job.format.frame_number, 1);
+  producer.join();
+  EXPECT_TRUE(pushed.load());
+  EXPECT_EQ(queue.stats().blocked, 1u);
+  EXPECT_EQ(queue.stats().dropped, 0u);
+
+  // Without a consumer the producer must not wait
+  EXPECT_FALSE(queue.push(make_job(3), false));
+  EXPECT_EQ(queue.stats().dropped, 1u);
+}
+
+TEST(develop_queue_test, close_releases_blocked_producers_and_consumers) {
+  DevelopQueue queue(1, DEVELOP_BLOCK);
+  ASSERT_TRUE(queue.push(make_job(1)));
+
+  std::thread producer([&]() { EXPECT_FALSE(queue.push(make_job(2))); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.close();
+  producer.join();
+
+  DevelopJob job;
+  EXPECT_TRUE(queue.pop(job));
+  EXPECT_FALSE(queue.pop(job));
+
+  queue.reopen();
+  EXPECT_TRUE(queue.push(make_job(3)));
+}
+
+TEST(develop_pool_test, workers_develop_every_queued_frame) {
+  DevFImage& dev_f_image = DevFImage::instance();
+  dev_f_image.dev_f_image_queue.configure(4, DEVELOP_BLOCK);
+  dev_f_image.start_workers(3);
+  EXPECT_EQ(dev_f_image.worker_count(), 3);
+
+  const uint64_t before = dev_f_image.developed_frames();
+  const int frames = 64;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < 2; ++p) {
+    producers.emplace_back([&dev_f_image, p]() {
+      for (int i = 0; i < frames / 2; ++i) {
+        DevelopJob job = make_job(p * 1000 + i);
+        EXPECT_TRUE(dev_f_image.queue_frame(job.format, std::move(job.data)));
+      }
+    });
+  }
+  for (auto& producer : producers) producer.join();
+  dev_f_image.stop_workers(true);
+
+  EXPECT_EQ(dev_f_image.worker_count(), 0);
+  EXPECT_EQ(dev_f_image.developed_frames() - before, static_cast<uint64_t>(frames));
+  DevelopQueueStats stats = dev_f_image.dev_f_image_queue.stats();
+  EXPECT_EQ(stats.depth, 0u);
+  EXPECT_EQ(stats.dropped, 0u);
+  EXPECT_LE(stats.high_water, 4u);
+}
+
+TEST(frame_file_test, segments_are_written_back_to_back) {
+  // More segments than one writev takes, some of them empty
+  std::vector<std::vector<u_char>> segments;
+  std::vector<u_char> expected;
+  for (int i = 0; i < 3000; ++i) {
+    segments.emplace_back(static_cast<size_t>(i % 7), static_cast<u_char>(i));
+    expected.insert(expected.end(), segments.back().begin(), segments.back().end());
+  }
+  const std::string path = "develop_pool_test_frame.jpg";
+  ASSERT_TRUE(write_frame_file(path, segments));
+  EXPECT_EQ(read_file(path), expected);
+
+  // Rewriting truncates
+  ASSERT_TRUE(write_frame_file(path, std::vector<std::vector<u_char>>{{1, 2, 3}}));
+  EXPECT_EQ(read_file(path), (std::vector<u_char>{1, 2, 3}));
+  std::remove(path.c_str());
+}
+
+TEST(frame_file_test, fsync_batches_keep_every_frame) {
+  set_frame_fsync_every(3);
+  std::vector<std::string> paths;
+  for (int i = 0; i < 5; ++i) {
+    paths.push_back("develop_pool_test_sync_" + std::to_string(i) + ".jpg");
+    const u_char byte = static_cast<u_char>(i);
+    const FrameSegment segment = {&byte, 1};
+    ASSERT_TRUE(write_frame_file(paths.back(), &segment, 1));
+  }
+  sync_frame_files();
+  set_frame_fsync_every(0);
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(read_file(paths[i]), (std::vector<u_char>{static_cast<u_char>(i)}));
+    std::remove(paths[i].c_str());
+  }
+  EXPECT_FALSE(write_frame_file("no_such_directory/frame.jpg", std::vector<std::vector<u_char>>{{1}}));
+}
+
+#ifndef _WIN32
+TEST(frame_file_test, fsync_batches_stay_under_the_descriptor_limit) {
+  rlimit saved{};
+  ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &saved), 0);
+  rlimit lowered = saved;
+  lowered.rlim_cur = 32;
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+
+  // A batch far above the limit must not hold a descriptor per frame
+  set_frame_fsync_every(1000);
+  std::vector<std::string> paths;
+  for (int i = 0; i < 48; ++i) {
+    paths.push_back("develop_pool_test_limit_" + std::to_string(i) + ".jpg");
+    const u_char byte = static_cast<u_char>(i);
+    const FrameSegment segment = {&byte, 1};
+    EXPECT_TRUE(write_frame_file(paths.back(), &segment, 1)) << paths.back();
+  }
+  sync_frame_files();
+  set_frame_fsync_every(0);
+  setrlimit(RLIMIT_NOFILE, &saved);
+
+  for (int i = 0; i < 48; ++i) {
+    EXPECT_EQ(read_file(paths[i]), (std::vector<u_char>{static_cast<u_char>(i)}));
+    std::remove(paths[i].c_str());
+  }
+}
+#endif
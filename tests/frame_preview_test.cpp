@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "frame_preview.hpp"
+#include "rgb_to_jpeg.hpp"
+#include "yuyv_to_rgb.hpp"
+
+namespace {
+
+DevelopFrameFormat rgb_format(int frame_number, int width, int height) {
+  DevelopFrameFormat frame;
+  frame.frame_number = frame_number;
+  frame.width = width;
+  frame.height = height;
+  frame.format = FRAME_FORMAT_RGB;
+  frame.error_frame = true;
+  return frame;
+}
+
+// Every byte of the frame carries its frame number
+std::vector<std::vector<u_char>> filled_rgb(int frame_number, int width, int height) {
+  return {std::vector<u_char>(size_t(width) * height * 3, static_cast<u_char>(frame_number))};
+}
+
+} // namespace
+
+TEST(frame_preview_test, only_wanted_frames_once_enabled) {
+  FramePreview& preview = FramePreview::instance();
+  DevelopFrameFormat frame = rgb_format(1, 4, 2);
+  preview.set_enabled(false);
+  EXPECT_FALSE(preview.wants(frame));
+
+  preview.set_enabled(true);
+  preview.set_errors_only(true);
+  EXPECT_TRUE(preview.wants(frame));
+  frame.error_frame = false;
+  EXPECT_FALSE(preview.wants(frame));
+  preview.set_errors_only(false);
+  EXPECT_TRUE(preview.wants(frame));
+  preview.set_errors_only(true);
+}
+
+TEST(frame_preview_test, reader_gets_the_latest_frame_once) {
+  FramePreview& preview = FramePreview::instance();
+  preview.set_enabled(true);
+  while (preview.acquire()) {
+  }
+
+  for (int frame = 10; frame < 13; ++frame) {
+    ASSERT_TRUE(preview.publish(rgb_format(frame, 5, 3), filled_rgb(frame, 5, 3)));
+  }
+  ASSERT_TRUE(preview.acquire());
+  EXPECT_EQ(preview.front().frame_number, 12);
+  EXPECT_EQ(preview.front().width, 5);
+  EXPECT_EQ(preview.front().height, 3);
+  EXPECT_EQ(preview.front().rgb, filled_rgb(12, 5, 3)[0]);
+  EXPECT_FALSE(preview.acquire());
+  EXPECT_EQ(preview.front().frame_number, 12);
+}
+
+TEST(frame_preview_test, mjpeg_frames_are_decoded) {
+  const int width = 64;
+  const int height = 32;
+  std::vector<u_char> rgb(size_t(width) * height * 3);
+  for (size_t i = 0; i < rgb.size(); i += 3) {
+    rgb[i] = 200;
+    rgb[i + 1] = 40;
+    rgb[i + 2] = 90;
+  }
+  JpegEncoder& encoder = JpegEncoder::thread_instance();
+  ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, JpegSettings{}));
+  // Split like payloads
+  const std::vector<u_char> jpeg(encoder.data(), encoder.data() + encoder.size());
+  std::vector<std::vector<u_char>> payloads;
+  for (size_t offset = 0; offset < jpeg.size(); offset += 100) {
+    payloads.emplace_back(jpeg.begin() + offset, jpeg.begin() + std::min(jpeg.size(), offset + 100));
+  }
+
+  DevelopFrameFormat frame = rgb_format(20, width, height);
+  frame.format = FRAME_FORMAT_MJPEG;
+  FramePreview& preview = FramePreview::instance();
+  preview.set_enabled(true);
+  ASSERT_TRUE(preview.publish(frame, payloads));
+  ASSERT_TRUE(preview.acquire());
+  const PreviewFrame& decoded = preview.front();
+  EXPECT_EQ(decoded.frame_number, 20);
+  ASSERT_EQ(decoded.rgb.size(), rgb.size());
+  for (size_t i = 0; i < rgb.size(); ++i) {
+    ASSERT_NEAR(decoded.rgb[i], rgb[i], 6) << i;
+  }
+}
+
+TEST(frame_preview_test, frames_never_tear_under_concurrent_publish) {
+  FramePreview& preview = FramePreview::instance();
+  preview.set_enabled(true);
+  while (preview.acquire()) {
+  }
+
+  const int width = 64;
+  const int height = 48;
+  const int frames = 2000;
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int frame = 0; frame < frames; ++frame) {
+      preview.publish(rgb_format(frame, width, height), filled_rgb(frame, width, height));
+    }
+    done = true;
+  });
+
+  int last = -1;
+  int seen = 0;
+  for (;;) {
+    const bool finished = done.load();
+    if (!preview.acquire()) {
+      if (finished) break;
+      std::this_thread::yield();
+      continue;
+    }
+    const PreviewFrame& frame = preview.front();
+    ASSERT_GT(frame.frame_number, last);
+    last = frame.frame_number;
+    const u_char expected = static_cast<u_char>(frame.frame_number);
+    for (u_char value : frame.rgb) {
+      ASSERT_EQ(value, expected) << "frame " << frame.frame_number;
+    }
+    ++seen;
+  }
+  writer.join();
+  EXPECT_EQ(preview.front().frame_number, frames - 1);
+  EXPECT_GT(seen, 0);
+}
+
+TEST(frame_preview_test, large_frames_are_scaled_while_they_cover_the_target) {
+  FramePreview& preview = FramePreview::instance();
+  EXPECT_EQ(preview.scale_for(3840, 2160), 8);
+  EXPECT_EQ(preview.scale_for(1920, 1080), 4);
+  EXPECT_EQ(preview.scale_for(1280, 720), 4);
+  EXPECT_EQ(preview.scale_for(640, 480), 2);
+  EXPECT_EQ(preview.scale_for(320, 240), 1);
+  preview.set_target_size(0, 0);
+  EXPECT_EQ(preview.scale_for(1920, 1080), 8);
+  preview.set_target_size(1920, 1080);
+  EXPECT_EQ(preview.scale_for(1920, 1080), 1);
+  preview.set_target_size(PREVIEW_TARGET_WIDTH, PREVIEW_TARGET_HEIGHT);
+}
+
+TEST(frame_preview_test, mjpeg_and_yuyv_previews_are_downscaled) {
+  const int width = 1280;
+  const int height = 720;
+  std::vector<u_char> rgb(size_t(width) * height * 3, 128);
+  JpegEncoder& encoder = JpegEncoder::thread_instance();
+  ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, JpegSettings{}));
+
+  FramePreview& preview = FramePreview::instance();
+  preview.set_enabled(true);
+  DevelopFrameFormat frame = rgb_format(30, width, height);
+  frame.format = FRAME_FORMAT_MJPEG;
+  ASSERT_TRUE(preview.publish(frame, {std::vector<u_char>(encoder.data(), encoder.data() + encoder.size())}));
+  std::shared_ptr<const PreviewFrame> mjpeg = preview.find(30);
+  ASSERT_NE(mjpeg, nullptr);
+  EXPECT_EQ(mjpeg->scale, 4);
+  EXPECT_EQ(mjpeg->width, 320);
+  EXPECT_EQ(mjpeg->height, 180);
+  ASSERT_EQ(mjpeg->rgb.size(), size_t(320) * 180 * 3);
+  EXPECT_NEAR(mjpeg->rgb[size_t(90) * 320 * 3 + 160 * 3], 128, 3);
+
+  // Mid grey in studio range
+  std::vector<u_char> yuyv(size_t(width) * height * 2);
+  for (size_t i = 0; i < yuyv.size(); i += 2) {
+    yuyv[i] = 126;
+    yuyv[i + 1] = 128;
+  }
+  frame.frame_number = 31;
+  frame.format = FRAME_FORMAT_YUYV;
+  ASSERT_TRUE(preview.publish(frame, {yuyv}));
+  std::shared_ptr<const PreviewFrame> scaled = preview.find(31);
+  ASSERT_NE(scaled, nullptr);
+  EXPECT_EQ(scaled->scale, 4);
+  EXPECT_EQ(scaled->width, 320);
+  EXPECT_EQ(scaled->height, 180);
+  const std::vector<u_char> expected = convertYUYVtoRGB(std::vector<u_char>{126, 128, 126, 128}, 2, 1);
+  EXPECT_EQ(scaled->rgb[0], expected[0]);
+  EXPECT_EQ(scaled->rgb.back(), expected[5]);
+}
+
+TEST(frame_preview_test, cache_evicts_the_least_recently_used_frame) {
+  PreviewCache cache(3);
+  for (int frame_number = 1; frame_number <= 3; ++frame_number) {
+    auto frame = std::make_shared<PreviewFrame>();
+    frame->frame_number = frame_number;
+    cache.put(frame);
+  }
+  ASSERT_NE(cache.get(1), nullptr);   // 1 becomes the most recent, 2 the oldest
+
+  auto fourth = std::make_shared<PreviewFrame>();
+  fourth->frame_number = 4;
+  cache.put(fourth);
+  EXPECT_EQ(cache.size(), 3u);
+  EXPECT_EQ(cache.get(2), nullptr);
+  EXPECT_NE(cache.get(1), nullptr);
+  EXPECT_NE(cache.get(3), nullptr);
+  EXPECT_NE(cache.get(4), nullptr);
+
+  // A reader keeps its preview after eviction
+  std::shared_ptr<const PreviewFrame> held = cache.get(1);
+  cache.set_capacity(1);
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(held->frame_number, 1);
+
+  auto replaced = std::make_shared<PreviewFrame>();
+  replaced->frame_number = 1;
+  replaced->width = 9;
+  cache.put(replaced);
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(cache.get(1)->width, 9);
+  EXPECT_GT(cache.hits(), 0u);
+  EXPECT_GT(cache.misses(), 0u);
+}
+
+TEST(frame_preview_test, cache_generation_moves_only_on_put) {
+  PreviewCache cache(2);
+  const uint64_t start = cache.generation();
+  EXPECT_EQ(cache.get(7), nullptr);
+  EXPECT_EQ(cache.generation(), start);
+
+  auto frame = std::make_shared<PreviewFrame>();
+  frame->frame_number = 7;
+  cache.put(frame);
+  EXPECT_EQ(cache.generation(), start + 1);
+  EXPECT_NE(cache.get(7), nullptr);
+  EXPECT_EQ(cache.generation(), start + 1);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "rgb_to_jpeg.hpp"
+#include "yuyv_to_rgb.hpp"
+
+namespace {
+
+std::vector<u_char> gradient_yuyv(int width, int height) {
+  std::vector<u_char> yuyv(size_t(width) * height * 2);
+  for (int row = 0; row < height; ++row) {
+    for (int x = 0; x < width; x += 2) {
+      u_char* p = &yuyv[(size_t(row) * width + x) * 2];
+      p[0] = p[2] = static_cast<u_char>(16 + (x + row) * 200 / (width + height));
+      p[1] = static_cast<u_char>(64 + x * 128 / width);
+      p[3] = static_cast<u_char>(64 + row * 128 / height);
+    }
+  }
+  return yuyv;
+}
+
+// Subsampling of a compressed image, -1 when it does not decode
+int decoded_subsampling(const JpegEncoder& encoder, int width, int height) {
+  tjhandle decompressor = tjInitDecompress();
+  int jpeg_width = 0, jpeg_height = 0, subsampling = -1, colorspace = -1;
+  int result = tjDecompressHeader3(decompressor, encoder.data(), encoder.size(), &jpeg_width, &jpeg_height,
+                                   &subsampling, &colorspace);
+  std::vector<u_char> rgb(size_t(width) * height * 3);
+  if (result == 0) result = tjDecompress2(decompressor, encoder.data(), encoder.size(), rgb.data(), width, 0, height, TJPF_RGB, 0);
+  tjDestroy(decompressor);
+  EXPECT_EQ(jpeg_width, width);
+  EXPECT_EQ(jpeg_height, height);
+  return result == 0 ? subsampling : -1;
+}
+
+}  // namespace
+
+TEST(jpeg_encoder_test, frames_reuse_the_handle_and_output_buffer) {
+  const int width = 640, height = 480;
+  const std::vector<u_char> rgb = convertYUYVtoRGB(gradient_yuyv(width, height), width, height);
+  JpegEncoder& encoder = JpegEncoder::thread_instance();
+  ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, JpegSettings{}));
+  const u_char* buffer = encoder.data();
+  const unsigned long size = encoder.size();
+  for (int frame = 0; frame < 5; ++frame) {
+    ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, JpegSettings{}));
+    EXPECT_EQ(encoder.data(), buffer);
+    EXPECT_EQ(encoder.size(), size);
+  }
+  EXPECT_EQ(decoded_subsampling(encoder, width, height), TJSAMP_444);
+
+  // Smaller frames keep the buffer, another thread has its own encoder
+  ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width / 2, height / 2, JpegSettings{}));
+  EXPECT_EQ(encoder.data(), buffer);
+  const u_char* other = nullptr;
+  std::thread([&]() {
+    JpegEncoder& mine = JpegEncoder::thread_instance();
+    ASSERT_TRUE(mine.compress_rgb(rgb.data(), width, height, JpegSettings{}));
+    other = mine.data();
+  }).join();
+  EXPECT_NE(other, buffer);
+}
+
+TEST(jpeg_encoder_test, settings_change_quality_subsampling_and_dct) {
+  const int width = 320, height = 240;
+  const std::vector<u_char> yuyv = gradient_yuyv(width, height);
+  const std::vector<u_char> rgb = convertYUYVtoRGB(yuyv, width, height);
+  const size_t pixels = size_t(width) * height;
+  std::vector<u_char> planes(pixels * 2);
+  splitYUYVtoPlanes({yuyv}, width, height, &planes[0], &planes[pixels], &planes[pixels * 3 / 2]);
+  const u_char* plane_pointers[3] = {&planes[0], &planes[pixels], &planes[pixels * 3 / 2]};
+  JpegEncoder& encoder = JpegEncoder::thread_instance();
+
+  JpegSettings settings;
+  settings.quality = 95;
+  ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, settings));
+  const unsigned long high = encoder.size();
+  settings.quality = 30;
+  settings.fast_dct = false;
+  ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, settings));
+  EXPECT_LT(encoder.size(), high);
+
+  ASSERT_TRUE(encoder.compress_yuv422(plane_pointers, width, height, settings));
+  EXPECT_EQ(decoded_subsampling(encoder, width, height), TJSAMP_422);
+  for (int subsampling : {TJSAMP_420, TJSAMP_GRAY}) {
+    settings.subsampling = subsampling;
+    ASSERT_TRUE(encoder.compress_yuv422(plane_pointers, width, height, settings));
+    EXPECT_EQ(decoded_subsampling(encoder, width, height), subsampling);
+    ASSERT_TRUE(encoder.compress_rgb(rgb.data(), width, height, settings));
+    EXPECT_EQ(decoded_subsampling(encoder, width, height), subsampling);
+  }
+  settings.subsampling = TJSAMP_444;
+  EXPECT_FALSE(encoder.compress_yuv422(plane_pointers, width, height, settings));
+
+  int parsed = 0;
+  EXPECT_TRUE(parse_jpeg_subsampling("420", parsed));
+  EXPECT_EQ(parsed, TJSAMP_420);
+  EXPECT_TRUE(parse_jpeg_subsampling("auto", parsed));
+  EXPECT_EQ(parsed, -1);
+  EXPECT_FALSE(parse_jpeg_subsampling("4:2:0", parsed));
+}
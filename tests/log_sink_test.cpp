@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/log_sink.hpp"
+#include "utils/mpsc_ring.hpp"
+
+TEST(mpsc_ring_test, full_ring_rejects_instead_of_blocking) {
+  MpscRing<int, 4> ring;
+  for (int i = 0; i < 4; ++i) {
+    int value = i;
+    EXPECT_TRUE(ring.try_push(std::move(value)));
+  }
+  int overflow = 99;
+  EXPECT_FALSE(ring.try_push(std::move(overflow)));
+
+  int out = -1;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.try_pop(out));
+    EXPECT_EQ(out, i);
+  }
+  EXPECT_FALSE(ring.try_pop(out));
+}
+
+TEST(mpsc_ring_test, producers_keep_their_own_order) {
+  MpscRing<int, 1024> ring;
+  const int producers = 4;
+  const int per_producer = 20000;
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&ring, p]() {
+      for (int i = 0; i < per_producer; ++i) {
+        int value = p * per_producer + i;
+        while (!ring.try_push(std::move(value))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<int> last(producers, -1);
+  int received = 0;
+  int out = 0;
+  while (received < producers * per_producer) {
+    if (!ring.try_pop(out)) {
+      std::this_thread::yield();
+      continue;
+    }
+    int p = out / per_producer;
+    EXPECT_GT(out % per_producer, last[p]);
+    last[p] = out % per_producer;
+    ++received;
+  }
+  for (auto& t : threads) t.join();
+  EXPECT_EQ(received, producers * per_producer);
+}
+
+TEST(log_sink_test, file_records_are_joined_in_order) {
+  std::ostringstream file;
+  for (int i = 0; i < 100; ++i) {
+    LogRecord record;
+    record.target = LOG_TARGET_FILE;
+    record.stream = &file;
+    record.text = "line " + std::to_string(i) + "\n";
+    LogSink::instance().submit(std::move(record));
+  }
+  LogSink::instance().flush();
+
+  std::istringstream lines(file.str());
+  std::string line;
+  int expected = 0;
+  while (std::getline(lines, line)) {
+    EXPECT_EQ(line, "line " + std::to_string(expected));
+    ++expected;
+  }
+  EXPECT_EQ(expected, 100);
+}
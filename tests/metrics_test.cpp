@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "utils/metrics.hpp"
+#include "utils/sharded_counter.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+
+TEST(sharded_counter_test, concurrent_adds_are_not_lost) {
+  ShardedCounter counter;
+  const int threads = 8;
+  const int per_thread = 100000;
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&counter]() {
+      for (int i = 0; i < per_thread; ++i) {
+        counter++;
+      }
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  EXPECT_EQ(counter.value(), static_cast<int64_t>(threads) * per_thread);
+}
+
+TEST(metrics_writer_test, samples_share_one_header) {
+  MetricsWriter writer;
+  writer.counter("uvcfd_test_total", "help text", {{"kind", "a"}}, 1);
+  writer.gauge("uvcfd_test_depth", "depth", {}, 2.5);
+  writer.counter("uvcfd_test_total", "help text", {{"kind", "b\"q"}}, 5000000000LL);
+
+  const std::string text = writer.str();
+  EXPECT_EQ(text,
+            "# HELP uvcfd_test_total help text\n"
+            "# TYPE uvcfd_test_total counter\n"
+            "uvcfd_test_total{kind=\"a\"} 1\n"
+            "uvcfd_test_total{kind=\"b\\\"q\"} 5000000000\n"
+            "# HELP uvcfd_test_depth depth\n"
+            "# TYPE uvcfd_test_depth gauge\n"
+            "uvcfd_test_depth 2.5\n");
+}
+
+TEST(metrics_registry_test, checker_counters_follow_checker_lifetime) {
+  std::string label;
+  {
+    UVCPHeaderChecker checker;
+    std::vector<u_char> empty_payload;
+    checker.payload_valid_ctrl(empty_payload, std::chrono::steady_clock::now());
+    checker.payload_valid_ctrl(empty_payload, std::chrono::steady_clock::now());
+
+    const std::string text = MetricsRegistry::instance().render();
+    size_t pos = text.find("uvcfd_payloads_total{checker=\"");
+    ASSERT_NE(pos, std::string::npos);
+    size_t open = text.find('{', pos);
+    label = text.substr(open, text.find('}', pos) - open + 1);  // {checker="N"}
+
+    EXPECT_NE(text.find("uvcfd_payloads_total" + label + " 2\n"), std::string::npos);
+    EXPECT_NE(text.find("uvcfd_payload_errors_total{" + label.substr(1, label.size() - 2) +
+                        ",error=\"empty_payload\"} 2\n"), std::string::npos);
+  }
+  EXPECT_EQ(MetricsRegistry::instance().render().find("uvcfd_payloads_total" + label), std::string::npos);
+}
+
+#ifndef _WIN32
+TEST(metrics_server_test, serves_metrics_over_http) {
+  int id = MetricsRegistry::instance().add_collector([](MetricsWriter& out) {
+    out.gauge("uvcfd_test_server_up", "set by the test", {}, 1);
+  });
+  ASSERT_TRUE(MetricsServer::instance().start("127.0.0.1:0"));
+  ASSERT_GT(MetricsServer::instance().port(), 0);
+
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(MetricsServer::instance().port()));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+  const std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(send(s, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+
+  std::string response;
+  char buffer[1024];
+  ssize_t n;
+  while ((n = recv(s, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, static_cast<size_t>(n));
+  }
+  close(s);
+
+  MetricsServer::instance().stop();
+  MetricsRegistry::instance().remove_collector(id);
+
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.0 200 OK"), 0);
+  EXPECT_NE(response.find("\r\n\r\n# HELP"), std::string::npos);
+  EXPECT_NE(response.find("uvcfd_test_server_up 1\n"), std::string::npos);
+}
+#endif
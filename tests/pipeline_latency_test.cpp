@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "utils/metrics.hpp"
+#include "utils/pipeline_latency.hpp"
+
+TEST(latency_histogram_test, buckets_keep_six_percent_resolution) {
+  for (uint64_t value : {0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 1000ULL, 123456789ULL, 1ULL << 40, ~0ULL}) {
+    size_t index = LatencyHistogram::bucket_index(value);
+    ASSERT_LT(index, LatencyHistogram::BUCKETS);
+    uint64_t upper = LatencyHistogram::bucket_upper(index);
+    EXPECT_GE(upper, value);
+    EXPECT_LE(upper - value, value / 16) << value;
+  }
+  EXPECT_EQ(LatencyHistogram::bucket_index(~0ULL), LatencyHistogram::BUCKETS - 1);
+}
+
+TEST(latency_histogram_test, percentiles_follow_the_distribution) {
+  LatencyHistogram histogram;
+  for (int i = 0; i < 990; ++i) histogram.record(100);
+  for (int i = 0; i < 9; ++i) histogram.record(10000);
+  histogram.record(1000000);
+
+  EXPECT_EQ(histogram.count(), 1000u);
+  EXPECT_NEAR(static_cast<double>(histogram.percentile_ticks(0.5)), 100.0, 100.0 / 16);
+  EXPECT_NEAR(static_cast<double>(histogram.percentile_ticks(0.99)), 100.0, 100.0 / 16);
+  EXPECT_NEAR(static_cast<double>(histogram.percentile_ticks(0.999)), 10000.0, 10000.0 / 16);
+  EXPECT_EQ(histogram.percentile_ticks(1.0), 1000000u);
+  EXPECT_EQ(histogram.max_ticks(), 1000000u);
+}
+
+TEST(pipeline_latency_test, stages_are_exported_as_summaries) {
+  PipelineLatency& latency = PipelineLatency::instance();
+  uint64_t before = latency.histogram(STAGE_DEVELOP_WAIT).count();
+  latency.record(STAGE_DEVELOP_WAIT, PipelineClock::now());
+  EXPECT_EQ(latency.histogram(STAGE_DEVELOP_WAIT).count(), before + 1);
+
+  const std::string text = MetricsRegistry::instance().render();
+  EXPECT_NE(text.find("# TYPE uvcfd_stage_latency_seconds summary\n"), std::string::npos);
+  EXPECT_NE(text.find("uvcfd_stage_latency_seconds{stage=\"develop_wait\",quantile=\"0.99\"}"), std::string::npos);
+  EXPECT_NE(text.find("uvcfd_stage_latency_seconds_count{stage=\"develop_wait\"} " + std::to_string(before + 1) + "\n"),
+            std::string::npos);
+}
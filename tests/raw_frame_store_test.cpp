@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raw_frame_store.hpp"
+
+namespace {
+
+std::string temp_base(const char* name) {
+  return std::string("/tmp/uvcfd_raw_") + name;
+}
+
+void remove_store(const std::string& base) {
+  std::remove((base + ".uvcraw").c_str());
+  std::remove((base + ".uvcridx").c_str());
+}
+
+uint64_t file_size(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return static_cast<uint64_t>(file.tellg());
+}
+
+DevelopFrameFormat frame_format(int frame_number, FrameFormat format, int error = 0) {
+  DevelopFrameFormat frame;
+  frame.frame_number = frame_number;
+  frame.width = 64;
+  frame.height = 48;
+  frame.format = format;
+  frame.frame_error = error;
+  frame.error_frame = error != 0;
+  frame.pts = 1000u * frame_number;
+  frame.first_received_ns = 1000000ll * frame_number;
+  frame.last_received_ns = 1000000ll * frame_number + 900000;
+  return frame;
+}
+
+// Payloads of uneven sizes, so frames never end on an aligned offset
+std::vector<std::vector<u_char>> payloads(int frame_number, size_t count) {
+  std::vector<std::vector<u_char>> data;
+  for (size_t i = 0; i < count; ++i) {
+    std::vector<u_char> payload(1000 + 37 * i);
+    for (size_t j = 0; j < payload.size(); ++j) {
+      payload[j] = static_cast<u_char>(frame_number * 7 + i * 13 + j);
+    }
+    data.push_back(std::move(payload));
+  }
+  return data;
+}
+
+std::vector<u_char> joined(const std::vector<std::vector<u_char>>& data) {
+  std::vector<u_char> out;
+  for (const auto& payload : data) out.insert(out.end(), payload.begin(), payload.end());
+  return out;
+}
+
+} // namespace
+
+TEST(raw_frame_store_test, frames_read_back_exactly_by_frame_number) {
+  const std::string base = temp_base("roundtrip");
+  {
+    RawFrameWriter writer;
+    ASSERT_TRUE(writer.open(base, 1 << 20));
+    for (int frame = 1; frame <= 20; ++frame) {
+      EXPECT_TRUE(writer.write(frame_format(frame, frame % 2 ? FRAME_FORMAT_YUYV : FRAME_FORMAT_MJPEG, frame == 7 ? 3 : 0),
+                               payloads(frame, static_cast<size_t>(frame))));
+    }
+    EXPECT_EQ(writer.frames(), 20u);
+  }
+
+  RawFrameReader reader;
+  ASSERT_TRUE(reader.open(base)) << reader.error();
+  ASSERT_EQ(reader.entries().size(), 20u);
+  for (const RawFrameEntry& entry : reader.entries()) {
+    EXPECT_EQ(entry.offset % RAW_FRAME_ALIGN, 0u);
+  }
+
+  const RawFrameEntry* entry = reader.find(7);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->format, FRAME_FORMAT_YUYV);
+  EXPECT_EQ(entry->frame_error, 3);
+  EXPECT_EQ(entry->width, 64);
+  EXPECT_EQ(entry->height, 48);
+  EXPECT_EQ(entry->pts, 7000u);
+  EXPECT_EQ(entry->first_received_ns, 7000000);
+  EXPECT_EQ(entry->last_received_ns, 7900000);
+  std::vector<u_char> data;
+  ASSERT_TRUE(reader.read(*entry, data));
+  EXPECT_EQ(data, joined(payloads(7, 7)));
+
+  ASSERT_TRUE(reader.read(*reader.find(20), data));
+  EXPECT_EQ(data, joined(payloads(20, 20)));
+  EXPECT_EQ(reader.find(21), nullptr);
+
+  // The preallocated tail is given back on close
+  const RawFrameEntry& last = reader.entries().back();
+  EXPECT_EQ(file_size(base + ".uvcraw"), (last.offset + last.size + RAW_FRAME_ALIGN - 1) / RAW_FRAME_ALIGN * RAW_FRAME_ALIGN);
+  remove_store(base);
+}
+
+TEST(raw_frame_store_test, concurrent_writers_keep_every_frame) {
+  const std::string base = temp_base("concurrent");
+  {
+    RawFrameWriter writer;
+    ASSERT_TRUE(writer.open(base, 0));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&writer, t]() {
+        for (int i = 0; i < 25; ++i) {
+          const int frame = t * 100 + i;
+          writer.write(frame_format(frame, FRAME_FORMAT_MJPEG), payloads(frame, 3));
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+
+  RawFrameReader reader;
+  ASSERT_TRUE(reader.open(base)) << reader.error();
+  ASSERT_EQ(reader.entries().size(), 100u);
+  std::vector<u_char> data;
+  for (const RawFrameEntry& entry : reader.entries()) {
+    ASSERT_TRUE(reader.read(entry, data));
+    EXPECT_EQ(data, joined(payloads(static_cast<int>(entry.frame_number), 3)));
+  }
+  remove_store(base);
+}
+
+TEST(raw_frame_store_test, partial_index_entry_is_ignored) {
+  const std::string base = temp_base("partial");
+  {
+    RawFrameWriter writer;
+    ASSERT_TRUE(writer.open(base, 0));
+    for (int frame = 0; frame < 3; ++frame) {
+      writer.write(frame_format(frame, FRAME_FORMAT_MJPEG), payloads(frame, 2));
+    }
+  }
+  {
+    // As if the process died while appending a fourth entry
+    std::ofstream index(base + ".uvcridx", std::ios::binary | std::ios::app);
+    const char partial[RAW_FRAME_INDEX_ENTRY / 2] = {};
+    index.write(partial, sizeof(partial));
+  }
+
+  RawFrameReader reader;
+  ASSERT_TRUE(reader.open(base)) << reader.error();
+  EXPECT_EQ(reader.entries().size(), 3u);
+  remove_store(base);
+}
+
+TEST(raw_frame_store_test, reader_rejects_other_files) {
+  const std::string base = temp_base("bogus");
+  {
+    std::ofstream index(base + ".uvcridx", std::ios::binary);
+    index << "not an index at all";
+  }
+  RawFrameReader reader;
+  EXPECT_FALSE(reader.open(base));
+  EXPECT_FALSE(reader.error().empty());
+  EXPECT_FALSE(reader.open(temp_base("missing")));
+  remove_store(base);
+}
+
+TEST(raw_frame_store_test, store_modes_parse) {
+  RawStoreMode mode = RAW_STORE_OFF;
+  EXPECT_TRUE(parse_raw_store_mode("errors", mode));
+  EXPECT_EQ(mode, RAW_STORE_ERRORS);
+  EXPECT_TRUE(parse_raw_store_mode("all", mode));
+  EXPECT_EQ(mode, RAW_STORE_ALL);
+  EXPECT_TRUE(parse_raw_store_mode("off", mode));
+  EXPECT_EQ(mode, RAW_STORE_OFF);
+  EXPECT_FALSE(parse_raw_store_mode("some", mode));
+}
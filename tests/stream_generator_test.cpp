@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/hex_bytes.hpp"
+#include "validuvc/control_config.hpp"
+#include "validuvc/stream_generator.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+
+namespace {
+
+GeneratorConfig small_stream(FrameFormat format, StreamTransfer transfer) {
+  GeneratorConfig config;
+  config.format = format;
+  config.transfer = transfer;
+  config.width = 320;
+  config.height = 240;
+  config.fps = 30;
+  config.max_payload_transfer_size = transfer == TRANSFER_ISO ? 3072 : 16384;
+  config.seed = 7;
+  return config;
+}
+
+// Payload validation results of every payload, per UVCError
+std::vector<int> run_checker(UVCStreamGenerator& generator, int frames, std::vector<GeneratedFrame>* truth = nullptr) {
+  VerboseStream::verbose_level = 0;
+  ControlConfig::instance().publish(generator.config().stream_config());
+  UVCPHeaderChecker checker;
+  std::vector<int> errors(ERR_UNKNOWN + 1, 0);
+  for (int f = 0; f < frames; ++f) {
+    const std::vector<PayloadView>& payloads = generator.next_frame();
+    if (truth) truth->push_back(generator.frame_truth());
+    for (const PayloadView& payload : payloads) {
+      std::vector<u_char> bytes(payload.data, payload.data + payload.size);
+      errors[checker.payload_valid_ctrl(bytes, payload.time)]++;
+    }
+  }
+  return errors;
+}
+
+}  // namespace
+
+TEST(stream_generator_test, clean_streams_validate_without_errors) {
+  const FrameFormat formats[] = {FRAME_FORMAT_YUYV, FRAME_FORMAT_MJPEG, FRAME_FORMAT_H264};
+  for (FrameFormat format : formats) {
+    for (StreamTransfer transfer : {TRANSFER_ISO, TRANSFER_BULK}) {
+      UVCStreamGenerator generator(small_stream(format, transfer));
+      std::vector<int> errors = run_checker(generator, 45);
+      int total = 0;
+      for (size_t e = 1; e < errors.size(); ++e) total += errors[e];
+      EXPECT_EQ(total, 0) << frame_format_name(format) << " transfer " << int(transfer);
+      EXPECT_EQ(generator.frames_generated(), 45u);
+    }
+  }
+}
+
+TEST(stream_generator_test, injected_payload_faults_are_detected) {
+  struct Case {
+    StreamFault fault;
+    UVCError expected;
+  };
+  const Case cases[] = {
+      {FAULT_EMPTY_PAYLOAD, ERR_EMPTY_PAYLOAD},       {FAULT_PAYLOAD_OVERFLOW, ERR_MAX_PAYLAOD_OVERFLOW},
+      {FAULT_ERR_BIT, ERR_ERR_BIT_SET},               {FAULT_LENGTH_OUT_OF_RANGE, ERR_LENGTH_OUT_OF_RANGE},
+      {FAULT_LENGTH_INVALID, ERR_LENGTH_INVALID},     {FAULT_RESERVED_BIT, ERR_RESERVED_BIT_SET},
+      {FAULT_FID_MISMATCH, ERR_FID_MISMATCH},         {FAULT_SWAP, ERR_SWAP},
+      {FAULT_MISSING_EOF, ERR_MISSING_EOF},
+  };
+  for (const Case& c : cases) {
+    GeneratorConfig config = small_stream(FRAME_FORMAT_YUYV, TRANSFER_ISO);
+    config.fault_probability[c.fault] = 0.2;
+    UVCStreamGenerator generator(config);
+
+    std::vector<GeneratedFrame> truth;
+    std::vector<int> errors = run_checker(generator, 120, &truth);
+
+    // A missing EOF only shows on the first payload of the next frame;
+    // a swapped frame never becomes the previous header, so each of its payloads is reported
+    int injected = 0;
+    for (size_t f = 0; f < truth.size(); ++f) {
+      if (!truth[f].has(c.fault) || (c.fault == FAULT_MISSING_EOF && f + 1 == truth.size())) continue;
+      injected += c.fault == FAULT_SWAP ? static_cast<int>(truth[f].payload_count) : 1;
+    }
+
+    EXPECT_GT(injected, 0) << stream_fault_name(c.fault);
+    EXPECT_EQ(errors[c.expected], injected) << stream_fault_name(c.fault);
+  }
+}
+
+TEST(stream_generator_test, same_seed_same_stream) {
+  GeneratorConfig config = small_stream(FRAME_FORMAT_MJPEG, TRANSFER_ISO);
+  for (int f = 0; f < FAULT_COUNT; ++f) config.fault_probability[f] = 0.05;
+  UVCStreamGenerator a(config);
+  UVCStreamGenerator b(config);
+  for (int f = 0; f < 30; ++f) {
+    const std::vector<PayloadView>& pa = a.next_frame();
+    const std::vector<PayloadView>& pb = b.next_frame();
+    ASSERT_EQ(pa.size(), pb.size());
+    EXPECT_EQ(a.frame_truth().faults, b.frame_truth().faults);
+    for (size_t i = 0; i < pa.size(); ++i) {
+      ASSERT_EQ(pa[i].size, pb[i].size);
+      EXPECT_EQ(std::memcmp(pa[i].data, pb[i].data, pa[i].size), 0);
+      EXPECT_EQ(pa[i].time, pb[i].time);
+    }
+  }
+}
+
+TEST(stream_generator_test, tshark_fields_carry_every_payload) {
+  GeneratorConfig config = small_stream(FRAME_FORMAT_YUYV, TRANSFER_ISO);
+  UVCStreamGenerator generator(config);
+  std::ostringstream text;
+  TsharkFieldsWriter writer(text, TRANSFER_ISO);
+
+  std::vector<std::vector<u_char>> expected;
+  for (int f = 0; f < 2; ++f) {
+    const std::vector<PayloadView>& payloads = generator.next_frame();
+    for (const PayloadView& p : payloads) expected.emplace_back(p.data, p.data + p.size);
+    writer.write(payloads);
+  }
+
+  // usb.transfer_type;frame.time_epoch;frame.len;usb.capdata;usb.iso.data
+  std::vector<std::vector<u_char>> parsed;
+  std::istringstream lines(text.str());
+  std::string line;
+  while (std::getline(lines, line)) {
+    ASSERT_EQ(line.compare(0, 5, "0x00;"), 0);
+    std::string iso = line.substr(line.rfind(';') + 1);
+    std::istringstream tokens(iso);
+    std::string token;
+    while (std::getline(tokens, token, ',')) {
+      std::vector<u_char> bytes;
+      hex_string_to_bytes_append(token, bytes);
+      parsed.push_back(bytes);
+    }
+  }
+  EXPECT_EQ(parsed, expected);
+}
+
+TEST(stream_generator_test, pcapng_bulk_urbs_reassemble_to_payloads) {
+  GeneratorConfig config = small_stream(FRAME_FORMAT_MJPEG, TRANSFER_BULK);
+  config.max_payload_transfer_size = 40000;
+  UVCStreamGenerator generator(config);
+  std::ostringstream out;
+  UsbmonPcapngWriter writer(out, TRANSFER_BULK, 1, 2, 0x81, 32, 16384);
+
+  std::vector<std::vector<u_char>> expected;
+  for (int f = 0; f < 3; ++f) {
+    const std::vector<PayloadView>& payloads = generator.next_frame();
+    for (const PayloadView& p : payloads) expected.emplace_back(p.data, p.data + p.size);
+    writer.write(payloads);
+  }
+
+  // Walk the blocks; full URBs continue a payload, a short one ends it (moncapler's rule)
+  const std::string file = out.str();
+  std::vector<std::vector<u_char>> parsed;
+  std::vector<u_char> current;
+  size_t offset = 0;
+  int blocks = 0;
+  while (offset + 12 <= file.size()) {
+    uint32_t type, length;
+    std::memcpy(&type, file.data() + offset, 4);
+    std::memcpy(&length, file.data() + offset + 4, 4);
+    ASSERT_EQ(length % 4, 0u);
+    if (type == 6) {
+      uint32_t captured;
+      std::memcpy(&captured, file.data() + offset + 20, 4);
+      const u_char* urb = reinterpret_cast<const u_char*>(file.data() + offset + 28);
+      EXPECT_EQ(urb[8], 'C');
+      EXPECT_EQ(urb[9], 0x03);
+      const size_t data = captured - 64;
+      current.insert(current.end(), urb + 64, urb + 64 + data);
+      if (data < 16384) {
+        parsed.push_back(current);
+        current.clear();
+      }
+    }
+    offset += length;
+    ++blocks;
+  }
+  EXPECT_EQ(offset, file.size());
+  EXPECT_GT(blocks, 2);
+  EXPECT_EQ(parsed, expected);
+}
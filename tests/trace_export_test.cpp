@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/trace_export.hpp"
+#include "validuvc/control_config.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+
+namespace {
+
+std::string read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+}  // namespace
+
+TEST(trace_export_test, writes_a_closed_chrome_trace_array) {
+  const std::string path = "trace_export_test.json";
+  TraceExporter& trace = TraceExporter::instance();
+  ASSERT_TRUE(trace.open(path));
+  EXPECT_FALSE(trace.open(path));
+
+  auto t0 = std::chrono::steady_clock::time_point(std::chrono::seconds(10));
+  trace.frame(7, t0, t0 + std::chrono::milliseconds(30), TRACE_FRAME_ERROR, 2, 99, 12, 4096);
+  trace.frame(8, t0 + std::chrono::milliseconds(33), t0 + std::chrono::milliseconds(60), TRACE_FRAME_VALID, 0, 0, 10, 4000);
+  trace.payload_error(t0 + std::chrono::milliseconds(5), 3, 1024);
+  trace.counter("packet_queue_depth", t0, 42);
+  trace.device_time(7, t0, std::chrono::steady_clock::time_point(std::chrono::milliseconds(500)));
+  trace.device_time(8, t0 + std::chrono::milliseconds(33),
+                    std::chrono::steady_clock::time_point(std::chrono::milliseconds(535)));
+  trace.close();
+  EXPECT_FALSE(trace.enabled());
+  EXPECT_EQ(trace.dropped_events(), 0u);
+
+  const std::string text = read_file(path);
+  std::remove(path.c_str());
+  ASSERT_FALSE(text.empty());
+  EXPECT_EQ(text.front(), '[');
+  EXPECT_EQ(text.substr(text.size() - 3), "\n]\n");
+  EXPECT_EQ(std::count(text.begin(), text.end(), '{'), std::count(text.begin(), text.end(), '}'));
+  EXPECT_EQ(text.find(",\n]"), std::string::npos);
+
+  EXPECT_NE(text.find("\"ph\":\"X\",\"pid\":1,\"tid\":1,\"name\":\"frame (error)\",\"ts\":10000000,\"dur\":30000,"
+                      "\"cname\":\"terrible\",\"args\":{\"frame\":7,\"error\":2,\"suspicious\":99,\"payloads\":12}"),
+            std::string::npos);
+  EXPECT_NE(text.find("\"name\":\"frame\",\"ts\":10033000,\"dur\":27000,\"cname\":\"good\""), std::string::npos);
+  EXPECT_NE(text.find("\"ph\":\"i\",\"pid\":1,\"tid\":2,\"name\":\"payload error\",\"ts\":10005000,\"s\":\"t\""),
+            std::string::npos);
+  EXPECT_NE(text.find("\"name\":\"packet_queue_depth\",\"ts\":10000000,\"args\":{\"value\":42}"), std::string::npos);
+  // Second frame: device clock advanced 35 ms while 33 ms passed on the host
+  EXPECT_NE(text.find("\"tid\":3,\"name\":\"pts\",\"ts\":10035000"), std::string::npos);
+  EXPECT_NE(text.find("\"name\":\"pts_drift_us\",\"ts\":10033000,\"args\":{\"drift\":2000}"), std::string::npos);
+  EXPECT_NE(text.find("\"name\":\"thread_name\",\"args\":{\"name\":\"Device time (PTS)\"}"), std::string::npos);
+}
+
+TEST(trace_export_test, checker_reports_finished_frames) {
+  ControlConfig::instance().set_frame_format("yuyv");
+  ControlConfig::instance().set_width(4);
+  ControlConfig::instance().set_height(2);
+  ControlConfig::instance().set_dwMaxPayloadTransferSize(1310720);
+  ControlConfig::instance().set_dwMaxVideoFrameSize(16777216);
+  ControlConfig::instance().set_dwTimeFrequency(1000000);
+
+  const std::string path = "trace_export_checker_test.json";
+  ASSERT_TRUE(TraceExporter::instance().open(path));
+  {
+    RunFlags flags;
+    UVCPHeaderChecker checker(flags);
+    auto current_time = std::chrono::steady_clock::now();
+
+    std::vector<u_char> frame = {0x02, 0b00000010};  // FID 0, EOF
+    frame.resize(2 + 4 * 2 * 2, 0x80);
+    EXPECT_EQ(checker.payload_valid_ctrl(frame, current_time), ERR_NO_ERROR);
+
+    std::vector<u_char> error_payload = {0x02, 0b01000001};  // FID 1, error bit
+    error_payload.resize(2 + 8, 0x80);
+    EXPECT_EQ(checker.payload_valid_ctrl(error_payload, current_time), ERR_ERR_BIT_SET);
+  }
+  TraceExporter::instance().close();
+
+  const std::string text = read_file(path);
+  std::remove(path.c_str());
+  EXPECT_NE(text.find("\"name\":\"frame\""), std::string::npos);
+  EXPECT_NE(text.find("\"name\":\"payload error\""), std::string::npos);
+  EXPECT_NE(text.find("\"args\":{\"error\":3,\"size\":10}"), std::string::npos);
+}
@@ -0,0 +1,346 @@
+// Microbenchmarks for the uvcfd hot paths (Google Benchmark)
+//
+//   cmake -S . -B build -DUVCFD_BUILD_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target uvcfd_bench
+//   ./build/tests/uvcfd_bench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// The run_uvcfd_bench target does the same with repetitions and writes
+// uvcfd_bench-<version>.json; compare two of them from the same machine with
+// benchmark's tools/compare.py.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "bench_stream.hpp"
+#include "frame_file.hpp"
+#include "frame_preview.hpp"
+#include "rgb_to_jpeg.hpp"
+#include "utils/hex_bytes.hpp"
+#include "utils/verbose.hpp"
+#include "validuvc/control_config.hpp"
+#include "validuvc/uvcpheader_checker.hpp"
+#include "yuyv_to_rgb.hpp"
+
+// An MJPEG frame saved from its iso payload chunks: 0 one ofstream write per chunk, 1 one writev
+void BM_write_mjpeg_frame(benchmark::State& state) {
+    const size_t frame_size = static_cast<size_t>(state.range(0)) * 1024;
+    std::vector<std::vector<u_char>> chunks;
+    for (size_t offset = 0; offset < frame_size; offset += kIsoPayloadData) {
+        chunks.emplace_back(std::min<size_t>(kIsoPayloadData, frame_size - offset), static_cast<u_char>(offset));
+    }
+    const std::string path = "uvcfd_bench_mjpeg_" + std::to_string(state.range(0)) + ".jpg";
+    for (auto _ : state) {
+        if (state.range(1) == 0) {
+            std::ofstream output_file(path, std::ios::binary);
+            for (const auto& chunk : chunks) {
+                output_file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+            }
+        } else {
+            benchmark::DoNotOptimize(write_frame_file(path, chunks));
+        }
+    }
+    std::remove(path.c_str());
+    state.SetLabel(state.range(1) == 0 ? "ofstream" : "writev");
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(frame_size));
+}
+// 4K MJPEG frames run from a few hundred KB to about 1.5 MB
+BENCHMARK(BM_write_mjpeg_frame)->ArgNames({"kb", "writev"})->ArgsProduct({{256, 1536}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+#ifdef UVCFD_BENCH_PACKET_HANDLER
+#include "moncapler.hpp"
+#endif
+
+#ifndef UVCFD_TEST_DATA_DIR
+#define UVCFD_TEST_DATA_DIR "../tests"
+#endif
+
+namespace {
+
+std::vector<u_char> make_yuyv(int width, int height) {
+    std::vector<u_char> yuyv(size_t(width) * height * 2);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 2) {
+            u_char* p = &yuyv[(size_t(y) * width + x) * 2];
+            p[0] = static_cast<u_char>(x + y);
+            p[1] = static_cast<u_char>(128 + (x >> 3));
+            p[2] = static_cast<u_char>(x + y + 1);
+            p[3] = static_cast<u_char>(128 - (y >> 3));
+        }
+    }
+    return yuyv;
+}
+
+std::vector<u_char> header_payload(uint8_t bfh) {
+    std::vector<u_char> payload = {0x0C, bfh, 0x10, 0x20, 0x30, 0x40, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    payload.resize(payload.size() + kIsoPayloadData, 0x80);
+    return payload;
+}
+
+void BM_parse_uvc_payload_header(benchmark::State& state) {
+    configure(1280, 720, BENCH_YUYV, kIsoPayloadData);
+    RunFlags flags;
+    UVCPHeaderChecker checker(flags);
+    const std::vector<u_char> payload = header_payload(0x8D);
+    const auto time = std::chrono::steady_clock::now();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(UVCPHeaderCheckerBench::parse(checker, payload, time));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_parse_uvc_payload_header);
+
+void BM_payload_header_valid(benchmark::State& state) {
+    configure(1280, 720, BENCH_YUYV, kIsoPayloadData);
+    RunFlags flags;
+    UVCPHeaderChecker checker(flags);
+    const auto time = std::chrono::steady_clock::now();
+    const UVC_Payload_Header previous_previous = UVCPHeaderCheckerBench::parse(checker, header_payload(0x8C), time);
+    const UVC_Payload_Header previous = UVCPHeaderCheckerBench::parse(checker, header_payload(0x8C), time);
+    const UVC_Payload_Header header = UVCPHeaderCheckerBench::parse(checker, header_payload(0x8C), time);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(UVCPHeaderCheckerBench::valid(checker, header, previous, previous_previous));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_payload_header_valid);
+
+// One iteration validates one full frame
+void BM_payload_valid_ctrl(benchmark::State& state) {
+    const BenchStream stream = static_cast<BenchStream>(state.range(0));
+    const int width = kResolutions[state.range(1)][0];
+    const int height = kResolutions[state.range(1)][1];
+    const BenchFormat format = static_cast<BenchFormat>(state.range(2));
+
+    configure(width, height, format, stream == STREAM_BULK ? kBulkPayloadData : kIsoPayloadData);
+    RunFlags flags;
+    UVCPHeaderChecker checker(flags);
+    SyntheticFrame frame = make_frame(stream, width, height, format);
+
+    auto time = std::chrono::steady_clock::now();
+    const auto payload_gap = std::chrono::microseconds(1000000 / kFps) / frame.payloads.size();
+    const uint32_t pts_step = kTimeFrequency / kFps;
+    uint32_t frame_id = 0;
+    uint32_t scr = 0;
+    size_t payload_index = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        frame.stamp(frame_id, frame_id * pts_step, scr);
+        state.ResumeTiming();
+        for (std::vector<u_char>& payload : frame.payloads) {
+            if (stream == STREAM_ERRORS && ++payload_index % kErrorEvery == 0) {
+                payload[1] |= 0x40;
+                benchmark::DoNotOptimize(checker.payload_valid_ctrl(payload, time));
+                payload[1] &= static_cast<u_char>(~0x40);
+            } else {
+                benchmark::DoNotOptimize(checker.payload_valid_ctrl(payload, time));
+            }
+            time += payload_gap;
+        }
+        ++frame_id;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(frame.bytes));
+    state.counters["payloads_per_frame"] = static_cast<double>(frame.payloads.size());
+}
+BENCHMARK(BM_payload_valid_ctrl)
+    ->ArgNames({"stream", "res", "mjpeg"})
+    ->ArgsProduct({{STREAM_BULK, STREAM_ISO, STREAM_ERRORS}, {0, 1, 2}, {BENCH_YUYV, BENCH_MJPEG}})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_hex_string_to_bytes_append(benchmark::State& state) {
+    // usb.capdata of one iso URB as tshark prints it
+    std::string hex;
+    for (int i = 0; i < 3072 * 32; ++i) {
+        static const char digits[] = "0123456789abcdef";
+        hex += digits[(i * 7) & 15];
+        hex += digits[(i * 13) & 15];
+    }
+    std::vector<u_char> out;
+    out.reserve(hex.size() / 2);
+    for (auto _ : state) {
+        out.clear();
+        hex_string_to_bytes_append(hex, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(hex.size()));
+}
+BENCHMARK(BM_hex_string_to_bytes_append);
+
+// res x kernel (YuyvRgbKernel) x threads, into a reused buffer as develope_yuyv_to_jpg does
+void BM_convertYUYVtoRGB(benchmark::State& state) {
+    const int width = kResolutions[state.range(0)][0];
+    const int height = kResolutions[state.range(0)][1];
+    const YuyvRgbKernel kernel = static_cast<YuyvRgbKernel>(state.range(1));
+    if (!set_yuyv_rgb_kernel(kernel)) {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    const std::vector<u_char> yuyv = make_yuyv(width, height);
+    std::vector<u_char> rgb;
+    state.SetLabel(yuyv_rgb_kernel_name(yuyv_rgb_kernel()));
+    for (auto _ : state) {
+        convertYUYVtoRGB(yuyv, width, height, rgb, static_cast<int>(state.range(2)));
+        benchmark::DoNotOptimize(rgb.data());
+    }
+    set_yuyv_rgb_kernel(YUYV_RGB_AUTO);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(yuyv.size()));
+}
+BENCHMARK(BM_convertYUYVtoRGB)
+    ->ArgNames({"res", "kernel", "threads"})
+    ->ArgsProduct({{0, 1, 2}, {YUYV_RGB_SCALAR, YUYV_RGB_AUTO}, {1}})
+    ->Args({2, YUYV_RGB_AUTO, 0})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_saveJPEG(benchmark::State& state) {
+    const int width = kResolutions[state.range(0)][0];
+    const int height = kResolutions[state.range(0)][1];
+    const std::vector<u_char> rgb = convertYUYVtoRGB(make_yuyv(width, height), width, height);
+    const std::string path = "uvcfd_bench_" + std::to_string(state.range(0)) + ".jpg";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(saveJPEG(rgb, width, height, path));
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_saveJPEG)->ArgName("res")->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Payload chunks of a YUYV frame to a JPEG file: 0 splits into 4:2:2 planes, 1 concatenates and goes through RGB
+void BM_yuyv_to_jpeg(benchmark::State& state) {
+    const int width = kResolutions[state.range(0)][0];
+    const int height = kResolutions[state.range(0)][1];
+    const std::vector<u_char> yuyv = make_yuyv(width, height);
+    std::vector<std::vector<u_char>> chunks;
+    for (size_t offset = 0; offset < yuyv.size(); offset += kIsoPayloadData) {
+        chunks.emplace_back(yuyv.begin() + offset, yuyv.begin() + std::min(yuyv.size(), offset + kIsoPayloadData));
+    }
+    const std::string path = "uvcfd_bench_yuyv_" + std::to_string(state.range(0)) + ".jpg";
+    const size_t pixels = size_t(width) * height;
+    std::vector<u_char> planes(pixels * 2);
+    std::vector<u_char> frame;
+    std::vector<u_char> rgb;
+    for (auto _ : state) {
+        if (state.range(1) == 0) {
+            splitYUYVtoPlanes(chunks, width, height, &planes[0], &planes[pixels], &planes[pixels * 3 / 2]);
+            const u_char* plane_pointers[3] = {&planes[0], &planes[pixels], &planes[pixels * 3 / 2]};
+            benchmark::DoNotOptimize(saveJPEGFromYUV422(plane_pointers, width, height, path));
+        } else {
+            frame.clear();
+            for (const auto& chunk : chunks) frame.insert(frame.end(), chunk.begin(), chunk.end());
+            convertYUYVtoRGB(frame, width, height, rgb);
+            benchmark::DoNotOptimize(saveJPEG(rgb, width, height, path));
+        }
+    }
+    std::remove(path.c_str());
+    state.SetLabel(state.range(1) == 0 ? "planes" : "rgb");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_yuyv_to_jpeg)->ArgNames({"res", "rgb"})->ArgsProduct({{0, 1, 2}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// GUI preview of an error frame: res x format (0 MJPEG, 1 YUYV) x scaled (0 full size, 1 to the default target)
+void BM_preview_frame(benchmark::State& state) {
+    const int width = kResolutions[state.range(0)][0];
+    const int height = kResolutions[state.range(0)][1];
+    const std::vector<u_char> yuyv = make_yuyv(width, height);
+    DevelopFrameFormat frame;
+    frame.frame_number = 0;
+    frame.width = width;
+    frame.height = height;
+    frame.error_frame = true;
+    std::vector<std::vector<u_char>> data;
+    if (state.range(1) == 0) {
+        JpegEncoder& encoder = JpegEncoder::thread_instance();
+        encoder.compress_rgb(convertYUYVtoRGB(yuyv, width, height).data(), width, height, JpegSettings{});
+        data.emplace_back(encoder.data(), encoder.data() + encoder.size());
+        frame.format = FRAME_FORMAT_MJPEG;
+    } else {
+        data.push_back(yuyv);
+        frame.format = FRAME_FORMAT_YUYV;
+    }
+
+    FramePreview& preview = FramePreview::instance();
+    preview.set_enabled(true);
+    // Full size 4K previews would add up to GBs in the cache
+    preview.cache.set_capacity(1);
+    if (state.range(2) == 0) {
+        preview.set_target_size(width, height);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(preview.publish(frame, data));
+        ++frame.frame_number;
+    }
+    preview.set_target_size(PREVIEW_TARGET_WIDTH, PREVIEW_TARGET_HEIGHT);
+    preview.cache.clear();
+    preview.cache.set_capacity(PREVIEW_CACHE_FRAMES);
+    state.SetLabel(std::string(state.range(1) == 0 ? "mjpeg" : "yuyv") + " 1/" +
+                   std::to_string(state.range(2) == 0 ? 1 : preview.scale_for(width, height)));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_preview_frame)->ArgNames({"res", "yuyv", "scaled"})->ArgsProduct({{0, 1, 2}, {0, 1}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+#ifdef UVCFD_BENCH_PACKET_HANDLER
+// Recorded usbmon URBs from tests/ (same files as test_packet_handler)
+const char* kRecordedUrbs[] = {"tph_iso_0.txt", "tph_iso_1.txt", "tph_bulk_0.txt", "tph_bulk_1.txt"};
+
+std::vector<u_char> read_urb(const std::string& filename) {
+    std::ifstream file(filename);
+    std::vector<u_char> data;
+    std::string hex_str;
+    while (file >> hex_str) {
+        data.push_back(static_cast<u_char>(std::stoul(hex_str, nullptr, 16)));
+    }
+    return data;
+}
+
+void BM_packet_handler(benchmark::State& state) {
+    const std::string filename = std::string(UVCFD_TEST_DATA_DIR) + "/" + kRecordedUrbs[state.range(0)];
+    std::vector<u_char> urb = read_urb(filename);
+    if (urb.empty()) {
+        state.SkipWithError(("cannot read " + filename).c_str());
+        return;
+    }
+    struct pcap_pkthdr pkthdr = {};
+    pkthdr.caplen = static_cast<bpf_u_int32>(urb.size());
+    pkthdr.len = static_cast<bpf_u_int32>(urb.size());
+    std::ofstream null_log;
+    target_busnum = -1;
+    target_devnum = -1;
+
+    for (auto _ : state) {
+        packet_handler(reinterpret_cast<u_char*>(&null_log), &pkthdr, urb.data());
+        // Nobody consumes here; drop the queued payloads before they pile up
+        if (packet_queue.size() > 4096) {
+            state.PauseTiming();
+            std::queue<std::vector<u_char>>().swap(packet_queue);
+            std::queue<uint64_t>().swap(packet_queue_ticks);
+            std::queue<std::chrono::time_point<std::chrono::steady_clock>>().swap(time_records);
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(urb.size()));
+}
+BENCHMARK(BM_packet_handler)->ArgName("urb")->DenseRange(0, 3);
+#endif
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Keep the console out of the measurement
+    VerboseStream::verbose_level = 0;
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
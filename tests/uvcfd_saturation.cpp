@@ -0,0 +1,516 @@
+// End to end saturation finder
+//
+// Replays a synthetic or recorded stream through the same pipeline the capture
+// tools run (capture thread -> packet queue -> checker -> develop queue) at
+// rising frame rates and reports, per pipeline mode, the highest rate at which
+// the injector keeps up, no payload is dropped and no queue keeps growing.
+//
+//   uvcfd_saturation -mode all -fw 1920 -fh 1080 -ff yuyv -stream iso -out capacity.json
+//   uvcfd_saturation -in payloads.txt -fw 1280 -fh 720 -ff mjpeg -mode threaded -develop 1
+//
+// Modes:
+//   inline    the injecting thread validates each payload itself
+//   threaded  injector -> packet queue -> checker thread (uvcfd / uvc_frame_detector)
+//   header    threaded, but the consumer only parses and checks the payload header
+//
+// -in takes one payload per line as hex text (tshark usb.capdata). -ingest tshark
+// hex encodes the stream up front and decodes it on the injector, like uvcfd's
+// capture thread does. -develop 1 turns on image capture of valid frames and
+// runs the develop worker pool writing ./images/, as the tools do. The pool
+// blocks the checker when full unless -dpolicy says otherwise; a dropped frame
+// fails the trial.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_stream.hpp"
+#include "develope_photo.hpp"
+#include "utils/hex_bytes.hpp"
+#include "utils/verbose.hpp"
+
+#ifndef UVCFD_VERSION
+#define UVCFD_VERSION "unknown"
+#endif
+
+namespace {
+
+enum PipelineMode { MODE_INLINE = 0, MODE_THREADED = 1, MODE_HEADER_ONLY = 2 };
+const char* const kModeNames[] = {"inline", "threaded", "header"};
+
+struct Options {
+    std::vector<PipelineMode> modes = {MODE_INLINE, MODE_THREADED, MODE_HEADER_ONLY};
+    int width = 1280;
+    int height = 720;
+    BenchFormat format = BENCH_YUYV;
+    BenchStream stream = STREAM_ISO;
+    std::string input;
+    bool tshark_ingest = false;
+    bool develop = false;
+    int develop_workers = 0;        // 0: the tools' default for this host
+    size_t develop_capacity = DEVELOP_QUEUE_DEFAULT_CAPACITY;
+    DevelopDropPolicy develop_policy = DEVELOP_BLOCK;
+    double start_fps = 30;
+    double max_fps = 7680;
+    double precision = 0.05;        // stop bisecting when hi / lo < 1 + precision
+    double duration_s = 2.0;
+    size_t queue_limit = 1 << 20;   // payloads; a push beyond it is a drop
+    std::string out;
+};
+
+// The stream as the injector sees it; frames are replayed in a loop
+struct ReplayStream {
+    std::vector<std::vector<u_char>> payloads;
+    std::vector<std::string> hex_payloads;   // -ingest tshark
+    double payloads_per_frame = 1;
+    uint64_t bytes = 0;
+    bool restamp = false;                    // synthetic: rewrite FID / PTS per replayed frame
+};
+
+struct Trial {
+    double fps = 0;
+    double target_payload_rate = 0;
+    double achieved_payload_rate = 0;
+    size_t max_queue_depth = 0;
+    size_t end_queue_depth = 0;
+    size_t end_develop_depth = 0;
+    uint64_t develop_dropped = 0;
+    uint64_t injected = 0;
+    uint64_t dropped = 0;
+    uint64_t frames_validated = 0;
+    bool passed = false;
+    std::string reason;
+};
+
+struct ModeResult {
+    PipelineMode mode;
+    double max_sustained_fps = 0;
+    std::vector<Trial> trials;
+};
+
+bool load_recording(const std::string& path, ReplayStream& stream) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    uint64_t frames = 0;
+    while (std::getline(file, line)) {
+        line.erase(std::remove_if(line.begin(), line.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)) || c == ':'; }),
+                   line.end());
+        if (line.size() < 4) {
+            continue;
+        }
+        std::vector<u_char> payload;
+        hex_string_to_bytes_append(line, payload);
+        if (payload.size() >= 2 && (payload[1] & 0x02)) {
+            ++frames;
+        }
+        stream.bytes += payload.size();
+        stream.payloads.push_back(std::move(payload));
+    }
+    stream.payloads_per_frame = frames > 0 ? static_cast<double>(stream.payloads.size()) / frames : 1.0;
+    return !stream.payloads.empty();
+}
+
+void build_synthetic(const Options& options, ReplayStream& stream) {
+    SyntheticFrame frame = make_frame(options.stream, options.width, options.height, options.format);
+    uint32_t scr = 0;
+    frame.stamp(0, 0, scr);
+    stream.payloads = frame.payloads;
+    stream.payloads_per_frame = static_cast<double>(frame.payloads.size());
+    stream.bytes = frame.bytes;
+    stream.restamp = true;
+}
+
+std::string to_hex(const std::vector<u_char>& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (u_char b : bytes) {
+        hex += digits[b >> 4];
+        hex += digits[b & 15];
+    }
+    return hex;
+}
+
+// Synthetic frames get a fresh FID / PTS / SCR each time round the loop
+void restamp(std::vector<u_char>& payload, uint64_t frame_id, uint32_t pts, uint32_t scr) {
+    if (payload.size() < kHeaderLength || payload[0] != kHeaderLength) {
+        return;
+    }
+    payload[1] = static_cast<u_char>((payload[1] & ~0x01) | (frame_id & 1));
+    for (int b = 0; b < 4; ++b) payload[2 + b] = static_cast<u_char>(pts >> (8 * b));
+    for (int b = 0; b < 4; ++b) payload[6 + b] = static_cast<u_char>(scr >> (8 * b));
+}
+
+// Packet queue between the injector (capture thread) and the consumer (process thread)
+struct PacketQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::queue<std::vector<u_char>> payloads;
+    std::queue<std::chrono::steady_clock::time_point> times;
+    bool stop = false;
+    size_t max_depth = 0;
+};
+
+Trial run_trial(PipelineMode mode, double fps, const ReplayStream& stream, const Options& options) {
+    Trial trial;
+    trial.fps = fps;
+    trial.target_payload_rate = fps * stream.payloads_per_frame;
+
+    configure(options.width, options.height, options.format,
+              options.stream == STREAM_BULK ? kBulkPayloadData : kIsoPayloadData,
+              std::max(1, static_cast<int>(fps + 0.5)));
+
+    RunFlags flags;
+    flags.capture_image_flag = options.develop;
+    flags.capture_valid_flag = options.develop;
+    UVCPHeaderChecker checker(flags);
+
+    PacketQueue queue;
+
+    std::thread consumer;
+    if (mode != MODE_INLINE) {
+        consumer = std::thread([&]() {
+            UVC_Payload_Header previous{};
+            UVC_Payload_Header previous_previous{};
+            while (true) {
+                std::unique_lock<std::mutex> lock(queue.mutex);
+                queue.cv.wait(lock, [&] { return !queue.payloads.empty() || queue.stop; });
+                if (queue.payloads.empty()) {
+                    break;
+                }
+                std::vector<u_char> payload = std::move(queue.payloads.front());
+                queue.payloads.pop();
+                auto received_time = queue.times.front();
+                queue.times.pop();
+                lock.unlock();
+
+                if (mode == MODE_HEADER_ONLY) {
+                    UVC_Payload_Header header = UVCPHeaderCheckerBench::parse(checker, payload, received_time);
+                    UVCPHeaderCheckerBench::valid(checker, header, previous, previous_previous);
+                    previous_previous = previous;
+                    previous = header;
+                } else {
+                    checker.payload_valid_ctrl(payload, received_time);
+                }
+            }
+        });
+    }
+
+    if (options.develop) {
+        DevFImage::instance().dev_f_image_queue.configure(options.develop_capacity, options.develop_policy);
+        DevFImage::instance().start_workers(options.develop_workers);
+    }
+
+    // Injector: paced against the wall clock, catching up in bursts when late
+    const auto interval = std::chrono::duration<double>(1.0 / trial.target_payload_rate);
+    const auto frame_interval = std::chrono::duration<double>(1.0 / fps);
+    const uint32_t pts_step = static_cast<uint32_t>(kTimeFrequency / fps);
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(options.duration_s));
+    const size_t ppf = std::max<size_t>(1, static_cast<size_t>(stream.payloads_per_frame + 0.5));
+    std::vector<u_char> payload;
+    uint64_t index = 0;
+    uint32_t scr = 0;
+
+    while (true) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= end) break;
+        const uint64_t due = static_cast<uint64_t>((now - start) / interval) + 1;
+        if (index >= due) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval * index));
+            continue;
+        }
+        for (; index < due; ++index) {
+            const size_t slot = index % stream.payloads.size();
+            if (options.tshark_ingest) {
+                payload.clear();
+                hex_string_to_bytes_append(stream.hex_payloads[slot], payload);
+            } else {
+                payload = stream.payloads[slot];
+            }
+            const uint64_t frame_id = index / ppf;
+            if (stream.restamp) {
+                restamp(payload, frame_id, static_cast<uint32_t>(frame_id * pts_step), scr);
+                scr += 1000;
+            }
+            const auto received_time = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                   frame_interval * static_cast<double>(frame_id) +
+                                                   interval * static_cast<double>(index % ppf));
+            if (mode == MODE_INLINE) {
+                checker.payload_valid_ctrl(payload, received_time);
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.payloads.size() >= options.queue_limit) {
+                    ++trial.dropped;
+                    continue;
+                }
+                queue.payloads.push(std::move(payload));
+                queue.times.push(received_time);
+                queue.max_depth = std::max(queue.max_depth, queue.payloads.size());
+            }
+            queue.cv.notify_one();
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    trial.injected = index;
+    trial.achieved_payload_rate = static_cast<double>(index) / elapsed;
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        trial.end_queue_depth = queue.payloads.size();
+        trial.max_queue_depth = queue.max_depth;
+        // Backlog left at the end is the verdict; do not wait for it to drain
+        std::queue<std::vector<u_char>>().swap(queue.payloads);
+        std::queue<std::chrono::steady_clock::time_point>().swap(queue.times);
+        queue.stop = true;
+    }
+    queue.cv.notify_all();
+    if (consumer.joinable()) consumer.join();
+    const DevelopQueueStats develop = DevFImage::instance().dev_f_image_queue.stats();
+    trial.end_develop_depth = develop.depth;
+    trial.develop_dropped = develop.dropped;
+    DevFImage::instance().stop_workers(false);
+    trial.frames_validated = UVCPHeaderCheckerBench::finished_frames(checker);
+
+    // Queue slack: a couple of frames in flight is normal, a backlog that grew all trial is not
+    const size_t queue_slack = 2 * ppf + 64;
+    if (trial.achieved_payload_rate < trial.target_payload_rate * 0.98) {
+        trial.reason = "injector fell behind";
+    } else if (trial.dropped > 0) {
+        trial.reason = "payloads dropped";
+    } else if (trial.end_queue_depth > queue_slack) {
+        trial.reason = "packet queue growing";
+    } else if (trial.develop_dropped > 0) {
+        trial.reason = "develop frames dropped";
+    } else if (options.develop && trial.end_develop_depth >= options.develop_capacity) {
+        trial.reason = "develop queue full";
+    } else {
+        trial.passed = true;
+    }
+    return trial;
+}
+
+ModeResult find_saturation(PipelineMode mode, const ReplayStream& stream, const Options& options) {
+    ModeResult result;
+    result.mode = mode;
+    auto run = [&](double fps) {
+        Trial trial = run_trial(mode, fps, stream, options);
+        std::fprintf(stderr, "[%s] %8.1f fps  %10.0f payloads/s  max queue %zu  %s\n", kModeNames[mode], fps,
+                     trial.achieved_payload_rate, trial.max_queue_depth,
+                     trial.passed ? "ok" : trial.reason.c_str());
+        result.trials.push_back(trial);
+        return trial.passed;
+    };
+
+    double lo = 0;
+    double hi = 0;
+    double fps = options.start_fps;
+    // Ramp: double until a rate fails (or halve until one passes)
+    if (run(fps)) {
+        lo = fps;
+        while (fps * 2 <= options.max_fps) {
+            fps *= 2;
+            if (!run(fps)) {
+                hi = fps;
+                break;
+            }
+            lo = fps;
+        }
+    } else {
+        hi = fps;
+        while (fps / 2 >= 1) {
+            fps /= 2;
+            if (run(fps)) {
+                lo = fps;
+                break;
+            }
+            hi = fps;
+        }
+    }
+    // Bisect between the last rate that held and the first that did not
+    while (lo > 0 && hi > 0 && hi / lo > 1 + options.precision) {
+        const double mid = (lo + hi) / 2;
+        if (run(mid)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    result.max_sustained_fps = lo;
+    return result;
+}
+
+std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string report_json(const Options& options, const ReplayStream& stream, const std::vector<ModeResult>& results) {
+    std::ostringstream out;
+    out.precision(6);
+    out << "{\n";
+    out << "  \"uvcfd_version\": " << json_string(UVCFD_VERSION) << ",\n";
+    out << "  \"host\": {\"hardware_concurrency\": " << std::thread::hardware_concurrency() << "},\n";
+    out << "  \"stream\": {\"source\": " << json_string(options.input.empty() ? "synthetic" : options.input)
+        << ", \"width\": " << options.width << ", \"height\": " << options.height
+        << ", \"format\": " << json_string(options.format == BENCH_YUYV ? "yuyv" : "mjpeg")
+        << ", \"transfer\": " << json_string(options.stream == STREAM_BULK ? "bulk" : "iso")
+        << ", \"payloads_per_frame\": " << stream.payloads_per_frame
+        << ", \"bytes_per_frame\": " << static_cast<double>(stream.bytes) / (stream.payloads.size() / stream.payloads_per_frame)
+        << ", \"ingest\": " << json_string(options.tshark_ingest ? "tshark" : "raw")
+        << ", \"develop\": " << (options.develop ? "true" : "false")
+        << ", \"develop_queue_frames\": " << options.develop_capacity
+        << ", \"develop_policy\": " << json_string(develop_drop_policy_name(options.develop_policy)) << "},\n";
+    out << "  \"trial_seconds\": " << options.duration_s << ",\n";
+    out << "  \"modes\": [\n";
+    for (size_t m = 0; m < results.size(); ++m) {
+        const ModeResult& r = results[m];
+        const double bytes_per_frame = static_cast<double>(stream.bytes) / (stream.payloads.size() / stream.payloads_per_frame);
+        out << "    {\"mode\": " << json_string(kModeNames[r.mode])
+            << ", \"max_sustained_fps\": " << r.max_sustained_fps
+            << ", \"max_sustained_payloads_per_second\": " << r.max_sustained_fps * stream.payloads_per_frame
+            << ", \"max_sustained_mbps\": " << r.max_sustained_fps * bytes_per_frame * 8 / 1e6
+            << ",\n     \"trials\": [\n";
+        for (size_t t = 0; t < r.trials.size(); ++t) {
+            const Trial& trial = r.trials[t];
+            out << "       {\"fps\": " << trial.fps << ", \"target_payloads_per_second\": " << trial.target_payload_rate
+                << ", \"achieved_payloads_per_second\": " << trial.achieved_payload_rate
+                << ", \"injected\": " << trial.injected << ", \"dropped\": " << trial.dropped
+                << ", \"max_queue_depth\": " << trial.max_queue_depth
+                << ", \"end_queue_depth\": " << trial.end_queue_depth
+                << ", \"end_develop_depth\": " << trial.end_develop_depth
+                << ", \"develop_dropped\": " << trial.develop_dropped
+                << ", \"frames_validated\": " << trial.frames_validated
+                << ", \"passed\": " << (trial.passed ? "true" : "false")
+                << ", \"reason\": " << json_string(trial.reason) << "}"
+                << (t + 1 < r.trials.size() ? ",\n" : "\n");
+        }
+        out << "     ]}" << (m + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " [-mode inline|threaded|header|all] [-fw frame_width] [-fh frame_height] [-ff yuyv|mjpeg]"
+                 " [-stream iso|bulk] [-in payloads.txt] [-ingest raw|tshark] [-develop 0|1]"
+                 " [-dw develop_workers] [-dq develop_queue_frames] [-dpolicy block|newest|oldest|errors]"
+                 " [-start fps] [-max fps] [-duration seconds] [-queue-limit payloads] [-out report.json]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[i + 1];
+        if (std::strcmp(argv[i], "-mode") == 0) {
+            if (value == "all") options.modes = {MODE_INLINE, MODE_THREADED, MODE_HEADER_ONLY};
+            else if (value == "inline") options.modes = {MODE_INLINE};
+            else if (value == "threaded") options.modes = {MODE_THREADED};
+            else if (value == "header") options.modes = {MODE_HEADER_ONLY};
+            else { usage(argv[0]); return 1; }
+        } else if (std::strcmp(argv[i], "-fw") == 0) {
+            options.width = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-fh") == 0) {
+            options.height = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-ff") == 0) {
+            options.format = value == "mjpeg" ? BENCH_MJPEG : BENCH_YUYV;
+        } else if (std::strcmp(argv[i], "-stream") == 0) {
+            options.stream = value == "bulk" ? STREAM_BULK : STREAM_ISO;
+        } else if (std::strcmp(argv[i], "-in") == 0) {
+            options.input = value;
+        } else if (std::strcmp(argv[i], "-ingest") == 0) {
+            options.tshark_ingest = value == "tshark";
+        } else if (std::strcmp(argv[i], "-develop") == 0) {
+            options.develop = std::atoi(value.c_str()) != 0;
+        } else if (std::strcmp(argv[i], "-dw") == 0) {
+            options.develop_workers = std::atoi(value.c_str());
+        } else if (std::strcmp(argv[i], "-dq") == 0) {
+            options.develop_capacity = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (std::strcmp(argv[i], "-dpolicy") == 0) {
+            if (!parse_develop_drop_policy(value.c_str(), options.develop_policy)) { usage(argv[0]); return 1; }
+        } else if (std::strcmp(argv[i], "-start") == 0) {
+            options.start_fps = std::atof(value.c_str());
+        } else if (std::strcmp(argv[i], "-max") == 0) {
+            options.max_fps = std::atof(value.c_str());
+        } else if (std::strcmp(argv[i], "-duration") == 0) {
+            options.duration_s = std::atof(value.c_str());
+        } else if (std::strcmp(argv[i], "-queue-limit") == 0) {
+            options.queue_limit = static_cast<size_t>(std::atoll(value.c_str()));
+        } else if (std::strcmp(argv[i], "-out") == 0) {
+            options.out = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.start_fps <= 0 || options.duration_s <= 0 || options.width <= 0 || options.height <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    VerboseStream::verbose_level = 0;
+
+    ReplayStream stream;
+    if (!options.input.empty()) {
+        if (!load_recording(options.input, stream)) {
+            std::cerr << "cannot read payloads from " << options.input << std::endl;
+            return 1;
+        }
+    } else {
+        build_synthetic(options, stream);
+    }
+    if (options.tshark_ingest) {
+        for (const auto& payload : stream.payloads) {
+            stream.hex_payloads.push_back(to_hex(payload));
+        }
+    }
+    if (options.develop) {
+        std::filesystem::create_directories("images");
+    }
+
+    std::vector<ModeResult> results;
+    for (PipelineMode mode : options.modes) {
+        results.push_back(find_saturation(mode, stream, options));
+    }
+
+    const std::string report = report_json(options, stream, results);
+    if (options.out.empty()) {
+        std::cout << report;
+    } else {
+        std::ofstream file(options.out);
+        file << report;
+        std::cerr << "report written to " << options.out << std::endl;
+    }
+    return 0;
+}
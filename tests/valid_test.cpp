@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <thread>
 
 #include "validuvc/uvcpheader_checker.hpp"
 #include "validuvc/control_config.hpp"
@@ -272,6 +273,131 @@ TEST_F(uvc_header_checker_test, max_payload_overflow_test) {
   EXPECT_EQ(valid_err, ERR_MAX_PAYLAOD_OVERFLOW);  // Expect error
 }
 
+// Two checkers in one process must not share previous header state
+TEST(uvc_checker_context_test, checkers_keep_separate_history) {
+  ControlConfig::instance().set_width(1280);
+  ControlConfig::instance().set_height(720);
+  ControlConfig::instance().set_frame_format("mjpeg");
+  ControlConfig::instance().set_fps(30);
+  ControlConfig::instance().set_dwMaxPayloadTransferSize(1310720);
+  ControlConfig::instance().set_dwMaxVideoFrameSize(16777216);
+  ControlConfig::instance().set_dwTimeFrequency(1000000);
+
+  RunFlags flags_a;
+  RunFlags flags_b;
+  UVCPHeaderChecker checker_a(flags_a);
+  UVCPHeaderChecker checker_b(flags_b);
+
+  std::vector<u_char> eof_packet = {
+      0x02, 0b00000010,                    // HLE and BFH (FID 0, EOF)
+      0xff, 0xd8, 0xff, 0xd9,
+  };
+
+  auto current_time = std::chrono::steady_clock::now();
+  EXPECT_EQ(checker_a.payload_valid_ctrl(eof_packet, current_time), ERR_NO_ERROR);
+  // Same FID right after an EOF is a mismatch for checker_a only
+  EXPECT_EQ(checker_a.payload_valid_ctrl(eof_packet, current_time), ERR_FID_MISMATCH);
+  EXPECT_EQ(checker_b.payload_valid_ctrl(eof_packet, current_time), ERR_NO_ERROR);
+
+  EXPECT_TRUE(checker_a.run_flags().filter_on_off_flag);
+  flags_b.filter_on_off_flag = false;
+  EXPECT_TRUE(checker_a.run_flags().filter_on_off_flag);
+  EXPECT_FALSE(checker_b.run_flags().filter_on_off_flag);
+}
+
+// Setters racing on different fields must both land in the final version
+TEST(control_config_test, concurrent_setters_keep_both_changes) {
+  for (int round = 1; round <= 200; ++round) {
+    std::thread width_setter([round] { ControlConfig::instance().set_width(round); });
+    std::thread height_setter([round] { ControlConfig::instance().set_height(round + 1000); });
+    width_setter.join();
+    height_setter.join();
+    ASSERT_EQ(ControlConfig::instance().get_width(), round);
+    ASSERT_EQ(ControlConfig::instance().get_height(), round + 1000);
+  }
+}
+
+// A resolution change mid frame must not fail the frame that started under the old one
+TEST(uvc_checker_context_test, frame_keeps_config_version) {
+  ControlConfig::instance().set_frame_format("yuyv");
+  ControlConfig::instance().set_width(4);
+  ControlConfig::instance().set_height(2);
+  ControlConfig::instance().set_dwMaxPayloadTransferSize(1310720);
+  ControlConfig::instance().set_dwMaxVideoFrameSize(16777216);
+  ControlConfig::instance().set_dwTimeFrequency(1000000);
+  uint64_t old_version = ControlConfig::instance().get_version();
+
+  RunFlags flags;
+  UVCPHeaderChecker checker(flags);
+  auto current_time = std::chrono::steady_clock::now();
+
+  std::vector<u_char> first_half = {0x02, 0b00000000};   // FID 0
+  std::vector<u_char> second_half = {0x02, 0b00000010};  // FID 0, EOF
+  first_half.resize(2 + 8, 0x80);
+  second_half.resize(2 + 8, 0x80);
+
+  EXPECT_EQ(checker.payload_valid_ctrl(first_half, current_time), ERR_NO_ERROR);
+
+  ControlConfig::instance().set_width(8);
+  ControlConfig::instance().set_height(4);
+  EXPECT_NE(ControlConfig::instance().get_version(), old_version);
+
+  EXPECT_EQ(checker.payload_valid_ctrl(second_half, current_time), ERR_NO_ERROR);
+  ASSERT_FALSE(checker.processed_frames.empty());
+  EXPECT_EQ(checker.processed_frames.back()->frame_error, ERR_FRAME_NO_ERROR);
+  EXPECT_LE(checker.processed_frames.back()->config_version, old_version);
+  EXPECT_EQ(checker.processed_frames.back()->frame_width, 4);
+
+  // The next frame is checked against 8 x 4
+  std::vector<u_char> next_frame = {0x02, 0b00000011};   // FID 1, EOF
+  next_frame.resize(2 + 8 * 4 * 2, 0x80);
+  EXPECT_EQ(checker.payload_valid_ctrl(next_frame, current_time), ERR_NO_ERROR);
+  EXPECT_EQ(checker.processed_frames.back()->frame_error, ERR_FRAME_NO_ERROR);
+  EXPECT_EQ(checker.processed_frames.back()->frame_width, 8);
+}
+
+// Payload bytes are only copied while someone wants the frame's category
+TEST(uvc_checker_context_test, payload_kept_only_on_demand) {
+  ControlConfig::instance().set_frame_format("mjpeg");
+  ControlConfig::instance().set_width(1280);
+  ControlConfig::instance().set_height(720);
+  ControlConfig::instance().set_dwMaxPayloadTransferSize(1310720);
+  ControlConfig::instance().set_dwMaxVideoFrameSize(16777216);
+  ControlConfig::instance().set_dwTimeFrequency(1000000);
+
+  RunFlags flags;
+  UVCPHeaderChecker checker(flags);
+  auto current_time = std::chrono::steady_clock::now();
+
+  std::vector<u_char> open_0 = {0x02, 0b00000000, 0xff, 0xd8};   // FID 0
+  std::vector<u_char> close_0 = {0x02, 0b00000010, 0xff, 0xd9};  // FID 0, EOF
+  std::vector<u_char> open_1 = {0x02, 0b00000001, 0xff, 0xd8};   // FID 1
+  std::vector<u_char> close_1 = {0x02, 0b00000011, 0xff, 0xd9};  // FID 1, EOF
+
+  // Every capture button off: metadata only
+  EXPECT_EQ(checker.payload_valid_ctrl(open_0, current_time), ERR_NO_ERROR);
+  ASSERT_FALSE(checker.frames.empty());
+  EXPECT_EQ(checker.frames.back()->payload_demand, 0u);
+  EXPECT_TRUE(checker.frames.back()->payload_datas.empty());
+  EXPECT_EQ(checker.frames.back()->payload_sizes.size(), 1u);
+  EXPECT_EQ(checker.payload_valid_ctrl(close_0, current_time), ERR_NO_ERROR);
+
+  // A registered consumer makes the next frame keep its bytes until it finishes
+  PayloadDemand::instance().add(1u << CAPTURE_VALID);
+  EXPECT_EQ(checker.payload_valid_ctrl(open_1, current_time), ERR_NO_ERROR);
+  EXPECT_EQ(checker.frames.back()->payload_demand, 1u << CAPTURE_VALID);
+  EXPECT_EQ(checker.frames.back()->payload_datas.size(), 1u);
+  EXPECT_EQ(checker.payload_valid_ctrl(close_1, current_time), ERR_NO_ERROR);
+  PayloadDemand::instance().remove(1u << CAPTURE_VALID);
+  EXPECT_EQ(PayloadDemand::instance().mask(), 0u);
+
+  ASSERT_EQ(checker.processed_frames.size(), 2u);
+  for (const auto& frame : checker.processed_frames) {
+    EXPECT_TRUE(frame->payload_datas.empty());
+    EXPECT_EQ(frame->payload_sizes.size(), 2u);
+  }
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "rgb_to_jpeg.hpp"
+#include "yuyv_to_rgb.hpp"
+
+namespace {
+
+// The conversion as it was before the SIMD kernels; reference images were made with it
+std::vector<u_char> reference_rgb(const std::vector<u_char>& yuyv, int width, int height) {
+  std::vector<u_char> rgb(size_t(width) * height * 3);
+  for (size_t i = 0; i < size_t(width) * height / 2; ++i) {
+    int y0 = yuyv[i * 4 + 0] - 16;
+    int u = yuyv[i * 4 + 1] - 128;
+    int y1 = yuyv[i * 4 + 2] - 16;
+    int v = yuyv[i * 4 + 3] - 128;
+    int c0 = 298 * y0, c1 = 298 * y1;
+    int d = 409 * v + 128, e = -100 * u + 128, f = -208 * v + 128, g = 516 * u + 128;
+    u_char* p = &rgb[i * 6];
+    p[0] = std::clamp((c0 + d) >> 8, 0, 255);
+    p[1] = std::clamp((c0 + e + f) >> 8, 0, 255);
+    p[2] = std::clamp((c0 + g) >> 8, 0, 255);
+    p[3] = std::clamp((c1 + d) >> 8, 0, 255);
+    p[4] = std::clamp((c1 + e + f) >> 8, 0, 255);
+    p[5] = std::clamp((c1 + g) >> 8, 0, 255);
+  }
+  return rgb;
+}
+
+std::vector<u_char> random_yuyv(int width, int height, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<u_char> yuyv(size_t(width) * height * 2);
+  for (auto& byte : yuyv) byte = static_cast<u_char>(rng());
+  return yuyv;
+}
+
+std::vector<YuyvRgbKernel> available_kernels() {
+  std::vector<YuyvRgbKernel> kernels;
+  for (YuyvRgbKernel kernel : {YUYV_RGB_SCALAR, YUYV_RGB_SSE2, YUYV_RGB_AVX2, YUYV_RGB_NEON}) {
+    if (set_yuyv_rgb_kernel(kernel)) kernels.push_back(kernel);
+  }
+  set_yuyv_rgb_kernel(YUYV_RGB_AUTO);
+  return kernels;
+}
+
+}  // namespace
+
+TEST(yuyv_to_rgb_test, every_kernel_matches_the_scalar_conversion) {
+  // Every U / V pair with Y at the ends of the range and in the middle
+  std::vector<u_char> all_chroma;
+  for (int u = 0; u < 256; ++u) {
+    for (int v = 0; v < 256; ++v) {
+      for (int y : {0, 16, 17, 128, 235, 255}) {
+        all_chroma.insert(all_chroma.end(), {u_char(y), u_char(u), u_char(255 - y), u_char(v)});
+      }
+    }
+  }
+  const int chroma_width = 256 * 6 * 2;
+
+  for (YuyvRgbKernel kernel : available_kernels()) {
+    ASSERT_TRUE(set_yuyv_rgb_kernel(kernel));
+    EXPECT_EQ(convertYUYVtoRGB(all_chroma, chroma_width, 256), reference_rgb(all_chroma, chroma_width, 256))
+        << yuyv_rgb_kernel_name(kernel);
+
+    // Widths that leave tails of every length after the vector loops
+    for (int width = 2; width <= 70; width += 2) {
+      const std::vector<u_char> yuyv = random_yuyv(width, 3, width);
+      EXPECT_EQ(convertYUYVtoRGB(yuyv, width, 3), reference_rgb(yuyv, width, 3))
+          << yuyv_rgb_kernel_name(kernel) << " width " << width;
+    }
+  }
+  set_yuyv_rgb_kernel(YUYV_RGB_AUTO);
+}
+
+TEST(yuyv_to_rgb_test, row_bands_and_reused_buffers_give_the_same_image) {
+  const int width = 1280, height = 722;
+  const std::vector<u_char> yuyv = random_yuyv(width, height, 11);
+  const std::vector<u_char> expected = reference_rgb(yuyv, width, height);
+
+  std::vector<u_char> rgb(size_t(width) * height * 3, 0xAA);
+  for (int threads : {1, 2, 3, 4, 0}) {
+    convertYUYVtoRGB(yuyv, width, height, rgb, threads);
+    EXPECT_EQ(rgb, expected) << threads << " threads";
+  }
+
+  // A short frame converts what is there and leaves the rest black
+  const std::vector<u_char> half(yuyv.begin(), yuyv.begin() + yuyv.size() / 2);
+  convertYUYVtoRGB(half, width, height, rgb);
+  EXPECT_TRUE(std::equal(rgb.begin(), rgb.begin() + expected.size() / 2, expected.begin()));
+  EXPECT_TRUE(std::all_of(rgb.begin() + expected.size() / 2, rgb.end(), [](u_char c) { return c == 0; }));
+}
+
+TEST(yuyv_to_rgb_test, planes_are_split_across_payload_boundaries) {
+  const int width = 640, height = 9;
+  const std::vector<u_char> yuyv = random_yuyv(width, height, 5);
+  const size_t pixels = size_t(width) * height;
+  // Studio range expanded to full range, luma with the 298 / 256 scale of the RGB conversion
+  auto luma = [](int value) { return u_char(std::clamp(((value - 16) * 298 + 128) >> 8, 0, 255)); };
+  auto chroma = [](int value) { return u_char(std::clamp((((value - 128) * 146 + 64) >> 7) + 128, 0, 255)); };
+  std::vector<u_char> expected(pixels * 2);
+  for (size_t i = 0; i < pixels / 2; ++i) {
+    expected[i * 2] = luma(yuyv[i * 4]);
+    expected[pixels + i] = chroma(yuyv[i * 4 + 1]);
+    expected[i * 2 + 1] = luma(yuyv[i * 4 + 2]);
+    expected[pixels + pixels / 2 + i] = chroma(yuyv[i * 4 + 3]);
+  }
+
+  // Payload sizes that cut macropixels anywhere, plus a payload too short to finish one
+  std::vector<std::vector<u_char>> chunks;
+  const size_t sizes[] = {3, 1, 2, 1, 1, 997, 3066, 5, 1023};
+  size_t offset = 0;
+  for (size_t k = 0; offset < yuyv.size(); ++k) {
+    const size_t size = std::min(sizes[k % 9], yuyv.size() - offset);
+    chunks.emplace_back(yuyv.begin() + offset, yuyv.begin() + offset + size);
+    offset += size;
+  }
+
+  for (YuyvRgbKernel kernel : available_kernels()) {
+    ASSERT_TRUE(set_yuyv_rgb_kernel(kernel));
+    std::vector<u_char> planes(pixels * 2, 0xAA);
+    EXPECT_EQ(splitYUYVtoPlanes(chunks, width, height, &planes[0], &planes[pixels], &planes[pixels * 3 / 2]), yuyv.size());
+    EXPECT_EQ(planes, expected) << yuyv_rgb_kernel_name(kernel);
+
+    // Short frame: the missing tail reads as zero bytes, as the RGB path pads it
+    std::vector<std::vector<u_char>> half(chunks.begin(), chunks.begin() + chunks.size() / 2);
+    const size_t taken = splitYUYVtoPlanes(half, width, height, &planes[0], &planes[pixels], &planes[pixels * 3 / 2]);
+    std::vector<u_char> padded(yuyv.begin(), yuyv.begin() + taken);
+    padded.resize(yuyv.size(), 0);
+    std::vector<std::vector<u_char>> whole = {padded};
+    std::vector<u_char> expected_short(pixels * 2);
+    splitYUYVtoPlanes(whole, width, height, &expected_short[0], &expected_short[pixels], &expected_short[pixels * 3 / 2]);
+    EXPECT_EQ(planes, expected_short) << yuyv_rgb_kernel_name(kernel);
+  }
+  set_yuyv_rgb_kernel(YUYV_RGB_AUTO);
+}
+
+TEST(yuyv_to_rgb_test, downscale_is_a_box_filter_on_every_kernel) {
+  // Odd sizes leave partial blocks on the right and bottom edge, which are dropped
+  const int width = 1286;
+  const int height = 725;
+  const std::vector<u_char> yuyv = random_yuyv(width, height, 11);
+
+  for (int factor : {2, 4, 8}) {
+    const int out_width = downscaled_yuyv_width(width, factor);
+    const int out_height = height / factor;
+    ASSERT_EQ(out_width % 2, 0);
+
+    // Straight from the definition: luma per output pixel, chroma per output macropixel
+    std::vector<u_char> expected(size_t(out_width) * out_height * 2);
+    const unsigned area = unsigned(factor * factor);
+    for (int row = 0; row < out_height; ++row) {
+      for (int x = 0; x < out_width; ++x) {
+        unsigned luma = 0, chroma = 0;
+        for (int r = 0; r < factor; ++r) {
+          const u_char* line = &yuyv[(size_t(row) * factor + r) * width * 2];
+          for (int p = 0; p < factor; ++p) {
+            luma += line[(size_t(x) * factor + p) * 2];
+            // x even carries U of its macropixel pair, x odd V
+            chroma += line[((size_t(x / 2) * factor + p) * 4) + (x % 2 ? 3 : 1)];
+          }
+        }
+        expected[(size_t(row) * out_width + x) * 2] = u_char((luma + area / 2) / area);
+        expected[(size_t(row) * out_width + x) * 2 + 1] = u_char((chroma + area / 2) / area);
+      }
+    }
+
+    for (YuyvRgbKernel kernel : available_kernels()) {
+      ASSERT_TRUE(set_yuyv_rgb_kernel(kernel));
+      std::vector<u_char> out(expected.size(), 0xAA);
+      downscaleYUYV(yuyv.data(), yuyv.size(), width, height, factor, out.data());
+      EXPECT_EQ(out, expected) << yuyv_rgb_kernel_name(kernel) << " 1/" << factor;
+    }
+  }
+  set_yuyv_rgb_kernel(YUYV_RGB_AUTO);
+}
+
+TEST(yuyv_to_rgb_test, downscale_of_a_short_frame_fills_with_zero) {
+  const int width = 64;
+  const int height = 32;
+  const std::vector<u_char> yuyv(size_t(width) * 2 * 8, 200);   // 8 of 32 rows arrived
+  std::vector<u_char> out(size_t(downscaled_yuyv_width(width, 4)) * (height / 4) * 2, 0xAA);
+  downscaleYUYV(yuyv.data(), yuyv.size(), width, height, 4, out.data());
+  const size_t row_bytes = size_t(downscaled_yuyv_width(width, 4)) * 2;
+  for (size_t i = 0; i < out.size(); ++i) {
+    ASSERT_EQ(out[i], i < row_bytes * 2 ? 200 : 0) << i;
+  }
+}
+
+TEST(yuyv_to_rgb_test, planes_jpeg_decodes_close_to_the_rgb_path) {
+  // Smooth gradient, so 4:2:2 chroma loses next to nothing
+  const int width = 320, height = 240;
+  std::vector<u_char> yuyv(size_t(width) * height * 2);
+  for (int row = 0; row < height; ++row) {
+    for (int x = 0; x < width; x += 2) {
+      u_char* p = &yuyv[(size_t(row) * width + x) * 2];
+      p[0] = p[2] = static_cast<u_char>(16 + (x + row) * 200 / (width + height));
+      p[1] = static_cast<u_char>(64 + x * 128 / width);
+      p[3] = static_cast<u_char>(64 + row * 128 / height);
+    }
+  }
+  const size_t pixels = size_t(width) * height;
+  std::vector<u_char> planes(pixels * 2);
+  splitYUYVtoPlanes({yuyv}, width, height, &planes[0], &planes[pixels], &planes[pixels * 3 / 2]);
+  const u_char* plane_pointers[3] = {&planes[0], &planes[pixels], &planes[pixels * 3 / 2]};
+
+  const std::string path = (std::filesystem::temp_directory_path() / "uvcfd_yuyv_planes.jpg").string();
+  ASSERT_TRUE(saveJPEGFromYUV422(plane_pointers, width, height, path));
+  std::ifstream file(path, std::ios::binary);
+  std::vector<u_char> jpeg((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::remove(path.c_str());
+
+  tjhandle decompressor = tjInitDecompress();
+  int jpeg_width = 0, jpeg_height = 0, subsampling = -1, colorspace = -1;
+  ASSERT_EQ(tjDecompressHeader3(decompressor, jpeg.data(), jpeg.size(), &jpeg_width, &jpeg_height, &subsampling, &colorspace), 0);
+  EXPECT_EQ(jpeg_width, width);
+  EXPECT_EQ(jpeg_height, height);
+  EXPECT_EQ(subsampling, TJSAMP_422);
+  std::vector<u_char> decoded(pixels * 3);
+  ASSERT_EQ(tjDecompress2(decompressor, jpeg.data(), jpeg.size(), decoded.data(), width, 0, height, TJPF_RGB, 0), 0);
+  tjDestroy(decompressor);
+
+  const std::vector<u_char> rgb = convertYUYVtoRGB(yuyv, width, height);
+  double error = 0;
+  for (size_t i = 0; i < rgb.size(); ++i) error += std::abs(int(rgb[i]) - int(decoded[i]));
+  EXPECT_LT(error / rgb.size(), 1.0);
+}